@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+const BenchSettings *bench_settings;
+static unsigned result_cnt;
+
+static double bench_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool bench_selected(const char *kernel, const char *resolution)
+{
+    if (bench_settings->kernel && strcmp(bench_settings->kernel, kernel))
+        return false;
+    if (bench_settings->resolution && resolution &&
+        strcmp(bench_settings->resolution, resolution))
+    {
+        return false;
+    }
+    return true;
+}
+
+int bench_run(BenchResult *result, int (*fn)(void *data), void *data)
+{
+    int err = fn(data);
+    if (err) return err;
+
+    unsigned long runs = 0;
+    const double start = bench_clock();
+    double elapsed;
+    do {
+        err = fn(data);
+        if (err) return err;
+        runs++;
+        elapsed = bench_clock() - start;
+    } while (runs < 3 || elapsed < bench_settings->min_time);
+
+    result->runs = runs;
+    result->seconds = elapsed;
+    return 0;
+}
+
+void bench_report(const BenchResult *r)
+{
+    const double per_run = r->seconds / r->runs;
+    printf("%s    {\"kernel\": \"%s\", \"isa\": \"%s\", ",
+           result_cnt++ ? ",\n" : "", r->kernel, r->isa);
+    if (r->w && r->h) {
+        printf("\"resolution\": \"%s\", \"bpc\": %u, \"width\": %u, "
+               "\"height\": %u, ", r->resolution, r->bpc, r->w, r->h);
+    }
+    printf("\"runs\": %lu, \"ns_per_frame\": %.0f", r->runs, per_run * 1e9);
+    if (r->w && r->h)
+        printf(", \"mpix_per_s\": %.3f", r->w * r->h / per_run * 1e-6);
+    printf("}");
+    fflush(stdout);
+
+    if (r->w && r->h) {
+        fprintf(stderr, "%-12s %-4s %-6s %2u-bit %12.3f us\n", r->kernel,
+                r->isa, r->resolution, r->bpc, per_run * 1e6);
+    } else {
+        fprintf(stderr, "%-12s %-4s %19.3f us\n", r->kernel, r->isa,
+                per_run * 1e6);
+    }
+}
+
+static void usage(const char *app)
+{
+    fprintf(stderr, "Usage: %s [options]\n\n"
+            "Runs libvmaf kernels on synthetic frames, results are written to\n"
+            "stdout as JSON.\n\n"
+            " --kernel $string:          run this kernel only\n"
+            " --resolution $string:      576p, 1080p or 2160p only\n"
+            " --min_time $seconds:       time spent per result (default 0.5)\n"
+            " --model $path:             libsvm model for svm_predict, e.g.\n"
+            "                            model/vmaf_v0.6.1.pkl.model\n",
+            app);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchSettings settings = { .min_time = 0.5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc) usage(argv[0]);
+        if (!strcmp(argv[i], "--kernel")) {
+            settings.kernel = argv[++i];
+        } else if (!strcmp(argv[i], "--resolution")) {
+            settings.resolution = argv[++i];
+        } else if (!strcmp(argv[i], "--model")) {
+            settings.model_path = argv[++i];
+        } else if (!strcmp(argv[i], "--min_time")) {
+            char *end;
+            settings.min_time = strtod(argv[++i], &end);
+            if (*end || settings.min_time < 0.) usage(argv[0]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    bench_settings = &settings;
+
+    printf("{\n  \"min_time\": %g,\n  \"results\": [\n", settings.min_time);
+    const int err = run_benchmarks();
+    printf("\n  ]\n}\n");
+
+    if (err) {
+        fprintf(stderr, "benchmark failed: %s\n", strerror(-err));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef __VMAF_BENCH_H__
+#define __VMAF_BENCH_H__
+
+#include <stdbool.h>
+
+/*
+ * Each benchmark runs `fn` on the same input until at least `min_time`
+ * seconds (and 3 runs) have passed, after one untimed warm-up run, and
+ * reports one JSON result. A run is one frame, svm_predict runs once per
+ * frame, for which `w` and `h` are 0.
+ */
+
+typedef struct BenchSettings {
+    const char *kernel;
+    const char *resolution;
+    const char *model_path;
+    double min_time;
+} BenchSettings;
+
+typedef struct BenchResult {
+    const char *kernel, *isa, *resolution;
+    unsigned bpc, w, h;
+    unsigned long runs;
+    double seconds;
+} BenchResult;
+
+extern const BenchSettings *bench_settings;
+
+bool bench_selected(const char *kernel, const char *resolution);
+
+int bench_run(BenchResult *result, int (*fn)(void *data), void *data);
+
+void bench_report(const BenchResult *result);
+
+int run_benchmarks(void);
+
+#endif /* __VMAF_BENCH_H__ */
@@ -0,0 +1,272 @@
+#!/usr/bin/env python3
+"""
+Run the legacy engine (vmafossexec) and the RC engine (vmaf_rc) on the same
+clip across thread counts. Reports fps, CPU utilization, peak RSS and how
+far every run's per-frame scores are from the baseline run (the first
+engine at the first thread count). The report is written to stdout as
+JSON, a summary table to stderr. Exits with 1 if any score differs by more
+than --tolerance.
+"""
+
+import argparse
+import json
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+import xml.etree.ElementTree as ET
+
+__copyright__ = "Copyright 2016-2020, Netflix, Inc."
+__license__ = "Apache, Version 2.0"
+
+LIBVMAF_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_MODEL = os.path.join(LIBVMAF_DIR, '..', 'model', 'vmaf_v0.6.1.pkl')
+
+LEGACY_FMT = {(420, 8): 'yuv420p', (422, 8): 'yuv422p', (444, 8): 'yuv444p',
+              (420, 10): 'yuv420p10le', (422, 10): 'yuv422p10le',
+              (444, 10): 'yuv444p10le'}
+
+
+def chroma_size(width, height, pixel_format):
+    if pixel_format == 420:
+        return ((width + 1) // 2) * ((height + 1) // 2)
+    if pixel_format == 422:
+        return ((width + 1) // 2) * height
+    return width * height
+
+
+def write_synthetic_clips(ref_path, dis_path, width, height, bitdepth,
+                          frames, seed):
+    """
+    A textured picture panning one pixel per frame, so motion is non-zero,
+    with the distorted clip quantized to 5 bits. Chroma is flat. The same
+    arguments give the same bytes on every machine.
+    """
+    rng = random.Random(seed)
+    span = width + frames
+
+    def walk(n, step):
+        v, out = rng.randrange(256), []
+        for _ in range(n):
+            v = (v + rng.randrange(-step, step + 1)) % 256
+            out.append(v)
+        return out
+
+    col, row = walk(span, 3), walk(height, 3)
+    tile = [[rng.randrange(24) for _ in range(64)] for _ in range(64)]
+    quant = bytes(v & 0xf8 for v in range(256))
+
+    ref_rows, dis_rows = [], []
+    for y in range(height):
+        t, r = tile[y % 64], row[y]
+        line = bytes(min(255, (col[x] + r) // 2 + t[x % 64])
+                     for x in range(span))
+        ref_rows.append(line)
+        dis_rows.append(line.translate(quant))
+
+    if bitdepth > 8:
+        def widen(line):
+            out = bytearray(2 * len(line))
+            for i, v in enumerate(line):
+                v <<= bitdepth - 8
+                out[2 * i], out[2 * i + 1] = v & 0xff, v >> 8
+            return bytes(out)
+        ref_rows = [widen(line) for line in ref_rows]
+        dis_rows = [widen(line) for line in dis_rows]
+
+    bps = 2 if bitdepth > 8 else 1
+    mid = 1 << (bitdepth - 1)
+    flat = (bytes([mid & 0xff, mid >> 8]) if bps == 2 else bytes([mid])) * \
+        (2 * chroma_size(width, height, 420))
+
+    with open(ref_path, 'wb') as ref, open(dis_path, 'wb') as dis:
+        for f in range(frames):
+            for out, rows in ((ref, ref_rows), (dis, dis_rows)):
+                for line in rows:
+                    out.write(line[f * bps:(f + width) * bps])
+                out.write(flat)
+
+
+def run_engine(cmd, log_path):
+    """Wall time, CPU time, peak RSS in KiB and exit status of one run."""
+    start = time.monotonic()
+    with open(log_path, 'w') as log:
+        proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT)
+        _, status, rusage = os.wait4(proc.pid, 0)
+    wall = time.monotonic() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    return wall, rusage.ru_utime + rusage.ru_stime, rusage.ru_maxrss, \
+        proc.returncode
+
+
+def parse_scores(xml_path):
+    """Per-frame scores as {name: [value, ...]}, 'vmaf' for the model."""
+    scores = {}
+    for frame in ET.parse(xml_path).getroot().iter('frame'):
+        for name, value in frame.attrib.items():
+            if name == 'frameNum':
+                continue
+            scores.setdefault(name, []).append(float(value))
+    return scores
+
+
+def score_deltas(scores, baseline):
+    """Largest per-frame difference of every score both runs have."""
+    deltas = {}
+    for name in sorted(set(scores) & set(baseline)):
+        a, b = scores[name], baseline[name]
+        if len(a) != len(b):
+            deltas[name] = float('inf')
+            continue
+        deltas[name] = max((abs(x - y) for x, y in zip(a, b)), default=0.)
+    return deltas
+
+
+def engine_cmd(engine, args, threads, xml_path):
+    if engine == 'legacy':
+        return [args.vmafossexec, LEGACY_FMT[(args.pixel_format,
+                                              args.bitdepth)],
+                str(args.width), str(args.height), args.reference,
+                args.distorted, args.model, '--log', xml_path,
+                '--log-fmt', 'xml', '--thread', str(threads)]
+    return [args.vmaf_rc, '-r', args.reference, '-d', args.distorted,
+            '-w', str(args.width), '-h', str(args.height),
+            '-p', str(args.pixel_format), '-b', str(args.bitdepth),
+            '-m', 'path={}:name=vmaf'.format(args.model), '--xml',
+            '-o', xml_path, '--threads', str(threads)]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__.strip())
+    parser.add_argument('--vmafossexec', default=os.path.join(
+        LIBVMAF_DIR, 'build', 'tools', 'vmafossexec'))
+    parser.add_argument('--vmaf_rc', default=os.path.join(
+        LIBVMAF_DIR, 'build', 'tools', 'vmaf_rc'))
+    parser.add_argument('--model', default=DEFAULT_MODEL,
+                        help='.pkl model, read by both engines')
+    parser.add_argument('--engines', default='legacy,rc',
+                        help='comma-separated, legacy and/or rc')
+    parser.add_argument('--threads', default='1,2,4,8',
+                        help='comma-separated thread counts')
+    parser.add_argument('--repeat', type=int, default=1,
+                        help='runs per configuration, the fastest counts')
+    parser.add_argument('--tolerance', type=float, default=1e-3,
+                        help='largest per-frame score difference allowed')
+    parser.add_argument('--reference', help='.yuv, synthetic if not given')
+    parser.add_argument('--distorted', help='.yuv, synthetic if not given')
+    parser.add_argument('--width', type=int, default=1920)
+    parser.add_argument('--height', type=int, default=1080)
+    parser.add_argument('--pixel_format', type=int, default=420,
+                        choices=[420, 422, 444])
+    parser.add_argument('--bitdepth', type=int, default=8, choices=[8, 10])
+    parser.add_argument('--frames', type=int, default=48,
+                        help='length of the synthetic clips')
+    parser.add_argument('--seed', type=int, default=0)
+    args = parser.parse_args()
+
+    if bool(args.reference) != bool(args.distorted):
+        parser.error('--reference and --distorted go together')
+    if not args.reference and args.pixel_format != 420:
+        parser.error('synthetic clips are 420')
+    args.engines = args.engines.split(',')
+    if not set(args.engines) <= {'legacy', 'rc'}:
+        parser.error('--engines takes legacy and/or rc')
+    args.threads = [int(t) for t in args.threads.split(',')]
+    return args
+
+
+def main():
+    args = parse_args()
+    workdir = tempfile.mkdtemp(prefix='bench_engines_')
+    args.synthetic = not args.reference
+    try:
+        if args.synthetic:
+            args.reference = os.path.join(workdir, 'ref.yuv')
+            args.distorted = os.path.join(workdir, 'dis.yuv')
+            write_synthetic_clips(args.reference, args.distorted,
+                                  args.width, args.height, args.bitdepth,
+                                  args.frames, args.seed)
+        return run(args, workdir)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+
+def run(args, workdir):
+    results, baseline = [], None
+    log_path = os.path.join(workdir, 'out.log')
+
+    for engine in args.engines:
+        for threads in args.threads:
+            # a run which writes nothing must not pass on an earlier output
+            xml_path = os.path.join(workdir,
+                                    '{}_{}.xml'.format(engine, threads))
+            best = None
+            for _ in range(args.repeat):
+                if os.path.exists(xml_path):
+                    os.remove(xml_path)
+                wall, cpu, rss, status = run_engine(
+                    engine_cmd(engine, args, threads, xml_path), log_path)
+                if status or not os.path.exists(xml_path):
+                    with open(log_path) as log:
+                        sys.stderr.write(log.read())
+                    sys.stderr.write('{} failed with --threads {}{}\n'.format(
+                        engine, threads,
+                        '' if status else ', no output written'))
+                    return 2
+                if best is None or wall < best[0]:
+                    best = (wall, cpu, rss)
+            scores = parse_scores(xml_path)
+            if baseline is None:
+                baseline = scores
+            wall, cpu, rss = best
+            frames = len(scores.get('vmaf', []))
+            deltas = score_deltas(scores, baseline)
+            results.append({
+                'engine': engine,
+                'threads': threads,
+                'frames': frames,
+                'seconds': wall,
+                'fps': frames / wall,
+                'cpu_seconds': cpu,
+                'cpu_utilization': cpu / wall,
+                'peak_rss_kib': rss,
+                'vmaf': sum(scores['vmaf']) / frames if frames else None,
+                'max_score_delta': deltas,
+            })
+
+    json.dump({
+        'width': args.width,
+        'height': args.height,
+        'pixel_format': args.pixel_format,
+        'bitdepth': args.bitdepth,
+        'reference': None if args.synthetic else args.reference,
+        'frames': args.frames if args.synthetic else None,
+        'baseline': '{} --threads {}'.format(args.engines[0],
+                                              args.threads[0]),
+        'tolerance': args.tolerance,
+        'results': results,
+    }, sys.stdout, indent=2)
+    sys.stdout.write('\n')
+
+    failed = False
+    sys.stderr.write('{:<7} {:>7} {:>9} {:>7} {:>11} {:>10} {:>12}\n'.format(
+        'engine', 'threads', 'fps', 'cpu', 'rss (MiB)', 'vmaf',
+        'max delta'))
+    for r in results:
+        delta = max(r['max_score_delta'].values(), default=0.)
+        failed |= delta > args.tolerance
+        sys.stderr.write(
+            '{:<7} {:>7} {:>9.2f} {:>7.2f} {:>11.1f} {:>10.6f} {:>12.3g}{}\n'
+            .format(r['engine'], r['threads'], r['fps'],
+                    r['cpu_utilization'], r['peak_rss_kib'] / 1024.,
+                    r['vmaf'], delta,
+                    ' !' if delta > args.tolerance else ''))
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
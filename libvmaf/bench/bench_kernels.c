@@ -0,0 +1,277 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <libvmaf/picture.h>
+
+#include "bench.h"
+#include "feature/adm.h"
+#include "feature/adm_options.h"
+#include "feature/common/convolution.h"
+#include "feature/common/cpu.h"
+#include "feature/motion.h"
+#include "feature/motion_tools.h"
+#include "feature/ms_ssim.h"
+#include "feature/picture_copy.h"
+#include "feature/ssim.h"
+#include "feature/vif.h"
+#include "mem.h"
+#include "svm.h"
+
+enum vmaf_cpu cpu;
+
+static const struct {
+    const char *name;
+    unsigned w, h;
+} resolution[] = {
+    { "576p",   720,  576 },
+    { "1080p", 1920, 1080 },
+    { "2160p", 3840, 2160 },
+};
+
+static const unsigned bpc[] = { 8, 10 };
+
+static const struct {
+    const char *name;
+    enum vmaf_cpu cpu;
+} isa[] = {
+    { "c",   VMAF_CPU_NONE },
+    { "avx", VMAF_CPU_AVX },
+};
+
+/* Luma of both pictures as the float feature extractors see it. */
+typedef struct Frame {
+    float *ref, *dis, *dst, *tmp;
+    unsigned w, h;
+    size_t stride;
+} Frame;
+
+static uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/* Smooth gradients plus texture, with noise as the distortion. The same
+ * seed gives the same frames on every machine, so runs are comparable. */
+static int fill_frame(Frame *f, unsigned bpc, uint32_t seed)
+{
+    VmafPicture ref, dis;
+    int err = vmaf_picture_alloc(&ref, VMAF_PIX_FMT_YUV400P, bpc, f->w, f->h);
+    if (err) return err;
+    err = vmaf_picture_alloc(&dis, VMAF_PIX_FMT_YUV400P, bpc, f->w, f->h);
+    if (err) goto unref_ref;
+
+    const unsigned max = (1 << bpc) - 1;
+    for (unsigned i = 0; i < f->h; i++) {
+        for (unsigned j = 0; j < f->w; j++) {
+            const uint32_t noise = xorshift32(&seed);
+            int r = ((i + j) * max) / (f->w + f->h) / 2 +
+                    ((i / 8 + j / 8) & 1) * max / 4 + (noise & 0xf);
+            int d = r + (int)((noise >> 8) & 0xf) - 8;
+            r = r > (int)max ? (int)max : r;
+            d = d < 0 ? 0 : d > (int)max ? (int)max : d;
+            if (bpc > 8) {
+                ((uint16_t *)ref.data[0])[i * ref.stride[0] / 2 + j] = r;
+                ((uint16_t *)dis.data[0])[i * dis.stride[0] / 2 + j] = d;
+            } else {
+                ((uint8_t *)ref.data[0])[i * ref.stride[0] + j] = r;
+                ((uint8_t *)dis.data[0])[i * dis.stride[0] + j] = d;
+            }
+        }
+    }
+    picture_copy(f->ref, &ref, -128, bpc);
+    picture_copy(f->dis, &dis, -128, bpc);
+
+    vmaf_picture_unref(&dis);
+unref_ref:
+    vmaf_picture_unref(&ref);
+    return err;
+}
+
+static void frame_free(Frame *f)
+{
+    if (f->ref) aligned_free(f->ref);
+    if (f->dis) aligned_free(f->dis);
+    if (f->dst) aligned_free(f->dst);
+    if (f->tmp) aligned_free(f->tmp);
+}
+
+static int frame_alloc(Frame *f, unsigned w, unsigned h)
+{
+    memset(f, 0, sizeof(*f));
+    f->w = w;
+    f->h = h;
+    f->stride = sizeof(float) * w;
+    const size_t sz = f->stride * h;
+    f->ref = aligned_malloc(sz, 32);
+    f->dis = aligned_malloc(sz, 32);
+    f->dst = aligned_malloc(sz, 32);
+    f->tmp = aligned_malloc(sz, 32);
+    if (f->ref && f->dis && f->dst && f->tmp) return 0;
+    frame_free(f);
+    return -ENOMEM;
+}
+
+static int bench_convolution(void *data)
+{
+    Frame *f = data;
+    convolution_f32_c_s(FILTER_5_s, 5, f->ref, f->dst, f->tmp, f->w, f->h,
+                        f->stride / sizeof(float), f->stride / sizeof(float));
+    return 0;
+}
+
+static int bench_vif(void *data)
+{
+    Frame *f = data;
+    double score, score_num, score_den, scores[8];
+    return compute_vif(f->ref, f->dis, f->w, f->h, f->stride, f->stride,
+                       &score, &score_num, &score_den, scores);
+}
+
+static int bench_adm(void *data)
+{
+    Frame *f = data;
+    double score, score_num, score_den, scores[8];
+    return compute_adm(f->ref, f->dis, f->w, f->h, f->stride, f->stride,
+                       &score, &score_num, &score_den, scores,
+                       ADM_BORDER_FACTOR);
+}
+
+static int bench_motion(void *data)
+{
+    Frame *f = data;
+    double score;
+    return compute_motion(f->ref, f->dis, f->w, f->h, f->stride, f->stride,
+                          &score);
+}
+
+static int bench_ssim(void *data)
+{
+    Frame *f = data;
+    double score, l_score, c_score, s_score;
+    return compute_ssim(f->ref, f->dis, f->w, f->h, f->stride, f->stride,
+                        &score, &l_score, &c_score, &s_score);
+}
+
+static int bench_ms_ssim(void *data)
+{
+    Frame *f = data;
+    double score, l_scores[5], c_scores[5], s_scores[5];
+    return compute_ms_ssim(f->ref, f->dis, f->w, f->h, f->stride, f->stride,
+                           &score, l_scores, c_scores, s_scores);
+}
+
+/* Kernels marked `simd` dispatch on the global `cpu`, and run once per
+ * ISA the machine supports. */
+static const struct {
+    const char *name;
+    int (*fn)(void *data);
+    bool simd;
+} kernel[] = {
+    { "convolution", bench_convolution, true },
+    { "vif",         bench_vif,         true },
+    { "adm",         bench_adm,         false },
+    { "motion",      bench_motion,      false },
+    { "ssim",        bench_ssim,        false },
+    { "ms_ssim",     bench_ms_ssim,     false },
+};
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+static int bench_frames(enum vmaf_cpu max_cpu)
+{
+    int err = 0;
+
+    for (unsigned r = 0; r < ARRAY_LEN(resolution); r++) {
+        bool selected = false;
+        for (unsigned k = 0; k < ARRAY_LEN(kernel); k++)
+            selected |= bench_selected(kernel[k].name, resolution[r].name);
+        if (!selected) continue;
+
+        Frame f;
+        err = frame_alloc(&f, resolution[r].w, resolution[r].h);
+        if (err) return err;
+
+        for (unsigned b = 0; b < ARRAY_LEN(bpc); b++) {
+            err = fill_frame(&f, bpc[b], 0x5eed + r);
+            if (err) goto free_frame;
+
+            for (unsigned k = 0; k < ARRAY_LEN(kernel); k++) {
+                if (!bench_selected(kernel[k].name, resolution[r].name))
+                    continue;
+                for (unsigned i = 0; i < ARRAY_LEN(isa); i++) {
+                    if (isa[i].cpu > max_cpu) continue;
+                    if (!kernel[k].simd && isa[i].cpu != VMAF_CPU_NONE)
+                        continue;
+                    cpu = isa[i].cpu;
+                    BenchResult result = {
+                        .kernel = kernel[k].name,
+                        .isa = isa[i].name,
+                        .resolution = resolution[r].name,
+                        .bpc = bpc[b],
+                        .w = f.w,
+                        .h = f.h,
+                    };
+                    err = bench_run(&result, kernel[k].fn, &f);
+                    if (err) goto free_frame;
+                    bench_report(&result);
+                }
+            }
+        }
+free_frame:
+        frame_free(&f);
+        if (err) return err;
+    }
+
+    return 0;
+}
+
+typedef struct Prediction {
+    struct svm_model *svm;
+    struct svm_node node[7];
+} Prediction;
+
+static int bench_svm_predict_one(void *data)
+{
+    Prediction *p = data;
+    volatile double score = svm_predict(p->svm, p->node);
+    (void) score;
+    return 0;
+}
+
+/* One prediction from the 6 normalized features of the default model. */
+static int bench_svm_predict(void)
+{
+    if (!bench_settings->model_path) return 0;
+    if (!bench_selected("svm_predict", NULL)) return 0;
+
+    Prediction p;
+    p.svm = svm_load_model(bench_settings->model_path);
+    if (!p.svm) return -EINVAL;
+
+    uint32_t seed = 0x5eed;
+    for (unsigned i = 0; i < 6; i++) {
+        p.node[i].index = i + 1;
+        p.node[i].value = (xorshift32(&seed) & 0xffff) / 65535.;
+    }
+    p.node[6].index = -1;
+
+    BenchResult result = { .kernel = "svm_predict", .isa = "c" };
+    const int err = bench_run(&result, bench_svm_predict_one, &p);
+    if (!err) bench_report(&result);
+    svm_free_and_destroy_model(&p.svm);
+    return err;
+}
+
+int run_benchmarks(void)
+{
+    const enum vmaf_cpu max_cpu = cpu_autodetect();
+
+    int err = bench_frames(max_cpu);
+    if (err) return err;
+    return bench_svm_predict();
+}
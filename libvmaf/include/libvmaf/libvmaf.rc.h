@@ -1,6 +1,7 @@
 #ifndef __VMAF_H__
 #define __VMAF_H__
 
+#include <stdint.h>
 #include <stdio.h>
 
 #include "libvmaf/model.h"
@@ -21,16 +22,93 @@ enum VmafPoolingMethod {
     VMAF_POOL_METHOD_MIN,
     VMAF_POOL_METHOD_MEAN,
     VMAF_POOL_METHOD_HARMONIC_MEAN,
+    VMAF_POOL_METHOD_MEDIAN,
+    VMAF_POOL_METHOD_PERC5,
+    VMAF_POOL_METHOD_PERC10,
+    VMAF_POOL_METHOD_PERC20,
 };
 
+enum VmafScalingMethod {
+    VMAF_SCALING_METHOD_NONE = 0,
+    VMAF_SCALING_METHOD_BICUBIC,
+    VMAF_SCALING_METHOD_LANCZOS,
+};
+
+enum VmafConfigurationFlags {
+    VMAF_CONFIGURATION_FLAGS_DEFAULT = 0,
+    /* Only luma is read; pictures may be VMAF_PIX_FMT_YUV400P, and feature
+     * extractors which need chroma are rejected at registration. */
+    VMAF_CONFIGURATION_FLAG_LUMA_ONLY = (1 << 0),
+    /* Time every feature extraction, for `vmaf_get_stats()`. Off by default,
+     * as each job then reads the clock and takes a lock. */
+    VMAF_CONFIGURATION_FLAG_STATS = (1 << 1),
+};
+
+typedef struct VmafThreadPool VmafThreadPool;
+
 typedef struct VmafConfiguration {
     enum VmafLogLevel log_level;
     unsigned n_threads;
     unsigned n_subsample;
+    uint64_t flags;
+    /* Bytes the per-thread feature extractor contexts may hold, 0 for no
+     * limit. Each feature extractor gets at least one context. */
+    size_t memory_budget;
+    /* Threads shared with other contexts, from `vmaf_thread_pool_create()`,
+     * instead of `n_threads` threads of this context's own. `n_threads`
+     * must still be set, it caps the feature extractor contexts kept for
+     * the pool's threads. The pool must outlive the context. */
+    VmafThreadPool *thread_pool;
 } VmafConfiguration;
 
+/* Times are in seconds, summed over threads. */
+typedef struct VmafFeatureExtractorStats {
+    const char *name;
+    uint64_t calls;
+    double extract, extract_min, extract_max, extract_p99;
+    /* Temporal feature extractors may prepare pictures concurrently
+     * ahead of `extract`, which is only the ordered part for them. */
+    double prepare;
+    /* Time queued for a thread, and waiting for a free context. */
+    double queue_wait, acquire_wait;
+    size_t bytes;
+} VmafFeatureExtractorStats;
+
+#define VMAF_STATS_MAX_FEATURE_EXTRACTORS 32
+
+typedef struct VmafStats {
+    VmafFeatureExtractorStats fex[VMAF_STATS_MAX_FEATURE_EXTRACTORS];
+    unsigned fex_cnt;
+} VmafStats;
+
 typedef struct VmafContext VmafContext;
 
+/**
+ * Start a pool of threads, which several VMAF contexts can share through
+ * `VmafConfiguration.thread_pool`, e.g. to score many pairs of videos at
+ * once without starting threads for each of them.
+ *
+ * @param pool      The thread pool to start.
+ *                  Should be cleaned up with `vmaf_thread_pool_destroy()`,
+ *                  after closing every context using it.
+ *
+ * @param n_threads Number of threads.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_thread_pool_create(VmafThreadPool **pool, unsigned n_threads);
+
+/**
+ * Stop the threads of a pool from `vmaf_thread_pool_create()` and free it.
+ *
+ * @param pool The thread pool to destroy.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_thread_pool_destroy(VmafThreadPool *pool);
+
 /**
  * Allocate and open a VMAF instance.
  *
@@ -66,6 +144,8 @@ int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model);
  * Useful when a specific/additional feature is required, usually one which
  * is not already provided by a model via `vmaf_use_features_from_model()`.
  * This may be called multiple times.
+ * Feature extractors which read chroma are rejected if the context was
+ * configured with `VMAF_CONFIGURATION_FLAG_LUMA_ONLY`.
  *
  * @param vmaf         The VMAF context allocated with `vmaf_init()`.
  *
@@ -76,6 +156,111 @@ int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model);
  */
 int vmaf_use_feature(VmafContext *vmaf, const char *feature_name);
 
+/**
+ * Share reference-side work with another context scoring the same reference.
+ * Used to score one reference against several distorted renditions (an
+ * encoding ladder), with one `VmafContext` per rendition. Features which
+ * depend on the reference picture alone (e.g. `motion2`) are extracted by
+ * `source` only, and are copied into `vmaf` as soon as `source` writes them,
+ * so that score callbacks and `vmaf_score_at_index()` on `vmaf` work while
+ * pictures are still being read. Flushing `vmaf` also flushes `source`.
+ * Both contexts must be fed the same reference pictures with the same
+ * indices and subsampling, and `source` must register every reference-only
+ * feature `vmaf` needs. Register the features of `vmaf` before this call.
+ * `source` must outlive `vmaf`, and may not itself share from another
+ * context.
+ *
+ * @param vmaf   The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param source The VMAF context which extracts the reference-only features.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_use_reference_features_from(VmafContext *vmaf, VmafContext *source);
+
+/**
+ * Cache reference-only features (e.g. `motion2`) on disk, across runs.
+ * Useful when the same reference is scored over and over against different
+ * distorted videos. Every reference picture is hashed, and for as long as
+ * the pictures match a cache file written by an earlier run, reference-only
+ * feature extractors are skipped and their scores are read from the file.
+ * After the first mismatch they run as usual. The file is keyed by the luma
+ * plane of every picture plus resolution and bitdepth, it is memory-mapped
+ * if it exists, and it is rewritten when the context is flushed by
+ * `vmaf_score_pooled()` or `vmaf_write_output()` unless every score was a
+ * hit. Pictures are expected in index order, starting at 0.
+ *
+ * @param vmaf The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param path Cache file, created if it does not exist. Or a directory, in
+ *             which the file is named after the contents of the first
+ *             reference picture, its resolution and bitdepth.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_use_reference_cache(VmafContext *vmaf, const char *path);
+
+/**
+ * Scale every picture to `w`x`h` before features are extracted, e.g. to the
+ * 1920x1080 a model was trained at when scoring 4K or 8K sources. Reference
+ * and distorted pictures are scaled independently, so they may come in at
+ * different resolutions. Pictures already at `w`x`h` are used as they are.
+ * Scaling runs on the context's threads, if any. This should be called
+ * before the first `vmaf_read_pictures()`.
+ *
+ * @param vmaf   The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param w      Width features are extracted at.
+ *
+ * @param h      Height features are extracted at.
+ *
+ * @param method Resampling filter, bicubic or lanczos as in swscale.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_use_scaling(VmafContext *vmaf, unsigned w, unsigned h,
+                     enum VmafScalingMethod method);
+
+/**
+ * Get the memory held by the contexts of a registered feature extractor,
+ * i.e. the buffers kept from one picture to the next, summed over threads.
+ * With threads, contexts are only added when the existing ones are busy,
+ * and `VmafConfiguration.memory_budget` caps how many are added.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param name  Name of the feature extractor, e.g. `float_vif`, or NULL
+ *              for the sum over every registered feature extractor.
+ *
+ * @param bytes Bytes held, 0 until the feature extractor has run.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_feature_extractor_bytes(VmafContext *vmaf, const char *name,
+                                 size_t *bytes);
+
+/**
+ * Get performance counters of every registered feature extractor, in the
+ * order they were registered: how often and how long each one extracted
+ * (p99 is within 2.2 % of the exact nearest-rank value), how long its jobs
+ * waited to be picked up by a thread and for a free context, and the bytes
+ * its contexts hold. This may be called at any time, also while pictures
+ * are being extracted on other threads. Only available when configured
+ * with `VMAF_CONFIGURATION_FLAG_STATS`.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param stats Counters, filled in.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_get_stats(VmafContext *vmaf, VmafStats *stats);
+
 /**
  * Import an external feature score.
  * Useful when pre-computed feature scores are available.
@@ -101,7 +286,10 @@ int vmaf_import_feature_score(VmafContext *vmaf, char *feature_name,
  * This should be called after feature extractors are registered via
  * `vmaf_use_features_from_model()` and/or `vmaf_use_feature()`.
  * `VmafContext` will take ownership of both `VmafPicture`s (`ref` and `dist`)
- * and `vmaf_picture_unref()`.
+ * and `vmaf_picture_unref()`. Both must have the same resolution, unless
+ * scaling was set up with `vmaf_use_scaling()`.
+ * Luma only pictures (`VMAF_PIX_FMT_YUV400P`) require a context configured
+ * with `VMAF_CONFIGURATION_FLAG_LUMA_ONLY`.
  *
  * @param vmaf  The VMAF context allocated with `vmaf_init()`.
  *
@@ -119,6 +307,8 @@ int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
 
 /**
  * Predict VMAF score at specific index.
+ * Predictions are cached per model and index, repeated calls for the same
+ * index do not re-run the model.
  *
  * @param vmaf   The VMAF context allocated with `vmaf_init()`.
  *
@@ -134,8 +324,62 @@ int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
 int vmaf_score_at_index(VmafContext *vmaf, VmafModel *model, double *score,
                         unsigned index);
 
+/**
+ * Record a timeline of the work done by this context, written to `outfile`
+ * as Chrome trace-event JSON (chrome://tracing, Perfetto) by `vmaf_close()`.
+ * Each feature extraction, prepare, sequencing and thread pool job is a span
+ * on the thread which ran it. Events go to per-thread buffers, so tracing
+ * does not serialize the workers. This should be called before the first
+ * `vmaf_read_pictures()`.
+ *
+ * @param vmaf    The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param outfile Output file, previously `fopen()`'d by calling application.
+ *                It must stay open until `vmaf_close()`.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_use_trace(VmafContext *vmaf, FILE *outfile);
+
+/**
+ * Register a callback which receives per-frame VMAF scores as soon as every
+ * feature required by `model` has been extracted for a picture index.
+ * Scores are delivered once per index, in index order from the first index
+ * passed to `vmaf_read_pictures()`, with the prediction already computed.
+ * When that index is not 0 and the model has temporal features, the first
+ * picture is lookbehind (see `vmaf_write_partial()`), and delivery starts
+ * at the next index.
+ * Temporal features are reported one picture late, so the score for the
+ * final index is delivered when the context is flushed by
+ * `vmaf_score_pooled()` or `vmaf_write_output()`.
+ * The callback may be invoked from a worker thread and must not call back
+ * into the `VmafContext`. It is called from one thread at a time, but the
+ * callbacks of different models may run concurrently. Passing a NULL `cb`
+ * removes the callback, it is no longer running once this returns.
+ *
+ * @param vmaf  The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param model Opaque model context.
+ *
+ * @param cb    Callback, receives `user`, the picture index and the score.
+ *
+ * @param user  Opaque pointer passed to `cb`.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_set_score_callback(VmafContext *vmaf, VmafModel *model,
+                            void (*cb)(void *user, unsigned index,
+                                       double score),
+                            void *user);
+
 /**
  * Predict pooled VMAF score for a specific interval.
+ * This may be called multiple times, for the same or overlapping intervals.
+ * Percentile methods (median, perc5/10/20) return the exact nearest-rank
+ * percentile of the interval's per-frame scores, which the context already
+ * holds; they select from a copy of the interval rather than stream.
  *
  * @param vmaf         The VMAF context allocated with `vmaf_init()`.
  *
@@ -156,6 +400,21 @@ int vmaf_score_pooled(VmafContext *vmaf, VmafModel *model,
                       enum VmafPoolingMethod pool_method, double *score,
                       unsigned index_low, unsigned index_high);
 
+/**
+ * Drop the scores and the feature extractor state of a VMAF instance, so
+ * that it can score another pair of videos, which may have another size.
+ * Registered features, scaling and threads are kept. Score callbacks, the
+ * reference cache and the counters of `vmaf_get_stats()` are cleared, and
+ * a trace is written out, as on `vmaf_close()`. A context sharing
+ * reference features with another one can not be reset.
+ *
+ * @param vmaf The VMAF instance to reset.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_reset(VmafContext *vmaf);
+
 /**
  * Close a VMAF instance and free all associated memory.
  *
@@ -181,6 +440,54 @@ int vmaf_close(VmafContext *vmaf);
 int vmaf_write_output(VmafContext *vmaf, FILE *logfile,
                       enum VmafOutputFormat fmt);
 
+/**
+ * Write the feature scores of a segment of pictures, e.g. when a long video
+ * is scored in parts by separate processes. Scores are written exactly, and
+ * segments which tile a whole video merge with `vmaf_import_partial()` into
+ * the same scores, output and pooled scores as a single run.
+ * Temporal features of the first and last picture of a segment depend on
+ * their neighbours, so the context should also be fed the picture before
+ * `index_low` and the picture at `index_high`, when they exist. Scores of
+ * those pictures are not written.
+ *
+ * @param vmaf       The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param outfile    Output file, previously `fopen()`'d by calling
+ *                   application.
+ *
+ * @param index_low  Low picture index of the segment.
+ *
+ * @param index_high High picture index of the segment, exclusive.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_write_partial(VmafContext *vmaf, FILE *outfile,
+                       unsigned index_low, unsigned index_high);
+
+/**
+ * Import the feature scores of a segment written by `vmaf_write_partial()`.
+ * Output columns follow the first segment imported. Segments may be
+ * imported in any order, but must not overlap.
+ *
+ * @param vmaf       The VMAF context allocated with `vmaf_init()`.
+ *
+ * @param infile     Input file, previously `fopen()`'d by calling
+ *                   application.
+ *
+ * @param index_low  Low picture index of the segment.
+ *
+ * @param index_high High picture index of the segment, exclusive.
+ *                   Both are set once the segment header is read, so they
+ *                   also describe a segment which fails to import, e.g.
+ *                   because it overlaps one imported before.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_import_partial(VmafContext *vmaf, FILE *infile,
+                        unsigned *index_low, unsigned *index_high);
+
 /**
  * Get libvmaf version.
  */
@@ -16,7 +16,28 @@ typedef struct VmafModelConfig {
     char *path;
 } VmafModelConfig;
 
+/**
+ * Load a model from disk.
+ * Models are immutable once loaded and may be shared across `VmafContext`s
+ * and threads. Loading a model with the same path, name and flags as one
+ * which is already loaded returns the cached instance and increments its
+ * reference count.
+ *
+ * @param model The loaded model.
+ *
+ * @param cfg   Model configuration.
+ *
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
 int vmaf_model_load_from_path(VmafModel **model, VmafModelConfig *cfg);
+
+/**
+ * Release a model reference obtained with `vmaf_model_load_from_path()`.
+ * The model is freed once the last reference is released.
+ *
+ * @param model The model to release.
+ */
 void vmaf_model_destroy(VmafModel *model);
 
 #endif /* __VMAF_MODEL_H__ */
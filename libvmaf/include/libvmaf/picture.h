@@ -9,8 +9,22 @@ enum VmafPixelFormat {
     VMAF_PIX_FMT_YUV420P,
     VMAF_PIX_FMT_YUV422P,
     VMAF_PIX_FMT_YUV444P,
+    /* Semi-planar 4:2:0, 8 bits per sample. */
+    VMAF_PIX_FMT_NV12,
+    /* Semi-planar 4:2:0, 10 bits per sample stored in the most significant
+     * bits of 16-bit words. */
+    VMAF_PIX_FMT_P010,
+    /* Luma only; `data[1]` and `data[2]` are NULL. */
+    VMAF_PIX_FMT_YUV400P,
 };
 
+/*
+ * Semi-planar pictures keep Cb and Cr interleaved in a single plane.
+ * `data[1]` points to the first Cb sample and `data[2]` to the first Cr
+ * sample of that plane; both share `stride[1]`, and adjacent samples of
+ * one component are two samples apart.
+ */
+
 typedef void pixel;
 
 typedef struct {
@@ -20,11 +34,60 @@ typedef struct {
     ptrdiff_t stride[3];
     pixel *data[3];
     atomic_int *ref_cnt;
+    void (*release_callback)(void *cookie);
+    void *cookie;
 } VmafPicture;
 
 int vmaf_picture_alloc(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
                        unsigned bpc, unsigned w, unsigned h);
 
+/**
+ * Wrap caller-owned pixel data in a `VmafPicture` without copying.
+ * Plane dimensions are derived from `pix_fmt`, `w` and `h` exactly as in
+ * `vmaf_picture_alloc()`. For semi-planar formats only `data[0]`,
+ * `data[1]`, `stride[0]` and `stride[1]` are used; `data[1]` is the start
+ * of the interleaved chroma plane. The data must stay valid and unmodified until
+ * the last reference to `pic` is dropped, at which point
+ * `release_callback` is invoked with `cookie`.
+ *
+ * @param pic              Picture to initialize.
+ *
+ * @param pix_fmt          Pixel format of `data`.
+ *
+ * @param bpc              Bits per component.
+ *
+ * @param w                Luma width.
+ *
+ * @param h                Luma height.
+ *
+ * @param data             Per-plane pointers to the first pixel.
+ *
+ * @param stride           Per-plane strides, in bytes.
+ *
+ * @param release_callback Called once `pic` is no longer referenced.
+ *
+ * @param cookie           Opaque pointer handed to `release_callback`.
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_picture_wrap(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
+                      unsigned bpc, unsigned w, unsigned h,
+                      pixel *data[3], ptrdiff_t stride[3],
+                      void (*release_callback)(void *cookie), void *cookie);
+
+/**
+ * Take an additional reference to `src`, which is shared rather than copied.
+ * Useful when the same picture is handed to more than one `VmafContext`.
+ * Each reference is released with `vmaf_picture_unref()`.
+ *
+ * @param dst Set to a new reference to the pixel data of `src`.
+ *
+ * @param src Picture previously allocated or wrapped.
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int vmaf_picture_ref(VmafPicture *dst, VmafPicture *src);
+
 int vmaf_picture_unref(VmafPicture *pic);
 
 #endif /* __VMAF_PICTURE_H__ */
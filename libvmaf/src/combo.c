@@ -29,7 +29,7 @@
 #include "common/convolution.h"
 #include "common/convolution_internal.h"
 #include "iqa/ssim_tools.h"
-#include "darray.h"
+#include "frame_table.h"
 #include "adm_options.h"
 #include "combo.h"
 #include "debug.h"
@@ -54,20 +54,173 @@ int compute_ms_ssim(const float *ref, const float *cmp, int w, int h, int ref_st
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
+/*
+ * Frames whose buffers are no longer needed are given back, in order. The
+ * blur buffer of a frame is used for motion by the workers of the previous
+ * and of the next frame, so a frame is retired once all three are done.
+ * Called with mutex_frame held, returns whether frame frm_idx fits in the
+ * buffer arrays.
+ */
+static bool retire_frames(VMAF_THREAD_STRUCT* thread_data, int frm_idx)
+{
+    int ring_size = thread_data->ring_size;
+    unsigned char *done = thread_data->frm_done;
+
+    while (thread_data->frm_retired + 1 < thread_data->frm_produced)
+    {
+        int i = thread_data->frm_retired;
+        if (!done[i % ring_size] || !done[(i + 1) % ring_size])
+            break;
+
+        release_blur_buf_reference(&thread_data->ref_buf_array, i);
+        release_blur_buf_reference(&thread_data->dis_buf_array, i);
+        release_blur_buf_reference(&thread_data->blur_buf_array, i);
+        release_blur_buf_slot(&thread_data->ref_buf_array, i);
+        release_blur_buf_slot(&thread_data->dis_buf_array, i);
+        release_blur_buf_slot(&thread_data->blur_buf_array, i);
+        thread_data->frm_retired++;
+    }
+
+    return frm_idx - thread_data->frm_retired < ring_size;
+}
+
+/*
+ * The only thread calling read_frame(). It reads frames in order into the
+ * buffer arrays, offsets and blurs them, so that workers only compute.
+ */
+void* combo_readerfunc(void* vmaf_thread_data)
+{
+    VMAF_THREAD_STRUCT* thread_data = (VMAF_THREAD_STRUCT*)vmaf_thread_data;
+
+    size_t data_sz = thread_data->data_sz;
+    int stride = thread_data->stride;
+    int w = thread_data->w;
+    int h = thread_data->h;
+    char* errmsg = thread_data->errmsg;
+    void* user_data = thread_data->user_data;
+
+    float *ref_buf = 0;
+    float *dis_buf = 0;
+    float *blur_buf = 0;
+    float *temp_buf = 0;
+
+    int ret = 0;
+    bool stop;
+
+    // use temp_buf for convolution_f32_c, and fread u and v
+    if (!(temp_buf = aligned_malloc(data_sz * 2, MAX_ALIGN)))
+    {
+        sprintf(errmsg, "aligned_malloc failed for temp_buf.\n");
+        ret = 1;
+        goto fail_or_end;
+    }
+
+    for (int frm_idx = 0; ; frm_idx++)
+    {
+        // wait for workers to be done with the oldest frame in the arrays
+        pthread_mutex_lock(&thread_data->mutex_frame);
+        while (!thread_data->stop_threads && !retire_frames(thread_data, frm_idx))
+            pthread_cond_wait(&thread_data->cond_done, &thread_data->mutex_frame);
+        stop = thread_data->stop_threads;
+        pthread_mutex_unlock(&thread_data->mutex_frame);
+
+        if (stop)
+            goto fail_or_end;
+
+        // Allocating the free buffers from buffer array
+        ref_buf     = get_free_blur_buf_slot(&thread_data->ref_buf_array, frm_idx);
+        dis_buf     = get_free_blur_buf_slot(&thread_data->dis_buf_array, frm_idx);
+        blur_buf    = get_free_blur_buf_slot(&thread_data->blur_buf_array, frm_idx);
+
+        if((NULL == blur_buf) || (NULL == ref_buf) || (NULL == dis_buf))
+        {
+            sprintf(errmsg, "No free slot found for buffer allocation.\n");
+            ret = 1;
+            goto fail_or_end;
+        }
+
+        // read frame from file
+        ret = thread_data->read_frame(ref_buf, dis_buf, temp_buf, stride, user_data);
+        if (ret == 1)
+        {
+            sprintf(errmsg, "read_frame failed.\n");
+            goto fail_or_end;
+        }
+        if (ret == 2)
+        {
+            // end of input, the slots taken for this frame are not used
+            release_blur_buf_reference(&thread_data->ref_buf_array, frm_idx);
+            release_blur_buf_reference(&thread_data->dis_buf_array, frm_idx);
+            release_blur_buf_reference(&thread_data->blur_buf_array, frm_idx);
+            release_blur_buf_slot(&thread_data->ref_buf_array, frm_idx);
+            release_blur_buf_slot(&thread_data->dis_buf_array, frm_idx);
+            release_blur_buf_slot(&thread_data->blur_buf_array, frm_idx);
+
+            pthread_mutex_lock(&thread_data->mutex_frame);
+            thread_data->eof = 1;
+            pthread_cond_broadcast(&thread_data->cond_produced);
+            pthread_mutex_unlock(&thread_data->mutex_frame);
+
+            ret = 0;
+            goto fail_or_end;
+        }
+
+        // ===============================================================
+        // offset pixel by OPT_RANGE_PIXEL_OFFSET
+        // ===============================================================
+        offset_image(ref_buf, OPT_RANGE_PIXEL_OFFSET, w, h, stride);
+        offset_image(dis_buf, OPT_RANGE_PIXEL_OFFSET, w, h, stride);
+
+        // ===============================================================
+        // filter
+        // apply filtering (to eliminate effects film grain)
+        // stride input to convolution_f32_c is in terms of (sizeof(float) bytes)
+        // since stride = ALIGN_CEIL(w * sizeof(float)), stride divides sizeof(float)
+        // ===============================================================
+        convolution_f32_c(FILTER_5, 5, ref_buf, blur_buf, temp_buf, w, h, stride / sizeof(float), stride / sizeof(float));
+
+        pthread_mutex_lock(&thread_data->mutex_frame);
+        if (reserve_frame_table(thread_data->frame_table, frm_idx + 1))
+        {
+            pthread_mutex_unlock(&thread_data->mutex_frame);
+            sprintf(errmsg, "reserve_frame_table failed.\n");
+            ret = 1;
+            goto fail_or_end;
+        }
+        thread_data->frm_done[frm_idx % thread_data->ring_size] = 0;
+        thread_data->frm_produced = frm_idx + 1;
+        pthread_cond_broadcast(&thread_data->cond_produced);
+        pthread_mutex_unlock(&thread_data->mutex_frame);
+    }
+
+fail_or_end:
+
+    aligned_free(temp_buf);
+
+    // on failure, workers waiting for frames have to stop
+    if (ret)
+    {
+        pthread_mutex_lock(&thread_data->mutex_frame);
+        thread_data->stop_threads = 1;
+        thread_data->ret = ret;
+        pthread_cond_broadcast(&thread_data->cond_produced);
+        pthread_mutex_unlock(&thread_data->mutex_frame);
+    }
+    pthread_exit(NULL);
+}
+
 void* combo_threadfunc(void* vmaf_thread_data)
 {
     // this is our shared thread data
     VMAF_THREAD_STRUCT* thread_data = (VMAF_THREAD_STRUCT*)vmaf_thread_data;
 
     // set the local variables from the thread shared data
-    size_t data_sz = thread_data->data_sz;
     int stride = thread_data->stride;
     double peak = thread_data->peak;
     double psnr_max = thread_data->psnr_max;
     int w = thread_data->w;
     int h = thread_data->h;
     char* errmsg = thread_data->errmsg;
-    void* user_data = thread_data->user_data;
     const char* fmt = thread_data->fmt;
     int n_subsample = thread_data->n_subsample;
 
@@ -87,161 +240,59 @@ void* combo_threadfunc(void* vmaf_thread_data)
     float *dis_buf = 0;
     float *prev_blur_buf = 0;
     float *blur_buf = 0;
-    float *next_ref_buf = 0;
-    float *next_dis_buf = 0;
     float *next_blur_buf = 0;
-    float *temp_buf = 0;
 
+    FrameRow row;
     int ret = 0;
     bool next_frame_read;
+    bool stop;
 
     bool offset_flag = false;
 
-    // use temp_buf for convolution_f32_c, and fread u and v
-    if (!(temp_buf = aligned_malloc(data_sz * 2, MAX_ALIGN)))
-    {
-        sprintf(errmsg, "aligned_malloc failed for temp_buf.\n");
-        goto fail_or_end;
-    }
-
     int frm_idx = -1;
 
     while (1)
     {
-
-        pthread_mutex_lock(&thread_data->mutex_readframe);
-
-        if (thread_data->stop_threads)
-        {
-            // this is the signal that another thread has reached the end of the input file, so we all quit
-            pthread_mutex_unlock(&thread_data->mutex_readframe);
-            goto fail_or_end;
-        }
+        pthread_mutex_lock(&thread_data->mutex_frame);
 
         // the next frame
         frm_idx = thread_data->frm_idx;
         thread_data->frm_idx++;
 
-        if (frm_idx == 0)
-        {
-            // Allocating the free buffers from buffer array
-            blur_buf    = get_free_blur_buf_slot(&thread_data->blur_buf_array, frm_idx);
-            ref_buf     = get_free_blur_buf_slot(&thread_data->ref_buf_array, frm_idx);
-            dis_buf     = get_free_blur_buf_slot(&thread_data->dis_buf_array, frm_idx);
-		
-            if((NULL == blur_buf) || (NULL == ref_buf) || (NULL == dis_buf))
-            {
-                thread_data->stop_threads = 1;
-                sprintf(errmsg, "No free slot found for buffer allocation.\n");
-                pthread_mutex_unlock(&thread_data->mutex_readframe);
-                goto fail_or_end;
-            }
-
-            // read frame from file
-
-            ret = thread_data->read_frame(ref_buf, dis_buf, temp_buf, stride, user_data);
-            if (ret == 1)
-            {
-                thread_data->stop_threads = 1;
-                pthread_mutex_unlock(&thread_data->mutex_readframe);
-                goto fail_or_end;
-            }
-            if (ret == 2)
-            {
-                thread_data->stop_threads = 1;
-                pthread_mutex_unlock(&thread_data->mutex_readframe);
-                goto fail_or_end;
-            }
-
-            // ===============================================================
-            // offset pixel by OPT_RANGE_PIXEL_OFFSET
-            // ===============================================================
-            offset_image(ref_buf, OPT_RANGE_PIXEL_OFFSET, w, h, stride);
-            offset_image(dis_buf, OPT_RANGE_PIXEL_OFFSET, w, h, stride);
-
-            // ===============================================================
-            // filter
-            // apply filtering (to eliminate effects film grain)
-            // stride input to convolution_f32_c is in terms of (sizeof(float) bytes)
-            // since stride = ALIGN_CEIL(w * sizeof(float)), stride divides sizeof(float)
-            // ===============================================================
-            convolution_f32_c(FILTER_5, 5, ref_buf, blur_buf, temp_buf, w, h, stride / sizeof(float), stride / sizeof(float));
-
-        }
-        else
+        // wait for the reader to have this frame and the next one (for
+        // motion2) in the buffer arrays, or to reach the end of the input
+        while (!thread_data->stop_threads && !thread_data->eof &&
+               thread_data->frm_produced <= frm_idx + 1)
         {
-            // retrieve from buffer array
-            ref_buf     = get_blur_buf(&thread_data->ref_buf_array, frm_idx);
-            dis_buf     = get_blur_buf(&thread_data->dis_buf_array, frm_idx);
-            blur_buf    = get_blur_buf(&thread_data->blur_buf_array, frm_idx);
-
-            if((NULL == ref_buf) || (NULL == dis_buf) || (NULL == blur_buf))
-            {
-                thread_data->stop_threads = 1;
-                sprintf(errmsg, "Data not available.\n");
-                pthread_mutex_unlock(&thread_data->mutex_readframe);
-                goto fail_or_end;
-            }
+            pthread_cond_wait(&thread_data->cond_produced, &thread_data->mutex_frame);
         }
 
-        // Allocate free buffer from the buffer array for next frame index
-        next_ref_buf 	= get_free_blur_buf_slot(&thread_data->ref_buf_array, frm_idx + 1);
-        next_dis_buf 	= get_free_blur_buf_slot(&thread_data->dis_buf_array, frm_idx + 1);
-        if((NULL == next_ref_buf) || (NULL == next_dis_buf))
+        // other threads failed, or there are no frames left
+        stop = thread_data->stop_threads || frm_idx >= thread_data->frm_produced;
+        next_frame_read = frm_idx + 1 < thread_data->frm_produced;
+        if (!stop)
         {
-            thread_data->stop_threads = 1;
-            sprintf(errmsg, "No free slot found for next buffer.\n");
-            pthread_mutex_unlock(&thread_data->mutex_readframe);
-            goto fail_or_end;
+            row = get_frame_row(thread_data->frame_table, frm_idx);
         }
+        pthread_mutex_unlock(&thread_data->mutex_frame);
 
-        ret = thread_data->read_frame(next_ref_buf, next_dis_buf, temp_buf, stride, user_data);
-        if (ret == 1)
+        if (stop)
         {
-            thread_data->stop_threads = 1;
-            pthread_mutex_unlock(&thread_data->mutex_readframe);
             goto fail_or_end;
         }
-        if (ret == 2)
-        {
-            thread_data->stop_threads = 1;
-            next_frame_read = false;
-        }
-        else
-        {
-            next_frame_read = true;
-        }
 
-        if (next_frame_read)
-        {
-            next_blur_buf     = get_free_blur_buf_slot(&thread_data->blur_buf_array, frm_idx + 1);
-            if(NULL == next_blur_buf)
-            {
-                thread_data->stop_threads = 1;
-                sprintf(errmsg, "No free slot found for blur buffer.\n");
-                goto fail_or_end;
-            }
-            // ===============================================================
-            // offset pixel by OPT_RANGE_PIXEL_OFFSET
-            // ===============================================================
-            offset_image(next_ref_buf, OPT_RANGE_PIXEL_OFFSET, w, h, stride);
-            offset_image(next_dis_buf, OPT_RANGE_PIXEL_OFFSET, w, h, stride);
-
-            // ===============================================================
-            // filter
-            // apply filtering (to eliminate effects film grain)
-            // stride input to convolution_f32_c is in terms of (sizeof(float) bytes)
-            // since stride = ALIGN_CEIL(w * sizeof(float)), stride divides sizeof(float)
-            // ===============================================================
-            convolution_f32_c(FILTER_5, 5, next_ref_buf, next_blur_buf, temp_buf, w, h, stride / sizeof(float), stride / sizeof(float));
+        // retrieve from buffer array
+        ref_buf     = get_blur_buf(&thread_data->ref_buf_array, frm_idx);
+        dis_buf     = get_blur_buf(&thread_data->dis_buf_array, frm_idx);
+        blur_buf    = get_blur_buf(&thread_data->blur_buf_array, frm_idx);
 
+        if((NULL == ref_buf) || (NULL == dis_buf) || (NULL == blur_buf))
+        {
+            sprintf(errmsg, "Data not available.\n");
+            ret = 1;
+            goto fail_or_end;
         }
 
-        // release ref and dis buffer references after blur buf computation
-        release_blur_buf_reference(&thread_data->ref_buf_array, frm_idx + 1);
-        release_blur_buf_reference(&thread_data->dis_buf_array, frm_idx + 1);
-        pthread_mutex_unlock(&thread_data->mutex_readframe);
-
         dbg_printf("frame: %d, ", frm_idx);
 
         // ===============================================================
@@ -251,14 +302,14 @@ void* combo_threadfunc(void* vmaf_thread_data)
         // ===============================================================
 
         // offset back the buffers only if required
-        if (frm_idx % n_subsample == 0 && ( (thread_data->psnr_array != NULL) || (thread_data->ssim_array != NULL) || (thread_data->ms_ssim_array != NULL) ))
+        if (frm_idx % n_subsample == 0 && (thread_data->do_psnr || thread_data->do_ssim || thread_data->do_ms_ssim))
         {
             offset_image(ref_buf, -OPT_RANGE_PIXEL_OFFSET, w, h, stride);
             offset_image(dis_buf, -OPT_RANGE_PIXEL_OFFSET, w, h, stride);
             offset_flag = true;
 		}
 
-        if (frm_idx % n_subsample == 0 && thread_data->psnr_array != NULL)
+        if (frm_idx % n_subsample == 0 && thread_data->do_psnr)
         {
             /* =========== psnr ============== */
             ret = compute_psnr(ref_buf, dis_buf, w, h, stride, stride, &score, peak, psnr_max);
@@ -271,10 +322,10 @@ void* combo_threadfunc(void* vmaf_thread_data)
 
             dbg_printf("psnr: %.3f, ", score);
 
-            insert_array_at(thread_data->psnr_array, score, frm_idx);
+            set_frame_feature(row, FT_PSNR, score);
         }
 
-        if (frm_idx % n_subsample == 0 && thread_data->ssim_array != NULL)
+        if (frm_idx % n_subsample == 0 && thread_data->do_ssim)
         {
 
             /* =========== ssim ============== */
@@ -286,10 +337,10 @@ void* combo_threadfunc(void* vmaf_thread_data)
 
             dbg_printf("ssim: %.3f, ", score);
 
-            insert_array_at(thread_data->ssim_array, score, frm_idx);
+            set_frame_feature(row, FT_SSIM, score);
         }
 
-        if (frm_idx % n_subsample == 0 && thread_data->ms_ssim_array != NULL)
+        if (frm_idx % n_subsample == 0 && thread_data->do_ms_ssim)
         {
             /* =========== ms-ssim ============== */
             if ((ret = compute_ms_ssim(ref_buf, dis_buf, w, h, stride, stride, &score, l_scores, c_scores, s_scores)))
@@ -300,7 +351,7 @@ void* combo_threadfunc(void* vmaf_thread_data)
 
             dbg_printf("ms_ssim: %.3f, ", score);
 
-            insert_array_at(thread_data->ms_ssim_array, score, frm_idx);
+            set_frame_feature(row, FT_MS_SSIM, score);
         }
 
         // ===============================================================
@@ -335,16 +386,16 @@ void* combo_threadfunc(void* vmaf_thread_data)
             dbg_printf("adm_num_scale3: %.3f, ", scores[6]);
             dbg_printf("adm_den_scale3: %.3f, ", scores[7]);
 
-            insert_array_at(thread_data->adm_num_array, score_num, frm_idx);
-            insert_array_at(thread_data->adm_den_array, score_den, frm_idx);
-            insert_array_at(thread_data->adm_num_scale0_array, scores[0], frm_idx);
-            insert_array_at(thread_data->adm_den_scale0_array, scores[1], frm_idx);
-            insert_array_at(thread_data->adm_num_scale1_array, scores[2], frm_idx);
-            insert_array_at(thread_data->adm_den_scale1_array, scores[3], frm_idx);
-            insert_array_at(thread_data->adm_num_scale2_array, scores[4], frm_idx);
-            insert_array_at(thread_data->adm_den_scale2_array, scores[5], frm_idx);
-            insert_array_at(thread_data->adm_num_scale3_array, scores[6], frm_idx);
-            insert_array_at(thread_data->adm_den_scale3_array, scores[7], frm_idx);
+            set_frame_feature(row, FT_ADM_NUM, score_num);
+            set_frame_feature(row, FT_ADM_DEN, score_den);
+            set_frame_feature(row, FT_ADM_NUM_SCALE0, scores[0]);
+            set_frame_feature(row, FT_ADM_DEN_SCALE0, scores[1]);
+            set_frame_feature(row, FT_ADM_NUM_SCALE1, scores[2]);
+            set_frame_feature(row, FT_ADM_DEN_SCALE1, scores[3]);
+            set_frame_feature(row, FT_ADM_NUM_SCALE2, scores[4]);
+            set_frame_feature(row, FT_ADM_DEN_SCALE2, scores[5]);
+            set_frame_feature(row, FT_ADM_NUM_SCALE3, scores[6]);
+            set_frame_feature(row, FT_ADM_DEN_SCALE3, scores[7]);
         }
 #ifdef COMPUTE_ANSNR
 
@@ -397,20 +448,30 @@ void* combo_threadfunc(void* vmaf_thread_data)
                 prev_blur_buf = get_blur_buf(&thread_data->blur_buf_array, frm_idx - 1);
                 if(NULL == prev_blur_buf)
                 {
-                    thread_data->stop_threads = 1;
                     sprintf(errmsg, "Data not available for prev_blur_buf.\n");
+                    ret = 1;
                     goto fail_or_end;
                 }
-                if ((ret = compute_motion(prev_blur_buf, blur_buf, w, h, stride, stride, &score)))
+                ret = compute_motion(prev_blur_buf, blur_buf, w, h, stride, stride, &score);
+                release_blur_buf_reference(&thread_data->blur_buf_array, frm_idx - 1);
+                if (ret)
                 {
                     sprintf(errmsg, "compute_motion (prev) failed.\n");
                     goto fail_or_end;
                 }
-                release_blur_buf_reference(&thread_data->blur_buf_array, frm_idx - 1);
 
                 if (next_frame_read)
                 {
-                    if ((ret = compute_motion(blur_buf, next_blur_buf, w, h, stride, stride, &score2)))
+                    next_blur_buf = get_blur_buf(&thread_data->blur_buf_array, frm_idx + 1);
+                    if(NULL == next_blur_buf)
+                    {
+                        sprintf(errmsg, "Data not available for next_blur_buf.\n");
+                        ret = 1;
+                        goto fail_or_end;
+                    }
+                    ret = compute_motion(blur_buf, next_blur_buf, w, h, stride, stride, &score2);
+                    release_blur_buf_reference(&thread_data->blur_buf_array, frm_idx + 1);
+                    if (ret)
                     {
                         sprintf(errmsg, "compute_motion (next) failed.\n");
                         goto fail_or_end;
@@ -426,13 +487,10 @@ void* combo_threadfunc(void* vmaf_thread_data)
             dbg_printf("motion: %.3f, ", score);
             dbg_printf("motion2: %.3f, ", score2);
 
-            insert_array_at(thread_data->motion_array, score, frm_idx);
-            insert_array_at(thread_data->motion2_array, score2, frm_idx);
+            set_frame_feature(row, FT_MOTION, score);
+            set_frame_feature(row, FT_MOTION2, score2);
 
         }
-        /* Indicate that motion score computation for this frame is complete */
-        insert_array_at(thread_data->motion_score_compute_flag_array, 1.0, frm_idx);
-        release_blur_buf_reference(&thread_data->blur_buf_array, frm_idx + 1);
 
         /* =========== vif ============== */
 
@@ -456,15 +514,15 @@ void* combo_threadfunc(void* vmaf_thread_data)
             dbg_printf("vif_den_scale3: %.3f, ", scores[7]);
             dbg_printf("vif: %.3f, ", score);
 
-            insert_array_at(thread_data->vif_num_scale0_array, scores[0], frm_idx);
-            insert_array_at(thread_data->vif_den_scale0_array, scores[1], frm_idx);
-            insert_array_at(thread_data->vif_num_scale1_array, scores[2], frm_idx);
-            insert_array_at(thread_data->vif_den_scale1_array, scores[3], frm_idx);
-            insert_array_at(thread_data->vif_num_scale2_array, scores[4], frm_idx);
-            insert_array_at(thread_data->vif_den_scale2_array, scores[5], frm_idx);
-            insert_array_at(thread_data->vif_num_scale3_array, scores[6], frm_idx);
-            insert_array_at(thread_data->vif_den_scale3_array, scores[7], frm_idx);
-            insert_array_at(thread_data->vif_array, score, frm_idx);
+            set_frame_feature(row, FT_VIF_NUM_SCALE0, scores[0]);
+            set_frame_feature(row, FT_VIF_DEN_SCALE0, scores[1]);
+            set_frame_feature(row, FT_VIF_NUM_SCALE1, scores[2]);
+            set_frame_feature(row, FT_VIF_DEN_SCALE1, scores[3]);
+            set_frame_feature(row, FT_VIF_NUM_SCALE2, scores[4]);
+            set_frame_feature(row, FT_VIF_DEN_SCALE2, scores[5]);
+            set_frame_feature(row, FT_VIF_NUM_SCALE3, scores[6]);
+            set_frame_feature(row, FT_VIF_DEN_SCALE3, scores[7]);
+            set_frame_feature(row, FT_VIF, score);
         }
 
         dbg_printf("\n");
@@ -473,92 +531,36 @@ void* combo_threadfunc(void* vmaf_thread_data)
         release_blur_buf_reference(&thread_data->ref_buf_array, frm_idx);
         release_blur_buf_reference(&thread_data->dis_buf_array, frm_idx);
         release_blur_buf_reference(&thread_data->blur_buf_array, frm_idx);
-        /*Loop through the slots and release slots if there are no more
-          reference till the current index. Not releasing next frame as
-          it may be required for the next loop						   */
-        for(int i = 0; i <= frm_idx; i++)
-        {
-            int ref_reference_count = get_blur_buf_reference_count(&thread_data->ref_buf_array, i);
-            int dis_reference_count = get_blur_buf_reference_count(&thread_data->dis_buf_array, i);
-
-            if((ref_reference_count == 0) && (dis_reference_count == 0))
-            {
-                release_blur_buf_slot(&thread_data->ref_buf_array, i);
-                release_blur_buf_slot(&thread_data->dis_buf_array, i);
-            }
-        }
-
-        /* Loop through the blur buffer array and release slots only till current index - 1 */
-        /* Only for those whose reference counter is zero */
-        for(int i = 0; i <= (frm_idx - 1); i++)
-        {
-            int reference_count = get_blur_buf_reference_count(&thread_data->blur_buf_array, i);
-            if(reference_count == 0)
-            {
-                /* Release buffer only if motion score is computed for current, previous and next frame */
-                if(
-                    (get_at(thread_data->motion_score_compute_flag_array, i)) &&
-                    (get_at(thread_data->motion_score_compute_flag_array, i + 1)) &&
-                    ((i == 0) || (get_at(thread_data->motion_score_compute_flag_array, i - 1)))
-                    )
-                {
-                    release_blur_buf_slot(&thread_data->blur_buf_array, i);
-                }
-            }
-        }
-
-        /* If this is the last frame then release any subsequent slots */
-        if (!next_frame_read)
-        {
-            release_blur_buf_slot(&thread_data->ref_buf_array, frm_idx + 1);
-            release_blur_buf_slot(&thread_data->dis_buf_array, frm_idx + 1);
-            release_blur_buf_slot(&thread_data->blur_buf_array, frm_idx);
-        }
-
-        if (!next_frame_read)
-        {
-            thread_data->stop_threads = 1;
-            goto fail_or_end;
-        }
 
+        // the reader gives the buffers back once the neighbours are done
+        pthread_mutex_lock(&thread_data->mutex_frame);
+        thread_data->frm_done[frm_idx % thread_data->ring_size] = 1;
+        pthread_cond_signal(&thread_data->cond_done);
+        pthread_mutex_unlock(&thread_data->mutex_frame);
     }
 
 fail_or_end:
 
-    aligned_free(temp_buf);
-
-    // when one thread ends we signal all other threads to also stop
-    thread_data->stop_threads = 1;
-    thread_data->ret = ret;
+    // when one thread fails we signal all other threads and the reader to
+    // also stop, at the end of the input the others still finish their frame
+    if (ret)
+    {
+        pthread_mutex_lock(&thread_data->mutex_frame);
+        thread_data->stop_threads = 1;
+        thread_data->ret = ret;
+        pthread_cond_broadcast(&thread_data->cond_produced);
+        pthread_cond_broadcast(&thread_data->cond_done);
+        pthread_mutex_unlock(&thread_data->mutex_frame);
+    }
     pthread_exit(&ret);
 
 }
 
 int combo(int (*read_frame)(float *ref_data, float *main_data, float *temp_data, int stride, void *user_data), void *user_data, int w, int h, const char *fmt,
-        DArray *adm_num_array,
-        DArray *adm_den_array,
-        DArray *adm_num_scale0_array,
-        DArray *adm_den_scale0_array,
-        DArray *adm_num_scale1_array,
-        DArray *adm_den_scale1_array,
-        DArray *adm_num_scale2_array,
-        DArray *adm_den_scale2_array,
-        DArray *adm_num_scale3_array,
-        DArray *adm_den_scale3_array,
-        DArray *motion_array,
-        DArray *motion2_array,
-        DArray *vif_num_scale0_array,
-        DArray *vif_den_scale0_array,
-        DArray *vif_num_scale1_array,
-        DArray *vif_den_scale1_array,
-        DArray *vif_num_scale2_array,
-        DArray *vif_den_scale2_array,
-        DArray *vif_num_scale3_array,
-        DArray *vif_den_scale3_array,
-        DArray *vif_array,
-        DArray *psnr_array,
-        DArray *ssim_array,
-        DArray *ms_ssim_array,
+        FrameTable *frame_table,
+        int do_psnr,
+        int do_ssim,
+        int do_ms_ssim,
         char *errmsg,
         int n_thread,
         int n_subsample
@@ -571,39 +573,19 @@ int combo(int (*read_frame)(float *ref_data, float *main_data, float *temp_data,
     combo_thread_data.w = w;
     combo_thread_data.h = h;
     combo_thread_data.fmt = fmt;
-    combo_thread_data.adm_num_array = adm_num_array;
-    combo_thread_data.adm_den_array = adm_den_array;
-    combo_thread_data.adm_num_scale0_array = adm_num_scale0_array;
-    combo_thread_data.adm_den_scale0_array = adm_den_scale0_array;
-    combo_thread_data.adm_num_scale1_array = adm_num_scale1_array;
-    combo_thread_data.adm_den_scale1_array = adm_den_scale1_array;
-    combo_thread_data.adm_num_scale2_array = adm_num_scale2_array;
-    combo_thread_data.adm_den_scale2_array = adm_den_scale2_array;
-    combo_thread_data.adm_num_scale3_array = adm_num_scale3_array;
-    combo_thread_data.adm_den_scale3_array = adm_den_scale3_array;
-    combo_thread_data.motion_array = motion_array;
-    combo_thread_data.motion2_array = motion2_array;
-    combo_thread_data.vif_num_scale0_array = vif_num_scale0_array;
-    combo_thread_data.vif_den_scale0_array = vif_den_scale0_array;
-    combo_thread_data.vif_num_scale1_array = vif_num_scale1_array;
-    combo_thread_data.vif_den_scale1_array = vif_den_scale1_array;
-    combo_thread_data.vif_num_scale2_array = vif_num_scale2_array;
-    combo_thread_data.vif_den_scale2_array = vif_den_scale2_array;
-    combo_thread_data.vif_num_scale3_array = vif_num_scale3_array;
-    combo_thread_data.vif_den_scale3_array = vif_den_scale3_array;
-    combo_thread_data.vif_array = vif_array;
-    combo_thread_data.psnr_array = psnr_array;
-    combo_thread_data.ssim_array = ssim_array;
-    combo_thread_data.ms_ssim_array = ms_ssim_array;
+    combo_thread_data.frame_table = frame_table;
+    combo_thread_data.do_psnr = do_psnr;
+    combo_thread_data.do_ssim = do_ssim;
+    combo_thread_data.do_ms_ssim = do_ms_ssim;
     combo_thread_data.errmsg = errmsg;
     combo_thread_data.frm_idx = 0;
+    combo_thread_data.frm_produced = 0;
+    combo_thread_data.frm_retired = 0;
+    combo_thread_data.eof = 0;
     combo_thread_data.stop_threads = 0;
+    combo_thread_data.ret = 0;
     combo_thread_data.n_subsample = n_subsample;
 
-    DArray	motion_score_compute_flag_array;
-    init_array(&motion_score_compute_flag_array, 1000);
-    combo_thread_data.motion_score_compute_flag_array = &motion_score_compute_flag_array;
-
     // sanity check for width/height
     if (w <= 0 || h <= 0 || (size_t)w > ALIGN_FLOOR(INT_MAX) / sizeof(float))
     {
@@ -638,18 +620,40 @@ int combo(int (*read_frame)(float *ref_data, float *main_data, float *temp_data,
 
     // for motion analysis we compare to previous buffer and next buffer
     /*
-     *	In the multi-thread mode, allocate a fixed size buffer pool for the reference, distorted and blur buffers.
-     *	At any point, the no. of required ref and dis buffers is 1 more than the total no. of allotted threads,
-        to accomodate reading the next frame index.
-     *	At any point, one thread operates on the current, previous and next blur buffers, and hence, the no. of
-        required blur buffers will be three times the total no. of allotted threads.
+     *	The reader fills a fixed size buffer pool for the reference, distorted and blur buffers, one slot
+        per frame, and gives a slot back once the frame is retired.
+     *	Every thread works on one frame and needs the next one read, while the previous frame can not be
+        retired yet, so two more slots than threads let the reader stay ahead of all threads. The arrays
+        round this up to a power of two, and the reader may use all of it.
      */
-    init_blur_array(&combo_thread_data.ref_buf_array, MIN(combo_thread_data.thread_count + 1, MAX_NUM_THREADS), combo_thread_data.data_sz, MAX_ALIGN);
-    init_blur_array(&combo_thread_data.dis_buf_array, MIN(combo_thread_data.thread_count + 1, MAX_NUM_THREADS), combo_thread_data.data_sz, MAX_ALIGN);
-    init_blur_array(&combo_thread_data.blur_buf_array, MIN(3 * (combo_thread_data.thread_count), MAX_NUM_THREADS), combo_thread_data.data_sz, MAX_ALIGN);
+    memset(&combo_thread_data.ref_buf_array, 0, sizeof(BLUR_BUF_ARRAY));
+    memset(&combo_thread_data.dis_buf_array, 0, sizeof(BLUR_BUF_ARRAY));
+    memset(&combo_thread_data.blur_buf_array, 0, sizeof(BLUR_BUF_ARRAY));
+    if (!init_blur_array(&combo_thread_data.ref_buf_array, combo_thread_data.thread_count + 2, combo_thread_data.data_sz, MAX_ALIGN) ||
+        !init_blur_array(&combo_thread_data.dis_buf_array, combo_thread_data.thread_count + 2, combo_thread_data.data_sz, MAX_ALIGN) ||
+        !init_blur_array(&combo_thread_data.blur_buf_array, combo_thread_data.thread_count + 2, combo_thread_data.data_sz, MAX_ALIGN))
+    {
+        sprintf(errmsg, "init_blur_array failed.\n");
+        free_blur_buf(&combo_thread_data.ref_buf_array);
+        free_blur_buf(&combo_thread_data.dis_buf_array);
+        free_blur_buf(&combo_thread_data.blur_buf_array);
+        return -1;
+    }
+    combo_thread_data.ring_size = combo_thread_data.ref_buf_array.actual_length;
+    combo_thread_data.frm_done = calloc(combo_thread_data.ring_size, sizeof(*combo_thread_data.frm_done));
+    if (!combo_thread_data.frm_done)
+    {
+        sprintf(errmsg, "calloc failed for frm_done.\n");
+        free_blur_buf(&combo_thread_data.ref_buf_array);
+        free_blur_buf(&combo_thread_data.dis_buf_array);
+        free_blur_buf(&combo_thread_data.blur_buf_array);
+        return -1;
+    }
 
-    // initialize the mutex that protects the read_frame function
-    pthread_mutex_init(&combo_thread_data.mutex_readframe, NULL);
+    // initialize the mutex and conditions passing frames from the reader to the threads
+    pthread_mutex_init(&combo_thread_data.mutex_frame, NULL);
+    pthread_cond_init(&combo_thread_data.cond_produced, NULL);
+    pthread_cond_init(&combo_thread_data.cond_done, NULL);
 
     // create a joinable thread
     pthread_attr_t attr;
@@ -661,7 +665,9 @@ int combo(int (*read_frame)(float *ref_data, float *main_data, float *temp_data,
     int numThread = combo_thread_data.thread_count;
     pthread_t* thread = (pthread_t*)calloc(numThread, sizeof(pthread_t));
     memset(thread, 0, numThread * sizeof(pthread_t));
+    pthread_t reader;
 
+    pthread_create(&reader, &attr, combo_readerfunc, &combo_thread_data);
     for (t=0; t < combo_thread_data.thread_count; t++)
     {
         pthread_create(&thread[t], &attr, combo_threadfunc, &combo_thread_data);
@@ -681,14 +687,19 @@ int combo(int (*read_frame)(float *ref_data, float *main_data, float *temp_data,
             return -1;
         }
     }
+    pthread_join(reader, NULL);
 
     free_blur_buf(&combo_thread_data.ref_buf_array);
     free_blur_buf(&combo_thread_data.dis_buf_array);
     free_blur_buf(&combo_thread_data.blur_buf_array);
 
-    free_array(&motion_score_compute_flag_array);
+    pthread_cond_destroy(&combo_thread_data.cond_done);
+    pthread_cond_destroy(&combo_thread_data.cond_produced);
+    pthread_mutex_destroy(&combo_thread_data.mutex_frame);
+    free(combo_thread_data.frm_done);
 
     free(thread);
 
-    return 0;
+    // errmsg is set by the thread which failed
+    return combo_thread_data.ret ? -1 : 0;
 }
@@ -25,7 +25,7 @@
 extern "C" {
 #endif
 
-#include "darray.h"
+#include "frame_table.h"
 #include "common/blur_array.h"
 
 #include <pthread.h>
@@ -37,76 +37,44 @@ typedef struct
     int w;
     int h;
     const char *fmt;
-    DArray *adm_num_array;
-    DArray *adm_den_array;
-    DArray *adm_num_scale0_array;
-    DArray *adm_den_scale0_array;
-    DArray *adm_num_scale1_array;
-    DArray *adm_den_scale1_array;
-    DArray *adm_num_scale2_array;
-    DArray *adm_den_scale2_array;
-    DArray *adm_num_scale3_array;
-    DArray *adm_den_scale3_array;
-    DArray *motion_array;
-    DArray *motion2_array;
-    DArray *vif_num_scale0_array;
-    DArray *vif_den_scale0_array;
-    DArray *vif_num_scale1_array;
-    DArray *vif_den_scale1_array;
-    DArray *vif_num_scale2_array;
-    DArray *vif_den_scale2_array;
-    DArray *vif_num_scale3_array;
-    DArray *vif_den_scale3_array;
-    DArray *vif_array;
-    DArray *psnr_array;
-    DArray *ssim_array;
-    DArray *ms_ssim_array;
+    FrameTable *frame_table;
+    int do_psnr;
+    int do_ssim;
+    int do_ms_ssim;
     char *errmsg;
     int n_subsample;
 
     int frm_idx;
+    int frm_produced;
+    int frm_retired;
+    int eof;
     int stride;
     double peak;
     double psnr_max;
     size_t data_sz;
     int thread_count;
     int stop_threads;
-    pthread_mutex_t mutex_readframe;
+    pthread_mutex_t mutex_frame;
+    pthread_cond_t cond_produced;
+    pthread_cond_t cond_done;
     BLUR_BUF_ARRAY blur_buf_array;
     BLUR_BUF_ARRAY ref_buf_array;
     BLUR_BUF_ARRAY dis_buf_array;
-    DArray *motion_score_compute_flag_array;
+    int ring_size;
+    unsigned char *frm_done;
     int ret;
 
 } VMAF_THREAD_STRUCT;
 
+void* combo_readerfunc(void* vmaf_thread_data);
+
 void* combo_threadfunc(void* vmaf_thread_data);
 
 int combo(int (*read_frame)(float *ref_data, float *main_data, float *temp_data, int stride, void *user_data), void *user_data, int w, int h, const char *fmt,
-        DArray *adm_num_array,
-        DArray *adm_den_array,
-        DArray *adm_num_scale0_array,
-        DArray *adm_den_scale0_array,
-        DArray *adm_num_scale1_array,
-        DArray *adm_den_scale1_array,
-        DArray *adm_num_scale2_array,
-        DArray *adm_den_scale2_array,
-        DArray *adm_num_scale3_array,
-        DArray *adm_den_scale3_array,
-        DArray *motion_array,
-        DArray *motion2_array,
-        DArray *vif_num_scale0_array,
-        DArray *vif_den_scale0_array,
-        DArray *vif_num_scale1_array,
-        DArray *vif_den_scale1_array,
-        DArray *vif_num_scale2_array,
-        DArray *vif_den_scale2_array,
-        DArray *vif_num_scale3_array,
-        DArray *vif_den_scale3_array,
-        DArray *vif_array,
-        DArray *psnr_array,
-        DArray *ssim_array,
-        DArray *ms_ssim_array,
+        FrameTable *frame_table,
+        int do_psnr,
+        int do_ssim,
+        int do_ms_ssim,
         char *errmsg,
         int n_thread,
         int n_subsample
@@ -5,32 +5,57 @@
  *      Author: thomas
  */
 
+#include <stdatomic.h>
 #include <string.h>
 #include "blur_array.h"
 
+// frame_idx of a slot which is not in use, or which put_blur_buf is filling
+#define SLOT_FREE -1
+#define SLOT_BUSY -2
+
+struct BLUR_BUF_STRUCT
+{
+    atomic_int frame_idx;
+    float *blur_buf;
+    atomic_int reference_count;
+};
+
+/*
+ * returns the slot for the frame index, frames length apart share a slot
+ */
+static BLUR_BUF_STRUCT* blur_buf_slot(BLUR_BUF_ARRAY* arr, int frame_idx)
+{
+    return &arr->blur_buf_array[frame_idx & (arr->actual_length - 1)];
+}
+
 /*
- * initializes an array of blurred buffers
+ * initializes an array of blurred buffers, array_length is rounded up to
+ * the next power of two
  */
 int init_blur_array(BLUR_BUF_ARRAY* arr, int array_length, size_t size, size_t alignement)
 {
-    // we can't go beyond the max number of threads
-    if (array_length > MAX_NUM_THREADS)
+    int length = 1;
+
+    while (length < array_length)
+        length <<= 1;
+
+    arr->actual_length = 0;
+    arr->buffer_size = size;
+    arr->blur_buf_array = calloc(length, sizeof(*arr->blur_buf_array));
+    if (arr->blur_buf_array == 0)
         return 0;
 
-    for (int i = 0; i < array_length; i++)
+    for (int i = 0; i < length; i++)
     {
-        arr->blur_buf_array[i].frame_idx = -1;
+        atomic_init(&arr->blur_buf_array[i].frame_idx, SLOT_FREE);
+        atomic_init(&arr->blur_buf_array[i].reference_count, 0);
         arr->blur_buf_array[i].blur_buf = aligned_malloc(size, alignement);
-		arr->blur_buf_array[i].reference_count	= 0;
         if (arr->blur_buf_array[i].blur_buf == 0)
             return 0;
 
-        arr->buffer_size = size;
         arr->actual_length = i + 1;
     }
 
-    pthread_mutex_init(&arr->block, NULL);
-
     return 1;
 }
 
@@ -39,61 +64,33 @@ int init_blur_array(BLUR_BUF_ARRAY* arr, int array_length, size_t size, size_t a
  */
 float* get_blur_buf(BLUR_BUF_ARRAY* arr, int search_frame_idx)
 {
-    int array_length = arr->actual_length;
-    BLUR_BUF_STRUCT* s = arr->blur_buf_array;
-	float *ret = NULL;
+    BLUR_BUF_STRUCT* s = blur_buf_slot(arr, search_frame_idx);
 
-    pthread_mutex_lock(&arr->block);
+    if (atomic_load(&s->frame_idx) != search_frame_idx)
+        return NULL;
 
-    for (int i = 0; i < array_length; i++)
-    {
-		if (s->frame_idx == search_frame_idx)
-		{
-			/* Increment reference counter */
-			s->reference_count++;
-			
-			ret = s->blur_buf;
-			break;
-		}
-
-		// next array item
-		s++;
-     }  
-
-    pthread_mutex_unlock(&arr->block);
-
-    return ret;
+    /* Increment reference counter */
+    atomic_fetch_add(&s->reference_count, 1);
+
+    return s->blur_buf;
 }
 
 /*
- * finds a free slot in the array, assigns the new frame index and copies the buffer
+ * takes the free slot of the frame index, and copies the buffer
  */
 int put_blur_buf(BLUR_BUF_ARRAY* arr, int frame_idx, float* blur_buf)
 {
-    int ret = 0;
-    int array_length = arr->actual_length;
-    size_t buf_size = arr->buffer_size;
-    BLUR_BUF_STRUCT* s = arr->blur_buf_array;
-
-    pthread_mutex_lock(&arr->block);
+    BLUR_BUF_STRUCT* s = blur_buf_slot(arr, frame_idx);
+    int expected = SLOT_FREE;
 
-    for (int i = 0; i < array_length; i++)
-    {
-        if (s->frame_idx == -1)
-        {
-            memcpy(s->blur_buf, blur_buf, buf_size);
-            s->frame_idx = frame_idx;
-            ret = 1;
-            break;
-        }
-
-        // next array item
-        s++;
-    }
+    // the slot is busy while copying, so the frame is not found half copied
+    if (!atomic_compare_exchange_strong(&s->frame_idx, &expected, SLOT_BUSY))
+        return 0;
 
-    pthread_mutex_unlock(&arr->block);
+    memcpy(s->blur_buf, blur_buf, arr->buffer_size);
+    atomic_store(&s->frame_idx, frame_idx);
 
-    return ret;
+    return 1;
 }
 
 /*
@@ -101,35 +98,17 @@ int put_blur_buf(BLUR_BUF_ARRAY* arr, int frame_idx, float* blur_buf)
  */
 int release_blur_buf_slot(BLUR_BUF_ARRAY* arr, int search_frame_idx)
 {
-    int ret = 0;
-    int array_length = arr->actual_length;
-    BLUR_BUF_STRUCT* s = arr->blur_buf_array;
+    BLUR_BUF_STRUCT* s = blur_buf_slot(arr, search_frame_idx);
 
-    pthread_mutex_lock(&arr->block);
-
-    for (int i = 0; i < array_length; i++)
-    {
-        if (s->frame_idx == search_frame_idx)
-        {
-			if(s->reference_count <= 0)
-			{
-				s->frame_idx = -1;
-				ret = 1;
-			}
-			else
-			{
-				ret = -1;
-			}
-            break;
-        }
+    if (atomic_load(&s->frame_idx) != search_frame_idx)
+        return 0;
 
-        // next struct
-        s++;
-    }
+    if (atomic_load(&s->reference_count) > 0)
+        return -1;
 
-    pthread_mutex_unlock(&arr->block);
+    atomic_store(&s->frame_idx, SLOT_FREE);
 
-    return ret;
+    return 1;
 }
 
 /*
@@ -138,7 +117,6 @@ int release_blur_buf_slot(BLUR_BUF_ARRAY* arr, int search_frame_idx)
 void free_blur_buf(BLUR_BUF_ARRAY* arr)
 {
     int array_length = arr->actual_length;
-    size_t buf_size = arr->buffer_size;
     BLUR_BUF_STRUCT* s = arr->blur_buf_array;
 
     for (int i = 0; i < array_length; i++)
@@ -149,39 +127,28 @@ void free_blur_buf(BLUR_BUF_ARRAY* arr)
         s++;
     }
 
-    pthread_mutex_destroy(&arr->block);
+    free(arr->blur_buf_array);
+    arr->blur_buf_array = NULL;
+    arr->actual_length = 0;
 }
 
 /*
- * finds a free slot in the array, assigns the new frame index and returns the free buffer pointer
+ * takes the free slot of the frame index and returns its buffer pointer, or 0
+ * if an older frame still holds the slot
  * This increases the reference count for this slot
  */
 float* get_free_blur_buf_slot(BLUR_BUF_ARRAY* arr, int frame_idx)
 {
-    int array_length = arr->actual_length;
-    BLUR_BUF_STRUCT* s = arr->blur_buf_array;
-	float *ret = NULL;
-    pthread_mutex_lock(&arr->block);
-	
-    for (int i = 0; i < array_length; i++)
-    {
-        if (s->frame_idx == -1)
-        {			
-            s->frame_idx = frame_idx;
-			
-			/* Increment reference counter */
-			s->reference_count++;
-			
-			ret = s->blur_buf;
-			break;
-        }
-
-        // next array item
-        s++;
-    }
-    pthread_mutex_unlock(&arr->block);
+    BLUR_BUF_STRUCT* s = blur_buf_slot(arr, frame_idx);
+    int expected = SLOT_FREE;
+
+    if (!atomic_compare_exchange_strong(&s->frame_idx, &expected, frame_idx))
+        return NULL;
 
-    return ret;
+    /* Increment reference counter */
+    atomic_fetch_add(&s->reference_count, 1);
+
+    return s->blur_buf;
 }
 
 /*
@@ -189,27 +156,12 @@ float* get_free_blur_buf_slot(BLUR_BUF_ARRAY* arr, int frame_idx)
 */
 int get_blur_buf_reference_count(BLUR_BUF_ARRAY* arr, int frame_idx)
 {
-    int array_length = arr->actual_length;
-    BLUR_BUF_STRUCT* s = arr->blur_buf_array;
-	int ret = -1;
+    BLUR_BUF_STRUCT* s = blur_buf_slot(arr, frame_idx);
 
-    pthread_mutex_lock(&arr->block);
+    if (atomic_load(&s->frame_idx) != frame_idx)
+        return -1;
 
-    for (int i = 0; i < array_length; i++)
-    {
-        if (s->frame_idx == frame_idx)
-        {
-			ret = s->reference_count;
-			break;
-        }
-
-        // next array item
-        s++;
-    }
-
-    pthread_mutex_unlock(&arr->block);
-
-    return ret;
+    return atomic_load(&s->reference_count);
 }
 
 /*
@@ -217,26 +169,12 @@ int get_blur_buf_reference_count(BLUR_BUF_ARRAY* arr, int frame_idx)
  */
 int release_blur_buf_reference(BLUR_BUF_ARRAY* arr, int search_frame_idx)
 {
-    int ret = -1;
-    int array_length = arr->actual_length;
-    BLUR_BUF_STRUCT* s = arr->blur_buf_array;
-
-    pthread_mutex_lock(&arr->block);
-	
-    for (int i = 0; i < array_length; i++)
-    {
-        if (s->frame_idx == search_frame_idx)
-        {
-			s->reference_count--;
-			ret = 0;
-			break;
-		}
+    BLUR_BUF_STRUCT* s = blur_buf_slot(arr, search_frame_idx);
 
-        // next struct
-        s++;
-    }
+    if (atomic_load(&s->frame_idx) != search_frame_idx)
+        return -1;
 
-    pthread_mutex_unlock(&arr->block);
+    atomic_fetch_sub(&s->reference_count, 1);
 
-    return ret;
+    return 0;
 }
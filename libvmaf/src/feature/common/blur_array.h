@@ -9,25 +9,21 @@
 #define VMAF_FEATURE_SRC_BLUR_ARRAY_H_
 
 #include <stdlib.h>
-#include <pthread.h>
 #include "mem.h"
 
-#define MAX_NUM_THREADS 128
-typedef struct
-{
-    int frame_idx;
-    float *blur_buf;
-    int reference_count;
-
-
-} BLUR_BUF_STRUCT;
+/*
+ * A ring of buffers, frame frame_idx lives in slot frame_idx % length. The
+ * slots hold atomics, so their layout is private to blur_array.c and the
+ * header stays usable from C++. Nothing is locked, a slot must only be
+ * released once no thread looks its frame up any more.
+ */
+typedef struct BLUR_BUF_STRUCT BLUR_BUF_STRUCT;
 
 typedef struct
 {
-    BLUR_BUF_STRUCT blur_buf_array[MAX_NUM_THREADS];
+    BLUR_BUF_STRUCT *blur_buf_array;
     int actual_length;
     size_t buffer_size;
-    pthread_mutex_t block;
 
 } BLUR_BUF_ARRAY;
 
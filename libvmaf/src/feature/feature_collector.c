@@ -64,6 +64,34 @@ static int feature_vector_append(FeatureVector *feature_vector,
     return 0;
 }
 
+static int grow_scores(void **score, unsigned *capacity, size_t score_sz,
+                       unsigned index)
+{
+    if (index < *capacity) return 0;
+
+    unsigned new_capacity = *capacity ? *capacity : 8;
+    while (index >= new_capacity)
+        new_capacity *= 2;
+    void *grown = realloc(*score, score_sz * new_capacity);
+    if (!grown) return -ENOMEM;
+    memset((char *)grown + score_sz * *capacity, 0,
+           score_sz * (new_capacity - *capacity));
+    *score = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+/* drops the predictions made from the scores at index */
+static int bump_stamp(VmafFeatureCollector *fc, unsigned index)
+{
+    int err = grow_scores((void **)&fc->prediction.stamp,
+                          &fc->prediction.capacity,
+                          sizeof(fc->prediction.stamp[0]), index);
+    if (err) return err;
+    fc->prediction.stamp[index]++;
+    return 0;
+}
+
 int vmaf_feature_collector_init(VmafFeatureCollector **const feature_collector)
 {
     if (!feature_collector) return -EINVAL;
@@ -101,6 +129,29 @@ static FeatureVector *find_feature_vector(VmafFeatureCollector *fc,
     return feature_vector;
 }
 
+static int feature_collector_insert(VmafFeatureCollector *feature_collector,
+                                    FeatureVector *feature_vector)
+{
+    if (feature_collector->cnt + 1 > feature_collector->capacity) {
+        size_t initial_size = sizeof(feature_collector->feature_vector[0]) *
+            feature_vector->capacity;
+        FeatureVector **fv =
+            realloc(feature_collector->feature_vector,
+            sizeof(*(feature_collector->feature_vector)) *
+            initial_size * 2);
+        if (!fv) {
+            feature_vector_destroy(feature_vector);
+            return -ENOMEM;
+        }
+        memset(fv + feature_collector->capacity, 0, initial_size);
+        feature_collector->feature_vector = fv;
+        feature_collector->capacity *= 2;
+    }
+    feature_collector->feature_vector[feature_collector->cnt++]
+        = feature_vector;
+    return 0;
+}
+
 int vmaf_feature_collector_append(VmafFeatureCollector *feature_collector,
                                   char *feature_name, double score,
                                   unsigned picture_index)
@@ -117,32 +168,35 @@ int vmaf_feature_collector_append(VmafFeatureCollector *feature_collector,
     if (!feature_vector) {
         err = feature_vector_init(&feature_vector, feature_name);
         if (err) goto unlock;
-        if (feature_collector->cnt + 1 > feature_collector->capacity) {
-            size_t initial_size = sizeof(feature_collector->feature_vector[0]) *
-                feature_vector->capacity;
-            FeatureVector **fv =
-                realloc(feature_collector->feature_vector,
-                sizeof(*(feature_collector->feature_vector)) *
-                initial_size * 2);
-            if (!fv) {
-                err = -ENOMEM;
-                goto unlock;
-            }
-            memset(fv + feature_collector->capacity, 0, initial_size);
-            feature_collector->feature_vector = fv;
-            feature_collector->capacity *= 2;
-        }
-        feature_collector->feature_vector[feature_collector->cnt++]
-            = feature_vector;
+        err = feature_collector_insert(feature_collector, feature_vector);
+        if (err) goto unlock;
     }
 
     err = feature_vector_append(feature_vector, picture_index, score);
+    if (err) goto unlock;
+    err = bump_stamp(feature_collector, picture_index);
 
 unlock:
     pthread_mutex_unlock(&(feature_collector->lock));
+    if (!err && feature_collector->observer.cb) {
+        feature_collector->observer.cb(feature_collector->observer.user,
+                                       feature_name, score, picture_index);
+    }
     return err;
 }
 
+void vmaf_feature_collector_set_observer(VmafFeatureCollector *feature_collector,
+                                         void (*cb)(void *user,
+                                                    const char *feature_name,
+                                                    double score,
+                                                    unsigned index),
+                                         void *user)
+{
+    if (!feature_collector) return;
+    feature_collector->observer.cb = cb;
+    feature_collector->observer.user = user;
+}
+
 int vmaf_feature_collector_get_score(VmafFeatureCollector *feature_collector,
                                      char *feature_name, double *score,
                                      unsigned index)
@@ -174,6 +228,181 @@ unlock:
     return err;
 }
 
+int vmaf_feature_collector_reserve(VmafFeatureCollector *feature_collector,
+                                   char *feature_name)
+{
+    if (!feature_collector) return -EINVAL;
+    if (!feature_name) return -EINVAL;
+
+    pthread_mutex_lock(&(feature_collector->lock));
+    int err = 0;
+
+    if (find_feature_vector(feature_collector, feature_name))
+        goto unlock;
+
+    FeatureVector *feature_vector;
+    err = feature_vector_init(&feature_vector, feature_name);
+    if (err) goto unlock;
+    err = feature_collector_insert(feature_collector, feature_vector);
+
+unlock:
+    pthread_mutex_unlock(&(feature_collector->lock));
+    return err;
+}
+
+int vmaf_feature_collector_import(VmafFeatureCollector *dst,
+                                  VmafFeatureCollector *src,
+                                  char *feature_name)
+{
+    if (!dst) return -EINVAL;
+    if (!src) return -EINVAL;
+    if (!feature_name) return -EINVAL;
+    if (dst == src) return -EINVAL;
+
+    /* snapshot src first, so that the two locks are never held together */
+    pthread_mutex_lock(&(src->lock));
+    FeatureVector *feature_vector = find_feature_vector(src, feature_name);
+    if (!feature_vector) {
+        pthread_mutex_unlock(&(src->lock));
+        return 0;
+    }
+    const unsigned capacity = feature_vector->capacity;
+    const size_t score_sz = sizeof(feature_vector->score[0]) * capacity;
+    void *const snapshot = malloc(score_sz);
+    if (!snapshot) {
+        pthread_mutex_unlock(&(src->lock));
+        return -ENOMEM;
+    }
+    memcpy(snapshot, feature_vector->score, score_sz);
+    pthread_mutex_unlock(&(src->lock));
+
+    FeatureVector imported = {
+        .name = feature_name,
+        .score = snapshot,
+        .capacity = capacity,
+    };
+
+    pthread_mutex_lock(&(dst->lock));
+    int err = 0;
+
+    feature_vector = find_feature_vector(dst, feature_name);
+    if (!feature_vector) {
+        err = feature_vector_init(&feature_vector, feature_name);
+        if (err) goto unlock;
+        err = feature_collector_insert(dst, feature_vector);
+        if (err) goto unlock;
+    }
+
+    for (unsigned i = 0; i < imported.capacity; i++) {
+        if (!imported.score[i].written) continue;
+        if (i < feature_vector->capacity && feature_vector->score[i].written)
+        {
+            continue;
+        }
+        err = feature_vector_append(feature_vector, i,
+                                    imported.score[i].value);
+        if (err) break;
+        err = bump_stamp(dst, i);
+        if (err) break;
+    }
+
+unlock:
+    pthread_mutex_unlock(&(dst->lock));
+    free(snapshot);
+    return err;
+}
+
+static PredictionMemo *find_prediction_memo(VmafFeatureCollector *fc,
+                                            uint64_t key)
+{
+    for (unsigned i = 0; i < fc->prediction.cnt; i++) {
+        if (fc->prediction.memo[i].key == key)
+            return &fc->prediction.memo[i];
+    }
+    return NULL;
+}
+
+int vmaf_feature_collector_get_prediction(VmafFeatureCollector *feature_collector,
+                                          uint64_t key, unsigned index,
+                                          double *score, unsigned *stamp)
+{
+    if (!feature_collector) return -EINVAL;
+    if (!key) return -EINVAL;
+    if (!score) return -EINVAL;
+    if (!stamp) return -EINVAL;
+
+    VmafFeatureCollector *const fc = feature_collector;
+    pthread_mutex_lock(&(fc->lock));
+    int err = 0;
+
+    *stamp = index < fc->prediction.capacity ? fc->prediction.stamp[index] : 0;
+
+    PredictionMemo *memo = find_prediction_memo(fc, key);
+    if (!memo || index >= memo->capacity || !memo->score[index].written ||
+        memo->score[index].stamp != *stamp)
+    {
+        err = -EINVAL;
+        goto unlock;
+    }
+
+    *score = memo->score[index].value;
+
+unlock:
+    pthread_mutex_unlock(&(fc->lock));
+    return err;
+}
+
+int vmaf_feature_collector_set_prediction(VmafFeatureCollector *feature_collector,
+                                          uint64_t key, char *feature_name,
+                                          unsigned index, double score,
+                                          unsigned stamp)
+{
+    if (!feature_collector) return -EINVAL;
+    if (!key) return -EINVAL;
+    if (!feature_name) return -EINVAL;
+
+    VmafFeatureCollector *const fc = feature_collector;
+    pthread_mutex_lock(&(fc->lock));
+    int err = 0;
+
+    PredictionMemo *memo = find_prediction_memo(fc, key);
+    if (!memo) {
+        PredictionMemo *grown = realloc(fc->prediction.memo,
+                            sizeof(*grown) * (fc->prediction.cnt + 1));
+        if (!grown) {
+            err = -ENOMEM;
+            goto unlock;
+        }
+        fc->prediction.memo = grown;
+        memo = &grown[fc->prediction.cnt++];
+        memset(memo, 0, sizeof(*memo));
+        memo->key = key;
+    }
+    err = grow_scores((void **)&memo->score, &memo->capacity,
+                      sizeof(memo->score[0]), index);
+    if (err) goto unlock;
+
+    FeatureVector *feature_vector = find_feature_vector(fc, feature_name);
+    if (!feature_vector) {
+        err = feature_vector_init(&feature_vector, feature_name);
+        if (err) goto unlock;
+        err = feature_collector_insert(fc, feature_vector);
+        if (err) goto unlock;
+    }
+    if (index < feature_vector->capacity)
+        feature_vector->score[index].written = false;
+    err = feature_vector_append(feature_vector, index, score);
+    if (err) goto unlock;
+
+    memo->score[index].written = true;
+    memo->score[index].stamp = stamp;
+    memo->score[index].value = score;
+
+unlock:
+    pthread_mutex_unlock(&(fc->lock));
+    return err;
+}
+
 void vmaf_feature_collector_destroy(VmafFeatureCollector *feature_collector)
 {
     if (!feature_collector) return;
@@ -182,6 +411,10 @@ void vmaf_feature_collector_destroy(VmafFeatureCollector *feature_collector)
     for (unsigned i = 0; i < feature_collector->cnt; i++)
         feature_vector_destroy(feature_collector->feature_vector[i]);
     free(feature_collector->feature_vector);
+    for (unsigned i = 0; i < feature_collector->prediction.cnt; i++)
+        free(feature_collector->prediction.memo[i].score);
+    free(feature_collector->prediction.memo);
+    free(feature_collector->prediction.stamp);
     pthread_mutex_destroy(&(feature_collector->lock));
     free(feature_collector);
 }
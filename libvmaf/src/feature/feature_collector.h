@@ -3,6 +3,7 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct {
     char *name;
@@ -13,9 +14,30 @@ typedef struct {
     unsigned capacity;
 } FeatureVector;
 
+typedef struct {
+    uint64_t key;
+    struct {
+        bool written;
+        unsigned stamp;
+        double value;
+    } *score;
+    unsigned capacity;
+} PredictionMemo;
+
 typedef struct VmafFeatureCollector {
     FeatureVector **feature_vector;
     unsigned cnt, capacity;
+    struct {
+        unsigned *stamp;
+        unsigned capacity;
+        PredictionMemo *memo;
+        unsigned cnt;
+    } prediction;
+    struct {
+        void (*cb)(void *user, const char *feature_name, double score,
+                   unsigned index);
+        void *user;
+    } observer;
     pthread_mutex_t lock;
 } VmafFeatureCollector;
 
@@ -25,10 +47,45 @@ int vmaf_feature_collector_append(VmafFeatureCollector *feature_collector,
                                   char *feature_name, double score,
                                   unsigned index);
 
+/* Call `cb` after every successful append, outside of the collector lock.
+ * Set the observer before any score is appended. */
+void vmaf_feature_collector_set_observer(VmafFeatureCollector *feature_collector,
+                                         void (*cb)(void *user,
+                                                    const char *feature_name,
+                                                    double score,
+                                                    unsigned index),
+                                         void *user);
+
 int vmaf_feature_collector_get_score(VmafFeatureCollector *feature_collector,
                                      char *feature_name, double *score,
                                      unsigned index);
 
+/* Add an empty vector for `feature_name`, unless there is one already.
+ * Vectors are written out in the order they were added. */
+int vmaf_feature_collector_reserve(VmafFeatureCollector *feature_collector,
+                                   char *feature_name);
+
+/* Copy every score of `feature_name` written in `src` into `dst`, skipping
+ * indices which `dst` already holds. */
+int vmaf_feature_collector_import(VmafFeatureCollector *dst,
+                                  VmafFeatureCollector *src,
+                                  char *feature_name);
+
+/* Predictions are memoized per `key` (a model id, never reused) and index. Every append at
+ * an index bumps its stamp, which drops the predictions made before. On a
+ * miss, `stamp` is set to the stamp to pass to the `set` below, once the
+ * prediction is computed from the scores at `index`. */
+int vmaf_feature_collector_get_prediction(VmafFeatureCollector *feature_collector,
+                                          uint64_t key, unsigned index,
+                                          double *score, unsigned *stamp);
+
+/* Memoize a prediction, and write it to the vector `feature_name`, where it
+ * replaces an earlier prediction. This does not bump the stamp. */
+int vmaf_feature_collector_set_prediction(VmafFeatureCollector *feature_collector,
+                                          uint64_t key, char *feature_name,
+                                          unsigned index, double score,
+                                          unsigned stamp);
+
 void vmaf_feature_collector_destroy(VmafFeatureCollector *feature_collector);
 
 #endif /* __VMAF_FEATURE_COLLECTOR_H__ */
@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -38,6 +39,12 @@ VmafFeatureExtractor *vmaf_get_feature_extractor_by_name(char *name)
     return NULL;
 }
 
+unsigned vmaf_get_feature_extractor_cnt(void)
+{
+    return sizeof(feature_extractor_list) / sizeof(feature_extractor_list[0])
+           - 1;
+}
+
 VmafFeatureExtractor *vmaf_get_feature_extractor_by_feature_name(char *name)
 {
     if (!name) return NULL;
@@ -66,6 +73,13 @@ int vmaf_feature_extractor_context_create(VmafFeatureExtractorContext **fex_ctx,
     memcpy(x, fex, sizeof(*x));
 
     f->fex = x;
+    f->fex_index = UINT_MAX;
+    for (unsigned i = 0; feature_extractor_list[i]; i++) {
+        if (!strcmp(fex->name, feature_extractor_list[i]->name)) {
+            f->fex_index = i;
+            break;
+        }
+    }
     if (f->fex->priv_size) {
         void *priv = malloc(f->fex->priv_size);
         if (!priv) goto free_x;
@@ -95,6 +109,9 @@ int vmaf_feature_extractor_context_init(VmafFeatureExtractorContext *fex_ctx,
         if (err) return err;
     }
 
+    fex_ctx->bytes = fex_ctx->fex->priv_size;
+    if (fex_ctx->fex->footprint)
+        fex_ctx->bytes += fex_ctx->fex->footprint(pix_fmt, bpc, w, h);
     fex_ctx->is_initialized = true;
     return err;
 }
@@ -118,7 +135,35 @@ int vmaf_feature_extractor_context_extract(VmafFeatureExtractorContext *fex_ctx,
         if (err) return err;
     }
 
-    return fex_ctx->fex->extract(fex_ctx->fex, ref, dist, pic_index, vfc);
+    if (!fex_ctx->stats)
+        return fex_ctx->fex->extract(fex_ctx->fex, ref, dist, pic_index, vfc);
+
+    const double start = vmaf_fex_stats_clock();
+    int err = fex_ctx->fex->extract(fex_ctx->fex, ref, dist, pic_index, vfc);
+    vmaf_fex_stats_add(fex_ctx->stats, VMAF_FEX_STATS_EXTRACT,
+                       vmaf_fex_stats_clock() - start);
+    return err;
+}
+
+int vmaf_feature_extractor_context_extract_prepared(
+                                    VmafFeatureExtractorContext *fex_ctx,
+                                    void *prepared, unsigned pic_index,
+                                    VmafFeatureCollector *vfc)
+{
+    if (!fex_ctx) return -EINVAL;
+    if (!prepared) return -EINVAL;
+    if (!vfc) return -EINVAL;
+    if (!fex_ctx->is_initialized) return -EINVAL;
+    if (!fex_ctx->fex->extract_prepared) return -EINVAL;
+
+    const double start = fex_ctx->stats ? vmaf_fex_stats_clock() : 0.;
+    int err = fex_ctx->fex->extract_prepared(fex_ctx->fex, prepared,
+                                             pic_index, vfc);
+    if (fex_ctx->stats) {
+        vmaf_fex_stats_add(fex_ctx->stats, VMAF_FEX_STATS_EXTRACT,
+                           vmaf_fex_stats_clock() - start);
+    }
+    return err;
 }
 
 int vmaf_feature_extractor_context_flush(VmafFeatureExtractorContext *fex_ctx,
@@ -161,7 +206,8 @@ int vmaf_feature_extractor_context_destroy(VmafFeatureExtractorContext *fex_ctx)
 }
 
 int vmaf_fex_ctx_pool_create(VmafFeatureExtractorContextPool **pool,
-                             unsigned n_threads)
+                             unsigned n_threads, size_t budget,
+                             VmafFexStats *stats)
 {
     if (!pool) return -EINVAL;
     if (!n_threads) return -EINVAL;
@@ -169,34 +215,43 @@ int vmaf_fex_ctx_pool_create(VmafFeatureExtractorContextPool **pool,
     VmafFeatureExtractorContextPool *const p = *pool = malloc(sizeof(*p));
     if (!p) return -ENOMEM;
     memset(p, 0, sizeof(*p));
+    p->budget = budget;
+    atomic_init(&p->bytes, 0);
 
-    p->length =
-        sizeof(feature_extractor_list) / sizeof(feature_extractor_list[0]) - 1;
+    p->length = vmaf_get_feature_extractor_cnt();
     p->fex_list = malloc(p->length * sizeof(*(p->fex_list)));
     if (!p->fex_list) goto free_p;
+    memset(p->fex_list, 0, p->length * sizeof(*(p->fex_list)));
 
     for (unsigned i = 0; i < p->length; i++) {
+        struct fex_list_entry *entry = &p->fex_list[i];
         VmafFeatureExtractor *fex = feature_extractor_list[i];
-        p->fex_list[i].fex = fex;
-        p->fex_list[i].capacity =
+        entry->fex = fex;
+        entry->capacity =
             fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL ? 1 : n_threads;
-        p->fex_list[i].in_use = 0;
-        pthread_cond_init(&(p->fex_list[i].full), NULL);
-        size_t ctx_array_sz =
-            sizeof(p->fex_list[i].ctx_list[0]) * p->fex_list[i].capacity;
-        p->fex_list[i].ctx_list = malloc(ctx_array_sz);
-        memset(p->fex_list[i].ctx_list, 0, ctx_array_sz);
-        if (!p->fex_list[i].ctx_list)
-            goto free_ctx_list;
+        const size_t slot_sz = sizeof(entry->slot[0]) * entry->capacity;
+        entry->slot = malloc(slot_sz);
+        if (!entry->slot) goto free_slot;
+        memset(entry->slot, 0, slot_sz);
+        // slots are only put on the stack once they have been handed out
+        for (unsigned j = 0; j < entry->capacity; j++)
+            atomic_init(&entry->slot[j].next, 0);
+        atomic_init(&entry->free, 0);
+        atomic_init(&entry->waiting, 0);
+        atomic_init(&entry->bytes, 0);
+        entry->stats = stats ? &stats[i] : NULL;
+        pthread_mutex_init(&(entry->lock), NULL);
+        pthread_cond_init(&(entry->available), NULL);
     }
 
-    pthread_mutex_init(&(p->lock), NULL);
     return 0;
 
-free_ctx_list:
+free_slot:
     for (unsigned i = 0; i < p->length; i++) {
-        if (p->fex_list[i].ctx_list)
-            free(p->fex_list[i].ctx_list);
+        if (!p->fex_list[i].slot) continue;
+        free(p->fex_list[i].slot);
+        pthread_mutex_destroy(&(p->fex_list[i].lock));
+        pthread_cond_destroy(&(p->fex_list[i].available));
     }
     free(p->fex_list);
 free_p:
@@ -204,94 +259,270 @@ free_p:
     return -ENOMEM;
 }
 
+/* Take a free slot off the stack, or return -1 when all are in use. The tag
+ * in the upper half of the head is bumped by every change, so a head which
+ * was popped and pushed again in between fails the compare-and-swap. */
+static int fex_pool_pop(struct fex_list_entry *entry)
+{
+    uint64_t head = atomic_load(&entry->free);
+    for (;;) {
+        const unsigned top = head & 0xffffffff;
+        if (!top) return -1;
+        const uint64_t next =
+            atomic_load_explicit(&entry->slot[top - 1].next,
+                                 memory_order_relaxed);
+        const uint64_t new_head = ((head >> 32) + 1) << 32 | next;
+        if (atomic_compare_exchange_weak(&entry->free, &head, new_head))
+            return top - 1;
+    }
+}
+
+static void fex_pool_push(struct fex_list_entry *entry, unsigned slot)
+{
+    uint64_t head = atomic_load(&entry->free);
+    uint64_t new_head;
+    do {
+        atomic_store_explicit(&entry->slot[slot].next, head & 0xffffffff,
+                              memory_order_relaxed);
+        new_head = ((head >> 32) + 1) << 32 | (slot + 1);
+    } while (!atomic_compare_exchange_weak(&entry->free, &head, new_head));
+}
+
+/* Add a slot when every existing one is busy. The first context is free,
+ * later ones are only added under a budget once the size of the first is
+ * known. Called with the entry's lock held. */
+static int fex_pool_grow(VmafFeatureExtractorContextPool *pool,
+                         struct fex_list_entry *entry)
+{
+    if (entry->created == entry->capacity) return -1;
+
+    size_t bytes = 0;
+    if (pool->budget && entry->created) {
+        if (!(bytes = entry->ctx_bytes)) return -1;
+        if (atomic_fetch_add(&pool->bytes, bytes) + bytes > pool->budget) {
+            atomic_fetch_sub(&pool->bytes, bytes);
+            return -1;
+        }
+        atomic_fetch_add(&entry->bytes, bytes);
+    }
+    entry->slot[entry->created].bytes = bytes;
+    return entry->created++;
+}
+
+/* Count the bytes of a context once it has been initialized, unless they
+ * were reserved when its slot was added. Called with the entry's lock held,
+ * or by the owner of the slot. */
+static void fex_pool_account(VmafFeatureExtractorContextPool *pool,
+                             struct fex_list_entry *entry, unsigned slot)
+{
+    VmafFeatureExtractorContext *fex_ctx = entry->slot[slot].fex_ctx;
+    if (!fex_ctx || !fex_ctx->bytes || entry->slot[slot].bytes) return;
+
+    entry->slot[slot].bytes = fex_ctx->bytes;
+    atomic_fetch_add(&pool->bytes, fex_ctx->bytes);
+    atomic_fetch_add(&entry->bytes, fex_ctx->bytes);
+}
+
 int vmaf_fex_ctx_pool_aquire(VmafFeatureExtractorContextPool *pool,
-                             VmafFeatureExtractor *fex,
+                             unsigned fex_index,
                              VmafFeatureExtractorContext **fex_ctx)
 {
     if (!pool) return -EINVAL;
-    if (!fex) return -EINVAL;
+    if (fex_index >= pool->length) return -EINVAL;
     if (!fex_ctx) return -EINVAL;
 
-    pthread_mutex_lock(&(pool->lock));
-    int err = 0;
+    struct fex_list_entry *entry = &pool->fex_list[fex_index];
+    int slot = fex_pool_pop(entry);
+    if (slot < 0) {
+        // `waiting` is raised before trying again, so a release either
+        // lands in time for the retry or sees that it has to signal
+        pthread_mutex_lock(&(entry->lock));
+        atomic_fetch_add(&entry->waiting, 1);
+        while ((slot = fex_pool_pop(entry)) < 0) {
+            if ((slot = fex_pool_grow(pool, entry)) >= 0) break;
+            pthread_cond_wait(&(entry->available), &(entry->lock));
+        }
+        atomic_fetch_sub(&entry->waiting, 1);
+        pthread_mutex_unlock(&(entry->lock));
+    }
 
-    struct fex_list_entry *entry = NULL;
-    for (unsigned i = 0; i < pool->length; i++) {
-        if (!strcmp(fex->name, pool->fex_list[i].fex->name)) {
-            entry = &pool->fex_list[i];
-            break;
+    // the slot is ours alone until released, fill it on first use
+    VmafFeatureExtractorContext *f = entry->slot[slot].fex_ctx;
+    if (!f) {
+        int err = vmaf_feature_extractor_context_create(&f, entry->fex);
+        if (err) {
+            fex_pool_push(entry, slot);
+            return err;
         }
+        f->fex_index = fex_index;
+        f->pool_slot = slot;
+        f->stats = entry->stats;
+        entry->slot[slot].fex_ctx = f;
     }
-    if (!entry) {
-        err = -EINVAL;
-        goto unlock;
+    *fex_ctx = f;
+    return 0;
+}
+
+int vmaf_fex_ctx_pool_release(VmafFeatureExtractorContextPool *pool,
+                              VmafFeatureExtractorContext *fex_ctx)
+{
+    if (!pool) return -EINVAL;
+    if (!fex_ctx) return -EINVAL;
+    if (fex_ctx->fex_index >= pool->length) return -EINVAL;
+
+    struct fex_list_entry *entry = &pool->fex_list[fex_ctx->fex_index];
+    if (fex_ctx->pool_slot >= entry->capacity) return -EINVAL;
+    if (entry->slot[fex_ctx->pool_slot].fex_ctx != fex_ctx) return -EINVAL;
+
+    if (!entry->slot[fex_ctx->pool_slot].bytes && fex_ctx->bytes) {
+        pthread_mutex_lock(&(entry->lock));
+        fex_pool_account(pool, entry, fex_ctx->pool_slot);
+        // the first context sizes the ones added after it
+        if (!entry->ctx_bytes) entry->ctx_bytes = fex_ctx->bytes;
+        pthread_mutex_unlock(&(entry->lock));
     }
+    fex_pool_push(entry, fex_ctx->pool_slot);
+    if (atomic_load(&entry->waiting)) {
+        pthread_mutex_lock(&(entry->lock));
+        pthread_cond_signal(&(entry->available));
+        pthread_mutex_unlock(&(entry->lock));
+    }
+    return 0;
+}
 
-    while (entry->capacity == entry->in_use)
-        pthread_cond_wait(&(entry->full), &(pool->lock));
+struct VmafFexTicket {
+    struct fex_list_entry *entry;
+    unsigned seq, index;
+    void *prepared;
+    VmafFeatureCollector *feature_collector;
+    struct VmafFexTicket *next;
+};
 
-    for (unsigned i = 0; i < entry->capacity; i++) {
-        VmafFeatureExtractorContext *f = entry->ctx_list[i].fex_ctx;
-        if (!f) {
-            err = vmaf_feature_extractor_context_create(&f, entry->fex);
-            if (err) goto unlock;
-        }
-        if (!entry->ctx_list[i].in_use) {
-            entry->ctx_list[i].fex_ctx = *fex_ctx = f;
-            entry->ctx_list[i].in_use = true;
-            break;
+int vmaf_fex_ctx_pool_ticket(VmafFeatureExtractorContextPool *pool,
+                             unsigned fex_index, VmafPicture *ref,
+                             VmafFexTicket **ticket)
+{
+    if (!pool) return -EINVAL;
+    if (fex_index >= pool->length) return -EINVAL;
+    if (!ref) return -EINVAL;
+    if (!ticket) return -EINVAL;
+
+    struct fex_list_entry *entry = &pool->fex_list[fex_index];
+    VmafFeatureExtractor *fex = entry->fex;
+    if (!fex->prepare || !fex->extract_prepared || !fex->free_prepared)
+        return -EINVAL;
+
+    VmafFexTicket *const t = *ticket = malloc(sizeof(*t));
+    if (!t) return -ENOMEM;
+    memset(t, 0, sizeof(*t));
+    t->entry = entry;
+
+    int err = 0;
+    pthread_mutex_lock(&(entry->lock));
+    if (!entry->slot[0].fex_ctx) {
+        VmafFeatureExtractorContext *fex_ctx;
+        err = vmaf_feature_extractor_context_create(&fex_ctx, fex);
+        if (err) goto unlock;
+        err = vmaf_feature_extractor_context_init(fex_ctx, ref->pix_fmt,
+                                                  ref->bpc, ref->w[0],
+                                                  ref->h[0]);
+        if (err) {
+            vmaf_feature_extractor_context_destroy(fex_ctx);
+            goto unlock;
         }
+        fex_ctx->stats = entry->stats;
+        entry->slot[0].fex_ctx = fex_ctx;
+        entry->created = 1;
+        fex_pool_account(pool, entry, 0);
     }
-    entry->in_use++;
+    t->seq = entry->seq.next_ticket++;
 
 unlock:
-    pthread_mutex_unlock(&(pool->lock));
+    pthread_mutex_unlock(&(entry->lock));
+    if (err) free(t);
     return err;
 }
 
-int vmaf_fex_ctx_pool_release(VmafFeatureExtractorContextPool *pool,
-                              VmafFeatureExtractorContext *fex_ctx)
+VmafFeatureExtractor *vmaf_fex_ticket_fex(VmafFexTicket *ticket)
 {
-    if (!pool) return -EINVAL;
-    if (!fex_ctx) return -EINVAL;
+    if (!ticket) return NULL;
+    return ticket->entry->slot[0].fex_ctx->fex;
+}
 
-    pthread_mutex_lock(&(pool->lock));
+/* Extract the results whose turn has come, without holding the lock while
+ * extracting. Called with the lock held, by one thread at a time. */
+static int drain_sequence(struct fex_list_entry *entry)
+{
     int err = 0;
 
-    VmafFeatureExtractor *fex = fex_ctx->fex;
-    struct fex_list_entry *entry = NULL;
-    for (unsigned i = 0; i < pool->length; i++) {
-        if (!strcmp(fex->name, pool->fex_list[i].fex->name)) {
-            entry = &pool->fex_list[i];
-            break;
+    for (;;) {
+        VmafFexTicket **p = &entry->seq.done;
+        while (*p && (*p)->seq != entry->seq.next)
+            p = &(*p)->next;
+        VmafFexTicket *t = *p;
+        if (!t) break;
+        *p = t->next;
+        entry->seq.next++;
+        pthread_mutex_unlock(&(entry->lock));
+
+        if (t->prepared) {
+            const int e = vmaf_feature_extractor_context_extract_prepared(
+                                        entry->slot[0].fex_ctx, t->prepared,
+                                        t->index, t->feature_collector);
+            if (e) err = e;
         }
-    }
-    if (!entry) {
-        err = -EINVAL;
-        goto unlock;
-    }
+        free(t);
 
-    for (unsigned i = 0; i < entry->capacity; i++) {
-        if (fex_ctx == entry->ctx_list[i].fex_ctx) {
-            entry->ctx_list[i].in_use = false;
-            entry->in_use--;
-            pthread_cond_signal(&(entry->full));
-            goto unlock;
-        }
+        pthread_mutex_lock(&(entry->lock));
     }
-    err = -EINVAL;
+    return err;
+}
 
-unlock:
-    pthread_mutex_unlock(&(pool->lock));
+int vmaf_fex_ctx_pool_sequence(VmafFeatureExtractorContextPool *pool,
+                               VmafFexTicket *ticket, void *prepared,
+                               unsigned index,
+                               VmafFeatureCollector *feature_collector)
+{
+    if (!pool) return -EINVAL;
+    if (!ticket) return -EINVAL;
+
+    struct fex_list_entry *entry = ticket->entry;
+    ticket->prepared = feature_collector ? prepared : NULL;
+    if (prepared && !ticket->prepared)
+        entry->fex->free_prepared(vmaf_fex_ticket_fex(ticket), prepared);
+    ticket->index = index;
+    ticket->feature_collector = feature_collector;
+
+    pthread_mutex_lock(&(entry->lock));
+    ticket->next = entry->seq.done;
+    entry->seq.done = ticket;
+
+    int err = 0;
+    if (!entry->seq.draining) {
+        entry->seq.draining = true;
+        err = drain_sequence(entry);
+        entry->seq.draining = false;
+    }
+    pthread_mutex_unlock(&(entry->lock));
     return err;
 }
 
+int vmaf_fex_ctx_pool_bytes(VmafFeatureExtractorContextPool *pool,
+                            unsigned fex_index, size_t *bytes)
+{
+    if (!pool) return -EINVAL;
+    if (fex_index >= pool->length) return -EINVAL;
+    if (!bytes) return -EINVAL;
+
+    *bytes = atomic_load(&pool->fex_list[fex_index].bytes);
+    return 0;
+}
+
 int vmaf_fex_ctx_pool_flush(VmafFeatureExtractorContextPool *pool,
                             VmafFeatureCollector *feature_collector)
 {
     if (!pool) return -EINVAL;
     if (!pool->fex_list) return -EINVAL;
-    pthread_mutex_lock(&(pool->lock));
 
     for (unsigned i = 0; i < pool->length; i++) {
         VmafFeatureExtractor *fex = pool->fex_list[i].fex;
@@ -299,13 +530,12 @@ int vmaf_fex_ctx_pool_flush(VmafFeatureExtractorContextPool *pool,
             continue;
         for (unsigned j = 0; j < pool->fex_list[i].capacity; j++) {
             VmafFeatureExtractorContext *fex_ctx =
-                pool->fex_list[i].ctx_list[j].fex_ctx;
+                pool->fex_list[i].slot[j].fex_ctx;
             if (!fex_ctx) continue;
             vmaf_feature_extractor_context_flush(fex_ctx, feature_collector);
         }
     }
 
-    pthread_mutex_unlock(&(pool->lock));
     return 0;
 }
 
@@ -313,18 +543,29 @@ int vmaf_fex_ctx_pool_destroy(VmafFeatureExtractorContextPool *pool)
 {
     if (!pool) return -EINVAL;
     if (!pool->fex_list) goto free_pool;
-    pthread_mutex_lock(&(pool->lock));
 
     for (unsigned i = 0; i < pool->length; i++) {
-        if (!pool->fex_list[i].ctx_list) continue;
+        if (!pool->fex_list[i].slot) continue;
+        // results never extracted go back to the context that prepared them
+        while (pool->fex_list[i].seq.done) {
+            VmafFexTicket *t = pool->fex_list[i].seq.done;
+            pool->fex_list[i].seq.done = t->next;
+            if (t->prepared) {
+                pool->fex_list[i].fex->free_prepared(vmaf_fex_ticket_fex(t),
+                                                     t->prepared);
+            }
+            free(t);
+        }
         for (unsigned j = 0; j < pool->fex_list[i].capacity; j++) {
             VmafFeatureExtractorContext *fex_ctx =
-                pool->fex_list[i].ctx_list[j].fex_ctx;
+                pool->fex_list[i].slot[j].fex_ctx;
             if (!fex_ctx) continue;
             vmaf_feature_extractor_context_close(fex_ctx);
             vmaf_feature_extractor_context_destroy(fex_ctx);
         }
-        free(pool->fex_list[i].ctx_list);
+        free(pool->fex_list[i].slot);
+        pthread_mutex_destroy(&(pool->fex_list[i].lock));
+        pthread_cond_destroy(&(pool->fex_list[i].available));
     }
     free(pool->fex_list);
 
@@ -1,15 +1,19 @@
 #ifndef __VMAF_FEATURE_EXTRACTOR_H__
 #define __VMAF_FEATURE_EXTRACTOR_H__
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 #include "feature_collector.h"
+#include "feature_stats.h"
 
 #include "libvmaf/picture.h"
 
 enum VmafFeatureExtractorFlags {
     VMAF_FEATURE_EXTRACTOR_TEMPORAL = 1 << 0,
+    VMAF_FEATURE_EXTRACTOR_CHROMA = 1 << 1,
+    VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY = 1 << 2,
 };
 
 typedef struct VmafFeatureExtractor {
@@ -22,6 +26,24 @@ typedef struct VmafFeatureExtractor {
     int (*flush)(struct VmafFeatureExtractor *fex,
                  VmafFeatureCollector *feature_collector);
     int (*close)(struct VmafFeatureExtractor *fex);
+    /* Optional split of `extract` for temporal feature extractors.
+     * `prepare` does the work on one picture pair which needs nothing from
+     * other pictures. It is called on an initialized `fex`, and may run on
+     * several pairs at once and alongside `extract_prepared`, so whatever
+     * it shares through `fex` has to be synchronized. `extract_prepared` is
+     * then called with each result in the order the pictures were read, and
+     * takes ownership of it. `free_prepared` releases a result which is
+     * never extracted. */
+    int (*prepare)(struct VmafFeatureExtractor *fex,
+                   VmafPicture *ref_pic, VmafPicture *dist_pic,
+                   void **prepared);
+    int (*extract_prepared)(struct VmafFeatureExtractor *fex, void *prepared,
+                            unsigned index,
+                            VmafFeatureCollector *feature_collector);
+    void (*free_prepared)(struct VmafFeatureExtractor *fex, void *prepared);
+    /* Optional, bytes an initialized context holds beyond `priv_size`. */
+    size_t (*footprint)(enum VmafPixelFormat pix_fmt, unsigned bpc,
+                        unsigned w, unsigned h);
     void *priv;
     size_t priv_size;
     uint64_t flags;
@@ -31,9 +53,15 @@ typedef struct VmafFeatureExtractor {
 VmafFeatureExtractor *vmaf_get_feature_extractor_by_name(char *name);
 VmafFeatureExtractor *vmaf_get_feature_extractor_by_feature_name(char *name);
 
+/* Number of feature extractors, which `fex_index` is below. */
+unsigned vmaf_get_feature_extractor_cnt(void);
+
 typedef struct VmafFeatureExtractorContext {
     bool is_initialized, is_closed;
     VmafFeatureExtractor *fex;
+    unsigned fex_index, pool_slot;
+    size_t bytes;
+    VmafFexStats *stats;
 } VmafFeatureExtractorContext;
 
 int vmaf_feature_extractor_context_create(VmafFeatureExtractorContext **fex_ctx,
@@ -48,37 +76,87 @@ int vmaf_feature_extractor_context_extract(VmafFeatureExtractorContext *fex_ctx,
                                            unsigned pic_index,
                                            VmafFeatureCollector *vfc);
 
+int vmaf_feature_extractor_context_extract_prepared(
+                                    VmafFeatureExtractorContext *fex_ctx,
+                                    void *prepared, unsigned pic_index,
+                                    VmafFeatureCollector *vfc);
+
 int vmaf_feature_extractor_context_flush(VmafFeatureExtractorContext *fex_ctx,
                                          VmafFeatureCollector *vfc);
 
 int vmaf_feature_extractor_context_close(VmafFeatureExtractorContext *fex_ctx);
 
-int vmaf_feature_extractor_context_delete(VmafFeatureExtractorContext *fex_ctx);
+int vmaf_feature_extractor_context_destroy(VmafFeatureExtractorContext *fex_ctx);
 
+/* Pooled contexts of each feature extractor, found by `fex_index`, the
+ * extractor's position in the registry which every context records. Free
+ * contexts sit on a lock-free stack; the lock and condition are only used
+ * to wait for one when all are busy, and to sequence prepared results.
+ * Contexts are only added when all existing ones are busy, up to `capacity`
+ * and, with a `budget`, for as long as the bytes held stay within it. */
 typedef struct VmafFeatureExtractorContextPool {
     struct fex_list_entry {
         VmafFeatureExtractor *fex;
-        struct {
+        struct fex_pool_slot {
             VmafFeatureExtractorContext *fex_ctx;
-            bool in_use;
-        } *ctx_list;
-        atomic_int capacity, in_use;
-        pthread_cond_t full;
+            atomic_uint next;
+            size_t bytes;
+        } *slot;
+        unsigned capacity, created;
+        size_t ctx_bytes;
+        atomic_size_t bytes;
+        // ABA tag in the upper half, top slot + 1 in the lower half
+        atomic_uint_least64_t free;
+        atomic_int waiting;
+        VmafFexStats *stats;
+        pthread_mutex_t lock;
+        pthread_cond_t available;
+        struct {
+            unsigned next_ticket, next;
+            struct VmafFexTicket *done;
+            bool draining;
+        } seq;
     } *fex_list;
     unsigned length;
-    pthread_mutex_t lock;
+    size_t budget;
+    atomic_size_t bytes;
 } VmafFeatureExtractorContextPool;
 
 int vmaf_fex_ctx_pool_create(VmafFeatureExtractorContextPool **pool,
-                             unsigned n_threads);
+                             unsigned n_threads, size_t budget,
+                             VmafFexStats *stats);
 
 int vmaf_fex_ctx_pool_aquire(VmafFeatureExtractorContextPool *pool,
-                             VmafFeatureExtractor *fex,
+                             unsigned fex_index,
                              VmafFeatureExtractorContext **fex_ctx);
 
 int vmaf_fex_ctx_pool_release(VmafFeatureExtractorContextPool *pool,
                              VmafFeatureExtractorContext *fex_ctx);
 
+/* Prepared results of a temporal feature extractor are extracted in ticket
+ * order, on its single pooled context. Tickets are taken in the order the
+ * pictures are read, and the first one creates and initializes the context
+ * from the format and size of `ref`. Pictures are prepared with the
+ * ticket's feature extractor, the one their results are extracted with.
+ * `sequence` hands each ticket back exactly once, from any thread, with a
+ * NULL `prepared` if preparing failed, and extracts every result whose turn
+ * has come. */
+typedef struct VmafFexTicket VmafFexTicket;
+
+int vmaf_fex_ctx_pool_ticket(VmafFeatureExtractorContextPool *pool,
+                             unsigned fex_index, VmafPicture *ref,
+                             VmafFexTicket **ticket);
+
+VmafFeatureExtractor *vmaf_fex_ticket_fex(VmafFexTicket *ticket);
+
+int vmaf_fex_ctx_pool_sequence(VmafFeatureExtractorContextPool *pool,
+                               VmafFexTicket *ticket, void *prepared,
+                               unsigned index,
+                               VmafFeatureCollector *feature_collector);
+
+int vmaf_fex_ctx_pool_bytes(VmafFeatureExtractorContextPool *pool,
+                            unsigned fex_index, size_t *bytes);
+
 int vmaf_fex_ctx_pool_flush(VmafFeatureExtractorContextPool *pool,
                             VmafFeatureCollector *feature_collector);
 
@@ -0,0 +1,106 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "feature_stats.h"
+
+int vmaf_fex_stats_init(VmafFexStats *stats)
+{
+    if (!stats) return -EINVAL;
+
+    memset(stats, 0, sizeof(*stats));
+    return pthread_mutex_init(&(stats->lock), NULL) ? -ENOMEM : 0;
+}
+
+double vmaf_fex_stats_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned bin_index(double seconds)
+{
+    if (seconds <= 0.) return 0;
+    const double b = (log2(seconds) - VMAF_FEX_STATS_MIN_LOG2) *
+                     VMAF_FEX_STATS_BINS_PER_OCTAVE;
+    if (b < 0.) return 0;
+    if (b >= VMAF_FEX_STATS_BIN_CNT) return VMAF_FEX_STATS_BIN_CNT - 1;
+    return b;
+}
+
+void vmaf_fex_stats_add(VmafFexStats *stats, enum VmafFexStatsKind kind,
+                        double seconds)
+{
+    if (!stats) return;
+
+    pthread_mutex_lock(&(stats->lock));
+    switch (kind) {
+    case VMAF_FEX_STATS_EXTRACT:
+        if (!stats->calls || seconds < stats->extract_min)
+            stats->extract_min = seconds;
+        if (!stats->calls || seconds > stats->extract_max)
+            stats->extract_max = seconds;
+        stats->extract += seconds;
+        stats->bin[bin_index(seconds)]++;
+        stats->calls++;
+        break;
+    case VMAF_FEX_STATS_PREPARE:
+        stats->prepare += seconds;
+        break;
+    case VMAF_FEX_STATS_QUEUE_WAIT:
+        stats->queue_wait += seconds;
+        break;
+    case VMAF_FEX_STATS_AQUIRE_WAIT:
+        stats->aquire_wait += seconds;
+        break;
+    }
+    pthread_mutex_unlock(&(stats->lock));
+}
+
+/* Consistent snapshot of stats which may still be added to. */
+int vmaf_fex_stats_copy(VmafFexStats *stats, VmafFexStats *copy)
+{
+    if (!stats) return -EINVAL;
+    if (!copy) return -EINVAL;
+
+    pthread_mutex_lock(&(stats->lock));
+    memcpy(copy, stats, sizeof(*copy));
+    pthread_mutex_unlock(&(stats->lock));
+    memset(&(copy->lock), 0, sizeof(copy->lock));
+    return 0;
+}
+
+/* Nearest-rank quantile of the extract times, as the geometric center of
+ * its bin, clamped to the exact extremes. The 0 and 1 quantiles are the
+ * extremes. */
+double vmaf_fex_stats_quantile(const VmafFexStats *stats, double q)
+{
+    if (!stats || !stats->calls) return 0.;
+    if (q <= 0.) return stats->extract_min;
+    if (q >= 1.) return stats->extract_max;
+
+    uint64_t rank = ceil(q * stats->calls);
+    if (rank < 1) rank = 1;
+    uint64_t cnt = 0;
+    unsigned i;
+    for (i = 0; i < VMAF_FEX_STATS_BIN_CNT - 1; i++) {
+        if ((cnt += stats->bin[i]) >= rank) break;
+    }
+
+    const double value =
+        exp2(VMAF_FEX_STATS_MIN_LOG2 +
+             (i + .5) / VMAF_FEX_STATS_BINS_PER_OCTAVE);
+    if (value < stats->extract_min) return stats->extract_min;
+    if (value > stats->extract_max) return stats->extract_max;
+    return value;
+}
+
+void vmaf_fex_stats_destroy(VmafFexStats *stats)
+{
+    if (!stats) return;
+    pthread_mutex_destroy(&(stats->lock));
+}
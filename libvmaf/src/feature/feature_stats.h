@@ -0,0 +1,45 @@
+#ifndef __VMAF_FEATURE_STATS_H__
+#define __VMAF_FEATURE_STATS_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+/* Extract times are binned on a log scale, 16 bins per doubling from
+ * 2^-20 s (about 1 us) to 2^6 s, so quantiles are within 2.2 %. */
+#define VMAF_FEX_STATS_BINS_PER_OCTAVE 16
+#define VMAF_FEX_STATS_MIN_LOG2 -20
+#define VMAF_FEX_STATS_MAX_LOG2 6
+#define VMAF_FEX_STATS_BIN_CNT \
+    ((VMAF_FEX_STATS_MAX_LOG2 - VMAF_FEX_STATS_MIN_LOG2) * \
+     VMAF_FEX_STATS_BINS_PER_OCTAVE)
+
+enum VmafFexStatsKind {
+    VMAF_FEX_STATS_EXTRACT = 0,
+    VMAF_FEX_STATS_PREPARE,
+    VMAF_FEX_STATS_QUEUE_WAIT,
+    VMAF_FEX_STATS_AQUIRE_WAIT,
+};
+
+/* Time spent by all contexts of one feature extractor, in seconds. */
+typedef struct VmafFexStats {
+    pthread_mutex_t lock;
+    uint64_t calls;
+    double extract, extract_min, extract_max;
+    double prepare, queue_wait, aquire_wait;
+    uint64_t bin[VMAF_FEX_STATS_BIN_CNT];
+} VmafFexStats;
+
+int vmaf_fex_stats_init(VmafFexStats *stats);
+
+double vmaf_fex_stats_clock(void);
+
+void vmaf_fex_stats_add(VmafFexStats *stats, enum VmafFexStatsKind kind,
+                        double seconds);
+
+int vmaf_fex_stats_copy(VmafFexStats *stats, VmafFexStats *copy);
+
+double vmaf_fex_stats_quantile(const VmafFexStats *stats, double q);
+
+void vmaf_fex_stats_destroy(VmafFexStats *stats);
+
+#endif /* __VMAF_FEATURE_STATS_H__ */
@@ -1,5 +1,7 @@
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "common/convolution.h"
@@ -11,40 +13,63 @@
 
 #include "picture_copy.h"
 
+/* One float plane of the picture size, prepared results are blurred ones. */
+typedef struct MotionBuf {
+    struct MotionBuf *next;
+    float *data;
+} MotionBuf;
+
 typedef struct MotionState {
     size_t float_stride;
-    float *ref;
-    float *tmp;
-    float *blur[3];
+    unsigned w, h;
+    MotionBuf *blur[2];
     unsigned index;
+    unsigned frame_cnt;
     double score;
+    // planes no longer in use, taken by prepare() on any thread
+    pthread_mutex_t lock;
+    MotionBuf *spare;
 } MotionState;
 
+static MotionBuf *buf_get(MotionState *s)
+{
+    pthread_mutex_lock(&(s->lock));
+    MotionBuf *buf = s->spare;
+    if (buf) s->spare = buf->next;
+    pthread_mutex_unlock(&(s->lock));
+    if (buf) return buf;
+
+    buf = malloc(sizeof(*buf));
+    if (!buf) return NULL;
+    buf->data = aligned_malloc(s->float_stride * s->h, 32);
+    if (!buf->data) {
+        free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+static void buf_put(MotionState *s, MotionBuf *buf)
+{
+    if (!buf) return;
+    pthread_mutex_lock(&(s->lock));
+    buf->next = s->spare;
+    s->spare = buf;
+    pthread_mutex_unlock(&(s->lock));
+}
+
 static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
                 unsigned bpc, unsigned w, unsigned h)
 {
     MotionState *s = fex->priv;
 
     s->float_stride = sizeof(float) * w;
-    s->ref = aligned_malloc(s->float_stride * h, 32);
-    s->tmp = aligned_malloc(s->float_stride * h, 32);
-    s->blur[0] = aligned_malloc(s->float_stride * h, 32);
-    s->blur[1] = aligned_malloc(s->float_stride * h, 32);
-    s->blur[2] = aligned_malloc(s->float_stride * h, 32);
-    if (!s->ref || !s->tmp || !s->blur[0] || !s->blur[1] || !s->blur[2])
-        goto fail;
-
+    s->w = w;
+    s->h = h;
+    s->blur[0] = s->blur[1] = NULL;
     s->score = 0;
-    return 0;
-
-fail:
-    if (s->ref) aligned_free(s->ref);
-    if (s->blur[0]) aligned_free(s->blur[0]);
-    if (s->blur[1]) aligned_free(s->blur[1]);
-    if (s->blur[2]) aligned_free(s->blur[2]);
-    if (s->tmp) aligned_free(s->tmp);
-    return -ENOMEM;
-
+    s->spare = NULL;
+    return pthread_mutex_init(&(s->lock), NULL) ? -ENOMEM : 0;
 }
 
 static int flush(VmafFeatureExtractor *fex,
@@ -57,62 +82,120 @@ static int flush(VmafFeatureExtractor *fex,
     return (ret < 0) ? ret : !ret;
 }
 
-static int extract(VmafFeatureExtractor *fex,
+static void free_prepared(VmafFeatureExtractor *fex, void *prepared)
+{
+    buf_put(fex->priv, prepared);
+}
+
+/* Blur the reference luma, which is all the scores need from a picture. */
+static int prepare(VmafFeatureExtractor *fex,
                    VmafPicture *ref_pic, VmafPicture *dist_pic,
-                   unsigned index, VmafFeatureCollector *feature_collector)
+                   void **prepared)
 {
     MotionState *s = fex->priv;
-    int err = 0;
-
-    s->index = index;
-    unsigned blur_idx_0 = (index + 0) % 3;
-    unsigned blur_idx_1 = (index + 1) % 3;
-    unsigned blur_idx_2 = (index + 2) % 3;
-
-    picture_copy(s->ref, ref_pic, -128, ref_pic->bpc);
-    convolution_f32_c_s(FILTER_5_s, 5, s->ref, s->blur[blur_idx_0], s->tmp,
-                        ref_pic->w[0], ref_pic->h[0],
+    (void) dist_pic;
+
+    MotionBuf *blur = buf_get(s);
+    MotionBuf *ref = buf_get(s);
+    MotionBuf *tmp = buf_get(s);
+    if (!blur || !ref || !tmp) {
+        buf_put(s, blur);
+        buf_put(s, ref);
+        buf_put(s, tmp);
+        return -ENOMEM;
+    }
+
+    picture_copy(ref->data, ref_pic, -128, ref_pic->bpc);
+    convolution_f32_c_s(FILTER_5_s, 5, ref->data, blur->data, tmp->data,
+                        s->w, s->h,
                         s->float_stride / sizeof(float),
                         s->float_stride / sizeof(float));
+    buf_put(s, ref);
+    buf_put(s, tmp);
+    *prepared = blur;
+    return 0;
+}
+
+static int extract_prepared(VmafFeatureExtractor *fex, void *prepared,
+                            unsigned index,
+                            VmafFeatureCollector *feature_collector)
+{
+    MotionState *s = fex->priv;
+    int err = 0;
 
-    if (index == 0)
+    s->index = index;
+    const unsigned frame = s->frame_cnt++;
+
+    // keep the last two blurred pictures, blur[1] being the newest
+    MotionBuf *const prev = s->blur[1], *const prev2 = s->blur[0];
+    MotionBuf *const blur = prepared;
+    s->blur[0] = prev;
+    s->blur[1] = blur;
+
+    /* Pictures may start mid-stream (e.g. a segment with one picture of
+     * lookbehind), so scores wait on the pictures seen, not on `index`. */
+    if (frame == 0) {
+        if (index) return 0;
         return vmaf_feature_collector_append(feature_collector,
                                              "'VMAF_feature_motion2_score'",
                                              0., index);
+    }
 
     double score;
-    err = compute_motion(s->blur[blur_idx_2], s->blur[blur_idx_0],
-                         ref_pic->w[0], ref_pic->h[0],
+    err = compute_motion(prev->data, blur->data, s->w, s->h,
                          s->float_stride, s->float_stride, &score);
-    if (err) return err;
+    if (err) goto free_prev2;
     s->score = score;
 
-    if (index == 1)
+    if (frame == 1)
         return 0;
-    
+
     double score2;
-    err = compute_motion(s->blur[blur_idx_2], s->blur[blur_idx_1],
-                         ref_pic->w[0], ref_pic->h[0],
+    err = compute_motion(prev->data, prev2->data, s->w, s->h,
                          s->float_stride, s->float_stride, &score2);
-    if (err) return err;
+    if (err) goto free_prev2;
     score2 = score2 < score ? score2 : score;
     err = vmaf_feature_collector_append(feature_collector,
                                         "'VMAF_feature_motion2_score'",
                                         score2, index - 1);
+
+free_prev2:
+    buf_put(s, prev2);
+    return err;
+}
+
+static int extract(VmafFeatureExtractor *fex,
+                   VmafPicture *ref_pic, VmafPicture *dist_pic,
+                   unsigned index, VmafFeatureCollector *feature_collector)
+{
+    void *prepared;
+    int err = prepare(fex, ref_pic, dist_pic, &prepared);
     if (err) return err;
+    return extract_prepared(fex, prepared, index, feature_collector);
+}
 
-    return 0;
+static size_t footprint(enum VmafPixelFormat pix_fmt, unsigned bpc,
+                        unsigned w, unsigned h)
+{
+    (void) pix_fmt;
+    (void) bpc;
+    // the blurred luma of the last two pictures, and two planes to blur
+    return 4 * sizeof(float) * w * h;
 }
 
 static int close(VmafFeatureExtractor *fex)
 {
     MotionState *s = fex->priv;
 
-    if (s->ref) aligned_free(s->ref);
-    if (s->blur[0]) aligned_free(s->blur[0]);
-    if (s->blur[1]) aligned_free(s->blur[1]);
-    if (s->blur[2]) aligned_free(s->blur[2]);
-    if (s->tmp) aligned_free(s->tmp);
+    buf_put(s, s->blur[0]);
+    buf_put(s, s->blur[1]);
+    while (s->spare) {
+        MotionBuf *buf = s->spare;
+        s->spare = buf->next;
+        aligned_free(buf->data);
+        free(buf);
+    }
+    pthread_mutex_destroy(&(s->lock));
     return 0;
 }
 
@@ -127,7 +210,12 @@ VmafFeatureExtractor vmaf_fex_float_motion = {
     .extract = extract,
     .flush = flush,
     .close = close,
+    .prepare = prepare,
+    .extract_prepared = extract_prepared,
+    .free_prepared = free_prepared,
+    .footprint = footprint,
     .priv_size = sizeof(MotionState),
     .provided_features = provided_features,
-    .flags = VMAF_FEATURE_EXTRACTOR_TEMPORAL,
+    .flags = VMAF_FEATURE_EXTRACTOR_TEMPORAL |
+             VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY,
 };
@@ -52,6 +52,15 @@ static int extract(VmafFeatureExtractor *fex,
     return 0;
 }
 
+static size_t footprint(enum VmafPixelFormat pix_fmt, unsigned bpc,
+                        unsigned w, unsigned h)
+{
+    (void) pix_fmt;
+    (void) bpc;
+    // ref and dist, as floats
+    return 2 * sizeof(float) * w * h;
+}
+
 static int close(VmafFeatureExtractor *fex)
 {
     MsSsimState *s = fex->priv;
@@ -70,6 +79,7 @@ VmafFeatureExtractor vmaf_fex_float_ms_ssim = {
     .init = init,
     .extract = extract,
     .close = close,
+    .footprint = footprint,
     .priv_size = sizeof(MsSsimState),
     .provided_features = provided_features,
 };
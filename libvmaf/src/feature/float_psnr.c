@@ -54,6 +54,15 @@ static int extract(VmafFeatureExtractor *fex,
     return 0;
 }
 
+static size_t footprint(enum VmafPixelFormat pix_fmt, unsigned bpc,
+                        unsigned w, unsigned h)
+{
+    (void) pix_fmt;
+    (void) bpc;
+    // ref and dist, as floats
+    return 2 * sizeof(float) * w * h;
+}
+
 static int close(VmafFeatureExtractor *fex)
 {
     PsnrState *s = fex->priv;
@@ -72,6 +81,7 @@ VmafFeatureExtractor vmaf_fex_float_psnr = {
     .init = init,
     .extract = extract,
     .close = close,
+    .footprint = footprint,
     .priv_size = sizeof(PsnrState),
     .provided_features = provided_features,
 };
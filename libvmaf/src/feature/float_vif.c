@@ -71,6 +71,15 @@ static int extract(VmafFeatureExtractor *fex,
     return 0;
 }
 
+static size_t footprint(enum VmafPixelFormat pix_fmt, unsigned bpc,
+                        unsigned w, unsigned h)
+{
+    (void) pix_fmt;
+    (void) bpc;
+    // ref and dist, as floats
+    return 2 * sizeof(float) * w * h;
+}
+
 static int close(VmafFeatureExtractor *fex)
 {
     VifState *s = fex->priv;
@@ -90,6 +99,7 @@ VmafFeatureExtractor vmaf_fex_float_vif = {
     .init = init,
     .extract = extract,
     .close = close,
+    .footprint = footprint,
     .priv_size = sizeof(VifState),
     .provided_features = provided_features,
 };
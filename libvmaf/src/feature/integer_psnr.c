@@ -1,4 +1,5 @@
 #include <math.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "feature_collector.h"
@@ -13,25 +14,58 @@ static int init(VmafFeatureExtractor *fex, enum VmafPixelFormat pix_fmt,
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 
+static double noise_8(VmafPicture *ref_pic, VmafPicture *dist_pic,
+                      unsigned plane, unsigned step)
+{
+    uint8_t *ref = ref_pic->data[plane];
+    uint8_t *dist = dist_pic->data[plane];
+
+    double noise = 0.;
+    for (unsigned j = 0; j < ref_pic->h[plane]; j++) {
+        for (unsigned k = 0; k < ref_pic->w[plane]; k++) {
+            double diff = ref[k * step] - dist[k * step];
+            noise += diff * diff;
+        }
+        ref += ref_pic->stride[plane];
+        dist += dist_pic->stride[plane];
+    }
+    return noise;
+}
+
+static double noise_16(VmafPicture *ref_pic, VmafPicture *dist_pic,
+                       unsigned plane, unsigned step, unsigned shift)
+{
+    uint16_t *ref = ref_pic->data[plane];
+    uint16_t *dist = dist_pic->data[plane];
+
+    double noise = 0.;
+    for (unsigned j = 0; j < ref_pic->h[plane]; j++) {
+        for (unsigned k = 0; k < ref_pic->w[plane]; k++) {
+            double diff = (ref[k * step] >> shift) - (dist[k * step] >> shift);
+            noise += diff * diff;
+        }
+        ref += ref_pic->stride[plane] / 2;
+        dist += dist_pic->stride[plane] / 2;
+    }
+    return noise;
+}
+
 static int extract(VmafFeatureExtractor *fex,
                    VmafPicture *ref_pic, VmafPicture *dist_pic,
                    unsigned index, VmafFeatureCollector *feature_collector)
 {
     int err = 0;
 
+    const int semi_planar = ref_pic->pix_fmt == VMAF_PIX_FMT_NV12 ||
+                            ref_pic->pix_fmt == VMAF_PIX_FMT_P010;
+    const unsigned shift =
+        ref_pic->pix_fmt == VMAF_PIX_FMT_P010 ? 16 - ref_pic->bpc : 0;
+
     for (unsigned i = 0; i < 3; i++) {
-        uint8_t *ref = ref_pic->data[i];
-        uint8_t *dist = dist_pic->data[i];
-
-        double noise = 0.;
-        for (unsigned j = 0; j < ref_pic->h[i]; j++) {
-            for (unsigned k = 0; k < ref_pic->w[i]; k++) {
-                double diff = ref[k] - dist[k];
-                noise += diff * diff;
-            }
-            ref += ref_pic->stride[i];
-            dist += dist_pic->stride[i];
-        }
+        const unsigned step = (i && semi_planar) ? 2 : 1;
+        double noise = ref_pic->bpc > 8 ?
+            noise_16(ref_pic, dist_pic, i, step, shift) :
+            noise_8(ref_pic, dist_pic, i, step);
         noise /= (ref_pic->w[i] * ref_pic->h[i]);
 
         double eps = 1e-10;
@@ -63,5 +97,6 @@ VmafFeatureExtractor vmaf_fex_psnr = {
     .init = init,
     .extract = extract,
     .close = close,
+    .flags = VMAF_FEATURE_EXTRACTOR_CHROMA,
     .provided_features = provided_features,
 };
@@ -86,7 +86,8 @@ struct ssim_moments{
 #define SSIM_K2 (0.03*0.03)
 
 static double calc_ssim(const unsigned char *_src,int _systride,
- const unsigned char *_dst,int _dystride,double _par,int depth,int _w,int _h){
+ const unsigned char *_dst,int _dystride,double _par,int depth,int shift,
+ int _w,int _h){
   ssim_moments  *line_buf;
   ssim_moments **lines;
   double         ssim;
@@ -137,6 +138,8 @@ static double calc_ssim(const unsigned char *_src,int _systride,
              (_src[(x-hkernel_offs+k)*2 + 1] << 8);
             d = _dst[(x-hkernel_offs+k)*2] +
              (_dst[(x-hkernel_offs+k)*2 + 1] << 8);
+            s >>= shift;
+            d >>= shift;
           } else {
             s=_src[(x-hkernel_offs+k)];
             d=_dst[(x-hkernel_offs+k)];
@@ -209,6 +212,7 @@ static int extract(VmafFeatureExtractor *fex,
     double score =
         calc_ssim(ref_pic->data[0], ref_pic->stride[0],
                   dist_pic->data[0], dist_pic->stride[0], 1.0, ref_pic->bpc,
+                  ref_pic->pix_fmt == VMAF_PIX_FMT_P010 ? 16 - ref_pic->bpc : 0,
                   ref_pic->w[0], ref_pic->h[0]);
     int err =
         vmaf_feature_collector_append(feature_collector, "ssim", score, index);
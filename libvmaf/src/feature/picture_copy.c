@@ -6,10 +6,11 @@ void picture_copy_hbd(float *dst, VmafPicture *src, int offset)
 {
     float *float_data = dst;
     uint16_t *data = src->data[0];
+    const unsigned shift = src->pix_fmt == VMAF_PIX_FMT_P010 ? 16 - src->bpc : 0;
 
     for (unsigned i = 0; i < src->h[0]; i++) {
         for (unsigned j = 0; j < src->w[0]; j++) {
-            float_data[j] = (float) data[j] / 4.0 + offset;
+            float_data[j] = (float) (data[j] >> shift) / 4.0 + offset;
         }
         float_data += src->w[0];
         data += src->stride[0] / 2;
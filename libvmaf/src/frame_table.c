@@ -0,0 +1,121 @@
+/**
+ *
+ *  Copyright 2016-2019 Netflix, Inc.
+ *
+ *     Licensed under the Apache License, Version 2.0 (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+#include <stdlib.h>
+#include "frame_table.h"
+
+void init_frame_table(FrameTable *t, size_t chunk_frames)
+{
+    t->chunk = NULL;
+    t->num_chunks = 0;
+    t->chunk_frames = chunk_frames;
+    t->used = 0;
+}
+
+/*
+ * makes room for frames [0, frames), frames not written stay 0
+ * returns 0 on success, -1 if out of memory
+ */
+int reserve_frame_table(FrameTable *t, size_t frames)
+{
+    size_t num_chunks = (frames + t->chunk_frames - 1) / t->chunk_frames;
+
+    if (num_chunks > t->num_chunks)
+    {
+        double **chunk = (double **)realloc(t->chunk, num_chunks * sizeof(double *));
+        if (!chunk)
+            return -1;
+        t->chunk = chunk;
+
+        while (t->num_chunks < num_chunks)
+        {
+            chunk[t->num_chunks] = (double *)calloc(FT_NUM_FEATURES * t->chunk_frames, sizeof(double));
+            if (!chunk[t->num_chunks])
+                return -1;
+            t->num_chunks++;
+        }
+    }
+
+    if (frames > t->used)
+        t->used = frames;
+
+    return 0;
+}
+
+FrameRow get_frame_row(FrameTable *t, size_t frame)
+{
+    FrameRow row;
+    row.values = t->chunk[frame / t->chunk_frames] + frame % t->chunk_frames;
+    row.stride = t->chunk_frames;
+    return row;
+}
+
+/*
+ * copies a feature of every n_subsample-th frame to out, which has room for
+ * ceil(used / n_subsample) values
+ */
+void copy_frame_feature(FrameTable *t, int feature, int n_subsample, double *out)
+{
+    size_t begin = 0;
+
+    for (size_t c = 0; c < t->num_chunks; c++, begin += t->chunk_frames)
+    {
+        const double *col = t->chunk[c] + feature * t->chunk_frames;
+        size_t end = begin + t->chunk_frames < t->used ? begin + t->chunk_frames : t->used;
+        size_t first = (begin + n_subsample - 1) / n_subsample * n_subsample;
+
+        for (size_t i = first; i < end; i += n_subsample)
+            *out++ = col[i - begin];
+    }
+}
+
+/*
+ * computes (num + constant) / (den + constant) of every n_subsample-th frame
+ * into out, like copy_frame_feature()
+ */
+void divide_frame_features(FrameTable *t, int num, int den, double constant, int n_subsample, double *out)
+{
+    size_t begin = 0;
+
+    for (size_t c = 0; c < t->num_chunks; c++, begin += t->chunk_frames)
+    {
+        const double *num_col = t->chunk[c] + num * t->chunk_frames;
+        const double *den_col = t->chunk[c] + den * t->chunk_frames;
+        size_t end = begin + t->chunk_frames < t->used ? begin + t->chunk_frames : t->used;
+        size_t first = (begin + n_subsample - 1) / n_subsample * n_subsample;
+
+        if (n_subsample == 1)
+        {
+            // contiguous, so the compiler can vectorize it
+            for (size_t i = 0; i < end - begin; i++)
+                out[i] = (num_col[i] + constant) / (den_col[i] + constant);
+            out += end - begin;
+            continue;
+        }
+
+        for (size_t i = first; i < end; i += n_subsample)
+            *out++ = (num_col[i - begin] + constant) / (den_col[i - begin] + constant);
+    }
+}
+
+void free_frame_table(FrameTable *t)
+{
+    for (size_t c = 0; c < t->num_chunks; c++)
+        free(t->chunk[c]);
+    free(t->chunk);
+    init_frame_table(t, t->chunk_frames);
+}
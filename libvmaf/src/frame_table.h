@@ -0,0 +1,99 @@
+/**
+ *
+ *  Copyright 2016-2019 Netflix, Inc.
+ *
+ *     Licensed under the Apache License, Version 2.0 (the "License");
+ *     you may not use this file except in compliance with the License.
+ *     You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *     Unless required by applicable law or agreed to in writing, software
+ *     distributed under the License is distributed on an "AS IS" BASIS,
+ *     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *     See the License for the specific language governing permissions and
+ *     limitations under the License.
+ *
+ */
+#pragma once
+
+#ifndef FRAME_TABLE_H_
+#define FRAME_TABLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/*
+ * Per-frame features of the legacy engine, as a frame x feature table. The
+ * table is stored in chunks of chunk_frames frames, and within a chunk by
+ * column, so that a feature of consecutive frames is contiguous. Chunks
+ * never move once allocated.
+ *
+ * reserve_frame_table() and get_frame_row() must not run concurrently.
+ * Writing through the rows of different frames needs no lock.
+ */
+
+enum
+{
+    FT_ADM_NUM,
+    FT_ADM_DEN,
+    FT_ADM_NUM_SCALE0,
+    FT_ADM_DEN_SCALE0,
+    FT_ADM_NUM_SCALE1,
+    FT_ADM_DEN_SCALE1,
+    FT_ADM_NUM_SCALE2,
+    FT_ADM_DEN_SCALE2,
+    FT_ADM_NUM_SCALE3,
+    FT_ADM_DEN_SCALE3,
+    FT_MOTION,
+    FT_MOTION2,
+    FT_VIF_NUM_SCALE0,
+    FT_VIF_DEN_SCALE0,
+    FT_VIF_NUM_SCALE1,
+    FT_VIF_DEN_SCALE1,
+    FT_VIF_NUM_SCALE2,
+    FT_VIF_DEN_SCALE2,
+    FT_VIF_NUM_SCALE3,
+    FT_VIF_DEN_SCALE3,
+    FT_VIF,
+    FT_PSNR,
+    FT_SSIM,
+    FT_MS_SSIM,
+    FT_NUM_FEATURES
+};
+
+typedef struct
+{
+    double **chunk;
+    size_t num_chunks;
+    size_t chunk_frames;
+    size_t used;
+} FrameTable;
+
+/* The features of one frame, feature f is at values[f * stride]. */
+typedef struct
+{
+    double *values;
+    size_t stride;
+} FrameRow;
+
+void init_frame_table(FrameTable *t, size_t chunk_frames);
+int reserve_frame_table(FrameTable *t, size_t frames);
+FrameRow get_frame_row(FrameTable *t, size_t frame);
+void copy_frame_feature(FrameTable *t, int feature, int n_subsample, double *out);
+void divide_frame_features(FrameTable *t, int num, int den, double constant, int n_subsample, double *out);
+void free_frame_table(FrameTable *t);
+
+static inline void set_frame_feature(FrameRow row, int feature, double value)
+{
+    row.values[feature * row.stride] = value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_TABLE_H_ */
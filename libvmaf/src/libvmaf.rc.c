@@ -1,4 +1,10 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,19 +14,67 @@
 #include "feature/common/cpu.h"
 #include "feature/feature_extractor.h"
 #include "feature/feature_collector.h"
+#include "feature/feature_stats.h"
 #include "fex_ctx_vector.h"
 #include "model.h"
 #include "output.h"
 #include "picture.h"
 #include "predict.h"
+#include "quantile.h"
+#include "ref_cache.h"
+#include "scale.h"
 #include "thread_pool.h"
+#include "trace.h"
+
 
 typedef struct VmafContext {
     VmafConfiguration cfg;
     VmafFeatureCollector *feature_collector;
     RegisteredFeatureExtractors registered_feature_extractors;
     VmafFeatureExtractorContextPool *fex_ctx_pool;
+    VmafFexStats *fex_stats;
     VmafThreadPool *thread_pool;
+    VmafThreadPoolGroup jobs;
+    struct VmafContext *reference_source;
+    struct {
+        struct VmafContext **ctx;
+        unsigned cnt;
+        pthread_rwlock_t lock;
+    } dependents;
+    atomic_int job_err;
+    bool features_reserved;
+    VmafScaler *scaler;
+    struct {
+        pthread_mutex_t lock;
+        VmafPicture pic;
+        const void *data;
+        unsigned index;
+    } scaled_ref;
+    struct {
+        VmafRefCache *cache;
+        VmafFeatureCollector *scratch;
+        VmafPicture prev[2];
+        unsigned next_index;
+        bool keyed, hit, finished;
+    } ref_cache;
+    struct {
+        struct {
+            VmafModel *model;
+            void (*cb)(void *user, unsigned index, double score);
+            void *user;
+            unsigned next_index;
+            bool busy, again;
+        } *entry;
+        unsigned cnt, capacity;
+        unsigned first_index;
+        bool started;
+        pthread_mutex_t lock;
+        pthread_cond_t idle;
+    } score_callback;
+    struct {
+        VmafTrace *trace;
+        FILE *outfile;
+    } trace;
 } VmafContext;
 
 enum vmaf_cpu cpu;
@@ -31,6 +85,7 @@ enum vmaf_cpu cpu;
 int vmaf_init(VmafContext **vmaf, VmafConfiguration cfg)
 {
     if (!vmaf) return -EINVAL;
+    if (cfg.thread_pool && !cfg.n_threads) return -EINVAL;
     int err = 0;
 
     cpu = cpu_autodetect(); //FIXME, see above
@@ -39,23 +94,57 @@ int vmaf_init(VmafContext **vmaf, VmafConfiguration cfg)
     if (!v) goto fail;
     memset(v, 0, sizeof(*v));
     v->cfg = cfg;
+    atomic_init(&v->job_err, 0);
 
     err = vmaf_feature_collector_init(&(v->feature_collector));
     if (err) goto free_v;
     err = feature_extractor_vector_init(&(v->registered_feature_extractors));
     if (err) goto free_feature_collector;
 
+    err = pthread_mutex_init(&(v->score_callback.lock), NULL);
+    if (err) goto free_feature_extractor_vector;
+    err = pthread_cond_init(&(v->score_callback.idle), NULL);
+    if (err) goto free_score_callback_lock;
+    err = pthread_mutex_init(&(v->scaled_ref.lock), NULL);
+    if (err) goto free_score_callback_idle;
+    err = pthread_rwlock_init(&(v->dependents.lock), NULL);
+    if (err) goto free_scaled_ref_lock;
+
+    // one entry per feature extractor, shared by all of its contexts
+    const unsigned fex_cnt = vmaf_get_feature_extractor_cnt();
+    if (v->cfg.flags & VMAF_CONFIGURATION_FLAG_STATS) {
+        v->fex_stats = malloc(sizeof(*(v->fex_stats)) * fex_cnt);
+        if (!v->fex_stats) goto free_dependents_lock;
+        for (unsigned i = 0; i < fex_cnt; i++)
+            vmaf_fex_stats_init(&(v->fex_stats[i]));
+    }
+
     if (v->cfg.n_threads > 0) {
-        err = vmaf_thread_pool_create(&v->thread_pool, v->cfg.n_threads);
-        if (err) goto free_feature_extractor_vector;
-        err = vmaf_fex_ctx_pool_create(&v->fex_ctx_pool, v->cfg.n_threads);
+        v->thread_pool = v->cfg.thread_pool;
+        if (!v->thread_pool)
+            err = vmaf_thread_pool_create(&v->thread_pool, v->cfg.n_threads);
+        if (err) goto free_fex_stats;
+        err = vmaf_fex_ctx_pool_create(&v->fex_ctx_pool, v->cfg.n_threads,
+                                       v->cfg.memory_budget, v->fex_stats);
         if (err) goto free_thread_pool;
     }
 
     return 0;
 
 free_thread_pool:
-    vmaf_thread_pool_destroy(v->thread_pool);
+    if (!v->cfg.thread_pool) vmaf_thread_pool_destroy(v->thread_pool);
+free_fex_stats:
+    for (unsigned i = 0; v->fex_stats && i < fex_cnt; i++)
+        vmaf_fex_stats_destroy(&(v->fex_stats[i]));
+    free(v->fex_stats);
+free_dependents_lock:
+    pthread_rwlock_destroy(&(v->dependents.lock));
+free_scaled_ref_lock:
+    pthread_mutex_destroy(&(v->scaled_ref.lock));
+free_score_callback_idle:
+    pthread_cond_destroy(&(v->score_callback.idle));
+free_score_callback_lock:
+    pthread_mutex_destroy(&(v->score_callback.lock));
 free_feature_extractor_vector:
     feature_extractor_vector_destroy(&(v->registered_feature_extractors));
 free_feature_collector:
@@ -69,15 +158,122 @@ fail:
 int vmaf_close(VmafContext *vmaf)
 {
     if (!vmaf) return -EINVAL;
+    int err = 0;
 
-    vmaf_thread_pool_wait(vmaf->thread_pool);
+    vmaf_thread_pool_wait_group(vmaf->thread_pool, &vmaf->jobs);
+    if (vmaf->reference_source) {
+        // waits for the source to finish forwarding scores to `vmaf`
+        VmafContext *source = vmaf->reference_source;
+        pthread_rwlock_wrlock(&(source->dependents.lock));
+        for (unsigned i = 0; i < source->dependents.cnt; i++) {
+            if (source->dependents.ctx[i] != vmaf) continue;
+            source->dependents.ctx[i] =
+                source->dependents.ctx[--source->dependents.cnt];
+            break;
+        }
+        pthread_rwlock_unlock(&(source->dependents.lock));
+    }
+    if (vmaf->trace.trace)
+        err = vmaf_trace_write(vmaf->trace.trace, vmaf->trace.outfile);
+    vmaf_picture_unref(&vmaf->ref_cache.prev[0]);
+    vmaf_picture_unref(&vmaf->ref_cache.prev[1]);
+    vmaf_ref_cache_destroy(vmaf->ref_cache.cache);
+    vmaf_feature_collector_destroy(vmaf->ref_cache.scratch);
+    if (vmaf->scaled_ref.data) vmaf_picture_unref(&vmaf->scaled_ref.pic);
+    pthread_mutex_destroy(&(vmaf->scaled_ref.lock));
+    pthread_rwlock_destroy(&(vmaf->dependents.lock));
+    free(vmaf->dependents.ctx);
+    vmaf_scaler_destroy(vmaf->scaler);
     feature_extractor_vector_destroy(&(vmaf->registered_feature_extractors));
     vmaf_feature_collector_destroy(vmaf->feature_collector);
-    vmaf_thread_pool_destroy(vmaf->thread_pool);
+    if (!vmaf->cfg.thread_pool) vmaf_thread_pool_destroy(vmaf->thread_pool);
+    vmaf_trace_destroy(vmaf->trace.trace);
     vmaf_fex_ctx_pool_destroy(vmaf->fex_ctx_pool);
+    for (unsigned i = 0;
+         vmaf->fex_stats && i < vmaf_get_feature_extractor_cnt(); i++)
+        vmaf_fex_stats_destroy(&(vmaf->fex_stats[i]));
+    free(vmaf->fex_stats);
+    pthread_cond_destroy(&(vmaf->score_callback.idle));
+    pthread_mutex_destroy(&(vmaf->score_callback.lock));
+    free(vmaf->score_callback.entry);
     free(vmaf);
 
-    return 0;
+    return err;
+}
+
+int vmaf_reset(VmafContext *vmaf)
+{
+    if (!vmaf) return -EINVAL;
+    if (vmaf->reference_source || vmaf->dependents.cnt) return -EINVAL;
+    int err = 0;
+
+    vmaf_thread_pool_wait_group(vmaf->thread_pool, &vmaf->jobs);
+
+    // fresh feature extractor contexts, as if the features were registered
+    // again, counting into the same, cleared, stats
+    RegisteredFeatureExtractors *rfe = &(vmaf->registered_feature_extractors);
+    for (unsigned i = 0; i < rfe->cnt; i++) {
+        VmafFeatureExtractorContext *fex_ctx = rfe->fex_ctx[i];
+        VmafFeatureExtractor *fex =
+            vmaf_get_feature_extractor_by_name((char *) fex_ctx->fex->name);
+        if (!fex) return -EINVAL;
+        VmafFeatureExtractorContext *fresh;
+        err = vmaf_feature_extractor_context_create(&fresh, fex);
+        if (err) return err;
+        fresh->stats = fex_ctx->stats;
+        vmaf_feature_extractor_context_close(fex_ctx);
+        vmaf_feature_extractor_context_destroy(fex_ctx);
+        rfe->fex_ctx[i] = fresh;
+    }
+
+    if (vmaf->fex_ctx_pool) {
+        VmafFeatureExtractorContextPool *fex_ctx_pool;
+        err = vmaf_fex_ctx_pool_create(&fex_ctx_pool, vmaf->cfg.n_threads,
+                                       vmaf->cfg.memory_budget,
+                                       vmaf->fex_stats);
+        if (err) return err;
+        vmaf_fex_ctx_pool_destroy(vmaf->fex_ctx_pool);
+        vmaf->fex_ctx_pool = fex_ctx_pool;
+    }
+
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    if (err) return err;
+    vmaf_feature_collector_destroy(vmaf->feature_collector);
+    vmaf->feature_collector = feature_collector;
+
+    vmaf_picture_unref(&vmaf->ref_cache.prev[0]);
+    vmaf_picture_unref(&vmaf->ref_cache.prev[1]);
+    vmaf_ref_cache_destroy(vmaf->ref_cache.cache);
+    vmaf_feature_collector_destroy(vmaf->ref_cache.scratch);
+    memset(&vmaf->ref_cache, 0, sizeof(vmaf->ref_cache));
+
+    if (vmaf->scaled_ref.data) vmaf_picture_unref(&vmaf->scaled_ref.pic);
+    vmaf->scaled_ref.data = NULL;
+
+    if (vmaf->trace.trace) {
+        err = vmaf_trace_write(vmaf->trace.trace, vmaf->trace.outfile);
+        if (!vmaf->cfg.thread_pool)
+            vmaf_thread_pool_set_trace(vmaf->thread_pool, NULL);
+        vmaf_trace_destroy(vmaf->trace.trace);
+        vmaf->trace.trace = NULL;
+        vmaf->trace.outfile = NULL;
+    }
+
+    for (unsigned i = 0;
+         vmaf->fex_stats && i < vmaf_get_feature_extractor_cnt(); i++)
+    {
+        vmaf_fex_stats_destroy(&(vmaf->fex_stats[i]));
+        vmaf_fex_stats_init(&(vmaf->fex_stats[i]));
+    }
+
+    vmaf->score_callback.cnt = 0;
+    vmaf->score_callback.first_index = 0;
+    vmaf->score_callback.started = false;
+    vmaf->features_reserved = false;
+    atomic_store(&vmaf->job_err, 0);
+
+    return err;
 }
 
 int vmaf_import_feature_score(VmafContext *vmaf, char *feature_name,
@@ -90,6 +286,17 @@ int vmaf_import_feature_score(VmafContext *vmaf, char *feature_name,
                                          value, index);
 }
 
+static int validate_feature_extractor(VmafContext *vmaf,
+                                      VmafFeatureExtractor *fex)
+{
+    if ((vmaf->cfg.flags & VMAF_CONFIGURATION_FLAG_LUMA_ONLY) &&
+        (fex->flags & VMAF_FEATURE_EXTRACTOR_CHROMA))
+    {
+        return -EINVAL;
+    }
+    return 0;
+}
+
 int vmaf_use_feature(VmafContext *vmaf, const char *feature_name)
 {
     if (!vmaf) return -EINVAL;
@@ -100,10 +307,14 @@ int vmaf_use_feature(VmafContext *vmaf, const char *feature_name)
     VmafFeatureExtractor *fex =
         vmaf_get_feature_extractor_by_name(feature_name);
     if (!fex) return -EINVAL;
+    err = validate_feature_extractor(vmaf, fex);
+    if (err) return err;
 
     VmafFeatureExtractorContext *fex_ctx;
     err = vmaf_feature_extractor_context_create(&fex_ctx, fex);
     if (err) return err;
+    if (vmaf->fex_stats)
+        fex_ctx->stats = &(vmaf->fex_stats[fex_ctx->fex_index]);
 
     RegisteredFeatureExtractors *rfe = &(vmaf->registered_feature_extractors);
     err = feature_extractor_vector_append(rfe, fex_ctx);
@@ -126,10 +337,14 @@ int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model)
         VmafFeatureExtractor *fex =
             vmaf_get_feature_extractor_by_feature_name(model->feature[i].name);
         if (!fex) return -EINVAL;
+        err = validate_feature_extractor(vmaf, fex);
+        if (err) return err;
 
         VmafFeatureExtractorContext *fex_ctx;
         err = vmaf_feature_extractor_context_create(&fex_ctx, fex);
         if (err) return err;
+        if (vmaf->fex_stats)
+            fex_ctx->stats = &(vmaf->fex_stats[fex_ctx->fex_index]);
         err = feature_extractor_vector_append(rfe, fex_ctx);
         if (err) {
             err |= vmaf_feature_extractor_context_destroy(fex_ctx);
@@ -139,70 +354,738 @@ int vmaf_use_features_from_model(VmafContext *vmaf, VmafModel *model)
     return 0;
 }
 
+static void forward_reference_score(void *user, const char *feature_name,
+                                    double score, unsigned index);
+static void reserve_features(VmafContext *vmaf, VmafFeatureExtractor *fex);
+
+int vmaf_use_reference_features_from(VmafContext *vmaf, VmafContext *source)
+{
+    if (!vmaf) return -EINVAL;
+    if (!source) return -EINVAL;
+    if (vmaf == source) return -EINVAL;
+    if (source->reference_source) return -EINVAL;
+    if (vmaf->dependents.cnt) return -EINVAL;
+    if (vmaf->reference_source) return -EINVAL;
+    if (vmaf->cfg.n_subsample != source->cfg.n_subsample) return -EINVAL;
+
+    // forwarded scores may land before `vmaf` reads its first picture
+    RegisteredFeatureExtractors *rfe = &(vmaf->registered_feature_extractors);
+    for (unsigned i = 0; i < rfe->cnt; i++)
+        reserve_features(vmaf, rfe->fex_ctx[i]->fex);
+
+    pthread_rwlock_wrlock(&(source->dependents.lock));
+    VmafContext **ctx = realloc(source->dependents.ctx,
+                                sizeof(*ctx) * (source->dependents.cnt + 1));
+    if (!ctx) {
+        pthread_rwlock_unlock(&(source->dependents.lock));
+        return -ENOMEM;
+    }
+    source->dependents.ctx = ctx;
+    source->dependents.ctx[source->dependents.cnt++] = vmaf;
+    if (source->dependents.cnt == 1) {
+        vmaf_feature_collector_set_observer(source->feature_collector,
+                                            forward_reference_score, source);
+    }
+    pthread_rwlock_unlock(&(source->dependents.lock));
+
+    vmaf->reference_source = source;
+    return 0;
+}
+
+int vmaf_use_reference_cache(VmafContext *vmaf, const char *path)
+{
+    if (!vmaf) return -EINVAL;
+    if (!path) return -EINVAL;
+    if (vmaf->ref_cache.cache) return -EINVAL;
+
+    int err = vmaf_feature_collector_init(&vmaf->ref_cache.scratch);
+    if (err) return err;
+    err = vmaf_ref_cache_init(&vmaf->ref_cache.cache, path);
+    if (err) {
+        vmaf_feature_collector_destroy(vmaf->ref_cache.scratch);
+        vmaf->ref_cache.scratch = NULL;
+        return err;
+    }
+    vmaf->ref_cache.hit = true;
+    return 0;
+}
+
+int vmaf_use_scaling(VmafContext *vmaf, unsigned w, unsigned h,
+                     enum VmafScalingMethod method)
+{
+    if (!vmaf) return -EINVAL;
+    if (vmaf->scaler) return -EINVAL;
+
+    return vmaf_scaler_init(&vmaf->scaler, w, h, method);
+}
+
+int vmaf_use_trace(VmafContext *vmaf, FILE *outfile)
+{
+    if (!vmaf) return -EINVAL;
+    if (!outfile) return -EINVAL;
+    if (vmaf->trace.trace) return -EINVAL;
+
+    int err = vmaf_trace_init(&vmaf->trace.trace);
+    if (err) return err;
+    vmaf->trace.outfile = outfile;
+    // a shared pool runs the jobs of other contexts too, and outlives this
+    if (vmaf->thread_pool && !vmaf->cfg.thread_pool)
+        vmaf_thread_pool_set_trace(vmaf->thread_pool, vmaf->trace.trace);
+    return 0;
+}
+
+int vmaf_feature_extractor_bytes(VmafContext *vmaf, const char *name,
+                                 size_t *bytes)
+{
+    if (!vmaf) return -EINVAL;
+    if (!bytes) return -EINVAL;
+
+    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
+    if (!name) {
+        *bytes = 0;
+        for (unsigned i = 0; i < rfe.cnt; i++) {
+            size_t b;
+            int err = vmaf_feature_extractor_bytes(vmaf,
+                                                   rfe.fex_ctx[i]->fex->name,
+                                                   &b);
+            if (err) return err;
+            *bytes += b;
+        }
+        return 0;
+    }
+
+    for (unsigned i = 0; i < rfe.cnt; i++) {
+        VmafFeatureExtractorContext *fex_ctx = rfe.fex_ctx[i];
+        if (strcmp(fex_ctx->fex->name, name)) continue;
+
+        // without threads the registered context does the extracting
+        *bytes = fex_ctx->is_initialized ? fex_ctx->bytes : 0;
+        if (!vmaf->fex_ctx_pool) return 0;
+        size_t pooled;
+        int err = vmaf_fex_ctx_pool_bytes(vmaf->fex_ctx_pool,
+                                          fex_ctx->fex_index, &pooled);
+        if (err) return err;
+        *bytes += pooled;
+        return 0;
+    }
+    return -EINVAL;
+}
+
+int vmaf_get_stats(VmafContext *vmaf, VmafStats *stats)
+{
+    if (!vmaf) return -EINVAL;
+    if (!stats) return -EINVAL;
+    if (!vmaf->fex_stats) return -EINVAL;
+
+    memset(stats, 0, sizeof(*stats));
+    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
+    for (unsigned i = 0; i < rfe.cnt; i++) {
+        if (stats->fex_cnt == VMAF_STATS_MAX_FEATURE_EXTRACTORS) break;
+        VmafFeatureExtractorContext *fex_ctx = rfe.fex_ctx[i];
+        VmafFeatureExtractorStats *s = &stats->fex[stats->fex_cnt++];
+
+        VmafFexStats copy;
+        int err = vmaf_fex_stats_copy(fex_ctx->stats, &copy);
+        if (err) return err;
+        s->name = fex_ctx->fex->name;
+        s->calls = copy.calls;
+        s->extract = copy.extract;
+        s->extract_min = copy.extract_min;
+        s->extract_max = copy.extract_max;
+        s->extract_p99 = vmaf_fex_stats_quantile(&copy, .99);
+        s->prepare = copy.prepare;
+        s->queue_wait = copy.queue_wait;
+        s->acquire_wait = copy.aquire_wait;
+        err = vmaf_feature_extractor_bytes(vmaf, s->name, &s->bytes);
+        if (err) return err;
+    }
+    return 0;
+}
+
+static unsigned find_score_callback(VmafContext *vmaf, VmafModel *model)
+{
+    unsigned i;
+    for (i = 0; i < vmaf->score_callback.cnt; i++) {
+        if (vmaf->score_callback.entry[i].model == model)
+            break;
+    }
+    return i;
+}
+
+/* The first index which is scored at all, i.e. not subsampled away. */
+static unsigned first_score_index(VmafContext *vmaf)
+{
+    const unsigned step =
+        vmaf->cfg.n_subsample > 1 ? vmaf->cfg.n_subsample : 1;
+    const unsigned index = vmaf->score_callback.first_index;
+    return index % step ? index + step - index % step : index;
+}
+
+int vmaf_set_score_callback(VmafContext *vmaf, VmafModel *model,
+                            void (*cb)(void *user, unsigned index,
+                                       double score),
+                            void *user)
+{
+    if (!vmaf) return -EINVAL;
+    if (!model) return -EINVAL;
+
+    pthread_mutex_lock(&(vmaf->score_callback.lock));
+    int err = 0;
+
+    /* once this returns, the previous callback is not running anymore */
+    unsigned i = find_score_callback(vmaf, model);
+    while (i < vmaf->score_callback.cnt && vmaf->score_callback.entry[i].busy) {
+        pthread_cond_wait(&(vmaf->score_callback.idle),
+                          &(vmaf->score_callback.lock));
+        i = find_score_callback(vmaf, model);
+    }
+
+    if (!cb) {
+        if (i < vmaf->score_callback.cnt) {
+            vmaf->score_callback.entry[i] =
+                vmaf->score_callback.entry[--vmaf->score_callback.cnt];
+        }
+        goto unlock;
+    }
+
+    if (i == vmaf->score_callback.cnt) {
+        if (vmaf->score_callback.cnt == vmaf->score_callback.capacity) {
+            const unsigned capacity = vmaf->score_callback.capacity ?
+                vmaf->score_callback.capacity * 2 : 4;
+            void *entry = realloc(vmaf->score_callback.entry,
+                sizeof(*(vmaf->score_callback.entry)) * capacity);
+            if (!entry) {
+                err = -ENOMEM;
+                goto unlock;
+            }
+            vmaf->score_callback.entry = entry;
+            vmaf->score_callback.capacity = capacity;
+        }
+        vmaf->score_callback.entry[i].next_index = first_score_index(vmaf);
+        vmaf->score_callback.entry[i].busy = false;
+        vmaf->score_callback.entry[i].again = false;
+        vmaf->score_callback.cnt++;
+    }
+
+    vmaf->score_callback.entry[i].model = model;
+    vmaf->score_callback.entry[i].cb = cb;
+    vmaf->score_callback.entry[i].user = user;
+
+unlock:
+    pthread_mutex_unlock(&(vmaf->score_callback.lock));
+    return err;
+}
+
+/* Scores are delivered from the first index read onwards. Temporal
+ * extractors take a picture starting mid-stream as lookbehind, and do not
+ * score it, so delivery starts at the next one then. */
+static void start_score_callbacks(VmafContext *vmaf, unsigned index)
+{
+    bool lookbehind = false;
+    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
+    for (unsigned i = 0; index && i < rfe.cnt; i++)
+        lookbehind |= !!(rfe.fex_ctx[i]->fex->flags &
+                         VMAF_FEATURE_EXTRACTOR_TEMPORAL);
+
+    pthread_mutex_lock(&(vmaf->score_callback.lock));
+    if (!vmaf->score_callback.started) {
+        vmaf->score_callback.started = true;
+        vmaf->score_callback.first_index = index + lookbehind;
+        for (unsigned i = 0; i < vmaf->score_callback.cnt; i++)
+            vmaf->score_callback.entry[i].next_index = first_score_index(vmaf);
+    }
+    pthread_mutex_unlock(&(vmaf->score_callback.lock));
+}
+
+/* Each callback is claimed by one thread at a time, which predicts and
+ * delivers without holding the lock. A thread finding it claimed leaves
+ * `again` behind, so that the claiming thread looks once more before it
+ * lets go, instead of missing the index this thread completed. */
+static void notify_score_callbacks(VmafContext *vmaf)
+{
+    pthread_mutex_lock(&(vmaf->score_callback.lock));
+    const unsigned step =
+        vmaf->cfg.n_subsample > 1 ? vmaf->cfg.n_subsample : 1;
+
+    for (unsigned i = 0; i < vmaf->score_callback.cnt; i++) {
+        if (vmaf->score_callback.entry[i].busy) {
+            vmaf->score_callback.entry[i].again = true;
+            continue;
+        }
+        vmaf->score_callback.entry[i].busy = true;
+        VmafModel *model = vmaf->score_callback.entry[i].model;
+        void (*cb)(void *user, unsigned index, double score) =
+            vmaf->score_callback.entry[i].cb;
+        void *user = vmaf->score_callback.entry[i].user;
+        unsigned index = vmaf->score_callback.entry[i].next_index;
+
+        do {
+            vmaf->score_callback.entry[i].again = false;
+            pthread_mutex_unlock(&(vmaf->score_callback.lock));
+            /* deliver in index order, stop at the first incomplete index */
+            for (;;) {
+                double score;
+                int err = vmaf_predict_score_at_index(model,
+                                                      vmaf->feature_collector,
+                                                      index, &score);
+                if (err) break;
+                cb(user, index, score);
+                index += step;
+            }
+            pthread_mutex_lock(&(vmaf->score_callback.lock));
+            // a claimed entry is not removed, but may have been moved
+            i = find_score_callback(vmaf, model);
+        } while (vmaf->score_callback.entry[i].again);
+
+        vmaf->score_callback.entry[i].next_index = index;
+        vmaf->score_callback.entry[i].busy = false;
+        pthread_cond_broadcast(&(vmaf->score_callback.idle));
+    }
+
+    pthread_mutex_unlock(&(vmaf->score_callback.lock));
+}
+
 struct ThreadData {
     VmafFeatureExtractorContext *fex_ctx;
     VmafPicture ref, dist;
     unsigned index;
+    double enqueued;
+    VmafContext *vmaf;
     VmafFeatureCollector *feature_collector;
-    VmafFeatureExtractorContextPool *fex_ctx_pool;
     int err;
 };
 
+static bool skip_feature_extractor(VmafContext *vmaf,
+                                   VmafFeatureExtractor *fex, unsigned index,
+                                   bool cached)
+{
+    if ((vmaf->reference_source || cached) &&
+        (fex->flags & VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY))
+    {
+        return true;
+    }
+    return (vmaf->cfg.n_subsample > 1) && (index % vmaf->cfg.n_subsample) &&
+           !(fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL);
+}
+
+/* Copy reference-only scores which `vmaf` did not extract itself. */
+static void import_reference_features(VmafContext *vmaf,
+                                      VmafFeatureExtractor *fex,
+                                      VmafFeatureCollector *src)
+{
+    if (!(fex->flags & VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY)) return;
+    if (!fex->provided_features) return;
+
+    for (unsigned i = 0; fex->provided_features[i]; i++) {
+        vmaf_feature_collector_import(vmaf->feature_collector, src,
+                                      (char *) fex->provided_features[i]);
+    }
+}
+
+/* Output columns follow the order in which features are first collected.
+ * Reserving them up front, in registration order, gives the same columns
+ * to a context which imports reference-only scores later, or which starts
+ * mid-stream where temporal and subsampled extractors append late. */
+static void reserve_features(VmafContext *vmaf, VmafFeatureExtractor *fex)
+{
+    if (!fex->provided_features) return;
+
+    for (unsigned i = 0; fex->provided_features[i]; i++) {
+        vmaf_feature_collector_reserve(vmaf->feature_collector,
+                                       (char *) fex->provided_features[i]);
+    }
+}
+
 static void threaded_extract_func(void *e)
 {
     struct ThreadData *f = e;
+    VmafTrace *trace = f->vmaf->trace.trace;
 
+    if (f->fex_ctx->stats) {
+        vmaf_fex_stats_add(f->fex_ctx->stats, VMAF_FEX_STATS_QUEUE_WAIT,
+                           vmaf_fex_stats_clock() - f->enqueued);
+    }
+    vmaf_trace_begin(trace, "extract", f->fex_ctx->fex->name, f->index);
     f->err = vmaf_feature_extractor_context_extract(f->fex_ctx, &f->ref,
                                                     &f->dist, f->index,
                                                     f->feature_collector);
-    f->err = vmaf_fex_ctx_pool_release(f->fex_ctx_pool, f->fex_ctx);
+    vmaf_trace_end(trace, "extract", f->fex_ctx->fex->name);
+    f->err = vmaf_fex_ctx_pool_release(f->vmaf->fex_ctx_pool, f->fex_ctx);
     vmaf_picture_unref(&f->ref);
     vmaf_picture_unref(&f->dist);
+    notify_score_callbacks(f->vmaf);
 }
 
-static int threaded_read_pictures(VmafContext *vmaf, VmafPicture *ref,
-                                  VmafPicture *dist, unsigned index)
+/* Jobs on the thread pool have no caller to return an error to, the first
+ * one is kept for the next call which can. */
+static void set_job_error(VmafContext *vmaf, int err)
 {
-    if (!vmaf) return -EINVAL;
-    if (!ref) return -EINVAL;
-    if (!dist) return -EINVAL;
+    int none = 0;
+    if (err) atomic_compare_exchange_strong(&vmaf->job_err, &none, err);
+}
 
-    int err = 0;
+static bool provides_reference_feature(VmafContext *vmaf,
+                                       const char *feature_name)
+{
+    RegisteredFeatureExtractors *rfe = &(vmaf->registered_feature_extractors);
+    for (unsigned i = 0; i < rfe->cnt; i++) {
+        VmafFeatureExtractor *fex = rfe->fex_ctx[i]->fex;
+        if (!(fex->flags & VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY)) continue;
+        for (unsigned j = 0; fex->provided_features &&
+                             fex->provided_features[j]; j++)
+        {
+            if (!strcmp(fex->provided_features[j], feature_name))
+                return true;
+        }
+    }
+    return false;
+}
 
-    for (unsigned i = 0; i < vmaf->registered_feature_extractors.cnt; i++) {
-        VmafPicture pic_a, pic_b;
-        vmaf_picture_ref(&pic_a, ref);
-        vmaf_picture_ref(&pic_b, dist);
+/* Observes the collector of a source context. A reference-only score is
+ * copied into each dependent as soon as the source writes it, so that the
+ * dependent can predict, and call back, without waiting for its flush. */
+static void forward_reference_score(void *user, const char *feature_name,
+                                    double score, unsigned index)
+{
+    VmafContext *source = user;
 
-        VmafFeatureExtractor *fex =
-            vmaf->registered_feature_extractors.fex_ctx[i]->fex;
+    pthread_rwlock_rdlock(&(source->dependents.lock));
+    for (unsigned i = 0; i < source->dependents.cnt; i++) {
+        VmafContext *vmaf = source->dependents.ctx[i];
+        if (!provides_reference_feature(vmaf, feature_name)) continue;
+        double written;
+        if (!vmaf_feature_collector_get_score(vmaf->feature_collector,
+                                              (char *) feature_name,
+                                              &written, index))
+        {
+            continue;
+        }
+        int err = vmaf_feature_collector_append(vmaf->feature_collector,
+                                                (char *) feature_name, score,
+                                                index);
+        set_job_error(vmaf, err);
+        notify_score_callbacks(vmaf);
+    }
+    pthread_rwlock_unlock(&(source->dependents.lock));
+}
+
+struct PreparedThreadData {
+    VmafFexTicket *ticket;
+    VmafPicture ref, dist;
+    unsigned index;
+    VmafFexStats *stats;
+    double enqueued;
+    VmafContext *vmaf;
+    VmafFeatureCollector *feature_collector;
+};
 
-        if ((vmaf->cfg.n_subsample > 1) && (index % vmaf->cfg.n_subsample) &&
-            !(fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL))
+/* Prepare concurrently, then wait on the ticket for the ordered part. */
+static void threaded_prepare_func(void *e)
+{
+    struct PreparedThreadData *f = e;
+    VmafTrace *trace = f->vmaf->trace.trace;
+    VmafFeatureExtractor *fex = vmaf_fex_ticket_fex(f->ticket);
+
+    const double start = f->stats ? vmaf_fex_stats_clock() : 0.;
+    if (f->stats) {
+        vmaf_fex_stats_add(f->stats, VMAF_FEX_STATS_QUEUE_WAIT,
+                           start - f->enqueued);
+    }
+    void *prepared = NULL;
+    vmaf_trace_begin(trace, "prepare", fex->name, f->index);
+    int err = fex->prepare(fex, &f->ref, &f->dist, &prepared);
+    vmaf_trace_end(trace, "prepare", fex->name);
+    if (f->stats) {
+        vmaf_fex_stats_add(f->stats, VMAF_FEX_STATS_PREPARE,
+                           vmaf_fex_stats_clock() - start);
+    }
+    set_job_error(f->vmaf, err);
+    vmaf_trace_begin(trace, "sequence", fex->name, f->index);
+    err = vmaf_fex_ctx_pool_sequence(f->vmaf->fex_ctx_pool, f->ticket,
+                                     err ? NULL : prepared, f->index,
+                                     f->feature_collector);
+    vmaf_trace_end(trace, "sequence", fex->name);
+    set_job_error(f->vmaf, err);
+    vmaf_picture_unref(&f->ref);
+    vmaf_picture_unref(&f->dist);
+    notify_score_callbacks(f->vmaf);
+}
+
+static int enqueue_prepare(VmafContext *vmaf,
+                           VmafFeatureExtractorContext *fex_ctx,
+                           VmafPicture *ref, VmafPicture *dist,
+                           unsigned index,
+                           VmafFeatureCollector *feature_collector)
+{
+    struct PreparedThreadData data = {
+        .index = index,
+        .stats = fex_ctx->stats,
+        .vmaf = vmaf,
+        .feature_collector = feature_collector,
+    };
+    int err = vmaf_fex_ctx_pool_ticket(vmaf->fex_ctx_pool, fex_ctx->fex_index,
+                                       ref, &data.ticket);
+    if (err) return err;
+    vmaf_picture_ref(&data.ref, ref);
+    vmaf_picture_ref(&data.dist, dist);
+
+    if (data.stats) data.enqueued = vmaf_fex_stats_clock();
+    err = vmaf_thread_pool_enqueue_group(vmaf->thread_pool, &vmaf->jobs,
+                                         threaded_prepare_func, &data,
+                                         sizeof(data));
+    if (err) {
+        // the ticket still has to be handed back for later ones to proceed
+        vmaf_fex_ctx_pool_sequence(vmaf->fex_ctx_pool, data.ticket, NULL,
+                                   index, feature_collector);
+        vmaf_picture_unref(&data.ref);
+        vmaf_picture_unref(&data.dist);
+    }
+    return err;
+}
+
+/* Extract with `fex_ctx` directly, or with a pooled context of the same
+ * feature extractor on the thread pool. Temporal feature extractors which
+ * can prepare pictures concurrently are sequenced instead of waiting on
+ * their one context. The caller keeps its references to `ref` and `dist`. */
+static int extract_pictures(VmafContext *vmaf,
+                            VmafFeatureExtractorContext *fex_ctx,
+                            VmafPicture *ref, VmafPicture *dist,
+                            unsigned index,
+                            VmafFeatureCollector *feature_collector)
+{
+    if (!vmaf->thread_pool) {
+        vmaf_trace_begin(vmaf->trace.trace, "extract", fex_ctx->fex->name,
+                         index);
+        int err = vmaf_feature_extractor_context_extract(fex_ctx, ref, dist,
+                                                         index,
+                                                         feature_collector);
+        vmaf_trace_end(vmaf->trace.trace, "extract", fex_ctx->fex->name);
+        return err;
+    }
+
+    if (fex_ctx->fex->prepare) {
+        return enqueue_prepare(vmaf, fex_ctx, ref, dist, index,
+                               feature_collector);
+    }
+
+    VmafFeatureExtractorContext *pooled_ctx;
+    const double start = fex_ctx->stats ? vmaf_fex_stats_clock() : 0.;
+    vmaf_trace_begin(vmaf->trace.trace, "aquire", fex_ctx->fex->name, index);
+    int err = vmaf_fex_ctx_pool_aquire(vmaf->fex_ctx_pool, fex_ctx->fex_index,
+                                       &pooled_ctx);
+    vmaf_trace_end(vmaf->trace.trace, "aquire", fex_ctx->fex->name);
+    if (err) return err;
+    if (pooled_ctx->stats) {
+        vmaf_fex_stats_add(pooled_ctx->stats, VMAF_FEX_STATS_AQUIRE_WAIT,
+                           vmaf_fex_stats_clock() - start);
+    }
+
+    struct ThreadData data = {
+        .fex_ctx = pooled_ctx,
+        .index = index,
+        .vmaf = vmaf,
+        .feature_collector = feature_collector,
+        .err = 0,
+    };
+    vmaf_picture_ref(&data.ref, ref);
+    vmaf_picture_ref(&data.dist, dist);
+
+    if (pooled_ctx->stats) data.enqueued = vmaf_fex_stats_clock();
+    err = vmaf_thread_pool_enqueue_group(vmaf->thread_pool, &vmaf->jobs,
+                                         threaded_extract_func, &data,
+                                         sizeof(data));
+    if (err) {
+        vmaf_picture_unref(&data.ref);
+        vmaf_picture_unref(&data.dist);
+        vmaf_fex_ctx_pool_release(vmaf->fex_ctx_pool, pooled_ctx);
+    }
+    return err;
+}
+
+static int ref_cache_set_key(VmafContext *vmaf, VmafPicture *ref)
+{
+    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
+
+    unsigned cnt = 0;
+    for (unsigned i = 0; i < rfe.cnt; i++) {
+        VmafFeatureExtractor *fex = rfe.fex_ctx[i]->fex;
+        if (!(fex->flags & VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY) ||
+            !fex->provided_features)
         {
             continue;
         }
+        for (unsigned j = 0; fex->provided_features[j]; j++)
+            cnt++;
+    }
 
-        VmafFeatureExtractorContext *fex_ctx;
-        err = vmaf_fex_ctx_pool_aquire(vmaf->fex_ctx_pool, fex, &fex_ctx);
+    const char *feature[cnt ? cnt : 1];
+    cnt = 0;
+    for (unsigned i = 0; i < rfe.cnt; i++) {
+        VmafFeatureExtractor *fex = rfe.fex_ctx[i]->fex;
+        if (!(fex->flags & VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY) ||
+            !fex->provided_features)
+        {
+            continue;
+        }
+        for (unsigned j = 0; fex->provided_features[j]; j++)
+            feature[cnt++] = fex->provided_features[j];
+    }
+
+    vmaf->ref_cache.keyed = true;
+    if (!cnt) vmaf->ref_cache.hit = false;
+    int err = vmaf_ref_cache_name(vmaf->ref_cache.cache, ref->w[0], ref->h[0],
+                                  ref->bpc, vmaf_ref_cache_hash(ref));
+    if (err) return err;
+    return vmaf_ref_cache_set_key(vmaf->ref_cache.cache, ref->w[0], ref->h[0],
+                                  ref->bpc, feature, cnt);
+}
+
+/* Leave replay mode. Temporal reference-only extractors were skipped while
+ * scores came from the cache, so they are fed the last two pictures again
+ * before they resume. Their scores for those pictures go to the scratch
+ * collector, and are only taken from there at flush for indices the cache
+ * did not provide (i.e. the first picture, when the second one missed). */
+static int ref_cache_resume(VmafContext *vmaf)
+{
+    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
+    const unsigned next_index = vmaf->ref_cache.next_index;
+    int err = 0;
+
+    vmaf->ref_cache.hit = false;
+    for (unsigned i = 0; i < 2; i++) {
+        VmafPicture *pic = &vmaf->ref_cache.prev[i];
+        if (!pic->ref_cnt) continue;
+        for (unsigned j = 0; !err && j < rfe.cnt; j++) {
+            if (!(rfe.fex_ctx[j]->fex->flags &
+                  VMAF_FEATURE_EXTRACTOR_REFERENCE_ONLY))
+            {
+                continue;
+            }
+            err = extract_pictures(vmaf, rfe.fex_ctx[j], pic, pic,
+                                   next_index - 2 + i,
+                                   vmaf->ref_cache.scratch);
+        }
+        vmaf_picture_unref(pic);
+    }
+    return err;
+}
+
+/* Reference-only scores are replayed from the cache for as long as every
+ * picture so far matches it, `cached` tells the caller to skip those
+ * extractors for `ref`. A score at index i is imported once picture i + 1
+ * matched too, since temporal features look one picture ahead. */
+static int ref_cache_lookup(VmafContext *vmaf, VmafPicture *ref,
+                            unsigned index, bool *cached)
+{
+    *cached = false;
+    if (!vmaf->ref_cache.cache || vmaf->reference_source) return 0;
+
+    int err = 0;
+    if (!vmaf->ref_cache.keyed) {
+        err = ref_cache_set_key(vmaf, ref);
         if (err) return err;
+    }
+    if (!vmaf->ref_cache.cache->feature_cnt) return 0;
+
+    const uint64_t hash = vmaf_ref_cache_hash(ref);
+    const int match = vmaf_ref_cache_record(vmaf->ref_cache.cache, index, hash);
+    if (match < 0) return match;
+    if (!vmaf->ref_cache.hit) return 0;
+
+    if (!match || index != vmaf->ref_cache.next_index)
+        return ref_cache_resume(vmaf);
 
-        struct ThreadData data = {
-            .fex_ctx = fex_ctx,
-            .ref = pic_a,
-            .dist = pic_b,
-            .index = index,
-            .feature_collector = vmaf->feature_collector,
-            .fex_ctx_pool = vmaf->fex_ctx_pool,
-            .err = 0,
-        };
-
-        err = vmaf_thread_pool_enqueue(vmaf->thread_pool, threaded_extract_func,
-                                       &data, sizeof(data));
+    if (index) {
+        err = vmaf_ref_cache_import(vmaf->ref_cache.cache,
+                                    vmaf->feature_collector, index - 1);
         if (err) return err;
     }
+    vmaf_picture_unref(&vmaf->ref_cache.prev[0]);
+    vmaf->ref_cache.prev[0] = vmaf->ref_cache.prev[1];
+    vmaf_picture_ref(&vmaf->ref_cache.prev[1], ref);
+    vmaf->ref_cache.next_index++;
+    *cached = true;
+    return 0;
+}
+
+/* Settle the final reference-only scores before the context is flushed.
+ * Returns true if the cache file has to be rewritten afterwards. */
+static bool ref_cache_finish(VmafContext *vmaf)
+{
+    if (!vmaf->ref_cache.cache || !vmaf->ref_cache.keyed) return false;
+    if (vmaf->ref_cache.finished) return false;
+    if (!vmaf->ref_cache.cache->feature_cnt) return false;
+    vmaf->ref_cache.finished = true;
+
+    if (!vmaf->ref_cache.hit) return true;
 
-    return vmaf_picture_unref(ref) | vmaf_picture_unref(dist);
+    const unsigned n = vmaf->ref_cache.next_index;
+    if (!n) return false;
+    if (n == vmaf_ref_cache_frame_cnt(vmaf->ref_cache.cache)) {
+        vmaf->ref_cache.hit = false;
+        vmaf_picture_unref(&vmaf->ref_cache.prev[0]);
+        vmaf_picture_unref(&vmaf->ref_cache.prev[1]);
+        vmaf_ref_cache_import(vmaf->ref_cache.cache, vmaf->feature_collector,
+                              n - 1);
+        return false;
+    }
+
+    // the cached stream was longer, its last scores do not apply
+    ref_cache_resume(vmaf);
+    return true;
+}
+
+/* Replace `pic` with its scaled version, the caller owns either. */
+static int scale_picture(VmafContext *vmaf, VmafPicture *pic)
+{
+    VmafPicture scaled;
+    vmaf_trace_begin(vmaf->trace.trace, "read", "scale",
+                     VMAF_TRACE_NO_INDEX);
+    int err = vmaf_scaler_scale(vmaf->scaler, &scaled, pic,
+                                vmaf->thread_pool);
+    vmaf_trace_end(vmaf->trace.trace, "read", "scale");
+    if (err) return err;
+    vmaf_picture_unref(pic);
+    *pic = scaled;
+    return 0;
+}
+
+/* Contexts sharing reference features also share the reference pictures
+ * they are given, so the first of them to scale a picture keeps the result
+ * in the source context and the others reuse it. */
+static int scale_reference(VmafContext *vmaf, VmafPicture *ref,
+                           unsigned index)
+{
+    VmafContext *source =
+        vmaf->reference_source ? vmaf->reference_source : vmaf;
+    if (source != vmaf && !vmaf_scaler_equivalent(vmaf->scaler,
+                                                  source->scaler))
+    {
+        return scale_picture(vmaf, ref);
+    }
+
+    pthread_mutex_lock(&(source->scaled_ref.lock));
+    int err = 0;
+    if (source->scaled_ref.data == ref->data[0] &&
+        source->scaled_ref.index == index)
+    {
+        vmaf_picture_unref(ref);
+        vmaf_picture_ref(ref, &source->scaled_ref.pic);
+        goto unlock;
+    }
+
+    const void *data = ref->data[0];
+    err = scale_picture(vmaf, ref);
+    if (err) goto unlock;
+    if (source->scaled_ref.data)
+        vmaf_picture_unref(&source->scaled_ref.pic);
+    vmaf_picture_ref(&source->scaled_ref.pic, ref);
+    source->scaled_ref.data = data;
+    source->scaled_ref.index = index;
+
+unlock:
+    pthread_mutex_unlock(&(source->scaled_ref.lock));
+    return err;
 }
 
 int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
@@ -211,35 +1094,90 @@ int vmaf_read_pictures(VmafContext *vmaf, VmafPicture *ref, VmafPicture *dist,
     if (!vmaf) return -EINVAL;
     if (!ref) return -EINVAL;
     if (!dist) return -EINVAL;
+    if (ref->pix_fmt != dist->pix_fmt) return -EINVAL;
+    if ((ref->pix_fmt == VMAF_PIX_FMT_YUV400P) &&
+        !(vmaf->cfg.flags & VMAF_CONFIGURATION_FLAG_LUMA_ONLY))
+    {
+        return -EINVAL;
+    }
 
-    int err = 0;
+    int err = atomic_load(&vmaf->job_err);
+    if (err) return err;
+    if (!vmaf->score_callback.started) start_score_callbacks(vmaf, index);
+    if (vmaf->scaler) {
+        err = scale_reference(vmaf, ref, index);
+        if (err) return err;
+        err = scale_picture(vmaf, dist);
+        if (err) return err;
+    }
+    if ((ref->w[0] != dist->w[0]) || (ref->h[0] != dist->h[0]))
+        return -EINVAL;
 
-    if (vmaf->thread_pool)
-        return threaded_read_pictures(vmaf, ref, dist, index);
+    bool cached;
+    err = ref_cache_lookup(vmaf, ref, index, &cached);
+    if (err) return err;
 
     for (unsigned i = 0; i < vmaf->registered_feature_extractors.cnt; i++) {
         VmafFeatureExtractorContext *fex_ctx =
             vmaf->registered_feature_extractors.fex_ctx[i];
 
-        if ((vmaf->cfg.n_subsample > 1) && (index % vmaf->cfg.n_subsample) &&
-            !(fex_ctx->fex->flags & VMAF_FEATURE_EXTRACTOR_TEMPORAL))
-        {
+        if (!vmaf->features_reserved)
+            reserve_features(vmaf, fex_ctx->fex);
+        if (skip_feature_extractor(vmaf, fex_ctx->fex, index, cached))
             continue;
-        }
 
-        err = vmaf_feature_extractor_context_extract(fex_ctx, ref, dist, index,
-                                                     vmaf->feature_collector);
+        err = extract_pictures(vmaf, fex_ctx, ref, dist, index,
+                               vmaf->feature_collector);
         if (err) return err;
     }
+    vmaf->features_reserved = true;
 
     err = vmaf_picture_unref(ref);
     if (err) return err;
     err = vmaf_picture_unref(dist);
     if (err) return err;
 
+    notify_score_callbacks(vmaf);
     return 0;
 }
 
+static int flush_context(VmafContext *vmaf)
+{
+    const bool ref_cache_update = ref_cache_finish(vmaf);
+    vmaf_trace_begin(vmaf->trace.trace, "flush", "wait", VMAF_TRACE_NO_INDEX);
+    vmaf_thread_pool_wait_group(vmaf->thread_pool, &vmaf->jobs);
+    vmaf_trace_end(vmaf->trace.trace, "flush", "wait");
+    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
+    for (unsigned i = 0; i < rfe.cnt; i++) {
+        vmaf_feature_extractor_context_flush(rfe.fex_ctx[i],
+                                             vmaf->feature_collector);
+    }
+    vmaf_fex_ctx_pool_flush(vmaf->fex_ctx_pool, vmaf->feature_collector);
+
+    if (vmaf->reference_source) {
+        VmafContext *source = vmaf->reference_source;
+        set_job_error(vmaf, flush_context(source));
+        for (unsigned i = 0; i < rfe.cnt; i++) {
+            import_reference_features(vmaf, rfe.fex_ctx[i]->fex,
+                                      source->feature_collector);
+        }
+    }
+
+    // scores of the pictures replayed on resume which were not cached yet
+    if (vmaf->ref_cache.scratch) {
+        for (unsigned i = 0; i < rfe.cnt; i++) {
+            import_reference_features(vmaf, rfe.fex_ctx[i]->fex,
+                                      vmaf->ref_cache.scratch);
+        }
+    }
+
+    if (ref_cache_update)
+        vmaf_ref_cache_write(vmaf->ref_cache.cache, vmaf->feature_collector);
+
+    notify_score_callbacks(vmaf);
+    return atomic_load(&vmaf->job_err);
+}
+
 int vmaf_score_at_index(VmafContext *vmaf, VmafModel *model, double *score,
                         unsigned index)
 {
@@ -255,46 +1193,87 @@ int vmaf_score_pooled(VmafContext *vmaf, VmafModel *model,
                       unsigned index_low, unsigned index_high)
 {
     if (!vmaf) return -EINVAL;
+    if (!model) return -EINVAL;
     if (!score) return -EINVAL;
     if (index_low >= index_high) return -EINVAL;
     if (!pool_method) return -EINVAL;
 
-    vmaf_thread_pool_wait(vmaf->thread_pool);
-    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
-    for (unsigned i = 0; i < rfe.cnt; i++) {
-        vmaf_feature_extractor_context_flush(rfe.fex_ctx[i],
-                                             vmaf->feature_collector);
+    int err = flush_context(vmaf);
+    if (err) return err;
+
+    double quantile = 0.;
+    switch (pool_method) {
+    case VMAF_POOL_METHOD_MEDIAN:
+        quantile = 0.5;
+        break;
+    case VMAF_POOL_METHOD_PERC5:
+        quantile = 0.05;
+        break;
+    case VMAF_POOL_METHOD_PERC10:
+        quantile = 0.1;
+        break;
+    case VMAF_POOL_METHOD_PERC20:
+        quantile = 0.2;
+        break;
+    default:
+        break;
     }
-    vmaf_fex_ctx_pool_flush(vmaf->fex_ctx_pool, vmaf->feature_collector);
 
-    double min, sum, i_sum = 0.;
+    double *scores = NULL;
+    if (quantile > 0.) {
+        scores = malloc(sizeof(*scores) * (index_high - index_low));
+        if (!scores) return -ENOMEM;
+    }
+
+    double min = 0., max = 0., sum = 0., i_sum = 0.;
+    unsigned n_scores = 0;
     for (unsigned i = index_low; i < index_high; i++) {
         if ((vmaf->cfg.n_subsample > 1) && (i % vmaf->cfg.n_subsample))
             continue;
         double vmaf_score;
-        int err = vmaf_score_at_index(vmaf, model, &vmaf_score, i);
-        if (err) return err;
+        err = vmaf_score_at_index(vmaf, model, &vmaf_score, i);
+        if (err) goto free_scores;
+        if (!isfinite(vmaf_score)) {
+            err = -ERANGE;
+            goto free_scores;
+        }
         sum += vmaf_score;
         i_sum += 1. / (vmaf_score + 1.);
-        if ((i == index_low) || (min < vmaf_score))
-            min = vmaf_score;
+        if (!n_scores) min = max = vmaf_score;
+        min = vmaf_score < min ? vmaf_score : min;
+        max = vmaf_score > max ? vmaf_score : max;
+        if (scores) scores[n_scores] = vmaf_score;
+        n_scores++;
+    }
+    if (!n_scores) {
+        err = -EINVAL;
+        goto free_scores;
     }
 
     switch (pool_method) {
     case VMAF_POOL_METHOD_MEAN:
-        *score = sum / (index_high - index_low);
+        *score = sum / n_scores;
         break;
     case VMAF_POOL_METHOD_MIN:
         *score = min;
         break;
     case VMAF_POOL_METHOD_HARMONIC_MEAN:
-        *score = (index_high - index_low) / i_sum - 1.0;
+        *score = n_scores / i_sum - 1.0;
+        break;
+    case VMAF_POOL_METHOD_MEDIAN:
+    case VMAF_POOL_METHOD_PERC5:
+    case VMAF_POOL_METHOD_PERC10:
+    case VMAF_POOL_METHOD_PERC20:
+        err = vmaf_quantile_nearest_rank(scores, n_scores, quantile, score);
         break;
     default:
-        return -EINVAL;
+        err = -EINVAL;
+        break;
     }
 
-    return 0;
+free_scores:
+    free(scores);
+    return err;
 }
 
 const char *vmaf_version(void)
@@ -305,13 +1284,8 @@ const char *vmaf_version(void)
 int vmaf_write_output(VmafContext *vmaf, FILE *outfile,
                       enum VmafOutputFormat fmt)
 {
-    vmaf_thread_pool_wait(vmaf->thread_pool);
-    RegisteredFeatureExtractors rfe = vmaf->registered_feature_extractors;
-    for (unsigned i = 0; i < rfe.cnt; i++) {
-        vmaf_feature_extractor_context_flush(rfe.fex_ctx[i],
-                                             vmaf->feature_collector);
-    }
-    vmaf_fex_ctx_pool_flush(vmaf->fex_ctx_pool, vmaf->feature_collector);
+    int err = flush_context(vmaf);
+    if (err) return err;
 
     switch (fmt) {
     case VMAF_OUTPUT_FORMAT_XML:
@@ -321,3 +1295,26 @@ int vmaf_write_output(VmafContext *vmaf, FILE *outfile,
         return 0;
     }
 }
+
+int vmaf_write_partial(VmafContext *vmaf, FILE *outfile,
+                       unsigned index_low, unsigned index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (!outfile) return -EINVAL;
+    if (index_low >= index_high) return -EINVAL;
+
+    int err = flush_context(vmaf);
+    if (err) return err;
+    return vmaf_write_output_partial(vmaf->feature_collector, outfile,
+                                     index_low, index_high);
+}
+
+int vmaf_import_partial(VmafContext *vmaf, FILE *infile,
+                        unsigned *index_low, unsigned *index_high)
+{
+    if (!vmaf) return -EINVAL;
+    if (!infile) return -EINVAL;
+
+    return vmaf_read_partial(vmaf->feature_collector, infile,
+                             index_low, index_high);
+}
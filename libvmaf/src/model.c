@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -45,7 +46,31 @@ char *generate_model_name(VmafModelConfig *cfg) {
 
 }
 
-int vmaf_model_load_from_path(VmafModel **model, VmafModelConfig *cfg)
+/* models are immutable once loaded, so identical loads share one instance */
+static struct {
+    VmafModel *head;
+    uint64_t last_id;
+    pthread_mutex_t lock;
+} registry = {
+    .head = NULL,
+    .last_id = 0,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static VmafModel *registry_find(const char *path, const char *name,
+                                enum VmafModelFlags flags)
+{
+    for (VmafModel *m = registry.head; m; m = m->registry.next) {
+        if (m->registry.flags == flags && !strcmp(m->path, path) &&
+            !strcmp(m->name, name))
+        {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static int model_load(VmafModel **model, VmafModelConfig *cfg, char *name)
 {
     VmafModel *const m = *model = malloc(sizeof(*m));
     if (!m) goto fail;
@@ -53,32 +78,29 @@ int vmaf_model_load_from_path(VmafModel **model, VmafModelConfig *cfg)
     m->path = malloc(strlen(cfg->path) + 1);
     if (!m->path) goto free_m;
     strcpy(m->path, cfg->path);
-
-    /* if config does not have a name, create a default one */
-    m->name = generate_model_name(cfg);
-    if (!m->name) goto free_path;
+    m->name = name;
 
     // ugly, this shouldn't be implict (but it is)
     char *svm_path_suffix = ".model";
     size_t svm_path_sz =
         strlen(m->path) + strlen(svm_path_suffix) + 1 * sizeof(char);
     char *svm_path = malloc(svm_path_sz);
-    if (!svm_path) goto free_name;
+    if (!svm_path) goto free_path;
     memset(svm_path, 0, svm_path_sz);
     strncat(svm_path, m->path, strlen(m->path));
     strncat(svm_path, svm_path_suffix, strlen(svm_path_suffix));
 
     m->svm = svm_load_model(svm_path);
     free(svm_path);
-    if (!m->svm) goto free_name;
+    if (!m->svm) goto free_path;
     int err = vmaf_unpickle_model(m, m->path, cfg->flags);
     if (err) goto free_svm;
+    m->registry.flags = cfg->flags;
+    m->registry.ref_cnt = 1;
     return 0;
 
 free_svm:
     svm_free_and_destroy_model(&(m->svm));
-free_name:
-    free(m->name);
 free_path:
     free(m->path);
 free_m:
@@ -87,9 +109,8 @@ fail:
     return -ENOMEM;
 }
 
-void vmaf_model_destroy(VmafModel *model)
+static void model_free(VmafModel *model)
 {
-    if (!model) return;
     free(model->path);
     free(model->name);
     svm_free_and_destroy_model(&(model->svm));
@@ -98,3 +119,71 @@ void vmaf_model_destroy(VmafModel *model)
     free(model->feature);
     free(model);
 }
+
+int vmaf_model_load_from_path(VmafModel **model, VmafModelConfig *cfg)
+{
+    if (!model) return -EINVAL;
+    if (!cfg) return -EINVAL;
+    if (!cfg->path) return -EINVAL;
+
+    /* if config does not have a name, create a default one */
+    char *name = generate_model_name(cfg);
+    if (!name) return -ENOMEM;
+
+    pthread_mutex_lock(&registry.lock);
+    VmafModel *m = registry_find(cfg->path, name, cfg->flags);
+    if (m) m->registry.ref_cnt++;
+    pthread_mutex_unlock(&registry.lock);
+    if (m) {
+        free(name);
+        *model = m;
+        return 0;
+    }
+
+    /* parse without the lock, so that unrelated loads don't wait */
+    VmafModel *loaded;
+    int err = model_load(&loaded, cfg, name);
+    if (err) {
+        free(name);
+        return err;
+    }
+
+    /* another thread may have loaded the same model meanwhile */
+    pthread_mutex_lock(&registry.lock);
+    m = registry_find(cfg->path, name, cfg->flags);
+    if (m) {
+        m->registry.ref_cnt++;
+    } else {
+        m = loaded;
+        m->registry.id = ++registry.last_id;
+        m->registry.next = registry.head;
+        registry.head = m;
+        loaded = NULL;
+    }
+    pthread_mutex_unlock(&registry.lock);
+
+    if (loaded) model_free(loaded);
+    *model = m;
+    return 0;
+}
+
+void vmaf_model_destroy(VmafModel *model)
+{
+    if (!model) return;
+
+    pthread_mutex_lock(&registry.lock);
+    if (--model->registry.ref_cnt) {
+        pthread_mutex_unlock(&registry.lock);
+        return;
+    }
+
+    for (VmafModel **m = &registry.head; *m; m = &(*m)->registry.next) {
+        if (*m == model) {
+            *m = model->registry.next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry.lock);
+
+    model_free(model);
+}
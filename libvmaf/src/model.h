@@ -2,6 +2,9 @@
 #define __VMAF_SRC_MODEL_H__
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "libvmaf/model.h"
 
 enum VmafModelType {
     VMAF_MODEL_TYPE_UNKNOWN = 0,
@@ -21,7 +24,7 @@ typedef struct {
     double slope, intercept;
 } VmafModelFeature;
 
-typedef struct VmafModel {
+struct VmafModel {
     char *path;
     char *name;
     enum VmafModelType type;
@@ -42,6 +45,13 @@ typedef struct VmafModel {
         bool out_lte_in, out_gte_in;
     } score_transform;
     struct svm_model *svm;
-} VmafModel;
+    struct {
+        enum VmafModelFlags flags;
+        unsigned ref_cnt;
+        /* unique over the process, unlike the address of a freed model */
+        uint64_t id;
+        struct VmafModel *next;
+    } registry;
+};
 
 #endif /* __VMAF_SRC_MODEL_H__ */
@@ -1,8 +1,11 @@
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "feature/alias.h"
 #include "feature/feature_collector.h"
+#include "output.h"
 
 #include <libvmaf/libvmaf.rc.h>
 
@@ -59,3 +62,117 @@ int vmaf_write_output_xml(VmafFeatureCollector *fc, FILE *outfile,
 
     return 0;
 }
+
+#define PARTIAL_VERSION 1
+#define PARTIAL_TOKEN_SZ 256
+
+int vmaf_write_output_partial(VmafFeatureCollector *fc, FILE *outfile,
+                              unsigned index_low, unsigned index_high)
+{
+    if (!fc) return -EINVAL;
+    if (!outfile) return -EINVAL;
+    if (index_low >= index_high) return -EINVAL;
+
+    fprintf(outfile, "vmaf_partial %d\n", PARTIAL_VERSION);
+    fprintf(outfile, "range %u %u\n", index_low, index_high);
+    fprintf(outfile, "features %u\n", fc->cnt);
+    for (unsigned j = 0; j < fc->cnt; j++)
+        fprintf(outfile, "%s\n", fc->feature_vector[j]->name);
+
+    for (unsigned i = index_low; i < index_high; i++) {
+        unsigned cnt = 0;
+        for (unsigned j = 0; j < fc->cnt; j++) {
+            if (i >= fc->feature_vector[j]->capacity)
+                continue;
+            if (fc->feature_vector[j]->score[i].written)
+                cnt++;
+        }
+        if (!cnt) continue;
+
+        fprintf(outfile, "frame %u", i);
+        for (unsigned j = 0; j < fc->cnt; j++) {
+            if ((i >= fc->feature_vector[j]->capacity) ||
+                !fc->feature_vector[j]->score[i].written)
+            {
+                fprintf(outfile, " -");
+                continue;
+            }
+            // hexadecimal floats round-trip exactly
+            fprintf(outfile, " %a", fc->feature_vector[j]->score[i].value);
+        }
+        fprintf(outfile, "\n");
+    }
+
+    fprintf(outfile, "end\n");
+    return ferror(outfile) ? -EIO : 0;
+}
+
+int vmaf_read_partial(VmafFeatureCollector *fc, FILE *infile,
+                      unsigned *index_low, unsigned *index_high)
+{
+    if (!fc) return -EINVAL;
+    if (!infile) return -EINVAL;
+    if (!index_low) return -EINVAL;
+    if (!index_high) return -EINVAL;
+
+    int version;
+    unsigned low, high, cnt;
+    if (fscanf(infile, " vmaf_partial %d range %u %u features %u",
+               &version, &low, &high, &cnt) != 4)
+    {
+        return -EINVAL;
+    }
+    if (version != PARTIAL_VERSION || low >= high) return -EINVAL;
+    *index_low = low;
+    *index_high = high;
+
+    int err = 0;
+    char (*name)[PARTIAL_TOKEN_SZ] = malloc(sizeof(*name) * (cnt ? cnt : 1));
+    if (!name) return -ENOMEM;
+    for (unsigned j = 0; j < cnt; j++) {
+        if (fscanf(infile, " %255s", name[j]) != 1) {
+            err = -EINVAL;
+            goto free_name;
+        }
+        err = vmaf_feature_collector_reserve(fc, name[j]);
+        if (err) goto free_name;
+    }
+
+    char token[PARTIAL_TOKEN_SZ];
+    for (;;) {
+        if (fscanf(infile, " %255s", token) != 1) {
+            // truncated, e.g. the segment's process did not finish
+            err = -EINVAL;
+            goto free_name;
+        }
+        if (!strcmp(token, "end")) break;
+
+        unsigned index;
+        if (strcmp(token, "frame") ||
+            fscanf(infile, " %u", &index) != 1 ||
+            index < low || index >= high)
+        {
+            err = -EINVAL;
+            goto free_name;
+        }
+        for (unsigned j = 0; j < cnt; j++) {
+            if (fscanf(infile, " %255s", token) != 1) {
+                err = -EINVAL;
+                goto free_name;
+            }
+            if (!strcmp(token, "-")) continue;
+            char *end;
+            const double score = strtod(token, &end);
+            if (*end) {
+                err = -EINVAL;
+                goto free_name;
+            }
+            err = vmaf_feature_collector_append(fc, name[j], score, index);
+            if (err) goto free_name;
+        }
+    }
+
+free_name:
+    free(name);
+    return err;
+}
@@ -1 +1,25 @@
-int vmaf_write_log_xml(VmafFeatureCollector *fc, FILE *logfile);
+#ifndef __VMAF_SRC_OUTPUT_H__
+#define __VMAF_SRC_OUTPUT_H__
+
+#include <stdio.h>
+
+#include "feature/feature_collector.h"
+
+int vmaf_write_output_xml(VmafFeatureCollector *fc, FILE *outfile,
+                          unsigned subsample);
+
+/*
+ * Partial output holds the feature scores of the picture indices
+ * [index_low, index_high) as exact hexadecimal floats, so that segments
+ * scored separately merge into the collector a single run would build.
+ * Features are listed in collector order, which sets the output columns of
+ * the merged collector.
+ */
+int vmaf_write_output_partial(VmafFeatureCollector *fc, FILE *outfile,
+                              unsigned index_low, unsigned index_high);
+
+/* Append the scores of a partial output to `fc`, and return its range. */
+int vmaf_read_partial(VmafFeatureCollector *fc, FILE *infile,
+                      unsigned *index_low, unsigned *index_high);
+
+#endif /* __VMAF_SRC_OUTPUT_H__ */
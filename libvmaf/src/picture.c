@@ -8,37 +8,65 @@
 
 #define DATA_ALIGN 32
 
-int vmaf_picture_alloc(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
-                       unsigned bpc, unsigned w, unsigned h)
+static int is_semi_planar(enum VmafPixelFormat pix_fmt)
+{
+    return pix_fmt == VMAF_PIX_FMT_NV12 || pix_fmt == VMAF_PIX_FMT_P010;
+}
+
+static int picture_init(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
+                        unsigned bpc, unsigned w, unsigned h)
 {
     if (!pic) return -EINVAL;
     if (!pix_fmt) return -EINVAL;
     if (bpc < 8 || bpc > 16) return -EINVAL;
+    if (pix_fmt == VMAF_PIX_FMT_NV12 && bpc != 8) return -EINVAL;
+    if (pix_fmt == VMAF_PIX_FMT_P010 && bpc != 10) return -EINVAL;
 
     memset(pic, 0, sizeof(*pic));
     pic->pix_fmt = pix_fmt;
     pic->bpc = bpc;
     const int ss_hor = pic->pix_fmt != VMAF_PIX_FMT_YUV444P;
-    const int ss_ver = pic->pix_fmt == VMAF_PIX_FMT_YUV420P;
+    const int ss_ver = pic->pix_fmt != VMAF_PIX_FMT_YUV444P &&
+                       pic->pix_fmt != VMAF_PIX_FMT_YUV422P;
     pic->w[0] = w;
     pic->w[1] = pic->w[2] = w >> ss_hor;
     pic->h[0] = h;
     pic->h[1] = pic->h[2] = h >> ss_ver;
+    if (pic->pix_fmt == VMAF_PIX_FMT_YUV400P)
+        pic->w[1] = pic->w[2] = pic->h[1] = pic->h[2] = 0;
+    return 0;
+}
+
+int vmaf_picture_alloc(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
+                       unsigned bpc, unsigned w, unsigned h)
+{
+    int err = picture_init(pic, pix_fmt, bpc, w, h);
+    if (err) return err;
+
+    const int semi_planar = is_semi_planar(pic->pix_fmt);
+    const unsigned c_w = pic->w[1] << semi_planar;
     const int aligned_y = pic->w[0] + DATA_ALIGN - (pic->w[0] % DATA_ALIGN);
-    const int aligned_c = pic->w[1] + DATA_ALIGN - (pic->w[1] % DATA_ALIGN);
+    const int aligned_c = c_w + DATA_ALIGN - (c_w % DATA_ALIGN);
     const int hbd = pic->bpc > 8;
     pic->stride[0] = aligned_y << hbd;
     pic->stride[1] = pic->stride[2] = aligned_c << hbd;
     const size_t y_sz = pic->stride[0] * pic->h[0];
     const size_t uv_sz = pic->stride[1] * pic->h[1];
-    const size_t pic_size = y_sz + 2 * uv_sz;
+    const unsigned uv_cnt = pic->pix_fmt == VMAF_PIX_FMT_YUV400P ? 0 :
+                            semi_planar ? 1 : 2;
+    const size_t pic_size = y_sz + uv_cnt * uv_sz;
 
     uint8_t *data = aligned_malloc(pic_size, DATA_ALIGN);
     if (!data) goto fail;
     memset(data, 0, sizeof(*data));
     pic->data[0] = data;
-    pic->data[1] = data + y_sz;
-    pic->data[2] = data + y_sz + uv_sz;
+    if (uv_cnt) {
+        pic->data[1] = data + y_sz;
+        pic->data[2] = semi_planar ? data + y_sz + (1 << hbd)
+                                   : data + y_sz + uv_sz;
+    } else {
+        pic->stride[1] = pic->stride[2] = 0;
+    }
 
     pic->ref_cnt = malloc(sizeof(*pic->ref_cnt));
     if (!pic->ref_cnt) goto free_data;
@@ -46,11 +74,42 @@ int vmaf_picture_alloc(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
     return 0;
 
 free_data:
-    free(data);
+    aligned_free(data);
 fail:
     return -ENOMEM;
 }
 
+int vmaf_picture_wrap(VmafPicture *pic, enum VmafPixelFormat pix_fmt,
+                      unsigned bpc, unsigned w, unsigned h,
+                      pixel *data[3], ptrdiff_t stride[3],
+                      void (*release_callback)(void *cookie), void *cookie)
+{
+    if (!data || !stride) return -EINVAL;
+    if (!release_callback) return -EINVAL;
+    int err = picture_init(pic, pix_fmt, bpc, w, h);
+    if (err) return err;
+
+    for (unsigned i = 0; i < 3; i++) {
+        pic->data[i] = data[i];
+        pic->stride[i] = stride[i];
+    }
+    if (is_semi_planar(pic->pix_fmt)) {
+        pic->data[2] = (uint8_t *) data[1] + (1 << (pic->bpc > 8));
+        pic->stride[2] = stride[1];
+    }
+    if (pic->pix_fmt == VMAF_PIX_FMT_YUV400P) {
+        pic->data[1] = pic->data[2] = NULL;
+        pic->stride[1] = pic->stride[2] = 0;
+    }
+    pic->release_callback = release_callback;
+    pic->cookie = cookie;
+
+    pic->ref_cnt = malloc(sizeof(*pic->ref_cnt));
+    if (!pic->ref_cnt) return -ENOMEM;
+    *(pic->ref_cnt) = 1;
+    return 0;
+}
+
 int vmaf_picture_ref(VmafPicture *dst, VmafPicture *src) {
     if (!dst || !src) return -EINVAL;
 
@@ -66,7 +125,10 @@ int vmaf_picture_unref(VmafPicture *pic) {
 
     atomic_int *ref_cnt = pic->ref_cnt;
     if (--(*ref_cnt) == 0) {
-        aligned_free(pic->data[0]);
+        if (pic->release_callback)
+            pic->release_callback(pic->cookie);
+        else
+            aligned_free(pic->data[0]);
         free(pic->ref_cnt);
     }
     memset(pic, 0, sizeof(*pic));
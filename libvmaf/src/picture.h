@@ -3,6 +3,4 @@
 
 #include "libvmaf/picture.h"
 
-int vmaf_picture_ref(VmafPicture *dst, VmafPicture *src);
-
 #endif /* __VMAF_SRC_PICTURE_H__ */
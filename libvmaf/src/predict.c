@@ -81,7 +81,13 @@ int vmaf_predict_score_at_index(VmafModel *model,
     if (!feature_collector) return -EINVAL;
     if (!vmaf_score) return -EINVAL;
 
-    int err = 0;
+    /* predictions are memoized per model and frame, and computed again
+     * once a feature score is appended at that frame */
+    unsigned stamp;
+    int err = vmaf_feature_collector_get_prediction(feature_collector,
+                                                    model->registry.id, index,
+                                                    vmaf_score, &stamp);
+    if (!err) return 0;
 
     struct svm_node *node = malloc(sizeof(*node) * (model->n_features + 1));
     if (!node) return -ENOMEM;
@@ -111,8 +117,10 @@ int vmaf_predict_score_at_index(VmafModel *model,
     err = clip(model, &prediction);
     if (err) goto free_node;
 
-    err = vmaf_feature_collector_append(feature_collector, model->name,
-                                        prediction, index);
+    err = vmaf_feature_collector_set_prediction(feature_collector,
+                                                model->registry.id,
+                                                model->name, index,
+                                                prediction, stamp);
     if (err) goto free_node;
 
     *vmaf_score = prediction;
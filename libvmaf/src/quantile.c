@@ -0,0 +1,52 @@
+#include <errno.h>
+#include <math.h>
+
+#include "quantile.h"
+
+static void swap(double *a, double *b)
+{
+    const double t = *a;
+    *a = *b;
+    *b = t;
+}
+
+int vmaf_quantile_nearest_rank(double *value, unsigned n, double q,
+                               double *quantile)
+{
+    if (!value) return -EINVAL;
+    if (!quantile) return -EINVAL;
+    if (!n) return -EINVAL;
+    if (!(q >= 0. && q <= 1.)) return -EINVAL;
+
+    /* nearest-rank definition, 1-based */
+    const double r = ceil(q * n);
+    const unsigned k = r > 1. ? (unsigned) r - 1 : 0;
+
+    unsigned lo = 0, hi = n - 1;
+    while (lo < hi) {
+        /* median of three, so sorted or constant input stays linear */
+        const unsigned mid = lo + (hi - lo) / 2;
+        if (value[mid] < value[lo]) swap(&value[mid], &value[lo]);
+        if (value[hi] < value[lo]) swap(&value[hi], &value[lo]);
+        if (value[hi] < value[mid]) swap(&value[hi], &value[mid]);
+        const double pivot = value[mid];
+
+        unsigned i = lo, j = hi;
+        while (i <= j) {
+            while (value[i] < pivot) i++;
+            while (value[j] > pivot) j--;
+            if (i > j) break;
+            swap(&value[i++], &value[j]);
+            if (!j--) break;
+        }
+        if (k <= j && j != (unsigned) -1)
+            hi = j;
+        else if (k >= i)
+            lo = i;
+        else
+            break;
+    }
+
+    *quantile = value[k];
+    return 0;
+}
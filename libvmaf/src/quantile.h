@@ -0,0 +1,13 @@
+#ifndef __VMAF_SRC_QUANTILE_H__
+#define __VMAF_SRC_QUANTILE_H__
+
+/*
+ * Exact nearest-rank quantile of `n` values: the smallest value such that
+ * at least a fraction `q` of them are less than or equal to it, with the
+ * 0 quantile being the smallest value. The values are reordered in place
+ * by a selection in expected linear time, without a full sort.
+ */
+int vmaf_quantile_nearest_rank(double *value, unsigned n, double q,
+                               double *quantile);
+
+#endif /* __VMAF_SRC_QUANTILE_H__ */
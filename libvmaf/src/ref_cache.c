@@ -0,0 +1,360 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <process.h>
+#define S_ISDIR(m) (((m) & _S_IFMT) == _S_IFDIR)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "ref_cache.h"
+
+#define REF_CACHE_MAGIC "VMAFREF1"
+#define REF_CACHE_NAME_SZ 64
+
+typedef struct RefCacheHeader {
+    char magic[8];
+    uint32_t w, h, bpc, feature_cnt;
+    uint64_t frame_cnt;
+} RefCacheHeader;
+
+/* A row is the frame hash followed by one double per feature. */
+static size_t row_words(VmafRefCache *cache)
+{
+    return 1 + cache->feature_cnt;
+}
+
+static void ref_cache_map(VmafRefCache *cache)
+{
+#if !defined(_WIN32)
+    const int fd = open(cache->path, O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size >= (off_t) sizeof(RefCacheHeader)) {
+        void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            cache->file.addr = addr;
+            cache->file.sz = st.st_size;
+        }
+    }
+    close(fd);
+#else
+    FILE *file = fopen(cache->path, "rb");
+    if (!file) return;
+    if (!fseek(file, 0, SEEK_END)) {
+        const long sz = ftell(file);
+        void *addr = sz >= (long) sizeof(RefCacheHeader) ? malloc(sz) : NULL;
+        if (addr && !fseek(file, 0, SEEK_SET) &&
+            fread(addr, 1, sz, file) == (size_t) sz)
+        {
+            cache->file.addr = addr;
+            cache->file.sz = sz;
+        } else {
+            free(addr);
+        }
+    }
+    fclose(file);
+#endif
+}
+
+static void ref_cache_unmap(VmafRefCache *cache)
+{
+    if (!cache->file.addr) return;
+#if !defined(_WIN32)
+    munmap(cache->file.addr, cache->file.sz);
+#else
+    free(cache->file.addr);
+#endif
+    cache->file.addr = NULL;
+}
+
+int vmaf_ref_cache_init(VmafRefCache **cache, const char *path)
+{
+    if (!cache) return -EINVAL;
+    if (!path) return -EINVAL;
+
+    VmafRefCache *const c = *cache = malloc(sizeof(*c));
+    if (!c) goto fail;
+    memset(c, 0, sizeof(*c));
+    c->path = malloc(strlen(path) + 1);
+    if (!c->path) goto free_c;
+    strcpy(c->path, path);
+
+    // in a directory, the file is only known once the first frame is
+    struct stat st;
+    c->dir = !stat(path, &st) && S_ISDIR(st.st_mode);
+    if (!c->dir) ref_cache_map(c);
+    return 0;
+
+free_c:
+    free(c);
+fail:
+    return -ENOMEM;
+}
+
+int vmaf_ref_cache_name(VmafRefCache *cache, unsigned w, unsigned h,
+                        unsigned bpc, uint64_t hash)
+{
+    if (!cache) return -EINVAL;
+    if (!cache->dir) return 0;
+
+    const size_t sz = strlen(cache->path) + 64;
+    char *path = malloc(sz);
+    if (!path) return -ENOMEM;
+    snprintf(path, sz, "%s/%016llx-%ux%u-%u.refcache", cache->path,
+             (unsigned long long) hash, w, h, bpc);
+    free(cache->path);
+    cache->path = path;
+    cache->dir = false;
+
+    ref_cache_map(cache);
+    return 0;
+}
+
+int vmaf_ref_cache_set_key(VmafRefCache *cache, unsigned w, unsigned h,
+                           unsigned bpc, const char **feature,
+                           unsigned feature_cnt)
+{
+    if (!cache) return -EINVAL;
+    if (feature_cnt && !feature) return -EINVAL;
+    if (cache->feature) return -EINVAL;
+
+    for (unsigned i = 0; i < feature_cnt; i++) {
+        if (strlen(feature[i]) >= REF_CACHE_NAME_SZ) return -EINVAL;
+    }
+
+    cache->feature = malloc(sizeof(*cache->feature) * (feature_cnt + 1));
+    if (!cache->feature) return -ENOMEM;
+    memset(cache->feature, 0, sizeof(*cache->feature) * (feature_cnt + 1));
+    for (unsigned i = 0; i < feature_cnt; i++) {
+        cache->feature[i] = malloc(strlen(feature[i]) + 1);
+        if (!cache->feature[i]) return -ENOMEM;
+        strcpy(cache->feature[i], feature[i]);
+    }
+    cache->feature_cnt = feature_cnt;
+    cache->w = w;
+    cache->h = h;
+    cache->bpc = bpc;
+
+    if (!cache->file.addr) return 0;
+
+    RefCacheHeader header;
+    memcpy(&header, cache->file.addr, sizeof(header));
+    if (memcmp(header.magic, REF_CACHE_MAGIC, sizeof(header.magic)) ||
+        header.w != w || header.h != h || header.bpc != bpc ||
+        header.feature_cnt != feature_cnt)
+    {
+        return 0;
+    }
+
+    const char *name = (const char *) cache->file.addr + sizeof(header);
+    const size_t names_sz = (size_t) feature_cnt * REF_CACHE_NAME_SZ;
+    const size_t row_sz = row_words(cache) * sizeof(uint64_t);
+    if (cache->file.sz < sizeof(header) + names_sz ||
+        (cache->file.sz - sizeof(header) - names_sz) / row_sz <
+        header.frame_cnt)
+    {
+        return 0;
+    }
+    for (unsigned i = 0; i < feature_cnt; i++) {
+        if (strncmp(name + i * REF_CACHE_NAME_SZ, feature[i],
+                    REF_CACHE_NAME_SZ))
+        {
+            return 0;
+        }
+    }
+
+    cache->file.row = (const uint64_t *) (name + names_sz);
+    cache->file.frame_cnt = header.frame_cnt;
+    return 0;
+}
+
+uint64_t vmaf_ref_cache_hash(VmafPicture *pic)
+{
+    /* Four independent multiply-xor lanes, so that the multiplications are
+     * not serialized on each other. */
+    const uint64_t k = 0x9e3779b97f4a7c15ULL;
+    uint64_t lane[4] = {
+        k ^ pic->w[0], k ^ pic->h[0], k ^ pic->bpc, k,
+    };
+
+    const size_t row_sz = (size_t) pic->w[0] << (pic->bpc > 8);
+    const uint8_t *row = pic->data[0];
+    for (unsigned i = 0; i < pic->h[0]; i++, row += pic->stride[0]) {
+        size_t j = 0;
+        for (; j + 32 <= row_sz; j += 32) {
+            uint64_t v[4];
+            memcpy(v, row + j, sizeof(v));
+            for (unsigned l = 0; l < 4; l++) {
+                lane[l] = (lane[l] ^ v[l]) * k;
+                lane[l] ^= lane[l] >> 29;
+            }
+        }
+        for (unsigned l = 0; j < row_sz; l = (l + 1) % 4, j += 8) {
+            uint64_t v = 0;
+            memcpy(&v, row + j, row_sz - j < 8 ? row_sz - j : 8);
+            lane[l] = (lane[l] ^ v) * k;
+            lane[l] ^= lane[l] >> 29;
+        }
+    }
+
+    uint64_t hash = 0;
+    for (unsigned l = 0; l < 4; l++) {
+        hash = (hash ^ lane[l]) * k;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+int vmaf_ref_cache_record(VmafRefCache *cache, unsigned index, uint64_t hash)
+{
+    if (!cache) return -EINVAL;
+
+    if (index >= cache->hash_capacity) {
+        unsigned capacity = cache->hash_capacity ? cache->hash_capacity : 256;
+        while (index >= capacity) capacity *= 2;
+        uint64_t *h = realloc(cache->hash, sizeof(*h) * capacity);
+        if (!h) return -ENOMEM;
+        memset(h + cache->hash_capacity, 0,
+               sizeof(*h) * (capacity - cache->hash_capacity));
+        cache->hash = h;
+        cache->hash_capacity = capacity;
+    }
+    cache->hash[index] = hash;
+    if (index >= cache->hash_cnt) cache->hash_cnt = index + 1;
+
+    if (index >= cache->file.frame_cnt) return 0;
+    return cache->file.row[index * row_words(cache)] == hash;
+}
+
+unsigned vmaf_ref_cache_frame_cnt(VmafRefCache *cache)
+{
+    if (!cache) return 0;
+    return cache->file.frame_cnt;
+}
+
+int vmaf_ref_cache_import(VmafRefCache *cache, VmafFeatureCollector *fc,
+                          unsigned index)
+{
+    if (!cache) return -EINVAL;
+    if (!fc) return -EINVAL;
+    if (index >= cache->file.frame_cnt) return -EINVAL;
+
+    const uint64_t *row = cache->file.row + index * row_words(cache);
+    for (unsigned i = 0; i < cache->feature_cnt; i++) {
+        double score;
+        memcpy(&score, &row[1 + i], sizeof(score));
+        int err = vmaf_feature_collector_append(fc, cache->feature[i], score,
+                                                index);
+        if (err) return err;
+    }
+    return 0;
+}
+
+int vmaf_ref_cache_write(VmafRefCache *cache, VmafFeatureCollector *fc)
+{
+    if (!cache) return -EINVAL;
+    if (!fc) return -EINVAL;
+    if (!cache->feature) return -EINVAL;
+
+    int err = 0;
+    const size_t rw = row_words(cache);
+    uint64_t *row = malloc(sizeof(*row) * rw * cache->hash_cnt);
+    if (cache->hash_cnt && !row) return -ENOMEM;
+
+    for (unsigned i = 0; i < cache->hash_cnt; i++) {
+        row[i * rw] = cache->hash[i];
+        for (unsigned j = 0; j < cache->feature_cnt; j++) {
+            double score;
+            err = vmaf_feature_collector_get_score(fc, cache->feature[j],
+                                                   &score, i);
+            if (err) goto free_row;
+            memcpy(&row[i * rw + 1 + j], &score, sizeof(score));
+        }
+    }
+
+    RefCacheHeader header = {
+        .w = cache->w,
+        .h = cache->h,
+        .bpc = cache->bpc,
+        .feature_cnt = cache->feature_cnt,
+        .frame_cnt = cache->hash_cnt,
+    };
+    memcpy(header.magic, REF_CACHE_MAGIC, sizeof(header.magic));
+
+    /* Written aside and renamed over the old file, which may still be
+     * mapped by this or another process. */
+    const size_t tmp_sz = strlen(cache->path) + 64;
+    char *tmp = malloc(tmp_sz);
+    if (!tmp) {
+        err = -ENOMEM;
+        goto free_row;
+    }
+#if defined(_WIN32)
+    snprintf(tmp, tmp_sz, "%s.%d.%p.tmp", cache->path, _getpid(),
+             (void *) cache);
+    FILE *file = fopen(tmp, "wb");
+#else
+    snprintf(tmp, tmp_sz, "%s.XXXXXX", cache->path);
+    FILE *file = NULL;
+    const int fd = mkstemp(tmp);
+    if (fd >= 0) {
+        /* mkstemp() creates the file owner-only, the cache is shared */
+        if (fchmod(fd, 0644) || !(file = fdopen(fd, "wb"))) {
+            close(fd);
+            remove(tmp);
+        }
+    }
+#endif
+    if (!file) {
+        err = -EIO;
+        goto free_tmp;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (unsigned i = 0; ok && i < cache->feature_cnt; i++) {
+        char name[REF_CACHE_NAME_SZ] = { 0 };
+        strcpy(name, cache->feature[i]);
+        ok = fwrite(name, sizeof(name), 1, file) == 1;
+    }
+    if (ok && cache->hash_cnt)
+        ok = fwrite(row, sizeof(*row) * rw, cache->hash_cnt, file) ==
+             cache->hash_cnt;
+    ok &= !fclose(file);
+
+#if defined(_WIN32)
+    if (ok) remove(cache->path);
+#endif
+    if (!ok || rename(tmp, cache->path)) {
+        remove(tmp);
+        err = -EIO;
+    }
+
+free_tmp:
+    free(tmp);
+free_row:
+    free(row);
+    return err;
+}
+
+void vmaf_ref_cache_destroy(VmafRefCache *cache)
+{
+    if (!cache) return;
+
+    ref_cache_unmap(cache);
+    if (cache->feature) {
+        for (unsigned i = 0; cache->feature[i]; i++)
+            free(cache->feature[i]);
+        free(cache->feature);
+    }
+    free(cache->hash);
+    free(cache->path);
+    free(cache);
+}
@@ -0,0 +1,72 @@
+#ifndef __VMAF_SRC_REF_CACHE_H__
+#define __VMAF_SRC_REF_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "feature/feature_collector.h"
+#include "libvmaf/picture.h"
+
+/*
+ * On-disk cache of reference-only feature scores.
+ * Every frame is keyed by a hash of its luma plane, and the whole file by
+ * resolution, bitdepth and the list of cached features. A file written by
+ * an earlier run is memory-mapped, and the hashes of the current run are
+ * compared against it frame by frame. The caller decides which cached
+ * scores remain valid, since temporal features also depend on neighbouring
+ * frames. Given a directory, the cache is a file within it named after the
+ * hash of the first frame, the resolution and the bitdepth, so references
+ * share a directory without sharing a file.
+ */
+
+typedef struct VmafRefCache {
+    char *path;
+    bool dir;
+    struct {
+        void *addr;
+        size_t sz;
+        const uint64_t *row;
+        unsigned frame_cnt;
+    } file;
+    unsigned w, h, bpc;
+    char **feature;
+    unsigned feature_cnt;
+    uint64_t *hash;
+    unsigned hash_cnt, hash_capacity;
+} VmafRefCache;
+
+int vmaf_ref_cache_init(VmafRefCache **cache, const char *path);
+
+/* Name the cache file after the first frame, when the cache was opened on
+ * a directory. A no-op for a cache file. */
+int vmaf_ref_cache_name(VmafRefCache *cache, unsigned w, unsigned h,
+                        unsigned bpc, uint64_t hash);
+
+/* Select the key of the current run. Cached frames written under another
+ * key are ignored, and overwritten by `vmaf_ref_cache_write()`. */
+int vmaf_ref_cache_set_key(VmafRefCache *cache, unsigned w, unsigned h,
+                           unsigned bpc, const char **feature,
+                           unsigned feature_cnt);
+
+uint64_t vmaf_ref_cache_hash(VmafPicture *pic);
+
+/* Record the hash of frame `index` for the current run.
+ * Returns 1 if the cached frame at `index` has the same hash, 0 if not,
+ * or < 0 on error. */
+int vmaf_ref_cache_record(VmafRefCache *cache, unsigned index, uint64_t hash);
+
+/* Number of frames held by the cache file under the current key. */
+unsigned vmaf_ref_cache_frame_cnt(VmafRefCache *cache);
+
+/* Append the cached scores of frame `index` to `fc`. */
+int vmaf_ref_cache_import(VmafRefCache *cache, VmafFeatureCollector *fc,
+                          unsigned index);
+
+/* Replace the cache file with the recorded hashes and the scores of `fc`.
+ * Fails without touching the file if any score is missing. */
+int vmaf_ref_cache_write(VmafRefCache *cache, VmafFeatureCollector *fc);
+
+void vmaf_ref_cache_destroy(VmafRefCache *cache);
+
+#endif /* __VMAF_SRC_REF_CACHE_H__ */
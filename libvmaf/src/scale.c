@@ -0,0 +1,398 @@
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "feature/common/cpu.h"
+#include "scale.h"
+
+extern enum vmaf_cpu cpu;
+
+#define SCALE_BAND_ROWS 64
+#define SCALE_MAX_HELPERS 8
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* For every output sample, `taps` clamped source positions and weights,
+ * also stored tap-major, for filtering several outputs at once. */
+typedef struct ScaleFilter {
+    unsigned src_n, dst_n;
+    unsigned taps;
+    int *pos, *pos_t;
+    float *coeff, *coeff_t;
+    struct ScaleFilter *next;
+} ScaleFilter;
+
+struct VmafScaler {
+    unsigned w, h;
+    enum VmafScalingMethod method;
+    ScaleFilter *filter;
+};
+
+typedef struct ScaleBand {
+    const ScaleFilter *hor, *ver;
+    const uint8_t *src;
+    ptrdiff_t src_stride;
+    uint8_t *dst;
+    ptrdiff_t dst_stride;
+    unsigned step, hbd, shift, max;
+    unsigned row_begin, row_end;
+} ScaleBand;
+
+/* The bands of one picture, taken in turn by the calling thread and by
+ * helper jobs on the thread pool. A helper which only runs once every band
+ * is taken finds nothing left to do; the last reference frees the job. */
+typedef struct ScaleJob {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    ScaleBand *band;
+    unsigned band_cnt, next, finished;
+    unsigned ref_cnt;
+    int err;
+} ScaleJob;
+
+static double sinc(double x)
+{
+    if (x == 0.) return 1.;
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double kernel(enum VmafScalingMethod method, double x)
+{
+    x = fabs(x);
+    switch (method) {
+    case VMAF_SCALING_METHOD_BICUBIC:
+        // Mitchell-Netravali with B = 0, C = 0.6
+        if (x < 1.) return (1.4 * x - 2.4) * x * x + 1.;
+        if (x < 2.) return ((-0.6 * x + 3.) * x - 4.8) * x + 2.4;
+        return 0.;
+    case VMAF_SCALING_METHOD_LANCZOS:
+        return x < 3. ? sinc(x) * sinc(x / 3.) : 0.;
+    default:
+        return 0.;
+    }
+}
+
+static double kernel_support(enum VmafScalingMethod method)
+{
+    return method == VMAF_SCALING_METHOD_LANCZOS ? 3. : 2.;
+}
+
+static ScaleFilter *scale_filter(VmafScaler *scaler, unsigned src_n,
+                                 unsigned dst_n)
+{
+    for (ScaleFilter *f = scaler->filter; f; f = f->next) {
+        if (f->src_n == src_n && f->dst_n == dst_n) return f;
+    }
+
+    ScaleFilter *const f = malloc(sizeof(*f));
+    if (!f) return NULL;
+    memset(f, 0, sizeof(*f));
+
+    const double scale = (double) src_n / dst_n;
+    const double widen = scale > 1. ? scale : 1.;
+    const double radius = kernel_support(scaler->method) * widen;
+    f->src_n = src_n;
+    f->dst_n = dst_n;
+    f->taps = ceil(2. * radius);
+    f->pos = malloc(sizeof(*f->pos) * dst_n * f->taps);
+    f->coeff = malloc(sizeof(*f->coeff) * dst_n * f->taps);
+    f->pos_t = malloc(sizeof(*f->pos_t) * dst_n * f->taps);
+    f->coeff_t = malloc(sizeof(*f->coeff_t) * dst_n * f->taps);
+    if (!f->pos || !f->coeff || !f->pos_t || !f->coeff_t) goto free_f;
+
+    for (unsigned i = 0; i < dst_n; i++) {
+        const double center = (i + .5) * scale - .5;
+        const int first = floor(center - radius) + 1;
+        int *pos = f->pos + i * f->taps;
+        float *coeff = f->coeff + i * f->taps;
+
+        double sum = 0.;
+        for (unsigned k = 0; k < f->taps; k++)
+            sum += kernel(scaler->method, (first + (int) k - center) / widen);
+        for (unsigned k = 0; k < f->taps; k++) {
+            const int x = first + (int) k;
+            pos[k] = x < 0 ? 0 : x >= (int) src_n ? (int) src_n - 1 : x;
+            coeff[k] = kernel(scaler->method, (x - center) / widen) / sum;
+            f->pos_t[k * dst_n + i] = pos[k];
+            f->coeff_t[k * dst_n + i] = coeff[k];
+        }
+    }
+
+    f->next = scaler->filter;
+    scaler->filter = f;
+    return f;
+
+free_f:
+    free(f->pos);
+    free(f->coeff);
+    free(f->pos_t);
+    free(f->coeff_t);
+    free(f);
+    return NULL;
+}
+
+int vmaf_scaler_init(VmafScaler **scaler, unsigned w, unsigned h,
+                     enum VmafScalingMethod method)
+{
+    if (!scaler) return -EINVAL;
+    if (!w || !h) return -EINVAL;
+    if (method != VMAF_SCALING_METHOD_BICUBIC &&
+        method != VMAF_SCALING_METHOD_LANCZOS)
+    {
+        return -EINVAL;
+    }
+
+    VmafScaler *const s = *scaler = malloc(sizeof(*s));
+    if (!s) return -ENOMEM;
+    memset(s, 0, sizeof(*s));
+    s->w = w;
+    s->h = h;
+    s->method = method;
+    return 0;
+}
+
+void scale_vertical_c(const float *const *row, const float *coeff,
+                      unsigned taps, float *dst, unsigned w)
+{
+    for (unsigned j = 0; j < w; j++)
+        dst[j] = coeff[0] * row[0][j];
+    for (unsigned k = 1; k < taps; k++) {
+        for (unsigned j = 0; j < w; j++)
+            dst[j] += coeff[k] * row[k][j];
+    }
+}
+
+void scale_horizontal_c(const float *line, const int *pos,
+                        const float *coeff, unsigned taps, float *dst,
+                        unsigned w)
+{
+    for (unsigned j = 0; j < w; j++) {
+        float sum = coeff[j] * line[pos[j]];
+        for (unsigned k = 1; k < taps; k++)
+            sum += coeff[k * w + j] * line[pos[k * w + j]];
+        dst[j] = sum;
+    }
+}
+
+/* One source row as float samples, deinterleaved and normalized. */
+static void load_line(const ScaleBand *b, const uint8_t *src, float *line)
+{
+    const unsigned n = b->hor->src_n;
+    if (b->hbd) {
+        const uint16_t *s = (const uint16_t *) src;
+        for (unsigned x = 0; x < n; x++)
+            line[x] = s[x * b->step] >> b->shift;
+    } else {
+        for (unsigned x = 0; x < n; x++)
+            line[x] = src[x * b->step];
+    }
+}
+
+static int scale_band(const ScaleBand *b)
+{
+    const ScaleFilter *hor = b->hor, *ver = b->ver;
+    const int row_lo = ver->pos[b->row_begin * ver->taps];
+    const int row_hi = ver->pos[b->row_end * ver->taps - 1];
+    const size_t w = hor->dst_n;
+
+    float *const tmp = malloc(sizeof(*tmp) *
+                              (w * (row_hi - row_lo + 2) + hor->src_n));
+    if (!tmp) return -ENOMEM;
+    float *const out = tmp + w * (row_hi - row_lo + 1);
+    float *const line = out + w;
+    const float *row[ver->taps];
+
+    for (int i = row_lo; i <= row_hi; i++) {
+        load_line(b, b->src + i * b->src_stride, line);
+        if (cpu >= VMAF_CPU_AVX)
+            scale_horizontal_avx(line, hor->pos_t, hor->coeff_t, hor->taps,
+                                 tmp + (i - row_lo) * w, w);
+        else
+            scale_horizontal_c(line, hor->pos_t, hor->coeff_t, hor->taps,
+                               tmp + (i - row_lo) * w, w);
+    }
+
+    for (unsigned i = b->row_begin; i < b->row_end; i++) {
+        const int *pos = ver->pos + i * ver->taps;
+        for (unsigned k = 0; k < ver->taps; k++)
+            row[k] = tmp + (pos[k] - row_lo) * w;
+        if (cpu >= VMAF_CPU_AVX)
+            scale_vertical_avx(row, ver->coeff + i * ver->taps, ver->taps,
+                               out, w);
+        else
+            scale_vertical_c(row, ver->coeff + i * ver->taps, ver->taps,
+                             out, w);
+
+        uint8_t *dst = b->dst + i * b->dst_stride;
+        for (unsigned j = 0; j < w; j++) {
+            const float v = out[j] + .5f;
+            const unsigned s = v <= 0.f ? 0 : v >= b->max ? b->max : v;
+            if (b->hbd)
+                ((uint16_t *) dst)[j * b->step] = s << b->shift;
+            else
+                dst[j * b->step] = s;
+        }
+    }
+
+    free(tmp);
+    return 0;
+}
+
+static void scale_bands(ScaleJob *job)
+{
+    pthread_mutex_lock(&job->lock);
+    while (job->next < job->band_cnt) {
+        const ScaleBand *b = &job->band[job->next++];
+        pthread_mutex_unlock(&job->lock);
+        const int err = scale_band(b);
+        pthread_mutex_lock(&job->lock);
+        if (err) job->err = err;
+        if (++job->finished == job->band_cnt)
+            pthread_cond_signal(&job->done);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void scale_job_unref(ScaleJob *job)
+{
+    pthread_mutex_lock(&job->lock);
+    const unsigned ref_cnt = --job->ref_cnt;
+    pthread_mutex_unlock(&job->lock);
+    if (ref_cnt) return;
+
+    pthread_cond_destroy(&job->done);
+    pthread_mutex_destroy(&job->lock);
+    free(job->band);
+    free(job);
+}
+
+static void scale_helper_func(void *data)
+{
+    ScaleJob *job = *(ScaleJob **) data;
+    scale_bands(job);
+    scale_job_unref(job);
+}
+
+int vmaf_scaler_scale(VmafScaler *scaler, VmafPicture *dst, VmafPicture *src,
+                      VmafThreadPool *pool)
+{
+    if (!scaler) return -EINVAL;
+    if (!dst) return -EINVAL;
+    if (!src) return -EINVAL;
+
+    if (src->w[0] == scaler->w && src->h[0] == scaler->h)
+        return vmaf_picture_ref(dst, src);
+
+    int err = vmaf_picture_alloc(dst, src->pix_fmt, src->bpc, scaler->w,
+                                 scaler->h);
+    if (err) return err;
+
+    const int semi_planar = src->pix_fmt == VMAF_PIX_FMT_NV12 ||
+                            src->pix_fmt == VMAF_PIX_FMT_P010;
+
+    ScaleJob *const job = malloc(sizeof(*job));
+    if (!job) goto fail;
+    memset(job, 0, sizeof(*job));
+    unsigned band_cnt = 0;
+    for (unsigned p = 0; p < 3; p++) {
+        if (!src->w[p] || !dst->w[p]) continue;
+        band_cnt += (dst->h[p] + SCALE_BAND_ROWS - 1) / SCALE_BAND_ROWS;
+    }
+    job->band = malloc(sizeof(*job->band) * band_cnt);
+    if (!job->band) goto free_job;
+
+    for (unsigned p = 0; p < 3; p++) {
+        if (!src->w[p] || !dst->w[p]) continue;
+        ScaleBand b = {
+            .hor = scale_filter(scaler, src->w[p], dst->w[p]),
+            .ver = scale_filter(scaler, src->h[p], dst->h[p]),
+            .src = src->data[p],
+            .src_stride = src->stride[p],
+            .dst = dst->data[p],
+            .dst_stride = dst->stride[p],
+            // interleaved chroma is scaled one component at a time
+            .step = semi_planar && p ? 2 : 1,
+            .hbd = src->bpc > 8,
+            .shift = src->pix_fmt == VMAF_PIX_FMT_P010 ? 6 : 0,
+            .max = (1u << src->bpc) - 1,
+        };
+        if (!b.hor || !b.ver) goto free_band;
+
+        for (unsigned i = 0; i < dst->h[p]; i += SCALE_BAND_ROWS) {
+            b.row_begin = i;
+            b.row_end = i + SCALE_BAND_ROWS < dst->h[p] ?
+                        i + SCALE_BAND_ROWS : dst->h[p];
+            job->band[job->band_cnt++] = b;
+        }
+    }
+
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->done, NULL);
+    job->ref_cnt = 1;
+
+    // idle threads help, busy ones leave the bands to the calling thread
+    const unsigned helper_cnt = band_cnt < SCALE_MAX_HELPERS + 1 ?
+                                band_cnt - !!band_cnt : SCALE_MAX_HELPERS;
+    for (unsigned i = 0; pool && i < helper_cnt; i++) {
+        pthread_mutex_lock(&job->lock);
+        job->ref_cnt++;
+        pthread_mutex_unlock(&job->lock);
+        ScaleJob *data = job;
+        if (!vmaf_thread_pool_enqueue(pool, scale_helper_func, &data,
+                                      sizeof(data)))
+        {
+            continue;
+        }
+        pthread_mutex_lock(&job->lock);
+        job->ref_cnt--;
+        pthread_mutex_unlock(&job->lock);
+        break;
+    }
+
+    scale_bands(job);
+    pthread_mutex_lock(&job->lock);
+    while (job->finished < job->band_cnt)
+        pthread_cond_wait(&job->done, &job->lock);
+    err = job->err;
+    pthread_mutex_unlock(&job->lock);
+    scale_job_unref(job);
+
+    if (err) vmaf_picture_unref(dst);
+    return err;
+
+free_band:
+    free(job->band);
+free_job:
+    free(job);
+fail:
+    vmaf_picture_unref(dst);
+    return -ENOMEM;
+}
+
+bool vmaf_scaler_equivalent(const VmafScaler *a, const VmafScaler *b)
+{
+    if (!a || !b) return false;
+    return a->w == b->w && a->h == b->h && a->method == b->method;
+}
+
+void vmaf_scaler_destroy(VmafScaler *scaler)
+{
+    if (!scaler) return;
+
+    while (scaler->filter) {
+        ScaleFilter *f = scaler->filter;
+        scaler->filter = f->next;
+        free(f->pos);
+        free(f->coeff);
+        free(f->pos_t);
+        free(f->coeff_t);
+        free(f);
+    }
+    free(scaler);
+}
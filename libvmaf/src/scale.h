@@ -0,0 +1,53 @@
+#ifndef __VMAF_SRC_SCALE_H__
+#define __VMAF_SRC_SCALE_H__
+
+#include <stdbool.h>
+
+#include <libvmaf/libvmaf.rc.h>
+
+#include "picture.h"
+#include "thread_pool.h"
+
+/*
+ * Separable resampler, scaling pictures to the resolution a model expects.
+ * Filters follow swscale's defaults: bicubic with B = 0, C = 0.6 and
+ * 3-lobe lanczos, widened by the scaling factor when downscaling, with
+ * samples aligned on their centers. Each plane is filtered horizontally into
+ * float rows, and vertically into the output, in bands of rows. The calling
+ * thread works through the bands, helped by the threads of the pool which
+ * are idle, so that scaling never waits behind queued extraction jobs.
+ */
+
+typedef struct VmafScaler VmafScaler;
+
+int vmaf_scaler_init(VmafScaler **scaler, unsigned w, unsigned h,
+                     enum VmafScalingMethod method);
+
+/* Scale `src` into `dst`, a new picture of the same pixel format and
+ * bitdepth. A picture which already has the scaler's resolution is
+ * referenced, not copied. */
+int vmaf_scaler_scale(VmafScaler *scaler, VmafPicture *dst, VmafPicture *src,
+                      VmafThreadPool *pool);
+
+/* Whether both scalers produce the same pictures from the same input. */
+bool vmaf_scaler_equivalent(const VmafScaler *a, const VmafScaler *b);
+
+void vmaf_scaler_destroy(VmafScaler *scaler);
+
+/* Filter one row of float samples into `w` outputs, with `taps` positions
+ * and weights per output, stored tap-major: tap k of output j is at
+ * k * w + j. */
+void scale_horizontal_c(const float *line, const int *pos,
+                        const float *coeff, unsigned taps, float *dst,
+                        unsigned w);
+void scale_horizontal_avx(const float *line, const int *pos,
+                          const float *coeff, unsigned taps, float *dst,
+                          unsigned w);
+
+/* Weighted sum of `taps` float rows, `w` samples wide. */
+void scale_vertical_c(const float *const *row, const float *coeff,
+                      unsigned taps, float *dst, unsigned w);
+void scale_vertical_avx(const float *const *row, const float *coeff,
+                        unsigned taps, float *dst, unsigned w);
+
+#endif /* __VMAF_SRC_SCALE_H__ */
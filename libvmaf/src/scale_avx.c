@@ -0,0 +1,58 @@
+#include <immintrin.h>
+
+#include "scale.h"
+
+static inline __m256 load_samples(const float *line, const int *pos)
+{
+    return _mm256_set_ps(line[pos[7]], line[pos[6]], line[pos[5]],
+                         line[pos[4]], line[pos[3]], line[pos[2]],
+                         line[pos[1]], line[pos[0]]);
+}
+
+/* Eight outputs at a time, each summed over the taps in the same order as
+ * the C version, which it matches exactly. */
+void scale_horizontal_avx(const float *line, const int *pos,
+                          const float *coeff, unsigned taps, float *dst,
+                          unsigned w)
+{
+    unsigned j = 0;
+    for (; j + 8 <= w; j += 8) {
+        __m256 sum = _mm256_mul_ps(_mm256_loadu_ps(coeff + j),
+                                   load_samples(line, pos + j));
+        for (unsigned k = 1; k < taps; k++) {
+            const size_t o = (size_t) k * w + j;
+            sum = _mm256_add_ps(sum,
+                                _mm256_mul_ps(_mm256_loadu_ps(coeff + o),
+                                              load_samples(line, pos + o)));
+        }
+        _mm256_storeu_ps(dst + j, sum);
+    }
+    for (; j < w; j++) {
+        float sum = coeff[j] * line[pos[j]];
+        for (unsigned k = 1; k < taps; k++)
+            sum += coeff[k * w + j] * line[pos[k * w + j]];
+        dst[j] = sum;
+    }
+}
+
+void scale_vertical_avx(const float *const *row, const float *coeff,
+                        unsigned taps, float *dst, unsigned w)
+{
+    unsigned j = 0;
+    for (; j + 8 <= w; j += 8) {
+        __m256 sum = _mm256_mul_ps(_mm256_set1_ps(coeff[0]),
+                                   _mm256_loadu_ps(row[0] + j));
+        for (unsigned k = 1; k < taps; k++) {
+            sum = _mm256_add_ps(sum,
+                                _mm256_mul_ps(_mm256_set1_ps(coeff[k]),
+                                              _mm256_loadu_ps(row[k] + j)));
+        }
+        _mm256_storeu_ps(dst + j, sum);
+    }
+    for (; j < w; j++) {
+        float sum = coeff[0] * row[0][j];
+        for (unsigned k = 1; k < taps; k++)
+            sum += coeff[k] * row[k][j];
+        dst[j] = sum;
+    }
+}
@@ -4,13 +4,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "thread_pool.h"
+#include "trace.h"
+
 typedef struct VmafThreadPoolJob {
     void (*func)(void *data);
     void *data;
+    VmafThreadPoolGroup *group;
     struct VmafThreadPoolJob *next;
 } VmafThreadPoolJob;
 
-typedef struct VmafTreadPool {
+struct VmafThreadPool {
     struct {
         pthread_mutex_t lock;
         pthread_cond_t empty;
@@ -20,7 +24,8 @@ typedef struct VmafTreadPool {
     unsigned n_threads;
     unsigned n_working;
     bool stop;
-} VmafThreadPool;
+    VmafTrace *trace;
+};
 
 static VmafThreadPoolJob *vmaf_thread_pool_fetch_job(VmafThreadPool *pool)
 {
@@ -54,21 +59,27 @@ static void *vmaf_thread_pool_runner(void *p)
             pthread_cond_wait(&(pool->queue.empty), &(pool->queue.lock));
         if (pool->stop) break;
         VmafThreadPoolJob *job = vmaf_thread_pool_fetch_job(pool);
+        VmafTrace *trace = pool->trace;
         pool->n_working++;
         pthread_mutex_unlock(&(pool->queue.lock));
+        VmafThreadPoolGroup *group = job ? job->group : NULL;
         if (job) {
+            vmaf_trace_begin(trace, "thread_pool", "job", VMAF_TRACE_NO_INDEX);
             job->func(job->data);
             vmaf_thread_pool_job_destroy(job);
+            vmaf_trace_end(trace, "thread_pool", "job");
         }
         pthread_mutex_lock(&(pool->queue.lock));
         pool->n_working--;
+        if (group && !--group->pending)
+            pthread_cond_broadcast(&(pool->working));
         if (!pool->stop && pool->n_working == 0 && !pool->queue.head)
-            pthread_cond_signal(&(pool->working));
+            pthread_cond_broadcast(&(pool->working));
         pthread_mutex_unlock(&(pool->queue.lock));
     }
 
     if (--(pool->n_threads) == 0)
-        pthread_cond_signal(&(pool->working));
+        pthread_cond_broadcast(&(pool->working));
 
     pthread_mutex_unlock(&(pool->queue.lock));
     return NULL;
@@ -99,6 +110,14 @@ int vmaf_thread_pool_create(VmafThreadPool **pool, unsigned n_threads)
 
 int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
                              void *data, size_t data_sz)
+{
+    return vmaf_thread_pool_enqueue_group(pool, NULL, func, data, data_sz);
+}
+
+int vmaf_thread_pool_enqueue_group(VmafThreadPool *pool,
+                                   VmafThreadPoolGroup *group,
+                                   void (*func)(void *data),
+                                   void *data, size_t data_sz)
 {
     if (!pool) return -EINVAL;
     if (!func) return -EINVAL;
@@ -107,6 +126,7 @@ int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
     if (!job) return -ENOMEM;
     memset(job, 0, sizeof(*job));
     job->func = func;
+    job->group = group;
     if (data) {
         job->data = malloc(data_sz);
         if (!job->data) goto free_job;
@@ -115,6 +135,7 @@ int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
 
     pthread_mutex_lock(&(pool->queue.lock));
 
+    if (group) group->pending++;
     if (!pool->queue.head) {
         pool->queue.head = job;
         pool->queue.tail = pool->queue.head;
@@ -138,11 +159,38 @@ int vmaf_thread_pool_wait(VmafThreadPool *pool)
     if (!pool) return -EINVAL;
 
     pthread_mutex_lock(&(pool->queue.lock));
-    while((!pool->stop && pool->n_working) || (pool->stop && pool->n_threads))
+    // queued jobs count as pending work, even while no runner has taken one
+    while((!pool->stop && (pool->n_working || pool->queue.head)) ||
+          (pool->stop && pool->n_threads))
+        pthread_cond_wait(&(pool->working), &(pool->queue.lock));
+    pthread_mutex_unlock(&(pool->queue.lock));
+    return 0;
+}
+
+int vmaf_thread_pool_wait_group(VmafThreadPool *pool,
+                                VmafThreadPoolGroup *group)
+{
+    if (!pool) return -EINVAL;
+    if (!group) return -EINVAL;
+
+    pthread_mutex_lock(&(pool->queue.lock));
+    while (group->pending)
         pthread_cond_wait(&(pool->working), &(pool->queue.lock));
     pthread_mutex_unlock(&(pool->queue.lock));
     return 0;
 }
+
+/* Record every job run from now on, `trace` must outlive the pool. */
+int vmaf_thread_pool_set_trace(VmafThreadPool *pool, VmafTrace *trace)
+{
+    if (!pool) return -EINVAL;
+
+    pthread_mutex_lock(&(pool->queue.lock));
+    pool->trace = trace;
+    pthread_mutex_unlock(&(pool->queue.lock));
+    return 0;
+}
+
 int vmaf_thread_pool_destroy(VmafThreadPool *pool)
 {
     if (!pool) return -EINVAL;
@@ -151,12 +199,14 @@ int vmaf_thread_pool_destroy(VmafThreadPool *pool)
     VmafThreadPoolJob *job = pool->queue.head;
     while (job) {
         VmafThreadPoolJob *next_job = job->next;
+        if (job->group) job->group->pending--;
         vmaf_thread_pool_job_destroy(job);
         job = next_job;
     }
 
     pool->stop = true;
     pthread_cond_broadcast(&(pool->queue.empty));
+    pthread_cond_broadcast(&(pool->working));
     pthread_mutex_unlock(&(pool->queue.lock));
     vmaf_thread_pool_wait(pool);
     pthread_mutex_destroy(&(pool->queue.lock));
@@ -3,15 +3,33 @@
 
 #include <pthread.h>
 
+#include "trace.h"
+
 typedef struct VmafThreadPool VmafThreadPool;
 
+/* Counts the jobs of one user of a shared pool, which can be waited for
+ * without waiting for the jobs of every other user. */
+typedef struct VmafThreadPoolGroup {
+    unsigned pending;
+} VmafThreadPoolGroup;
+
 int vmaf_thread_pool_create(VmafThreadPool **tpool, unsigned n_threads);
 
 int vmaf_thread_pool_enqueue(VmafThreadPool *pool, void (*func)(void *data),
                              void *data, size_t data_sz);
 
+int vmaf_thread_pool_enqueue_group(VmafThreadPool *pool,
+                                   VmafThreadPoolGroup *group,
+                                   void (*func)(void *data),
+                                   void *data, size_t data_sz);
+
 int vmaf_thread_pool_wait(VmafThreadPool *pool);
 
+int vmaf_thread_pool_wait_group(VmafThreadPool *pool,
+                                VmafThreadPoolGroup *group);
+
+int vmaf_thread_pool_set_trace(VmafThreadPool *pool, VmafTrace *trace);
+
 int vmaf_thread_pool_destroy(VmafThreadPool *tpool);
 
 #endif /* __VMAF_THREAD_POOL_H__ */
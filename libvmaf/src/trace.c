@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+#define TRACE_CHUNK_EVENTS 1024
+
+typedef struct TraceEvent {
+    const char *cat, *name;
+    double ts;
+    unsigned index;
+    char ph;
+} TraceEvent;
+
+typedef struct TraceChunk {
+    TraceEvent event[TRACE_CHUNK_EVENTS];
+    unsigned cnt;
+    struct TraceChunk *next;
+} TraceChunk;
+
+typedef struct TraceBuffer {
+    unsigned tid;
+    TraceChunk *head, *tail;
+    struct TraceBuffer *next;
+} TraceBuffer;
+
+struct VmafTrace {
+    pthread_key_t key;
+    double start;
+    // guards adding a thread's buffer, appending to it takes no lock
+    pthread_mutex_t lock;
+    TraceBuffer *buffers;
+    unsigned next_tid;
+};
+
+static double trace_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int vmaf_trace_init(VmafTrace **trace)
+{
+    if (!trace) return -EINVAL;
+
+    VmafTrace *const t = *trace = malloc(sizeof(*t));
+    if (!t) return -ENOMEM;
+    memset(t, 0, sizeof(*t));
+    if (pthread_key_create(&t->key, NULL)) {
+        free(t);
+        return -ENOMEM;
+    }
+    pthread_mutex_init(&t->lock, NULL);
+    t->next_tid = 1;
+    t->start = trace_clock();
+    return 0;
+}
+
+/* The calling thread's buffer, added to the list on its first event. */
+static TraceBuffer *trace_buffer(VmafTrace *trace)
+{
+    TraceBuffer *b = pthread_getspecific(trace->key);
+    if (b) return b;
+
+    b = malloc(sizeof(*b));
+    if (!b) return NULL;
+    memset(b, 0, sizeof(*b));
+    if (pthread_setspecific(trace->key, b)) {
+        free(b);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&trace->lock);
+    b->tid = trace->next_tid++;
+    b->next = trace->buffers;
+    trace->buffers = b;
+    pthread_mutex_unlock(&trace->lock);
+    return b;
+}
+
+static void trace_event(VmafTrace *trace, char ph, const char *cat,
+                        const char *name, unsigned index)
+{
+    const double ts = trace_clock();
+    TraceBuffer *b = trace_buffer(trace);
+    if (!b) return;
+
+    if (!b->tail || b->tail->cnt == TRACE_CHUNK_EVENTS) {
+        TraceChunk *c = malloc(sizeof(*c));
+        // events are dropped rather than failing the caller
+        if (!c) return;
+        c->cnt = 0;
+        c->next = NULL;
+        if (b->tail) b->tail->next = c;
+        else b->head = c;
+        b->tail = c;
+    }
+
+    TraceEvent *e = &b->tail->event[b->tail->cnt++];
+    e->cat = cat;
+    e->name = name;
+    e->ts = ts;
+    e->index = index;
+    e->ph = ph;
+}
+
+void vmaf_trace_begin(VmafTrace *trace, const char *cat, const char *name,
+                      unsigned index)
+{
+    if (!trace) return;
+    trace_event(trace, 'B', cat, name, index);
+}
+
+void vmaf_trace_end(VmafTrace *trace, const char *cat, const char *name)
+{
+    if (!trace) return;
+    trace_event(trace, 'E', cat, name, VMAF_TRACE_NO_INDEX);
+}
+
+int vmaf_trace_write(VmafTrace *trace, FILE *outfile)
+{
+    if (!trace) return -EINVAL;
+    if (!outfile) return -EINVAL;
+
+    fprintf(outfile, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    const char *sep = "";
+    for (TraceBuffer *b = trace->buffers; b; b = b->next) {
+        fprintf(outfile, "%s{\"name\": \"thread_name\", \"ph\": \"M\", "
+                "\"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+                sep, b->tid, b->tid);
+        sep = ",\n";
+        for (TraceChunk *c = b->head; c; c = c->next) {
+            for (unsigned i = 0; i < c->cnt; i++) {
+                const TraceEvent *e = &c->event[i];
+                fprintf(outfile, "%s{\"name\": \"%s\", \"cat\": \"%s\", "
+                        "\"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, "
+                        "\"tid\": %u", sep, e->name, e->cat, e->ph,
+                        (e->ts - trace->start) * 1e6, b->tid);
+                if (e->index != VMAF_TRACE_NO_INDEX)
+                    fprintf(outfile, ", \"args\": {\"index\": %u}", e->index);
+                fprintf(outfile, "}");
+            }
+        }
+    }
+    fprintf(outfile, "\n]}\n");
+    return ferror(outfile) ? -EIO : 0;
+}
+
+void vmaf_trace_destroy(VmafTrace *trace)
+{
+    if (!trace) return;
+
+    TraceBuffer *b = trace->buffers;
+    while (b) {
+        TraceBuffer *next_b = b->next;
+        while (b->head) {
+            TraceChunk *c = b->head;
+            b->head = c->next;
+            free(c);
+        }
+        free(b);
+        b = next_b;
+    }
+    pthread_key_delete(trace->key);
+    pthread_mutex_destroy(&trace->lock);
+    free(trace);
+}
@@ -0,0 +1,29 @@
+#ifndef __VMAF_SRC_TRACE_H__
+#define __VMAF_SRC_TRACE_H__
+
+#include <stdio.h>
+
+/*
+ * Timeline of begin/end events, written as Chrome trace-event JSON (for
+ * chrome://tracing or Perfetto). Every thread appends to its own buffer,
+ * without locks, and the buffers are only read by `vmaf_trace_write()`,
+ * once every thread is done. `name` and `cat` must outlive the trace.
+ * Callers skip tracing altogether with a NULL trace.
+ */
+
+typedef struct VmafTrace VmafTrace;
+
+#define VMAF_TRACE_NO_INDEX (~0u)
+
+int vmaf_trace_init(VmafTrace **trace);
+
+void vmaf_trace_begin(VmafTrace *trace, const char *cat, const char *name,
+                      unsigned index);
+
+void vmaf_trace_end(VmafTrace *trace, const char *cat, const char *name);
+
+int vmaf_trace_write(VmafTrace *trace, FILE *outfile);
+
+void vmaf_trace_destroy(VmafTrace *trace);
+
+#endif /* __VMAF_SRC_TRACE_H__ */
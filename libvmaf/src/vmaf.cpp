@@ -148,6 +148,8 @@ void LibsvmNusvrTrainTestModel::load_model()
     const char *libsvm_model_path = libsvm_model_path_.c_str();
     dbg_printf("Read input model (libsvm) at %s ...\n", libsvm_model_path);
     svm_model_ptr = _read_and_assert_svm_model(libsvm_model_path);
+
+    _resolve_features();
 }
 
 std::unique_ptr<svm_model, SvmDelete> LibsvmNusvrTrainTestModel::_read_and_assert_svm_model(const char* libsvm_model_path)
@@ -160,121 +162,83 @@ std::unique_ptr<svm_model, SvmDelete> LibsvmNusvrTrainTestModel::_read_and_asser
     return svm_model_ptr;
 }
 
-void LibsvmNusvrTrainTestModel::populate_and_normalize_nodes_at_frm(size_t i_frm,
-        svm_node*& nodes, StatVector& adm2,
-        StatVector& adm_scale0, StatVector& adm_scale1,
-        StatVector& adm_scale2, StatVector& adm_scale3, StatVector& motion,
-        StatVector& vif_scale0, StatVector& vif_scale1, StatVector& vif_scale2,
-        StatVector& vif_scale3, StatVector& vif, StatVector& motion2) {
-    if (VAL_EQUAL_STR(norm_type, "'linear_rescale'")) {
-        for (size_t j = 0; j < feature_names.length(); j++) {
-            nodes[j].index = j + 1;
-            if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm2_score'") == 0)
-                nodes[j].value = double(slopes[j + 1]) * adm2.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale0_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * adm_scale0.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale1_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * adm_scale1.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale2_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * adm_scale2.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale3_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * adm_scale3.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_motion_score'") == 0)
-                nodes[j].value = double(slopes[j + 1]) * motion.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale0_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * vif_scale0.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale1_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * vif_scale1.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale2_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * vif_scale2.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale3_score'") == 0)
-                nodes[j].value = double(slopes[j + 1])
-                        * vif_scale3.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_score'") == 0)
-                nodes[j].value = double(slopes[j + 1]) * vif.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_motion2_score'") == 0)
-                nodes[j].value = double(slopes[j + 1]) * motion2.at(i_frm)
-                        + double(intercepts[j + 1]);
-            else {
-                printf("Unknown feature name: %s.\n",
-                        Stringize(feature_names[j]).c_str());
-                throw VmafException("Unknown feature name");
-            }
+static const struct {
+    const char *name, *key;
+} vmaf_feature_table[NUM_VMAF_FEATURES] = {
+    { "'VMAF_feature_adm2_score'",       "adm2" },
+    { "'VMAF_feature_adm_scale0_score'", "adm_scale0" },
+    { "'VMAF_feature_adm_scale1_score'", "adm_scale1" },
+    { "'VMAF_feature_adm_scale2_score'", "adm_scale2" },
+    { "'VMAF_feature_adm_scale3_score'", "adm_scale3" },
+    { "'VMAF_feature_motion_score'",     "motion" },
+    { "'VMAF_feature_vif_scale0_score'", "vif_scale0" },
+    { "'VMAF_feature_vif_scale1_score'", "vif_scale1" },
+    { "'VMAF_feature_vif_scale2_score'", "vif_scale2" },
+    { "'VMAF_feature_vif_scale3_score'", "vif_scale3" },
+    { "'VMAF_feature_vif_score'",        "vif" },
+    { "'VMAF_feature_motion2_score'",    "motion2" },
+};
+
+const char *LibsvmNusvrTrainTestModel::feature_key(VmafFeature feature)
+{
+    return vmaf_feature_table[feature].key;
+}
+
+void LibsvmNusvrTrainTestModel::_resolve_features()
+{
+    linear_rescale = VAL_EQUAL_STR(norm_type, "'linear_rescale'");
+
+    features.clear();
+    feature_slopes.clear();
+    feature_intercepts.clear();
+    for (size_t j = 0; j < feature_names.length(); j++) {
+        std::string name = Stringize(feature_names[j]);
+        size_t k;
+        for (k = 0; k < NUM_VMAF_FEATURES; k++) {
+            if (name.compare(vmaf_feature_table[k].name) == 0)
+                break;
         }
-    } else {
-        for (size_t j = 0; j < feature_names.length(); j++) {
-            nodes[j].index = j + 1;
-            if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm2_score'") == 0)
-                nodes[j].value = adm2.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale0_score'") == 0)
-                nodes[j].value = adm_scale0.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale1_score'") == 0)
-                nodes[j].value = adm_scale1.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale2_score'") == 0)
-                nodes[j].value = adm_scale2.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_adm_scale3_score'") == 0)
-                nodes[j].value = adm_scale3.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_motion_score'") == 0)
-                nodes[j].value = motion.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale0_score'") == 0)
-                nodes[j].value = vif_scale0.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale1_score'") == 0)
-                nodes[j].value = vif_scale1.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale2_score'") == 0)
-                nodes[j].value = vif_scale2.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_scale3_score'") == 0)
-                nodes[j].value = vif_scale3.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_vif_score'") == 0)
-                nodes[j].value = vif.at(i_frm);
-            else if (strcmp(Stringize(feature_names[j]).c_str(),
-                    "'VMAF_feature_motion2_score'") == 0)
-                nodes[j].value = motion2.at(i_frm);
-            else {
-                printf("Unknown feature name: %s.\n",
-                        Stringize(feature_names[j]).c_str());
-                throw VmafException("Unknown feature name");
-            }
+        if (k == NUM_VMAF_FEATURES) {
+            printf("Unknown feature name: %s.\n", name.c_str());
+            throw VmafException("Unknown feature name");
+        }
+        features.push_back(static_cast<VmafFeature>(k));
+        if (linear_rescale) {
+            feature_slopes.push_back(double(slopes[j + 1]));
+            feature_intercepts.push_back(double(intercepts[j + 1]));
+        }
+    }
+
+    if (linear_rescale) {
+        prediction_slope = double(slopes[0]);
+        prediction_intercept = double(intercepts[0]);
+    }
+}
+
+/*
+ * Normalize every model feature over all frames in one pass. The result is
+ * feature-major: the value for feature j at frame i is at j * num_frms + i.
+ */
+void LibsvmNusvrTrainTestModel::normalize_features(size_t num_frms,
+        StatVector* const stats[NUM_VMAF_FEATURES],
+        std::vector<double>& normalized)
+{
+    normalized.resize(features.size() * num_frms);
+
+    for (size_t j = 0; j < features.size(); j++) {
+        std::vector<double> values = stats[features[j]]->getVector();
+        if (values.size() < num_frms) {
+            throw VmafException("Feature vector shorter than number of frames");
+        }
+        double *dst = normalized.data() + j * num_frms;
+        const double *src = values.data();
+        if (linear_rescale) {
+            const double slope = feature_slopes[j];
+            const double intercept = feature_intercepts[j];
+            for (size_t i = 0; i < num_frms; i++)
+                dst[i] = slope * src[i] + intercept;
+        } else {
+            std::copy(src, src + num_frms, dst);
         }
     }
 }
@@ -293,12 +257,9 @@ VmafPredictionStruct LibsvmNusvrTrainTestModel::predict(svm_node* nodes) {
 }
 
 void LibsvmNusvrTrainTestModel::_denormalize_prediction(double& prediction) {
-    if (VAL_EQUAL_STR(norm_type, "'linear_rescale'")) {
+    if (linear_rescale) {
         /* denormalize */
-        prediction = (prediction - double(intercepts[0]))
-                / double(slopes[0]);
-    } else {
-        ;
+        prediction = (prediction - prediction_intercept) / prediction_slope;
     }
 }
 
@@ -379,6 +340,7 @@ void BootstrapLibsvmNusvrTrainTestModel::load_model()
         }
     }
 
+    _resolve_features();
 }
 
 VmafPredictionStruct BootstrapLibsvmNusvrTrainTestModel::predict(svm_node* nodes) {
@@ -486,15 +448,25 @@ void VmafQualityRunner::_normalize_predict_denormalize_transform_clip(
     /* IMPORTANT: always allocate one more spot and put a -1 at the last one's
      * index, so that libsvm will stop looping when seeing the -1 !!!
      * see https://github.com/cjlin1/libsvm */
+    const size_t num_features = model.features.size();
     svm_node* nodes = (svm_node*) alloca(
-            sizeof(svm_node) * (model.feature_names.length() + 1));
-    nodes[model.feature_names.length()].index = -1;
+            sizeof(svm_node) * (num_features + 1));
+    for (size_t j = 0; j < num_features; j++) {
+        nodes[j].index = j + 1;
+    }
+    nodes[num_features].index = -1;
+
+    StatVector* const stats[NUM_VMAF_FEATURES] = {
+        &adm2, &adm_scale0, &adm_scale1, &adm_scale2, &adm_scale3, &motion,
+        &vif_scale0, &vif_scale1, &vif_scale2, &vif_scale3, &vif, &motion2,
+    };
+    std::vector<double> normalized;
+    model.normalize_features(num_frms, stats, normalized);
 
-    size_t i_subsampled;
     for (size_t i_frm=0; i_frm<num_frms; i_frm++) {
-        model.populate_and_normalize_nodes_at_frm(i_frm, nodes, adm2,
-                adm_scale0, adm_scale1, adm_scale2, adm_scale3, motion,
-                vif_scale0, vif_scale1, vif_scale2, vif_scale3, vif, motion2);
+        for (size_t j = 0; j < num_features; j++) {
+            nodes[j].value = normalized[j * num_frms + i_frm];
+        }
 
         VmafPredictionStruct predictionStruct = model.predict(nodes);
 
@@ -561,263 +533,88 @@ Result VmafQualityRunner::run(Asset asset, int (*read_frame)(float *ref_data, fl
     int h = asset.getHeight();
     const char* fmt = asset.getFmt();
     char errmsg[1024];
-    DArray adm_num_array, adm_den_array, adm_num_scale0_array,
-            adm_den_scale0_array, adm_num_scale1_array, adm_den_scale1_array,
-            adm_num_scale2_array, adm_den_scale2_array, adm_num_scale3_array,
-            adm_den_scale3_array, motion_array, motion2_array,
-            vif_num_scale0_array, vif_den_scale0_array, vif_num_scale1_array,
-            vif_den_scale1_array, vif_num_scale2_array, vif_den_scale2_array,
-            vif_num_scale3_array, vif_den_scale3_array, vif_array, psnr_array,
-            ssim_array, ms_ssim_array;
-    /* use the following ptrs as flags to turn on/off optional metrics */
-    DArray *psnr_array_ptr, *ssim_array_ptr, *ms_ssim_array_ptr;
-    init_array(&adm_num_array, INIT_FRAMES);
-    init_array(&adm_den_array, INIT_FRAMES);
-    init_array(&adm_num_scale0_array, INIT_FRAMES);
-    init_array(&adm_den_scale0_array, INIT_FRAMES);
-    init_array(&adm_num_scale1_array, INIT_FRAMES);
-    init_array(&adm_den_scale1_array, INIT_FRAMES);
-    init_array(&adm_num_scale2_array, INIT_FRAMES);
-    init_array(&adm_den_scale2_array, INIT_FRAMES);
-    init_array(&adm_num_scale3_array, INIT_FRAMES);
-    init_array(&adm_den_scale3_array, INIT_FRAMES);
-    init_array(&motion_array, INIT_FRAMES);
-    init_array(&motion2_array, INIT_FRAMES);
-    init_array(&vif_num_scale0_array, INIT_FRAMES);
-    init_array(&vif_den_scale0_array, INIT_FRAMES);
-    init_array(&vif_num_scale1_array, INIT_FRAMES);
-    init_array(&vif_den_scale1_array, INIT_FRAMES);
-    init_array(&vif_num_scale2_array, INIT_FRAMES);
-    init_array(&vif_den_scale2_array, INIT_FRAMES);
-    init_array(&vif_num_scale3_array, INIT_FRAMES);
-    init_array(&vif_den_scale3_array, INIT_FRAMES);
-    init_array(&vif_array, INIT_FRAMES);
-    init_array(&psnr_array, INIT_FRAMES);
-    init_array(&ssim_array, INIT_FRAMES);
-    init_array(&ms_ssim_array, INIT_FRAMES);
-    /* optional output arrays */
-    if (do_psnr) {
-        psnr_array_ptr = &psnr_array;
-    } else {
-        psnr_array_ptr = NULL;
-    }
-    if (do_ssim) {
-        ssim_array_ptr = &ssim_array;
-    } else {
-        ssim_array_ptr = NULL;
-    }
-    if (do_ms_ssim) {
-        ms_ssim_array_ptr = &ms_ssim_array;
-    } else {
-        ms_ssim_array_ptr = NULL;
-    }
+    FrameTable frame_table;
+    init_frame_table(&frame_table, INIT_FRAMES);
     dbg_printf("Extract atom features...\n");
-    int ret = combo(read_frame, user_data, w, h, fmt, &adm_num_array,
-            &adm_den_array, &adm_num_scale0_array, &adm_den_scale0_array,
-            &adm_num_scale1_array, &adm_den_scale1_array, &adm_num_scale2_array,
-            &adm_den_scale2_array, &adm_num_scale3_array, &adm_den_scale3_array,
-            &motion_array, &motion2_array, &vif_num_scale0_array,
-            &vif_den_scale0_array, &vif_num_scale1_array, &vif_den_scale1_array,
-            &vif_num_scale2_array, &vif_den_scale2_array, &vif_num_scale3_array,
-            &vif_den_scale3_array, &vif_array, psnr_array_ptr, ssim_array_ptr,
-            ms_ssim_array_ptr, errmsg, n_thread, n_subsample);
+    int ret = combo(read_frame, user_data, w, h, fmt, &frame_table, do_psnr,
+            do_ssim, do_ms_ssim, errmsg, n_thread, n_subsample);
     if (ret) {
+        free_frame_table(&frame_table);
         throw VmafException(errmsg);
     }
-    size_t num_frms = motion_array.used;
-    bool num_frms_is_consistent = (adm_num_array.used == num_frms)
-            && (adm_den_array.used == num_frms)
-            && (motion2_array.used == num_frms)
-            && (adm_num_scale0_array.used == num_frms)
-            && (adm_den_scale0_array.used == num_frms)
-            && (adm_num_scale1_array.used == num_frms)
-            && (adm_den_scale1_array.used == num_frms)
-            && (adm_num_scale2_array.used == num_frms)
-            && (adm_den_scale2_array.used == num_frms)
-            && (adm_num_scale3_array.used == num_frms)
-            && (adm_den_scale3_array.used == num_frms)
-            && (vif_num_scale0_array.used == num_frms)
-            && (vif_den_scale0_array.used == num_frms)
-            && (vif_num_scale1_array.used == num_frms)
-            && (vif_den_scale1_array.used == num_frms)
-            && (vif_num_scale2_array.used == num_frms)
-            && (vif_den_scale2_array.used == num_frms)
-            && (vif_num_scale3_array.used == num_frms)
-            && (vif_den_scale3_array.used == num_frms)
-            && (vif_array.used == num_frms);
-    if (psnr_array_ptr != NULL) {
-        num_frms_is_consistent = num_frms_is_consistent
-                && (psnr_array.used == num_frms);
-    }
-    if (ssim_array_ptr != NULL) {
-        num_frms_is_consistent = num_frms_is_consistent
-                && (ssim_array.used == num_frms);
-    }
-    if (ms_ssim_array_ptr != NULL) {
-        num_frms_is_consistent = num_frms_is_consistent
-                && (ms_ssim_array.used == num_frms);
-    }
-    if (!num_frms_is_consistent) {
-        sprintf(errmsg,
-                "Output feature vectors are of inconsistent dimensions: motion (%zu), motion2 (%zu), adm_num (%zu), adm_den (%zu), vif_num_scale0 (%zu), vif_den_scale0 (%zu), vif_num_scale1 (%zu), vif_den_scale1 (%zu), vif_num_scale2 (%zu), vif_den_scale2 (%zu), vif_num_scale3 (%zu), vif_den_scale3 (%zu), vif (%zu), psnr (%zu), ssim (%zu), ms_ssim (%zu), adm_num_scale0 (%zu), adm_den_scale0 (%zu), adm_num_scale1 (%zu), adm_den_scale1 (%zu), adm_num_scale2 (%zu), adm_den_scale2 (%zu), adm_num_scale3 (%zu), adm_den_scale3 (%zu)",
-                motion_array.used, motion2_array.used, adm_num_array.used,
-                adm_den_array.used, vif_num_scale0_array.used,
-                vif_den_scale0_array.used, vif_num_scale1_array.used,
-                vif_den_scale1_array.used, vif_num_scale2_array.used,
-                vif_den_scale2_array.used, vif_num_scale3_array.used,
-                vif_num_scale3_array.used, vif_array.used, psnr_array.used,
-                ssim_array.used, ms_ssim_array.used, adm_num_scale0_array.used,
-                adm_den_scale0_array.used, adm_num_scale1_array.used,
-                adm_den_scale1_array.used, adm_num_scale2_array.used,
-                adm_den_scale2_array.used, adm_num_scale3_array.used,
-                adm_num_scale3_array.used);
-        throw VmafException(errmsg);
-    }
+    size_t num_frms = frame_table.used;
+    size_t num_frms_subsampled = (num_frms + n_subsample - 1) / n_subsample;
     dbg_printf(
             "Generate final features (including derived atom features)...\n");
     double ADM2_CONSTANT = 0.0;
     double ADM_SCALE_CONSTANT = 0.0;
-    StatVector adm2, motion, vif_scale0, vif_scale1, vif_scale2, vif_scale3,
-            vif, motion2;
-    StatVector adm_scale0, adm_scale1, adm_scale2, adm_scale3;
+    std::vector<double> column(num_frms_subsampled);
+    auto copy = [&](int feature) {
+        copy_frame_feature(&frame_table, feature, n_subsample, column.data());
+        return StatVector(column);
+    };
+    auto divide = [&](int num, int den, double constant) {
+        divide_frame_features(&frame_table, num, den, constant, n_subsample,
+                column.data());
+        return StatVector(column);
+    };
+    StatVector adm2 = divide(FT_ADM_NUM, FT_ADM_DEN, ADM2_CONSTANT);
+    StatVector adm_scale0 = divide(FT_ADM_NUM_SCALE0, FT_ADM_DEN_SCALE0,
+            ADM_SCALE_CONSTANT);
+    StatVector adm_scale1 = divide(FT_ADM_NUM_SCALE1, FT_ADM_DEN_SCALE1,
+            ADM_SCALE_CONSTANT);
+    StatVector adm_scale2 = divide(FT_ADM_NUM_SCALE2, FT_ADM_DEN_SCALE2,
+            ADM_SCALE_CONSTANT);
+    StatVector adm_scale3 = divide(FT_ADM_NUM_SCALE3, FT_ADM_DEN_SCALE3,
+            ADM_SCALE_CONSTANT);
+    StatVector motion = copy(FT_MOTION);
+    StatVector motion2 = copy(FT_MOTION2);
+    StatVector vif_scale0 = divide(FT_VIF_NUM_SCALE0, FT_VIF_DEN_SCALE0, 0.0);
+    StatVector vif_scale1 = divide(FT_VIF_NUM_SCALE1, FT_VIF_DEN_SCALE1, 0.0);
+    StatVector vif_scale2 = divide(FT_VIF_NUM_SCALE2, FT_VIF_DEN_SCALE2, 0.0);
+    StatVector vif_scale3 = divide(FT_VIF_NUM_SCALE3, FT_VIF_DEN_SCALE3, 0.0);
+    StatVector vif = copy(FT_VIF);
     StatVector psnr, ssim, ms_ssim;
-    std::vector<VmafPredictionStruct> predictionStructs;
-    for (size_t i = 0; i < num_frms; i += n_subsample) {
-        adm2.append(
-                (get_at(&adm_num_array, i) + ADM2_CONSTANT)
-                        / (get_at(&adm_den_array, i) + ADM2_CONSTANT));
-        adm_scale0.append(
-                (get_at(&adm_num_scale0_array, i) + ADM_SCALE_CONSTANT)
-                        / (get_at(&adm_den_scale0_array, i) + ADM_SCALE_CONSTANT));
-        adm_scale1.append(
-                (get_at(&adm_num_scale1_array, i) + ADM_SCALE_CONSTANT)
-                        / (get_at(&adm_den_scale1_array, i) + ADM_SCALE_CONSTANT));
-        adm_scale2.append(
-                (get_at(&adm_num_scale2_array, i) + ADM_SCALE_CONSTANT)
-                        / (get_at(&adm_den_scale2_array, i) + ADM_SCALE_CONSTANT));
-        adm_scale3.append(
-                (get_at(&adm_num_scale3_array, i) + ADM_SCALE_CONSTANT)
-                        / (get_at(&adm_den_scale3_array, i) + ADM_SCALE_CONSTANT));
-        motion.append(get_at(&motion_array, i));
-        motion2.append(get_at(&motion2_array, i));
-        vif_scale0.append(
-                get_at(&vif_num_scale0_array, i)
-                        / get_at(&vif_den_scale0_array, i));
-        vif_scale1.append(
-                get_at(&vif_num_scale1_array, i)
-                        / get_at(&vif_den_scale1_array, i));
-        vif_scale2.append(
-                get_at(&vif_num_scale2_array, i)
-                        / get_at(&vif_den_scale2_array, i));
-        vif_scale3.append(
-                get_at(&vif_num_scale3_array, i)
-                        / get_at(&vif_den_scale3_array, i));
-        vif.append(get_at(&vif_array, i));
-
-        if (psnr_array_ptr != NULL) {
-            psnr.append(get_at(&psnr_array, i));
-        }
-        if (ssim_array_ptr != NULL) {
-            ssim.append(get_at(&ssim_array, i));
-        }
-        if (ms_ssim_array_ptr != NULL) {
-            ms_ssim.append(get_at(&ms_ssim_array, i));
-        }
+    if (do_psnr) {
+        psnr = copy(FT_PSNR);
     }
+    if (do_ssim) {
+        ssim = copy(FT_SSIM);
+    }
+    if (do_ms_ssim) {
+        ms_ssim = copy(FT_MS_SSIM);
+    }
+    free_frame_table(&frame_table);
+    std::vector<VmafPredictionStruct> predictionStructs;
     dbg_printf(
             "Normalize features, SVM regression, denormalize score, clip...\n");
-    size_t num_frms_subsampled = 0;
-    for (size_t i = 0; i < num_frms; i += n_subsample) {
-        num_frms_subsampled++;
-    }
     _normalize_predict_denormalize_transform_clip(model, num_frms_subsampled,
             adm2, adm_scale0, adm_scale1, adm_scale2, adm_scale3, motion,
             vif_scale0, vif_scale1, vif_scale2, vif_scale3, vif, motion2,
             enable_transform, disable_clip, predictionStructs);
     Result result { };
-    for (size_t j = 0; j < model.feature_names.length(); j++) {
-
-        if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_adm2_score'") == 0)
-            result.set_scores("adm2", adm2);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_adm_scale0_score'") == 0)
-            result.set_scores("adm_scale0", adm_scale0);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_adm_scale1_score'") == 0)
-            result.set_scores("adm_scale1", adm_scale1);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_adm_scale2_score'") == 0)
-            result.set_scores("adm_scale2", adm_scale2);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_adm_scale3_score'") == 0)
-            result.set_scores("adm_scale3", adm_scale3);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_motion_score'") == 0)
-            result.set_scores("motion", motion);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_vif_scale0_score'") == 0)
-            result.set_scores("vif_scale0", vif_scale0);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_vif_scale1_score'") == 0)
-            result.set_scores("vif_scale1", vif_scale1);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_vif_scale2_score'") == 0)
-            result.set_scores("vif_scale2", vif_scale2);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_vif_scale3_score'") == 0)
-            result.set_scores("vif_scale3", vif_scale3);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_vif_score'") == 0)
-            result.set_scores("vif", vif);
-        else if (strcmp(Stringize(model.feature_names[j]).c_str(),
-                "'VMAF_feature_motion2_score'") == 0)
-            result.set_scores("motion2", motion2);
-        else {
-            printf("Unknown feature name: %s.\n",
-                    Stringize(model.feature_names[j]).c_str());
-            throw VmafException("Unknown feature name");
-
-        }
+    StatVector* const stats[NUM_VMAF_FEATURES] = {
+        &adm2, &adm_scale0, &adm_scale1, &adm_scale2, &adm_scale3, &motion,
+        &vif_scale0, &vif_scale1, &vif_scale2, &vif_scale3, &vif, &motion2,
+    };
+    for (size_t j = 0; j < model.features.size(); j++) {
+        VmafFeature feature = model.features[j];
+        result.set_scores(LibsvmNusvrTrainTestModel::feature_key(feature),
+                *stats[feature]);
     }
 
-    if (psnr_array_ptr != NULL) {
+    if (do_psnr) {
         result.set_scores("psnr", psnr);
     }
-    if (ssim_array_ptr != NULL) {
+    if (do_ssim) {
         result.set_scores("ssim", ssim);
     }
-    if (ms_ssim_array_ptr != NULL) {
+    if (do_ms_ssim) {
         result.set_scores("ms_ssim", ms_ssim);
     }
 
     _set_prediction_result(predictionStructs, result);
 
-    free_array(&adm_num_array);
-    free_array(&adm_den_array);
-    free_array(&adm_num_scale0_array);
-    free_array(&adm_den_scale0_array);
-    free_array(&adm_num_scale1_array);
-    free_array(&adm_den_scale1_array);
-    free_array(&adm_num_scale2_array);
-    free_array(&adm_den_scale2_array);
-    free_array(&adm_num_scale3_array);
-    free_array(&adm_den_scale3_array);
-    free_array(&motion_array);
-    free_array(&motion2_array);
-    free_array(&vif_num_scale0_array);
-    free_array(&vif_den_scale0_array);
-    free_array(&vif_num_scale1_array);
-    free_array(&vif_den_scale1_array);
-    free_array(&vif_num_scale2_array);
-    free_array(&vif_den_scale2_array);
-    free_array(&vif_num_scale3_array);
-    free_array(&vif_den_scale3_array);
-    free_array(&vif_array);
-    free_array(&psnr_array);
-    free_array(&ssim_array);
-    free_array(&ms_ssim_array);
-
     return result;
 }
 
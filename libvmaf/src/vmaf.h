@@ -35,7 +35,6 @@
 
 #include "svm.h"
 #include "chooseser.h"
-#include "darray.h"
 
 #ifndef WINCE
 #define TIME_TEST_ENABLE 		1 // 1: memory leak test enable 0: disable
@@ -156,27 +155,47 @@ struct VmafPredictionStruct
     std::vector<double> vmafMultiModelPrediction;
 };
 
+/* features a model may refer to, in the order the quality runner passes them */
+enum VmafFeature
+{
+    VMAF_FEATURE_ADM2,
+    VMAF_FEATURE_ADM_SCALE0,
+    VMAF_FEATURE_ADM_SCALE1,
+    VMAF_FEATURE_ADM_SCALE2,
+    VMAF_FEATURE_ADM_SCALE3,
+    VMAF_FEATURE_MOTION,
+    VMAF_FEATURE_VIF_SCALE0,
+    VMAF_FEATURE_VIF_SCALE1,
+    VMAF_FEATURE_VIF_SCALE2,
+    VMAF_FEATURE_VIF_SCALE3,
+    VMAF_FEATURE_VIF,
+    VMAF_FEATURE_MOTION2,
+    NUM_VMAF_FEATURES
+};
+
 class LibsvmNusvrTrainTestModel
 {
 public:
     LibsvmNusvrTrainTestModel(const char *model_path): model_path(model_path) {}
     Val feature_names, norm_type, slopes, intercepts, score_clip, score_transform;
+    /* resolved from feature_names by load_model() */
+    std::vector<VmafFeature> features;
     virtual void load_model();
     virtual VmafPredictionStruct predict(svm_node* nodes);
-    void populate_and_normalize_nodes_at_frm(size_t i_frm,
-            svm_node*& nodes, StatVector& adm2,
-            StatVector& adm_scale0, StatVector& adm_scale1,
-            StatVector& adm_scale2, StatVector& adm_scale3, StatVector& motion,
-            StatVector& vif_scale0, StatVector& vif_scale1,
-            StatVector& vif_scale2, StatVector& vif_scale3, StatVector& vif,
-            StatVector& motion2);
+    void normalize_features(size_t num_frms, StatVector* const stats[NUM_VMAF_FEATURES],
+            std::vector<double>& normalized);
+    static const char *feature_key(VmafFeature feature);
     virtual ~LibsvmNusvrTrainTestModel() {}
 protected:
     const char *model_path;
     std::unique_ptr<svm_model, SvmDelete> svm_model_ptr;
+    bool linear_rescale;
+    std::vector<double> feature_slopes, feature_intercepts;
+    double prediction_slope, prediction_intercept;
     void _read_and_assert_model(const char *model_path, Val& feature_names, Val& norm_type, Val& slopes,
             Val& intercepts, Val& score_clip, Val& score_transform);
     std::unique_ptr<svm_model, SvmDelete> _read_and_assert_svm_model(const char* libsvm_model_path);
+    void _resolve_features();
     void _denormalize_prediction(double& prediction);
 
 private:
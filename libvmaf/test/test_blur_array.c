@@ -0,0 +1,102 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "test.h"
+#include "feature/common/blur_array.h"
+
+static char *test_blur_array_ring()
+{
+    int err;
+    BLUR_BUF_ARRAY arr;
+
+    err = !init_blur_array(&arr, 5, 64 * sizeof(float), 32);
+    mu_assert("problem during init_blur_array", !err);
+    mu_assert("length should be rounded up to a power of two",
+              arr.actual_length == 8);
+
+    float *buf[9];
+    for (int i = 0; i < 8; i++) {
+        buf[i] = get_free_blur_buf_slot(&arr, i);
+        mu_assert("every frame should get a free slot", buf[i]);
+    }
+    buf[8] = get_free_blur_buf_slot(&arr, 8);
+    mu_assert("frame 8 should not get the slot of frame 0", !buf[8]);
+
+    mu_assert("frame 3 should be found", get_blur_buf(&arr, 3) == buf[3]);
+    mu_assert("frame 11 should not be found", !get_blur_buf(&arr, 11));
+    mu_assert("frame 3 should have two references",
+              get_blur_buf_reference_count(&arr, 3) == 2);
+
+    mu_assert("frame 0 should not be released while referenced",
+              release_blur_buf_slot(&arr, 0) == -1);
+    err = release_blur_buf_reference(&arr, 0);
+    mu_assert("problem during release_blur_buf_reference", !err);
+    mu_assert("frame 0 should be released",
+              release_blur_buf_slot(&arr, 0) == 1);
+    mu_assert("frame 0 should not be found", !get_blur_buf(&arr, 0));
+
+    buf[8] = get_free_blur_buf_slot(&arr, 8);
+    mu_assert("frame 8 should reuse the slot of frame 0", buf[8] == buf[0]);
+    mu_assert("frame 0 can not be put while frame 8 has the slot",
+              !put_blur_buf(&arr, 16, buf[1]));
+
+    free_blur_buf(&arr);
+    return NULL;
+}
+
+typedef struct {
+    BLUR_BUF_ARRAY *arr;
+    int frames;
+} Reader;
+
+static void *reference_frames(void *data)
+{
+    Reader *r = data;
+    for (int n = 0; n < 10000; n++) {
+        for (int i = 0; i < r->frames; i++) {
+            if (!get_blur_buf(r->arr, i)) return r;
+            release_blur_buf_reference(r->arr, i);
+        }
+    }
+    return NULL;
+}
+
+static char *test_blur_array_concurrent_references()
+{
+    int err;
+    BLUR_BUF_ARRAY arr;
+
+    err = !init_blur_array(&arr, 200, sizeof(float), 32);
+    mu_assert("problem during init_blur_array", !err);
+    mu_assert("length should not be capped", arr.actual_length == 256);
+
+    Reader r = { .arr = &arr, .frames = arr.actual_length };
+    for (int i = 0; i < r.frames; i++)
+        mu_assert("every frame should get a free slot",
+                  get_free_blur_buf_slot(&arr, i));
+
+    pthread_t thread[4];
+    for (unsigned i = 0; i < 4; i++)
+        pthread_create(&thread[i], NULL, reference_frames, &r);
+    void *ret = NULL, *thread_ret;
+    for (unsigned i = 0; i < 4; i++) {
+        pthread_join(thread[i], &thread_ret);
+        if (thread_ret) ret = thread_ret;
+    }
+    mu_assert("every frame should be found", !ret);
+
+    for (int i = 0; i < r.frames; i++) {
+        mu_assert("only the reference of the producer should be left",
+                  get_blur_buf_reference_count(&arr, i) == 1);
+    }
+
+    free_blur_buf(&arr);
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_blur_array_ring);
+    mu_run_test(test_blur_array_concurrent_references);
+    return NULL;
+}
@@ -68,9 +68,104 @@ static char *test_feature_collector_init_append_get_and_destroy()
     return NULL;
 }
 
+static char *test_feature_collector_import()
+{
+    int err;
+
+    VmafFeatureCollector *src, *dst;
+    err = vmaf_feature_collector_init(&src);
+    err |= vmaf_feature_collector_init(&dst);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+
+    for (unsigned i = 0; i < 20; i += 2) {
+        err = vmaf_feature_collector_append(src, "motion2", i, i);
+        mu_assert("problem during vmaf_feature_collector_append", !err);
+    }
+    err = vmaf_feature_collector_append(dst, "motion2", 100., 4);
+    mu_assert("problem during vmaf_feature_collector_append", !err);
+
+    err = vmaf_feature_collector_import(dst, src, "motion2");
+    mu_assert("problem during vmaf_feature_collector_import", !err);
+    err = vmaf_feature_collector_import(dst, src, "missing");
+    mu_assert("importing an absent feature should not fail", !err);
+
+    double score;
+    for (unsigned i = 0; i < 20; i++) {
+        err = vmaf_feature_collector_get_score(dst, "motion2", &score, i);
+        if (i % 2) {
+            mu_assert("import should not fill unwritten indices", err);
+            continue;
+        }
+        mu_assert("problem during vmaf_feature_collector_get_score", !err);
+        mu_assert("import should not overwrite existing scores",
+                  score == (i == 4 ? 100. : i));
+    }
+
+    const unsigned cnt = dst->cnt;
+    err = vmaf_feature_collector_reserve(dst, "reserved");
+    err |= vmaf_feature_collector_reserve(dst, "reserved");
+    mu_assert("problem during vmaf_feature_collector_reserve", !err);
+    mu_assert("reserve should add exactly one vector", dst->cnt == cnt + 1);
+    err = vmaf_feature_collector_get_score(dst, "reserved", &score, 0);
+    mu_assert("a reserved vector should hold no scores", err);
+
+    vmaf_feature_collector_destroy(src);
+    vmaf_feature_collector_destroy(dst);
+    return NULL;
+}
+
+static char *test_feature_collector_prediction()
+{
+    int err;
+
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+
+    const uint64_t model_a = 1, model_b = 2;
+    double score;
+    unsigned stamp;
+    err = vmaf_feature_collector_append(feature_collector, "feature_a", 1., 3);
+    mu_assert("problem during vmaf_feature_collector_append", !err);
+    err = vmaf_feature_collector_get_prediction(feature_collector, model_a,
+                                                3, &score, &stamp);
+    mu_assert("nothing should be memoized yet", err);
+
+    err = vmaf_feature_collector_set_prediction(feature_collector, model_a,
+                                                "vmaf", 3, 50., stamp);
+    mu_assert("problem during vmaf_feature_collector_set_prediction", !err);
+    err = vmaf_feature_collector_get_prediction(feature_collector, model_a,
+                                                3, &score, &stamp);
+    mu_assert("prediction should be memoized", !err && score == 50.);
+    err = vmaf_feature_collector_get_prediction(feature_collector, model_b,
+                                                3, &score, &stamp);
+    mu_assert("prediction should not be shared across keys", err);
+    err = vmaf_feature_collector_get_score(feature_collector, "vmaf",
+                                           &score, 3);
+    mu_assert("prediction should be collected", !err && score == 50.);
+
+    err = vmaf_feature_collector_append(feature_collector, "feature_b", 2., 3);
+    mu_assert("problem during vmaf_feature_collector_append", !err);
+    err = vmaf_feature_collector_get_prediction(feature_collector, model_a,
+                                                3, &score, &stamp);
+    mu_assert("a new score should drop the prediction", err);
+    err = vmaf_feature_collector_set_prediction(feature_collector, model_a,
+                                                "vmaf", 3, 60., stamp);
+    mu_assert("a prediction should replace an earlier one", !err);
+    err = vmaf_feature_collector_get_score(feature_collector, "vmaf",
+                                           &score, 3);
+    mu_assert("collected prediction should be replaced",
+              !err && score == 60.);
+
+    vmaf_feature_collector_destroy(feature_collector);
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_feature_vector_init_append_and_destroy);
     mu_run_test(test_feature_collector_init_append_get_and_destroy);
+    mu_run_test(test_feature_collector_import);
+    mu_run_test(test_feature_collector_prediction);
     return NULL;
 }
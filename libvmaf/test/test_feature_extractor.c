@@ -1,3 +1,5 @@
+#include <limits.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -38,18 +40,29 @@ static char *test_feature_extractor_context_pool()
 
     const unsigned n_threads = 8;
     VmafFeatureExtractorContextPool *pool;
-    err = vmaf_fex_ctx_pool_create(&pool, n_threads);
+    err = vmaf_fex_ctx_pool_create(&pool, n_threads, 0, NULL);
     mu_assert("problem during vmaf_fex_ctx_pool_create", !err);
 
     VmafFeatureExtractor *fex = vmaf_get_feature_extractor_by_name("ssim");
     mu_assert("problem during vmaf_get_feature_extractor_by_name", fex);
+    VmafFeatureExtractorContext *registered;
+    err = vmaf_feature_extractor_context_create(&registered, fex);
+    mu_assert("problem during vmaf_feature_extractor_context_create", !err);
+    const unsigned fex_index = registered->fex_index;
+    mu_assert("a registered context should know its extractor's index",
+              fex_index != UINT_MAX);
+    err = vmaf_fex_ctx_pool_release(pool, registered);
+    mu_assert("a context from outside the pool should not be released", err);
 
     VmafFeatureExtractorContext *fex_ctx[n_threads];
     for (unsigned i = 0; i < n_threads; i++) {
-        err = vmaf_fex_ctx_pool_aquire(pool, fex, &fex_ctx[i]);
+        err = vmaf_fex_ctx_pool_aquire(pool, fex_index, &fex_ctx[i]);
         mu_assert("problem during vmaf_fex_ctx_pool_aquire", !err);
         mu_assert("fex_ctx[i] should be ssim feature extractor",
                   !strcmp(fex_ctx[i]->fex->name, "ssim"));
+        for (unsigned j = 0; j < i; j++)
+            mu_assert("a context should not be handed out twice",
+                      fex_ctx[i] != fex_ctx[j]);
     }
 
     for (unsigned i = 0; i < n_threads; i++) {
@@ -57,12 +70,177 @@ static char *test_feature_extractor_context_pool()
         mu_assert("problem during vmaf_fex_ctx_pool_release", !err);
     }
 
+    // released contexts are reused rather than created again
+    VmafFeatureExtractorContext *reused;
+    err = vmaf_fex_ctx_pool_aquire(pool, fex_index, &reused);
+    mu_assert("problem during vmaf_fex_ctx_pool_aquire", !err);
+    mu_assert("a released context should be reused",
+              reused == fex_ctx[n_threads - 1]);
+    err = vmaf_fex_ctx_pool_release(pool, reused);
+    mu_assert("problem during vmaf_fex_ctx_pool_release", !err);
+    vmaf_feature_extractor_context_destroy(registered);
+
     err = vmaf_fex_ctx_pool_destroy(pool);
     mu_assert("problem during vmaf_fex_ctx_pool_destroy", !err);
 
     return NULL;
 }
 
+struct PoolAquire {
+    VmafFeatureExtractorContextPool *pool;
+    unsigned fex_index;
+    VmafFeatureExtractorContext *fex_ctx;
+    int err;
+};
+
+static void *pool_aquire_func(void *data)
+{
+    struct PoolAquire *a = data;
+    a->err = vmaf_fex_ctx_pool_aquire(a->pool, a->fex_index, &a->fex_ctx);
+    return NULL;
+}
+
+static char *test_feature_extractor_context_pool_budget()
+{
+    int err = 0;
+
+    VmafPicture ref, dist;
+    err = vmaf_picture_alloc(&ref, VMAF_PIX_FMT_YUV420P, 8, 64, 64);
+    err |= vmaf_picture_alloc(&dist, VMAF_PIX_FMT_YUV420P, 8, 64, 64);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    memset(ref.data[0], 0, ref.stride[0] * ref.h[0]);
+    memset(dist.data[0], 1, dist.stride[0] * dist.h[0]);
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+
+    VmafFeatureExtractor *fex =
+        vmaf_get_feature_extractor_by_name("float_psnr");
+    VmafFeatureExtractorContext *registered;
+    err = vmaf_feature_extractor_context_create(&registered, fex);
+    mu_assert("problem during vmaf_feature_extractor_context_create", !err);
+    const unsigned fex_index = registered->fex_index;
+
+    // without a budget, contexts used one after the other are not added to
+    VmafFeatureExtractorContextPool *pool;
+    err = vmaf_fex_ctx_pool_create(&pool, 4, 0, NULL);
+    mu_assert("problem during vmaf_fex_ctx_pool_create", !err);
+    size_t ctx_bytes = 0;
+    for (unsigned i = 0; i < 3; i++) {
+        VmafFeatureExtractorContext *fex_ctx;
+        err = vmaf_fex_ctx_pool_aquire(pool, fex_index, &fex_ctx);
+        err |= vmaf_feature_extractor_context_extract(fex_ctx, &ref, &dist, i,
+                                                      feature_collector);
+        err |= vmaf_fex_ctx_pool_release(pool, fex_ctx);
+        mu_assert("problem during extraction from the pool", !err);
+        ctx_bytes = fex_ctx->bytes;
+    }
+    mu_assert("a context should count its float buffers",
+              ctx_bytes >= 2 * sizeof(float) * 64 * 64);
+    size_t bytes;
+    err = vmaf_fex_ctx_pool_bytes(pool, fex_index, &bytes);
+    mu_assert("problem during vmaf_fex_ctx_pool_bytes", !err);
+    mu_assert("contexts should only be added when all are busy",
+              bytes == ctx_bytes);
+    vmaf_fex_ctx_pool_destroy(pool);
+
+    // a budget of two contexts has a third thread wait for one of them
+    err = vmaf_fex_ctx_pool_create(&pool, 4, 2 * ctx_bytes, NULL);
+    mu_assert("problem during vmaf_fex_ctx_pool_create", !err);
+    VmafFeatureExtractorContext *a, *b;
+    err = vmaf_fex_ctx_pool_aquire(pool, fex_index, &a);
+    err |= vmaf_feature_extractor_context_extract(a, &ref, &dist, 3,
+                                                  feature_collector);
+    err |= vmaf_fex_ctx_pool_release(pool, a);
+    err |= vmaf_fex_ctx_pool_aquire(pool, fex_index, &a);
+    err |= vmaf_fex_ctx_pool_aquire(pool, fex_index, &b);
+    mu_assert("problem during vmaf_fex_ctx_pool_aquire", !err);
+    mu_assert("a busy context should be added to", a != b);
+
+    struct PoolAquire c = { .pool = pool, .fex_index = fex_index };
+    pthread_t thread;
+    mu_assert("problem during pthread_create",
+              !pthread_create(&thread, NULL, pool_aquire_func, &c));
+    err = vmaf_fex_ctx_pool_release(pool, a);
+    mu_assert("problem during vmaf_fex_ctx_pool_release", !err);
+    pthread_join(thread, NULL);
+    mu_assert("problem during vmaf_fex_ctx_pool_aquire", !c.err);
+    mu_assert("a context over budget should not be added", c.fex_ctx == a);
+
+    err = vmaf_fex_ctx_pool_release(pool, c.fex_ctx);
+    err |= vmaf_fex_ctx_pool_release(pool, b);
+    err |= vmaf_fex_ctx_pool_bytes(pool, fex_index, &bytes);
+    mu_assert("problem during vmaf_fex_ctx_pool_bytes", !err);
+    mu_assert("bytes held should stay within the budget",
+              bytes == 2 * ctx_bytes);
+    vmaf_fex_ctx_pool_destroy(pool);
+
+    vmaf_feature_extractor_context_destroy(registered);
+    vmaf_feature_collector_destroy(feature_collector);
+    vmaf_picture_unref(&ref);
+    vmaf_picture_unref(&dist);
+    return NULL;
+}
+
+static char *test_feature_extractor_stats()
+{
+    int err = 0;
+
+    VmafFexStats stats;
+    err = vmaf_fex_stats_init(&stats);
+    mu_assert("problem during vmaf_fex_stats_init", !err);
+    // 1 ms to 100 ms, the slowest percent above 99 ms
+    for (unsigned i = 1; i <= 100; i++)
+        vmaf_fex_stats_add(&stats, VMAF_FEX_STATS_EXTRACT, i * 1e-3);
+    vmaf_fex_stats_add(&stats, VMAF_FEX_STATS_AQUIRE_WAIT, .5);
+    vmaf_fex_stats_add(&stats, VMAF_FEX_STATS_AQUIRE_WAIT, .25);
+    mu_assert("every extract should be counted",
+              stats.calls == 100 && stats.extract_min == 1e-3 &&
+              stats.extract_max == 100e-3);
+    mu_assert("waits should be summed", stats.aquire_wait == .75);
+    const double p99 = vmaf_fex_stats_quantile(&stats, .99);
+    mu_assert("p99 should be within 2.2 %% of the nearest rank",
+              p99 > 99e-3 / 1.022 && p99 < 99e-3 * 1.022);
+    mu_assert("quantiles should stay within the extremes",
+              vmaf_fex_stats_quantile(&stats, 1.) == 100e-3 &&
+              vmaf_fex_stats_quantile(&stats, 0.) == 1e-3);
+    vmaf_fex_stats_destroy(&stats);
+
+    // contexts count their own extract calls
+    err = vmaf_fex_stats_init(&stats);
+    mu_assert("problem during vmaf_fex_stats_init", !err);
+    VmafPicture ref, dist;
+    err = vmaf_picture_alloc(&ref, VMAF_PIX_FMT_YUV420P, 8, 64, 64);
+    err |= vmaf_picture_alloc(&dist, VMAF_PIX_FMT_YUV420P, 8, 64, 64);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+    VmafFeatureExtractor *fex =
+        vmaf_get_feature_extractor_by_name("float_psnr");
+    VmafFeatureExtractorContext *fex_ctx;
+    err = vmaf_feature_extractor_context_create(&fex_ctx, fex);
+    mu_assert("problem during vmaf_feature_extractor_context_create", !err);
+    fex_ctx->stats = &stats;
+    for (unsigned i = 0; i < 3; i++) {
+        err = vmaf_feature_extractor_context_extract(fex_ctx, &ref, &dist, i,
+                                                     feature_collector);
+        mu_assert("problem during vmaf_feature_extractor_context_extract",
+                  !err);
+    }
+    mu_assert("a context should count its extract calls",
+              stats.calls == 3 && stats.extract > 0. &&
+              stats.extract_min <= stats.extract_max);
+
+    vmaf_feature_extractor_context_close(fex_ctx);
+    vmaf_feature_extractor_context_destroy(fex_ctx);
+    vmaf_feature_collector_destroy(feature_collector);
+    vmaf_picture_unref(&ref);
+    vmaf_picture_unref(&dist);
+    vmaf_fex_stats_destroy(&stats);
+    return NULL;
+}
+
 static char *test_feature_extractor_flush()
 {
     int err = 0;
@@ -105,10 +283,97 @@ static char *test_feature_extractor_flush()
     return NULL;
 }
 
+static char *test_feature_extractor_context_pool_sequence()
+{
+    int err = 0;
+
+    VmafFeatureExtractor *fex =
+        vmaf_get_feature_extractor_by_name("float_motion");
+    mu_assert("problem during vmaf_get_feature_extractor_by_name", fex);
+
+    enum { n = 5 };
+    VmafPicture pic[n];
+    for (unsigned i = 0; i < n; i++) {
+        err = vmaf_picture_alloc(&pic[i], VMAF_PIX_FMT_YUV420P, 8, 64, 32);
+        mu_assert("problem during vmaf_picture_alloc", !err);
+        for (unsigned y = 0; y < pic[i].h[0]; y++) {
+            uint8_t *row = (uint8_t *) pic[i].data[0] + y * pic[i].stride[0];
+            for (unsigned x = 0; x < pic[i].w[0]; x++)
+                row[x] = (x * (i + 1) + y * i * i) & 0xff;
+        }
+    }
+
+    VmafFeatureExtractorContext *fex_ctx;
+    VmafFeatureCollector *serial, *sequenced;
+    err = vmaf_feature_extractor_context_create(&fex_ctx, fex);
+    err |= vmaf_feature_collector_init(&serial);
+    err |= vmaf_feature_collector_init(&sequenced);
+    mu_assert("problem during setup", !err);
+    for (unsigned i = 0; i < n; i++) {
+        err = vmaf_feature_extractor_context_extract(fex_ctx, &pic[i], &pic[i],
+                                                     i, serial);
+        mu_assert("problem during vmaf_feature_extractor_context_extract",
+                  !err);
+    }
+    err = vmaf_feature_extractor_context_flush(fex_ctx, serial);
+    mu_assert("problem during vmaf_feature_extractor_context_flush", !err);
+    vmaf_feature_extractor_context_close(fex_ctx);
+
+    VmafFeatureExtractorContextPool *pool;
+    err = vmaf_fex_ctx_pool_create(&pool, 4, 0, NULL);
+    mu_assert("problem during vmaf_fex_ctx_pool_create", !err);
+    VmafFexTicket *ticket[n];
+    for (unsigned i = 0; i < n; i++) {
+        err = vmaf_fex_ctx_pool_ticket(pool, fex_ctx->fex_index, &pic[i],
+                                       &ticket[i]);
+        mu_assert("problem during vmaf_fex_ctx_pool_ticket", !err);
+    }
+    // prepared pictures arrive last to first, extraction stays in order
+    for (unsigned i = n; i-- > 0;) {
+        VmafFeatureExtractor *sequenced_fex = vmaf_fex_ticket_fex(ticket[i]);
+        mu_assert("ticket should carry an initialized feature extractor",
+                  sequenced_fex && sequenced_fex->priv);
+        void *prepared;
+        err = sequenced_fex->prepare(sequenced_fex, &pic[i], &pic[i],
+                                     &prepared);
+        mu_assert("problem during prepare", !err);
+        err = vmaf_fex_ctx_pool_sequence(pool, ticket[i], prepared, i,
+                                         sequenced);
+        mu_assert("problem during vmaf_fex_ctx_pool_sequence", !err);
+        double score;
+        mu_assert("nothing should be extracted before its turn",
+                  !i || vmaf_feature_collector_get_score(sequenced,
+                            "'VMAF_feature_motion2_score'", &score, 0));
+    }
+    err = vmaf_fex_ctx_pool_flush(pool, sequenced);
+    mu_assert("problem during vmaf_fex_ctx_pool_flush", !err);
+
+    for (unsigned i = 0; i < n; i++) {
+        double a, b;
+        err = vmaf_feature_collector_get_score(serial,
+                    "'VMAF_feature_motion2_score'", &a, i);
+        err |= vmaf_feature_collector_get_score(sequenced,
+                    "'VMAF_feature_motion2_score'", &b, i);
+        mu_assert("every picture should be scored", !err);
+        mu_assert("sequenced scores should match serial ones", a == b);
+    }
+
+    vmaf_fex_ctx_pool_destroy(pool);
+    vmaf_feature_extractor_context_destroy(fex_ctx);
+    vmaf_feature_collector_destroy(serial);
+    vmaf_feature_collector_destroy(sequenced);
+    for (unsigned i = 0; i < n; i++)
+        vmaf_picture_unref(&pic[i]);
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_get_feature_extractor_by_name_and_feature_name);
     mu_run_test(test_feature_extractor_context_pool);
+    mu_run_test(test_feature_extractor_context_pool_sequence);
+    mu_run_test(test_feature_extractor_context_pool_budget);
+    mu_run_test(test_feature_extractor_stats);
     mu_run_test(test_feature_extractor_flush);
     return NULL;
 }
@@ -0,0 +1,54 @@
+#include <stdlib.h>
+
+#include "test.h"
+#include "frame_table.h"
+
+static char *test_frame_table_chunks()
+{
+    int err;
+    FrameTable t;
+    init_frame_table(&t, 4);
+
+    const size_t n = 11;
+    for (size_t i = 0; i < n; i++) {
+        err = reserve_frame_table(&t, i + 1);
+        mu_assert("problem during reserve_frame_table", !err);
+        FrameRow row = get_frame_row(&t, i);
+        set_frame_feature(row, FT_ADM_NUM, i + 1.);
+        set_frame_feature(row, FT_ADM_DEN, 2. * (i + 1.));
+        set_frame_feature(row, FT_MS_SSIM, i);
+    }
+    mu_assert("table should hold 11 frames", t.used == n);
+    mu_assert("11 frames should take 3 chunks of 4", t.num_chunks == 3);
+
+    double out[11];
+    copy_frame_feature(&t, FT_MS_SSIM, 1, out);
+    for (size_t i = 0; i < n; i++)
+        mu_assert("frames should be copied in order", out[i] == i);
+
+    divide_frame_features(&t, FT_ADM_NUM, FT_ADM_DEN, 0., 1, out);
+    for (size_t i = 0; i < n; i++)
+        mu_assert("num / den should be 0.5", out[i] == 0.5);
+
+    divide_frame_features(&t, FT_ADM_NUM, FT_ADM_DEN, 1., 1, out);
+    mu_assert("constant should be added to num and den",
+              out[1] == 3. / 5.);
+
+    copy_frame_feature(&t, FT_MS_SSIM, 3, out);
+    for (size_t i = 0; i < (n + 2) / 3; i++)
+        mu_assert("every third frame should be copied", out[i] == 3. * i);
+
+    copy_frame_feature(&t, FT_PSNR, 1, out);
+    for (size_t i = 0; i < n; i++)
+        mu_assert("features not written should be 0", out[i] == 0.);
+
+    free_frame_table(&t);
+    mu_assert("table should be empty", !t.used && !t.num_chunks);
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_frame_table_chunks);
+    return NULL;
+}
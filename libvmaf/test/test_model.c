@@ -1,3 +1,4 @@
+#include <pthread.h>
 #include <stdint.h>
 #include "test.h"
 #include "model.c"
@@ -105,11 +106,82 @@ static char *test_model_set_flags()
     return NULL;
 }
 
+static char *test_model_load_shared()
+{
+    int err;
+
+    VmafModel *model1, *model2, *model3;
+    VmafModelConfig cfg = {
+        .path = "../../model/vmaf_v0.6.1.pkl",
+        .name = "vmaf",
+    };
+    err = vmaf_model_load_from_path(&model1, &cfg);
+    mu_assert("problem during vmaf_model_load_from_path", !err);
+    err = vmaf_model_load_from_path(&model2, &cfg);
+    mu_assert("problem during vmaf_model_load_from_path", !err);
+    mu_assert("identical loads should share one model", model1 == model2);
+    mu_assert("shared model should hold two references",
+              model1->registry.ref_cnt == 2);
+
+    cfg.flags = VMAF_MODEL_FLAG_DISABLE_CLIP;
+    err = vmaf_model_load_from_path(&model3, &cfg);
+    mu_assert("problem during vmaf_model_load_from_path", !err);
+    mu_assert("different flags should load a new model", model3 != model1);
+    mu_assert("Clipping must be disabled.\n", !model3->score_clip.enabled);
+    mu_assert("Clipping must be enabled.\n", model1->score_clip.enabled);
+
+    vmaf_model_destroy(model1);
+    mu_assert("shared model should hold one reference",
+              model2->registry.ref_cnt == 1);
+    mu_assert("shared model should remain usable",
+              !strcmp(model2->name, "vmaf"));
+    vmaf_model_destroy(model2);
+    vmaf_model_destroy(model3);
+
+    return NULL;
+}
+
+static void *load_model(void *data)
+{
+    VmafModelConfig cfg = {
+        .path = "../../model/vmaf_v0.6.1.pkl",
+        .name = "vmaf",
+    };
+    VmafModel **model = data;
+    if (vmaf_model_load_from_path(model, &cfg)) *model = NULL;
+    return NULL;
+}
+
+static char *test_model_load_shared_concurrently()
+{
+    VmafModel *model[4];
+    pthread_t thread[4];
+    for (unsigned i = 0; i < 4; i++)
+        pthread_create(&thread[i], NULL, load_model, &model[i]);
+    for (unsigned i = 0; i < 4; i++)
+        pthread_join(thread[i], NULL);
+
+    for (unsigned i = 0; i < 4; i++) {
+        mu_assert("problem during vmaf_model_load_from_path", model[i]);
+        mu_assert("concurrent loads should share one model",
+                  model[i] == model[0]);
+    }
+    mu_assert("shared model should hold four references",
+              model[0]->registry.ref_cnt == 4);
+    for (unsigned i = 0; i < 4; i++)
+        vmaf_model_destroy(model[i]);
+    mu_assert("registry should be empty", !registry.head);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_model_load_and_destroy);
     mu_run_test(test_model_check_default_behavior_unset_flags);
     mu_run_test(test_model_check_default_behavior_set_flags);
     mu_run_test(test_model_set_flags);
+    mu_run_test(test_model_load_shared);
+    mu_run_test(test_model_load_shared_concurrently);
     return NULL;
 }
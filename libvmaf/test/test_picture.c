@@ -46,9 +46,95 @@ static char *test_picture_data_alignment()
     return NULL;
 }
 
+static char *test_picture_semi_planar()
+{
+    int err;
+
+    VmafPicture pic;
+    err = vmaf_picture_alloc(&pic, VMAF_PIX_FMT_NV12, 8, 1920, 1080);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    mu_assert("chroma dimensions should be 4:2:0",
+              pic.w[1] == 960 && pic.h[1] == 540 &&
+              pic.w[2] == 960 && pic.h[2] == 540);
+    mu_assert("Cr should be interleaved with Cb",
+              (uint8_t *) pic.data[2] == (uint8_t *) pic.data[1] + 1 &&
+              pic.stride[1] == pic.stride[2] && pic.stride[1] >= 1920);
+    err = vmaf_picture_unref(&pic);
+    mu_assert("problem during vmaf_picture_unref", !err);
+
+    err = vmaf_picture_alloc(&pic, VMAF_PIX_FMT_P010, 10, 1920, 1080);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    mu_assert("Cr should be interleaved with Cb",
+              (uint8_t *) pic.data[2] == (uint8_t *) pic.data[1] + 2 &&
+              pic.stride[1] >= 1920 * 2);
+    err = vmaf_picture_unref(&pic);
+    mu_assert("problem during vmaf_picture_unref", !err);
+
+    err = vmaf_picture_alloc(&pic, VMAF_PIX_FMT_P010, 8, 1920, 1080);
+    mu_assert("P010 should require a bitdepth of 10", err);
+
+    return NULL;
+}
+
+static char *test_picture_luma_only()
+{
+    int err;
+
+    VmafPicture pic;
+    err = vmaf_picture_alloc(&pic, VMAF_PIX_FMT_YUV400P, 8, 1920, 1080);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    mu_assert("luma plane should be allocated",
+              pic.data[0] && pic.w[0] == 1920 && pic.h[0] == 1080);
+    mu_assert("chroma planes should not be allocated",
+              !pic.data[1] && !pic.data[2] && !pic.w[1] && !pic.h[2]);
+    err = vmaf_picture_unref(&pic);
+    mu_assert("problem during vmaf_picture_unref", !err);
+
+    return NULL;
+}
+
+static void release_callback(void *cookie)
+{
+    (*(unsigned *) cookie)++;
+}
+
+static char *test_picture_wrap()
+{
+    int err;
+
+    uint8_t buf[16 * 8 + 2 * 8 * 4];
+    pixel *data[3] = { buf, buf + 16 * 8, buf + 16 * 8 + 8 * 4 };
+    ptrdiff_t stride[3] = { 16, 8, 8 };
+    unsigned release_cnt = 0;
+
+    VmafPicture pic_a, pic_b;
+    err = vmaf_picture_wrap(&pic_a, VMAF_PIX_FMT_YUV420P, 8, 16, 8,
+                            data, stride, release_callback, &release_cnt);
+    mu_assert("problem during vmaf_picture_wrap", !err);
+    mu_assert("wrapped picture should not copy data",
+              pic_a.data[0] == buf && pic_a.data[2] == data[2]);
+    mu_assert("chroma dimensions should follow pix_fmt",
+              pic_a.w[1] == 8 && pic_a.h[1] == 4);
+    err = vmaf_picture_ref(&pic_b, &pic_a);
+    mu_assert("problem during vmaf_picture_ref", !err);
+    err = vmaf_picture_unref(&pic_a);
+    mu_assert("problem during vmaf_picture_unref", !err);
+    mu_assert("release_callback called while still referenced",
+              release_cnt == 0);
+    err = vmaf_picture_unref(&pic_b);
+    mu_assert("problem during vmaf_picture_unref", !err);
+    mu_assert("release_callback should be called exactly once",
+              release_cnt == 1);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_picture_alloc_ref_and_unref);
     mu_run_test(test_picture_data_alignment);
+    mu_run_test(test_picture_semi_planar);
+    mu_run_test(test_picture_luma_only);
+    mu_run_test(test_picture_wrap);
     return NULL;
 }
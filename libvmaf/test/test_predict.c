@@ -32,6 +32,107 @@ static char *test_predict_score_at_index()
     err = vmaf_predict_score_at_index(model, feature_collector, 0, &vmaf_score);
     mu_assert("problem during vmaf_predict_score_at_index", !err);
 
+    double cached_score = 0.;
+    err = vmaf_predict_score_at_index(model, feature_collector, 0,
+                                      &cached_score);
+    mu_assert("repeated vmaf_predict_score_at_index should not fail", !err);
+    mu_assert("repeated prediction should return the cached score",
+              cached_score == vmaf_score);
+
+    err = vmaf_predict_score_at_index(model, feature_collector, 1,
+                                      &cached_score);
+    mu_assert("prediction without features should fail", err);
+
+    vmaf_model_destroy(model);
+    vmaf_feature_collector_destroy(feature_collector);
+    return NULL;
+}
+
+static char *test_predict_memo_is_per_model()
+{
+    int err;
+
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+
+    VmafModel *clipped, *unclipped;
+    VmafModelConfig cfg = {
+        .path = "../../model/vmaf_v0.6.1.pkl",
+        .name = "vmaf",
+        .flags = VMAF_MODEL_FLAGS_DEFAULT,
+    };
+    err = vmaf_model_load_from_path(&clipped, &cfg);
+    mu_assert("problem during vmaf_model_load_from_path", !err);
+    cfg.flags = VMAF_MODEL_FLAG_DISABLE_CLIP;
+    err = vmaf_model_load_from_path(&unclipped, &cfg);
+    mu_assert("problem during vmaf_model_load_from_path", !err);
+
+    for (unsigned i = 0; i < clipped->n_features; i++) {
+        err = vmaf_feature_collector_append(feature_collector,
+                                            clipped->feature[i].name, 60., 0);
+        mu_assert("problem during vmaf_feature_collector_append", !err);
+    }
+
+    double clipped_score, unclipped_score;
+    err = vmaf_predict_score_at_index(clipped, feature_collector, 0,
+                                      &clipped_score);
+    mu_assert("problem during vmaf_predict_score_at_index", !err);
+    err = vmaf_predict_score_at_index(unclipped, feature_collector, 0,
+                                      &unclipped_score);
+    mu_assert("problem during vmaf_predict_score_at_index", !err);
+    mu_assert("scores should be clipped to 100", clipped_score == 100.);
+    mu_assert("models with the same name should not share predictions",
+              unclipped_score > 100.);
+
+    double score;
+    err = vmaf_predict_score_at_index(clipped, feature_collector, 0, &score);
+    mu_assert("problem during vmaf_predict_score_at_index", !err);
+    mu_assert("memoized prediction should belong to the model",
+              score == clipped_score);
+
+    vmaf_model_destroy(clipped);
+    vmaf_model_destroy(unclipped);
+    vmaf_feature_collector_destroy(feature_collector);
+    return NULL;
+}
+
+static char *test_predict_memo_outlives_model()
+{
+    int err;
+
+    VmafFeatureCollector *feature_collector;
+    err = vmaf_feature_collector_init(&feature_collector);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+
+    VmafModel *model;
+    VmafModelConfig cfg = {
+        .path = "../../model/vmaf_v0.6.1.pkl",
+        .name = "vmaf",
+        .flags = VMAF_MODEL_FLAGS_DEFAULT,
+    };
+    err = vmaf_model_load_from_path(&model, &cfg);
+    mu_assert("problem during vmaf_model_load_from_path", !err);
+    for (unsigned i = 0; i < model->n_features; i++) {
+        err = vmaf_feature_collector_append(feature_collector,
+                                            model->feature[i].name, 60., 0);
+        mu_assert("problem during vmaf_feature_collector_append", !err);
+    }
+    double score;
+    err = vmaf_predict_score_at_index(model, feature_collector, 0, &score);
+    mu_assert("problem during vmaf_predict_score_at_index", !err);
+    mu_assert("scores should be clipped to 100", score == 100.);
+    vmaf_model_destroy(model);
+
+    // the new model may well be allocated where the old one was
+    cfg.flags = VMAF_MODEL_FLAG_DISABLE_CLIP;
+    err = vmaf_model_load_from_path(&model, &cfg);
+    mu_assert("problem during vmaf_model_load_from_path", !err);
+    err = vmaf_predict_score_at_index(model, feature_collector, 0, &score);
+    mu_assert("problem during vmaf_predict_score_at_index", !err);
+    mu_assert("a new model should not see the predictions of a freed one",
+              score > 100.);
+
     vmaf_model_destroy(model);
     vmaf_feature_collector_destroy(feature_collector);
     return NULL;
@@ -40,5 +141,7 @@ static char *test_predict_score_at_index()
 char *run_tests()
 {
     mu_run_test(test_predict_score_at_index);
+    mu_run_test(test_predict_memo_is_per_model);
+    mu_run_test(test_predict_memo_outlives_model);
     return NULL;
 }
@@ -0,0 +1,80 @@
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "quantile.h"
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static char *test_quantile_nearest_rank()
+{
+    int err;
+
+    const unsigned n_max = 257;
+    double *value = malloc(sizeof(*value) * n_max);
+    double *sorted = malloc(sizeof(*sorted) * n_max);
+    mu_assert("problem allocating values", value && sorted);
+
+    const double q[] = { 0., 0.05, 0.1, 0.2, 0.5, 0.9, 0.999, 1. };
+    uint32_t state = 1;
+    for (unsigned n = 1; n <= n_max; n += 8) {
+        // random, few distinct, ascending and descending values
+        for (unsigned pattern = 0; pattern < 4; pattern++) {
+            for (unsigned i = 0; i < n; i++) {
+                state = state * 1664525u + 1013904223u;
+                sorted[i] = pattern == 0 ? 100. * (state >> 8) / (1u << 24) :
+                            pattern == 1 ? (double) (state >> 29) :
+                            pattern == 2 ? i * .5 : (n - i) * 1e3;
+            }
+            qsort(sorted, n, sizeof(*sorted), cmp_double);
+            for (unsigned j = 0; j < sizeof(q) / sizeof(q[0]); j++) {
+                for (unsigned i = 0; i < n; i++)
+                    value[i] = sorted[(i * 7919u) % n];
+                double quantile;
+                err = vmaf_quantile_nearest_rank(value, n, q[j], &quantile);
+                mu_assert("problem during vmaf_quantile_nearest_rank", !err);
+                const unsigned rank = ceil(q[j] * n);
+                mu_assert("quantile should be the exact nearest rank",
+                          quantile == sorted[rank ? rank - 1 : 0]);
+            }
+        }
+    }
+
+    free(value);
+    free(sorted);
+    return NULL;
+}
+
+static char *test_quantile_invalid()
+{
+    double value[3] = { 3., 1., 2. }, quantile;
+
+    mu_assert("no values should have no quantile",
+              vmaf_quantile_nearest_rank(value, 0, .5, &quantile) == -EINVAL);
+    mu_assert("q above 1 should be rejected",
+              vmaf_quantile_nearest_rank(value, 3, 1.5, &quantile) == -EINVAL);
+    mu_assert("q of NaN should be rejected",
+              vmaf_quantile_nearest_rank(value, 3, NAN, &quantile) == -EINVAL);
+
+    int err = vmaf_quantile_nearest_rank(value, 3, 0., &quantile);
+    mu_assert("problem during vmaf_quantile_nearest_rank", !err);
+    mu_assert("the 0 quantile should be the smallest value", quantile == 1.);
+    err = vmaf_quantile_nearest_rank(value, 3, .5, &quantile);
+    mu_assert("problem during vmaf_quantile_nearest_rank", !err);
+    mu_assert("the median should be the middle value", quantile == 2.);
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_quantile_nearest_rank);
+    mu_run_test(test_quantile_invalid);
+    return NULL;
+}
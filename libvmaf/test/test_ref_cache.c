@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "test.h"
+#include "ref_cache.h"
+#include "libvmaf/picture.h"
+
+static const char *feature[] = { "'VMAF_feature_motion2_score'" };
+
+static char *test_ref_cache_hash()
+{
+    int err;
+
+    VmafPicture a, b;
+    err = vmaf_picture_alloc(&a, VMAF_PIX_FMT_YUV420P, 8, 35, 7);
+    err |= vmaf_picture_alloc(&b, VMAF_PIX_FMT_YUV420P, 8, 35, 7);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    for (unsigned i = 0; i < a.h[0]; i++) {
+        uint8_t *row_a = (uint8_t *) a.data[0] + i * a.stride[0];
+        uint8_t *row_b = (uint8_t *) b.data[0] + i * b.stride[0];
+        for (unsigned j = 0; j < a.w[0]; j++)
+            row_a[j] = row_b[j] = i * 31 + j;
+    }
+    // padding past the picture width is not part of the content
+    ((uint8_t *) b.data[0])[b.w[0]] ^= 0xff;
+    mu_assert("equal pictures should hash equally",
+              vmaf_ref_cache_hash(&a) == vmaf_ref_cache_hash(&b));
+
+    ((uint8_t *) b.data[0])[b.stride[0] * 6 + 34] ^= 1;
+    mu_assert("different pictures should hash differently",
+              vmaf_ref_cache_hash(&a) != vmaf_ref_cache_hash(&b));
+
+    vmaf_picture_unref(&a);
+    vmaf_picture_unref(&b);
+    return NULL;
+}
+
+static char *test_ref_cache_write_and_replay()
+{
+    int err;
+    char path[] = "test_ref_cache.tmp";
+    remove(path);
+
+    VmafRefCache *cache;
+    err = vmaf_ref_cache_init(&cache, path);
+    mu_assert("problem during vmaf_ref_cache_init", !err);
+    err = vmaf_ref_cache_set_key(cache, 1920, 1080, 8, feature, 1);
+    mu_assert("problem during vmaf_ref_cache_set_key", !err);
+    mu_assert("a missing file should hold no frames",
+              !vmaf_ref_cache_frame_cnt(cache));
+
+    VmafFeatureCollector *fc;
+    err = vmaf_feature_collector_init(&fc);
+    mu_assert("problem during vmaf_feature_collector_init", !err);
+    for (unsigned i = 0; i < 10; i++) {
+        err = vmaf_ref_cache_record(cache, i, 1000 + i);
+        mu_assert("nothing should match an empty cache", !err);
+        if (i == 9) {
+            err = vmaf_ref_cache_write(cache, fc);
+            mu_assert("a cache with missing scores should not be written",
+                      err);
+        }
+        err = vmaf_feature_collector_append(fc, (char *) feature[0], i * .5,
+                                            i);
+        mu_assert("problem during vmaf_feature_collector_append", !err);
+    }
+    err = vmaf_ref_cache_write(cache, fc);
+    mu_assert("problem during vmaf_ref_cache_write", !err);
+    vmaf_ref_cache_destroy(cache);
+    vmaf_feature_collector_destroy(fc);
+
+    err = vmaf_ref_cache_init(&cache, path);
+    err |= vmaf_ref_cache_set_key(cache, 1920, 1080, 8, feature, 1);
+    mu_assert("problem reopening the cache", !err);
+    mu_assert("the cache should hold every frame",
+              vmaf_ref_cache_frame_cnt(cache) == 10);
+    mu_assert("the first frame should match",
+              vmaf_ref_cache_record(cache, 0, 1000) == 1);
+    mu_assert("a changed frame should not match",
+              vmaf_ref_cache_record(cache, 1, 42) == 0);
+    mu_assert("frames past the cache should not match",
+              vmaf_ref_cache_record(cache, 10, 1010) == 0);
+
+    err = vmaf_feature_collector_init(&fc);
+    err |= vmaf_ref_cache_import(cache, fc, 7);
+    mu_assert("problem during vmaf_ref_cache_import", !err);
+    double score;
+    err = vmaf_feature_collector_get_score(fc, (char *) feature[0], &score, 7);
+    mu_assert("imported score should be in the collector", !err);
+    mu_assert("imported score is wrong", score == 3.5);
+    vmaf_feature_collector_destroy(fc);
+    vmaf_ref_cache_destroy(cache);
+
+    err = vmaf_ref_cache_init(&cache, path);
+    err |= vmaf_ref_cache_set_key(cache, 1280, 720, 8, feature, 1);
+    mu_assert("problem reopening the cache", !err);
+    mu_assert("a cache written for another resolution should be ignored",
+              !vmaf_ref_cache_frame_cnt(cache));
+    vmaf_ref_cache_destroy(cache);
+
+    remove(path);
+    return NULL;
+}
+
+static char *test_ref_cache_directory()
+{
+    int err;
+    char dir[] = "test_ref_cache.dir";
+    char path[] = "test_ref_cache.dir/00000000000003e8-1920x1080-8.refcache";
+    remove(path);
+    remove(dir);
+    err = mkdir(dir, 0755);
+    mu_assert("problem creating the cache directory", !err);
+
+    VmafFeatureCollector *fc;
+    err = vmaf_feature_collector_init(&fc);
+    err |= vmaf_feature_collector_append(fc, (char *) feature[0], 1., 0);
+    mu_assert("problem during vmaf_feature_collector_append", !err);
+
+    VmafRefCache *cache;
+    err = vmaf_ref_cache_init(&cache, dir);
+    err |= vmaf_ref_cache_name(cache, 1920, 1080, 8, 1000);
+    err |= vmaf_ref_cache_set_key(cache, 1920, 1080, 8, feature, 1);
+    err |= vmaf_ref_cache_record(cache, 0, 1000);
+    err |= vmaf_ref_cache_write(cache, fc);
+    mu_assert("problem writing a cache in a directory", !err);
+    vmaf_ref_cache_destroy(cache);
+
+    err = vmaf_ref_cache_init(&cache, dir);
+    err |= vmaf_ref_cache_name(cache, 1920, 1080, 8, 1000);
+    err |= vmaf_ref_cache_set_key(cache, 1920, 1080, 8, feature, 1);
+    mu_assert("problem reopening the cache", !err);
+    mu_assert("a reference starting alike should find its cache",
+              vmaf_ref_cache_frame_cnt(cache) == 1);
+    vmaf_ref_cache_destroy(cache);
+
+    err = vmaf_ref_cache_init(&cache, dir);
+    err |= vmaf_ref_cache_name(cache, 1920, 1080, 8, 2000);
+    err |= vmaf_ref_cache_set_key(cache, 1920, 1080, 8, feature, 1);
+    mu_assert("problem opening another cache", !err);
+    mu_assert("another reference should get its own cache",
+              !vmaf_ref_cache_frame_cnt(cache));
+    vmaf_ref_cache_destroy(cache);
+
+    vmaf_feature_collector_destroy(fc);
+    remove(path);
+    remove(dir);
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_ref_cache_hash);
+    mu_run_test(test_ref_cache_write_and_replay);
+    mu_run_test(test_ref_cache_directory);
+    return NULL;
+}
@@ -0,0 +1,435 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "feature/common/cpu.h"
+#include "test.h"
+#include "scale.h"
+#include "thread_pool.h"
+
+enum vmaf_cpu cpu;
+
+static void fill(VmafPicture *pic)
+{
+    const int semi_planar = pic->pix_fmt == VMAF_PIX_FMT_NV12;
+    for (unsigned p = 0; p < (semi_planar ? 2 : 3); p++) {
+        const unsigned w = pic->w[p] << (semi_planar && p);
+        uint8_t *row = pic->data[p];
+        for (unsigned i = 0; i < pic->h[p]; i++, row += pic->stride[p]) {
+            for (unsigned j = 0; j < w; j++) {
+                const unsigned v = (i * 7 + j * 13 + p * 50) % 256;
+                if (pic->bpc > 8)
+                    ((uint16_t *) row)[j] = v << (pic->bpc - 8);
+                else
+                    row[j] = v;
+            }
+        }
+    }
+}
+
+static int same_pixels(VmafPicture *a, VmafPicture *b)
+{
+    const int semi_planar = a->pix_fmt == VMAF_PIX_FMT_NV12;
+    for (unsigned p = 0; p < (semi_planar ? 2 : 3); p++) {
+        const size_t row_sz =
+            (size_t) a->w[p] << (a->bpc > 8) << (semi_planar && p);
+        for (unsigned i = 0; i < a->h[p]; i++) {
+            if (memcmp((uint8_t *) a->data[p] + i * a->stride[p],
+                       (uint8_t *) b->data[p] + i * b->stride[p], row_sz))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Luma of a 30x20 and a 12x10 picture filled by swscale_pattern(), scaled to
+ * 12x8 and 20x16, as produced by swscale's C path (initFilter,
+ * hScale8To15_c, yuv2planeX_8_c) with default parameters. */
+static unsigned swscale_pattern(unsigned i, unsigned j)
+{
+    return (i * 37 + j * 91 + (i * j) % 17 * 11) % 256;
+}
+
+static const uint8_t sws_bicubic_down[8 * 12] = {
+    101, 119, 132, 145, 143, 153, 101, 131, 123, 155, 137, 152,
+    135, 131, 125, 116, 142, 129, 145, 151, 144, 132, 112, 143,
+    131, 139, 104, 115, 158, 171, 124, 125, 119, 113, 127, 118,
+     81, 123, 151, 104, 132, 186,  76,  99, 138, 145, 112, 143,
+    119, 117, 140, 119, 129, 130, 131, 124, 136, 113, 133, 148,
+    164, 146, 134, 121, 138,  91, 167, 115, 133, 144, 134, 115,
+     91, 164, 152, 102, 130, 113, 125,  96, 112, 154, 109, 152,
+    114, 115, 169, 146, 149, 120, 132, 115, 136, 145, 112, 113,
+};
+
+static const uint8_t sws_bicubic_up[16 * 20] = {
+      0,  26,  87, 163, 156,  33,  26, 102, 191, 188,
+     51,  39, 117, 205, 202,  65,  61, 150, 212, 247,
+      6,  43, 108, 198, 198,  65,  71, 154, 146, 110,
+     70, 111, 183, 174, 144, 120,  91,  82, 149, 202,
+     32,  74, 142, 218, 217, 110, 124, 184,  86,  38,
+    117, 198, 237, 140,  94, 182, 136,  39,  87, 138,
+     54, 108, 171, 128,  98, 132, 107,  59,  60, 112,
+    207, 204, 148, 161, 175, 166, 180, 194, 149, 113,
+     77, 144, 213, 101,  55, 176, 129,  18,  93, 190,
+    237, 163,  59, 152, 198, 100, 146, 239, 141,  54,
+     98, 167, 240, 148, 111, 217, 180,  89, 165, 222,
+    187,  99,  23, 109, 140,  29,  61, 146,  66,   0,
+    133, 124, 115, 128, 134, 119, 131, 156, 172, 145,
+     69,  61,  91,  62,  64, 125, 127,  98, 118, 137,
+    166,  94,  18, 122, 165,  52,  74, 165, 164, 108,
+     18,  51, 134,  66,  62, 196, 189, 120, 194, 255,
+    186, 123,  61, 170, 218, 113,  65,  81, 173, 204,
+    118,  68,  69, 148, 187, 131, 160, 227, 230, 221,
+    227, 169,  96, 111, 151, 188, 152,  90, 124, 135,
+     81,  80, 117, 166, 158,  66, 125, 245, 205, 158,
+    221, 187, 126,  36,  50, 215, 238, 157,  91,  38,
+     14,  85, 176, 123,  59,  44, 116, 204, 151,  96,
+     56, 104, 155,  92,  53,  95, 167, 228, 210, 157,
+     99,  71,  65,  24,  36, 125, 181, 186, 126,  78,
+      0,  75, 197, 159,  94,  61, 106, 184, 188, 177,
+    175, 135,  81,  45,  71, 170, 184, 135,  86,  56,
+     23, 113, 224, 186, 137, 135, 101,  60,  37,  81,
+    199, 242, 217, 168, 136, 146, 113,  64,  48,  45,
+     61,  80, 103,  77,  88, 165, 172, 132,  96, 104,
+    173, 183, 150, 131, 105,  73,  39,  28,  95, 147,
+     86,  47,   0,   0,  38, 176, 234, 218, 176, 142,
+    143, 110,  67,  75,  66,  17,   0,  15, 142, 235,
+};
+
+static const uint8_t sws_lanczos_down[8 * 12] = {
+    102, 121, 133, 145, 140, 157,  96, 131, 122, 158, 135, 149,
+    136, 132, 125, 116, 145, 125, 147, 152, 144, 135, 107, 145,
+    131, 141, 101, 114, 160, 169, 128, 126, 118, 113, 128, 116,
+     76, 122, 155,  98, 134, 193,  68,  92, 140, 147, 109, 146,
+    120, 116, 141, 120, 128, 128, 134, 126, 135, 114, 133, 149,
+    166, 150, 132, 120, 140,  87, 171, 117, 134, 146, 131, 114,
+     87, 164, 155,  99, 131, 118, 121,  90, 113, 155, 106, 155,
+    117, 113, 171, 147, 146, 119, 132, 119, 134, 148, 113, 109,
+};
+
+static const uint8_t sws_lanczos_up[16 * 20] = {
+      0,  21,  88, 173, 148,  37,   9,  96, 206, 191,
+     59,  19, 111, 223, 203,  65,  49, 157, 224, 245,
+      7,  34, 107, 221, 201,  64,  64, 162, 162, 100,
+     60, 109, 186, 177, 136, 122,  82,  71, 143, 205,
+     33,  67, 142, 232, 212, 106, 123, 183,  90,  29,
+    108, 215, 238, 134,  95, 183, 142,  40,  81, 144,
+     53, 110, 166, 128,  97, 128, 112,  62,  42, 105,
+    209, 217, 157, 153, 172, 178, 194, 192, 150, 117,
+     67, 157, 221,  92,  48, 183, 135,   7,  78, 217,
+    255, 149,  48, 160, 211,  87, 138, 251, 152,  39,
+     93, 176, 242, 144, 109, 220, 183,  85, 155, 236,
+    201,  86,  20, 115, 145,  26,  57, 151,  75,   0,
+    134, 123, 115, 128, 132, 120, 136, 168, 181, 133,
+     54,  58,  97,  54,  49, 123, 124,  83, 106, 136,
+    171,  81,  13, 127, 171,  47,  55, 162, 179, 103,
+     16,  56, 133,  65,  65, 206, 199, 123, 193, 255,
+    188, 108,  56, 174, 228, 112,  40,  84, 183, 210,
+    126,  54,  68, 149, 186, 142, 161, 226, 237, 226,
+    239, 178, 103,  99, 161, 209, 156,  78, 112, 138,
+     90,  76, 120, 192, 162,  50, 112, 250, 215, 143,
+    218, 194, 125,  18,  51, 209, 253, 161,  91,  34,
+      4,  89, 175, 130,  45,  36, 123, 204, 156,  91,
+     52, 107, 149,  84,  35,  89, 183, 241, 223, 151,
+     87,  67,  61,  12,  23, 117, 189, 185, 126,  78,
+      0,  74, 204, 190,  91,  48,  94, 179, 193, 184,
+    183, 142,  79,  36,  80, 178, 200, 136,  80,  53,
+     14, 114, 225, 197, 132, 130, 105,  60,  30,  84,
+    200, 251, 215, 161, 137, 146, 118,  63,  44,  46,
+     66,  87, 103,  73,  90, 170, 182, 124,  77,  98,
+    171, 194, 160, 138, 111,  73,  28,  25,  93, 150,
+     87,  49,   0,   0,  37, 173, 245, 225, 178, 147,
+    141, 104,  61,  69,  65,  22,   0,  17, 147, 241,
+};
+
+static char *test_scale_flat()
+{
+    int err;
+
+    const enum VmafScalingMethod method[] = {
+        VMAF_SCALING_METHOD_BICUBIC, VMAF_SCALING_METHOD_LANCZOS,
+    };
+    for (unsigned m = 0; m < 2; m++) {
+        VmafScaler *scaler;
+        err = vmaf_scaler_init(&scaler, 64, 36, method[m]);
+        mu_assert("problem during vmaf_scaler_init", !err);
+
+        VmafPicture src, dst;
+        err = vmaf_picture_alloc(&src, VMAF_PIX_FMT_YUV420P, 10, 250, 140);
+        mu_assert("problem during vmaf_picture_alloc", !err);
+        for (unsigned p = 0; p < 3; p++) {
+            for (unsigned i = 0; i < src.h[p]; i++) {
+                uint16_t *row = (uint16_t *)
+                    ((uint8_t *) src.data[p] + i * src.stride[p]);
+                for (unsigned j = 0; j < src.w[p]; j++)
+                    row[j] = 100 + p;
+            }
+        }
+
+        err = vmaf_scaler_scale(scaler, &dst, &src, NULL);
+        mu_assert("problem during vmaf_scaler_scale", !err);
+        mu_assert("scaled picture has the wrong size",
+                  dst.w[0] == 64 && dst.h[0] == 36 &&
+                  dst.w[1] == 32 && dst.h[1] == 18);
+        mu_assert("scaled picture has the wrong format",
+                  dst.pix_fmt == src.pix_fmt && dst.bpc == src.bpc);
+        for (unsigned p = 0; p < 3; p++) {
+            for (unsigned i = 0; i < dst.h[p]; i++) {
+                uint16_t *row = (uint16_t *)
+                    ((uint8_t *) dst.data[p] + i * dst.stride[p]);
+                for (unsigned j = 0; j < dst.w[p]; j++)
+                    mu_assert("a flat plane should stay flat",
+                              row[j] == 100 + p);
+            }
+        }
+
+        vmaf_picture_unref(&src);
+        vmaf_picture_unref(&dst);
+        vmaf_scaler_destroy(scaler);
+    }
+
+    return NULL;
+}
+
+static char *test_scale_passthrough()
+{
+    int err;
+
+    VmafScaler *scaler;
+    err = vmaf_scaler_init(&scaler, 64, 36, VMAF_SCALING_METHOD_BICUBIC);
+    mu_assert("problem during vmaf_scaler_init", !err);
+
+    VmafPicture src, dst;
+    err = vmaf_picture_alloc(&src, VMAF_PIX_FMT_YUV420P, 8, 64, 36);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    err = vmaf_scaler_scale(scaler, &dst, &src, NULL);
+    mu_assert("problem during vmaf_scaler_scale", !err);
+    mu_assert("a picture at the target size should not be copied",
+              dst.data[0] == src.data[0] && *src.ref_cnt == 2);
+
+    vmaf_picture_unref(&src);
+    vmaf_picture_unref(&dst);
+    vmaf_scaler_destroy(scaler);
+    return NULL;
+}
+
+static char *test_scale_threaded()
+{
+    int err;
+
+    VmafThreadPool *pool;
+    err = vmaf_thread_pool_create(&pool, 4);
+    mu_assert("problem during vmaf_thread_pool_create", !err);
+
+    const enum VmafPixelFormat pix_fmt[] = {
+        VMAF_PIX_FMT_YUV420P, VMAF_PIX_FMT_NV12, VMAF_PIX_FMT_YUV400P,
+    };
+    for (unsigned f = 0; f < 3; f++) {
+        VmafScaler *scaler;
+        err = vmaf_scaler_init(&scaler, 320, 180, VMAF_SCALING_METHOD_LANCZOS);
+        mu_assert("problem during vmaf_scaler_init", !err);
+
+        VmafPicture src, serial, threaded;
+        err = vmaf_picture_alloc(&src, pix_fmt[f], 8, 1280, 720);
+        mu_assert("problem during vmaf_picture_alloc", !err);
+        fill(&src);
+
+        err = vmaf_scaler_scale(scaler, &serial, &src, NULL);
+        err |= vmaf_scaler_scale(scaler, &threaded, &src, pool);
+        mu_assert("problem during vmaf_scaler_scale", !err);
+        mu_assert("bands on the thread pool should match a serial run",
+                  same_pixels(&serial, &threaded));
+
+        vmaf_picture_unref(&src);
+        vmaf_picture_unref(&serial);
+        vmaf_picture_unref(&threaded);
+        vmaf_scaler_destroy(scaler);
+    }
+
+    vmaf_thread_pool_destroy(pool);
+    return NULL;
+}
+
+static char *test_scale_swscale()
+{
+    int err;
+
+    const struct {
+        enum VmafScalingMethod method;
+        unsigned src_w, src_h, dst_w, dst_h;
+        const uint8_t *expected;
+        unsigned border;
+    } t[] = {
+        { VMAF_SCALING_METHOD_BICUBIC, 30, 20, 12, 8, sws_bicubic_down, 0 },
+        { VMAF_SCALING_METHOD_BICUBIC, 12, 10, 20, 16, sws_bicubic_up, 0 },
+        { VMAF_SCALING_METHOD_LANCZOS, 30, 20, 12, 8, sws_lanczos_down, 0 },
+        /* swscale truncates the start of its filter window toward zero, so
+         * when upscaling it drops the leftmost lanczos tap at the top and
+         * left edges; those outputs are not comparable. */
+        { VMAF_SCALING_METHOD_LANCZOS, 12, 10, 20, 16, sws_lanczos_up, 4 },
+    };
+    for (unsigned k = 0; k < 4; k++) {
+        VmafScaler *scaler;
+        err = vmaf_scaler_init(&scaler, t[k].dst_w, t[k].dst_h, t[k].method);
+        mu_assert("problem during vmaf_scaler_init", !err);
+
+        VmafPicture src, dst;
+        err = vmaf_picture_alloc(&src, VMAF_PIX_FMT_YUV400P, 8,
+                                 t[k].src_w, t[k].src_h);
+        mu_assert("problem during vmaf_picture_alloc", !err);
+        for (unsigned i = 0; i < t[k].src_h; i++) {
+            uint8_t *row = (uint8_t *) src.data[0] + i * src.stride[0];
+            for (unsigned j = 0; j < t[k].src_w; j++)
+                row[j] = swscale_pattern(i, j);
+        }
+
+        err = vmaf_scaler_scale(scaler, &dst, &src, NULL);
+        mu_assert("problem during vmaf_scaler_scale", !err);
+        for (unsigned i = t[k].border; i < t[k].dst_h; i++) {
+            const uint8_t *row = (uint8_t *) dst.data[0] + i * dst.stride[0];
+            for (unsigned j = t[k].border; j < t[k].dst_w; j++) {
+                const int diff = row[j] - t[k].expected[i * t[k].dst_w + j];
+                mu_assert("scaled luma should match swscale within 1",
+                          diff >= -1 && diff <= 1);
+            }
+        }
+
+        vmaf_picture_unref(&src);
+        vmaf_picture_unref(&dst);
+        vmaf_scaler_destroy(scaler);
+    }
+
+    return NULL;
+}
+
+static void block_func(void *data)
+{
+    atomic_int *release = *(atomic_int **) data;
+    while (!atomic_load(release))
+        ;
+}
+
+static char *test_scale_busy_pool()
+{
+    int err;
+
+    VmafThreadPool *pool;
+    err = vmaf_thread_pool_create(&pool, 2);
+    mu_assert("problem during vmaf_thread_pool_create", !err);
+
+    atomic_int release = 0;
+    atomic_int *data = &release;
+    for (unsigned i = 0; i < 2; i++) {
+        err = vmaf_thread_pool_enqueue(pool, block_func, &data, sizeof(data));
+        mu_assert("problem during vmaf_thread_pool_enqueue", !err);
+    }
+
+    VmafScaler *scaler;
+    err = vmaf_scaler_init(&scaler, 320, 180, VMAF_SCALING_METHOD_BICUBIC);
+    mu_assert("problem during vmaf_scaler_init", !err);
+
+    VmafPicture src, serial, busy;
+    err = vmaf_picture_alloc(&src, VMAF_PIX_FMT_YUV420P, 8, 1280, 720);
+    mu_assert("problem during vmaf_picture_alloc", !err);
+    fill(&src);
+
+    err = vmaf_scaler_scale(scaler, &serial, &src, NULL);
+    err |= vmaf_scaler_scale(scaler, &busy, &src, pool);
+    mu_assert("problem during vmaf_scaler_scale", !err);
+    mu_assert("bands should be scaled on the caller while workers are busy",
+              same_pixels(&serial, &busy));
+
+    atomic_store(&release, 1);
+    vmaf_thread_pool_destroy(pool);
+    vmaf_picture_unref(&src);
+    vmaf_picture_unref(&serial);
+    vmaf_picture_unref(&busy);
+    vmaf_scaler_destroy(scaler);
+    return NULL;
+}
+
+static char *test_scale_horizontal_avx()
+{
+    if (cpu_autodetect() < VMAF_CPU_AVX) return NULL;
+
+    enum { w = 37, taps = 6, line_n = 80 };
+    float line[line_n], coeff[taps * w], out_c[w], out_avx[w];
+    int pos[taps * w];
+    for (unsigned j = 0; j < line_n; j++)
+        line[j] = (j * 29 % 256) * .5f;
+    for (unsigned k = 0; k < taps; k++) {
+        for (unsigned j = 0; j < w; j++) {
+            const int p = (int) (j * 2) + (int) k - 2;
+            pos[k * w + j] = p < 0 ? 0 : p >= line_n ? line_n - 1 : p;
+            coeff[k * w + j] = (k + 1) * .0625f - (j % 3) * .03125f;
+        }
+    }
+
+    scale_horizontal_c(line, pos, coeff, taps, out_c, w);
+    scale_horizontal_avx(line, pos, coeff, taps, out_avx, w);
+    for (unsigned j = 0; j < w; j++)
+        mu_assert("avx and c kernels disagree", out_c[j] == out_avx[j]);
+
+    return NULL;
+}
+
+static char *test_scale_vertical_avx()
+{
+    if (cpu_autodetect() < VMAF_CPU_AVX) return NULL;
+
+    float a[37], b[37], c[37], out_c[37], out_avx[37];
+    for (unsigned j = 0; j < 37; j++) {
+        a[j] = j * .5f;
+        b[j] = 100.f - j;
+        c[j] = j * j * .25f;
+    }
+    const float *row[3] = { a, b, c };
+    const float coeff[3] = { -.125f, .75f, .375f };
+
+    scale_vertical_c(row, coeff, 3, out_c, 37);
+    scale_vertical_avx(row, coeff, 3, out_avx, 37);
+    for (unsigned j = 0; j < 37; j++)
+        mu_assert("avx and c kernels disagree", out_c[j] == out_avx[j]);
+
+    return NULL;
+}
+
+static char *test_scale_equivalent()
+{
+    int err;
+
+    VmafScaler *a, *b, *c, *d;
+    err = vmaf_scaler_init(&a, 64, 48, VMAF_SCALING_METHOD_BICUBIC);
+    err |= vmaf_scaler_init(&b, 64, 48, VMAF_SCALING_METHOD_BICUBIC);
+    err |= vmaf_scaler_init(&c, 64, 48, VMAF_SCALING_METHOD_LANCZOS);
+    err |= vmaf_scaler_init(&d, 64, 32, VMAF_SCALING_METHOD_BICUBIC);
+    mu_assert("problem during vmaf_scaler_init", !err);
+
+    mu_assert("same settings should be equivalent",
+              vmaf_scaler_equivalent(a, b));
+    mu_assert("methods should differ", !vmaf_scaler_equivalent(a, c));
+    mu_assert("resolutions should differ", !vmaf_scaler_equivalent(a, d));
+    mu_assert("no scaler should not be equivalent",
+              !vmaf_scaler_equivalent(a, NULL));
+
+    vmaf_scaler_destroy(a);
+    vmaf_scaler_destroy(b);
+    vmaf_scaler_destroy(c);
+    vmaf_scaler_destroy(d);
+    return NULL;
+}
+
+char *run_tests()
+{
+    mu_run_test(test_scale_flat);
+    mu_run_test(test_scale_passthrough);
+    mu_run_test(test_scale_swscale);
+    mu_run_test(test_scale_threaded);
+    mu_run_test(test_scale_busy_pool);
+    mu_run_test(test_scale_horizontal_avx);
+    mu_run_test(test_scale_vertical_avx);
+    mu_run_test(test_scale_equivalent);
+    return NULL;
+}
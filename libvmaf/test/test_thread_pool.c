@@ -1,4 +1,8 @@
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "feature/common/cpu.h"
 #include "test.h"
@@ -60,8 +64,115 @@ static char *test_thread_pool_create_enqueue_wait_and_destroy()
     return NULL;
 }
 
+static void fn_e(void *data)
+{
+    (void) data;
+}
+
+static char *test_thread_pool_trace()
+{
+    int err;
+
+    VmafTrace *trace;
+    err = vmaf_trace_init(&trace);
+    mu_assert("problem during vmaf_trace_init", !err);
+
+    VmafThreadPool *pool;
+    err = vmaf_thread_pool_create(&pool, 4);
+    mu_assert("problem during vmaf_thread_pool_init", !err);
+    err = vmaf_thread_pool_set_trace(pool, trace);
+    mu_assert("problem during vmaf_thread_pool_set_trace", !err);
+
+    const unsigned n_jobs = 2000;
+    for (unsigned i = 0; i < n_jobs; i++) {
+        err = vmaf_thread_pool_enqueue(pool, fn_e, NULL, 0);
+        mu_assert("problem during vmaf_thread_pool_enqueue", !err);
+    }
+    vmaf_trace_begin(trace, "test", "wait", 7);
+    err = vmaf_thread_pool_wait(pool);
+    mu_assert("problem during vmaf_thread_pool_wait", !err);
+    vmaf_trace_end(trace, "test", "wait");
+
+    FILE *f = tmpfile();
+    mu_assert("could not open tmpfile", f);
+    err = vmaf_trace_write(trace, f);
+    mu_assert("problem during vmaf_trace_write", !err);
+    err = vmaf_thread_pool_destroy(pool);
+    mu_assert("problem during vmaf_thread_pool_destroy", !err);
+    vmaf_trace_destroy(trace);
+
+    rewind(f);
+    char line[256];
+    unsigned begin = 0, end = 0, index = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strstr(line, "\"name\": \"job\"")) {
+            begin += !!strstr(line, "\"ph\": \"B\"");
+            end += !!strstr(line, "\"ph\": \"E\"");
+        }
+        index += !!strstr(line, "\"args\": {\"index\": 7}");
+    }
+    fclose(f);
+    mu_assert("every job should have one begin event", begin == n_jobs);
+    mu_assert("every job should have one end event", end == n_jobs);
+    mu_assert("index should be written to args", index == 1);
+
+    return NULL;
+}
+
+static atomic_uint group_done;
+static atomic_bool release_blocker;
+
+static void fn_count(void *data)
+{
+    (void) data;
+    atomic_fetch_add(&group_done, 1);
+}
+
+static void fn_block(void *data)
+{
+    (void) data;
+    while (!atomic_load(&release_blocker));
+}
+
+static char *test_thread_pool_wait_group()
+{
+    int err;
+
+    VmafThreadPool *pool;
+    err = vmaf_thread_pool_create(&pool, 2);
+    mu_assert("problem during vmaf_thread_pool_init", !err);
+
+    // another user's job is still running when the group is done
+    atomic_init(&group_done, 0);
+    atomic_init(&release_blocker, false);
+    err = vmaf_thread_pool_enqueue(pool, fn_block, NULL, 0);
+    mu_assert("problem during vmaf_thread_pool_enqueue", !err);
+
+    VmafThreadPoolGroup group = { 0 };
+    const unsigned n_jobs = 100;
+    for (unsigned i = 0; i < n_jobs; i++) {
+        err = vmaf_thread_pool_enqueue_group(pool, &group, fn_count, NULL, 0);
+        mu_assert("problem during vmaf_thread_pool_enqueue_group", !err);
+    }
+    err = vmaf_thread_pool_wait_group(pool, &group);
+    mu_assert("problem during vmaf_thread_pool_wait_group", !err);
+    mu_assert("every job of the group should have run",
+              atomic_load(&group_done) == n_jobs);
+    mu_assert("group should have no pending jobs", !group.pending);
+
+    atomic_store(&release_blocker, true);
+    err = vmaf_thread_pool_wait(pool);
+    mu_assert("problem during vmaf_thread_pool_wait", !err);
+    err = vmaf_thread_pool_destroy(pool);
+    mu_assert("problem during vmaf_thread_pool_destroy", !err);
+
+    return NULL;
+}
+
 char *run_tests()
 {
     mu_run_test(test_thread_pool_create_enqueue_wait_and_destroy);
+    mu_run_test(test_thread_pool_trace);
+    mu_run_test(test_thread_pool_wait_group);
     return NULL;
 }
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <getopt.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -9,6 +10,23 @@
 
 #include <libvmaf/libvmaf.rc.h>
 
+enum {
+    ARG_NO_MMAP = 256,
+    ARG_READ_AHEAD,
+    ARG_LUMA_ONLY,
+    ARG_BATCH,
+    ARG_BATCH_JOBS,
+    ARG_MEMORY_LIMIT,
+    ARG_REF_CACHE,
+    ARG_FRAMES,
+    ARG_MERGE,
+    ARG_SCALE,
+    ARG_SCALE_METHOD,
+    ARG_CTX_BUDGET,
+    ARG_STATS,
+    ARG_TRACE,
+};
+
 static const char short_opts[] = "r:d:w:h:p:b:m:o:x:t:f:i:s:n:v:";
 
 static const struct option long_opts[] = {
@@ -27,6 +45,20 @@ static const struct option long_opts[] = {
     { "subsample",        1, NULL, 's' },
     { "no_prediction",    0, NULL, 'n' },
     { "version",          0, NULL, 'v' },
+    { "no_mmap",          0, NULL, ARG_NO_MMAP },
+    { "read_ahead",       1, NULL, ARG_READ_AHEAD },
+    { "luma_only",        0, NULL, ARG_LUMA_ONLY },
+    { "batch",            1, NULL, ARG_BATCH },
+    { "batch_jobs",       1, NULL, ARG_BATCH_JOBS },
+    { "memory_limit",     1, NULL, ARG_MEMORY_LIMIT },
+    { "ref_cache",        1, NULL, ARG_REF_CACHE },
+    { "frames",           1, NULL, ARG_FRAMES },
+    { "merge",            1, NULL, ARG_MERGE },
+    { "scale",            1, NULL, ARG_SCALE },
+    { "scale_method",     1, NULL, ARG_SCALE_METHOD },
+    { "ctx_budget",       1, NULL, ARG_CTX_BUDGET },
+    { "stats",            0, NULL, ARG_STATS },
+    { "trace",            1, NULL, ARG_TRACE },
     { NULL,               0, NULL, 0 },
 };
 
@@ -41,15 +73,16 @@ static void usage(const char *const app, const char *const reason, ...) {
     fprintf(stderr, "Usage: %s [options]\n\n", app);
     fprintf(stderr, "Supported options:\n"
             " --reference/-r $path:      path to reference .y4m or .yuv\n"
-            " --distorted/-d $path:      path to distorted .y4m or .yuv\n"
+            " --distorted/-d $path:      path to distorted .y4m or .yuv, repeat to\n"
+            "                            score an encoding ladder against one reference\n"
             " --width/-w $unsigned:      width\n"
             " --height/-h $unsigned:     height\n"
-            " --pixel_format/-p: $string pixel format (420/422/444)\n"
+            " --pixel_format/-p: $string pixel format (420/422/444/nv12/p010)\n"
             " --bitdepth/-b $unsigned:   bitdepth (8/10/12)\n"
             " --model/-m $model-params:  path to model file (required) + optional parameters, e.g.\n"
             "                               path=foo.pkl:disable_clip\n"
             "                               path=foo.pkl:name=foo:enable_transform\n"
-            " --output/-o $path:         path to output file\n"
+            " --output/-o $path:         path to output file, one per distorted\n"
             " --xml/-x:                  write output file as XML (default)\n"
             " --threads/-t $unsigned:    number of threads to use\n"
             " --feature/-f $string:      additional feature\n"
@@ -57,6 +90,27 @@ static void usage(const char *const app, const char *const reason, ...) {
             " --subsample/-s: $unsigned  compute scores only every N frames\n"
             " --no_prediction/-n:        no prediction, extract features only\n"
             " --version/-v:              print version and exit\n"
+            " --no_mmap:                 read input with stdio instead of mmap\n"
+            " --read_ahead $unsigned:    pictures prefetched per input (default 2)\n"
+            " --luma_only:               skip chroma, only luma is read\n"
+            " --batch $path:             list of \"$reference $distorted [$output]\"\n"
+            "                            lines, processed concurrently\n"
+            " --batch_jobs $unsigned:    pairs processed at once (default 4)\n"
+            " --memory_limit $unsigned:  approximate batch memory budget in MiB\n"
+            " --ref_cache $path:         directory caching reference-only features,\n"
+            "                            one file per reference content\n"
+            " --frames $start:[$end]:    score frames start to end - 1 only, and write\n"
+            "                            them to -o/--output as a partial for --merge\n"
+            " --merge $path:             partial written with --frames, repeat to merge\n"
+            "                            segments into one output and pooled score\n"
+            " --scale $wx$h:             scale both videos to this resolution before\n"
+            "                            features are extracted, e.g. 1920x1080\n"
+            " --scale_method $string:    bicubic (default) or lanczos\n"
+            " --ctx_budget $unsigned:    MiB per-thread feature extractor buffers may\n"
+            "                            take up, per pair (default no limit)\n"
+            " --stats:                   print time and memory per feature extractor\n"
+            " --trace $path:             write a Chrome trace-event JSON timeline of\n"
+            "                            feature extraction across threads\n"
            );
     exit(1);
 }
@@ -111,13 +165,61 @@ static enum VmafPixelFormat parse_pix_fmt(const char *const optarg,
         pix_fmt = VMAF_PIX_FMT_YUV422P;
     if (!strcmp(optarg, "444"))
         pix_fmt = VMAF_PIX_FMT_YUV444P;
+    if (!strcmp(optarg, "nv12"))
+        pix_fmt = VMAF_PIX_FMT_NV12;
+    if (!strcmp(optarg, "p010"))
+        pix_fmt = VMAF_PIX_FMT_P010;
 
     if (!pix_fmt) error(app, optarg, option, "a valid pixel format "
-                                             "(420/422/444)");
+                                             "(420/422/444/nv12/p010)");
 
     return pix_fmt;
 }
 
+static void parse_frames(const char *const optarg, const int option,
+                         const char *const app, CLISettings *const settings)
+{
+    char *end;
+    settings->frame_start = (unsigned) strtoul(optarg, &end, 0);
+    if (end == optarg || *end != ':')
+        error(app, optarg, option, "$start:$end or $start:");
+    const char *const optarg_end = end + 1;
+    settings->frame_end = UINT_MAX;
+    if (*optarg_end) {
+        settings->frame_end = (unsigned) strtoul(optarg_end, &end, 0);
+        if (*end || end == optarg_end)
+            error(app, optarg, option, "$start:$end or $start:");
+    }
+    if (settings->frame_end <= settings->frame_start)
+        error(app, optarg, option, "$start:$end with $start < $end");
+    settings->frames = true;
+}
+
+static void parse_scale(const char *const optarg, const int option,
+                        const char *const app, CLISettings *const settings)
+{
+    char *end;
+    settings->scale_w = (unsigned) strtoul(optarg, &end, 0);
+    if (end == optarg || *end != 'x' || !settings->scale_w)
+        error(app, optarg, option, "a resolution, e.g. 1920x1080");
+    const char *const optarg_h = end + 1;
+    settings->scale_h = (unsigned) strtoul(optarg_h, &end, 0);
+    if (end == optarg_h || *end || !settings->scale_h)
+        error(app, optarg, option, "a resolution, e.g. 1920x1080");
+}
+
+static enum VmafScalingMethod parse_scale_method(const char *const optarg,
+                                                 const int option,
+                                                 const char *const app)
+{
+    if (!strcmp(optarg, "bicubic"))
+        return VMAF_SCALING_METHOD_BICUBIC;
+    if (!strcmp(optarg, "lanczos"))
+        return VMAF_SCALING_METHOD_LANCZOS;
+    error(app, optarg, option, "a scaling method (bicubic/lanczos)");
+    return VMAF_SCALING_METHOD_NONE;
+}
+
 static VmafModelConfig parse_model_config(const char *const optarg,
                                           const char *const app)
 {
@@ -167,7 +269,11 @@ void cli_parse(const int argc, char *const *const argv,
             settings->path_ref = optarg;
             break;
         case 'd':
-            settings->path_dist = optarg;
+            if (settings->dist_cnt == CLI_SETTINGS_STATIC_ARRAY_LEN) {
+                usage(argv[0], "A maximum of %d distorted inputs is supported\n",
+                      CLI_SETTINGS_STATIC_ARRAY_LEN);
+            }
+            settings->path_dist[settings->dist_cnt++] = optarg;
             break;
         case 'w':
             settings->width = parse_unsigned(optarg, 'w', argv[0]);
@@ -186,7 +292,11 @@ void cli_parse(const int argc, char *const *const argv,
             settings->use_yuv = true;
             break;
         case 'o':
-            settings->output_path = optarg;
+            if (settings->output_cnt == CLI_SETTINGS_STATIC_ARRAY_LEN) {
+                usage(argv[0], "A maximum of %d outputs is supported\n",
+                      CLI_SETTINGS_STATIC_ARRAY_LEN);
+            }
+            settings->output_path[settings->output_cnt++] = optarg;
             break;
         case 'x':
             settings->output_fmt = VMAF_OUTPUT_FORMAT_XML;
@@ -225,6 +335,61 @@ void cli_parse(const int argc, char *const *const argv,
         case 'v':
             fprintf(stderr, "%s\n", vmaf_version());
             exit(0);
+        case ARG_NO_MMAP:
+            settings->no_mmap = true;
+            break;
+        case ARG_BATCH:
+            settings->batch_path = optarg;
+            break;
+        case ARG_BATCH_JOBS:
+            settings->batch_jobs =
+                parse_unsigned(optarg, ARG_BATCH_JOBS, argv[0]);
+            if (!settings->batch_jobs)
+                error(argv[0], optarg, ARG_BATCH_JOBS, "greater than 0");
+            break;
+        case ARG_MEMORY_LIMIT:
+            settings->memory_limit =
+                parse_unsigned(optarg, ARG_MEMORY_LIMIT, argv[0]);
+            break;
+        case ARG_CTX_BUDGET:
+            settings->ctx_budget =
+                parse_unsigned(optarg, ARG_CTX_BUDGET, argv[0]);
+            break;
+        case ARG_REF_CACHE:
+            settings->ref_cache_dir = optarg;
+            break;
+        case ARG_FRAMES:
+            parse_frames(optarg, ARG_FRAMES, argv[0], settings);
+            break;
+        case ARG_MERGE:
+            if (settings->merge_cnt == CLI_SETTINGS_STATIC_ARRAY_LEN) {
+                usage(argv[0], "A maximum of %d partials is supported\n",
+                      CLI_SETTINGS_STATIC_ARRAY_LEN);
+            }
+            settings->merge_path[settings->merge_cnt++] = optarg;
+            break;
+        case ARG_SCALE:
+            parse_scale(optarg, ARG_SCALE, argv[0], settings);
+            break;
+        case ARG_SCALE_METHOD:
+            settings->scale_method =
+                parse_scale_method(optarg, ARG_SCALE_METHOD, argv[0]);
+            break;
+        case ARG_LUMA_ONLY:
+            settings->luma_only = true;
+            break;
+        case ARG_STATS:
+            settings->stats = true;
+            break;
+        case ARG_TRACE:
+            settings->trace_path = optarg;
+            break;
+        case ARG_READ_AHEAD:
+            settings->read_ahead =
+                parse_unsigned(optarg, ARG_READ_AHEAD, argv[0]);
+            if (!settings->read_ahead)
+                error(argv[0], optarg, ARG_READ_AHEAD, "greater than 0");
+            break;
         default:
             break;
         }
@@ -232,10 +397,45 @@ void cli_parse(const int argc, char *const *const argv,
 
     if (!settings->output_fmt)
         settings->output_fmt = VMAF_OUTPUT_FORMAT_XML;
-    if (!settings->path_ref)
+    if (!settings->read_ahead)
+        settings->read_ahead = 2;
+    if (!settings->batch_jobs)
+        settings->batch_jobs = 4;
+    if (!settings->scale_method)
+        settings->scale_method = VMAF_SCALING_METHOD_BICUBIC;
+    if (settings->merge_cnt && (settings->path_ref || settings->dist_cnt ||
+                                settings->batch_path || settings->frames))
+    {
+        usage(argv[0], "--merge can not be combined with -r/--reference, "
+                       "-d/--distorted, --batch or --frames");
+    }
+    if (settings->merge_cnt && settings->output_cnt > 1)
+        usage(argv[0], "--merge writes a single -o/--output");
+    if (!settings->path_ref && !settings->batch_path && !settings->merge_cnt)
         usage(argv[0], "Reference .y4m or .yuv (-r/--reference) is required");
-    if (!settings->path_ref)
+    if (!settings->dist_cnt && !settings->batch_path && !settings->merge_cnt)
         usage(argv[0], "Distorted .y4m or .yuv (-d/--distorted) is required");
+    if (settings->output_cnt && settings->output_cnt != settings->dist_cnt &&
+        !settings->merge_cnt)
+    {
+        usage(argv[0], "Every -d/--distorted needs its own -o/--output");
+    }
+    if (settings->frames && settings->output_cnt != settings->dist_cnt)
+        usage(argv[0], "--frames writes partials to -o/--output");
+    if (settings->frames && settings->batch_path)
+        usage(argv[0], "--frames can not be combined with --batch");
+    if (settings->batch_path && (settings->path_ref || settings->dist_cnt ||
+                                 settings->output_cnt))
+    {
+        usage(argv[0], "--batch can not be combined with "
+                       "-r/--reference, -d/--distorted or -o/--output");
+    }
+    if (settings->trace_path && (settings->batch_path ||
+                                 settings->merge_cnt || settings->dist_cnt > 1))
+    {
+        usage(argv[0], "--trace records a single -d/--distorted, it can not "
+                       "be combined with --batch or --merge");
+    }
     if (settings->use_yuv && !(settings->width && settings->height &&
         settings->pix_fmt && settings->bitdepth))
     {
@@ -245,6 +445,12 @@ void cli_parse(const int argc, char *const *const argv,
                        "  --pixel_format/-p\n"
                        "  --bitdepth/-b\n");
     }
+    if ((settings->pix_fmt == VMAF_PIX_FMT_NV12 && settings->bitdepth != 8) ||
+        (settings->pix_fmt == VMAF_PIX_FMT_P010 && settings->bitdepth != 10))
+    {
+        usage(argv[0], "nv12 requires --bitdepth/-b 8, "
+                       "p010 requires --bitdepth/-b 10");
+    }
     if ((settings->model_cnt == 0) && !settings->no_prediction)
         usage(argv[0], "At least one model file (-m/--model) is required");
 }
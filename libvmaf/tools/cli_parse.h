@@ -9,12 +9,15 @@
 #define CLI_SETTINGS_STATIC_ARRAY_LEN 256
 
 typedef struct {
-    char *path_ref, *path_dist;
+    char *path_ref;
+    char *path_dist[CLI_SETTINGS_STATIC_ARRAY_LEN];
+    unsigned dist_cnt;
     unsigned width, height;
     enum VmafPixelFormat pix_fmt;
     unsigned bitdepth;
     bool use_yuv;
-    char *output_path;
+    char *output_path[CLI_SETTINGS_STATIC_ARRAY_LEN];
+    unsigned output_cnt;
     enum VmafOutputFormat output_fmt;
     VmafModelConfig model_config[CLI_SETTINGS_STATIC_ARRAY_LEN];
     unsigned model_cnt;
@@ -26,6 +29,22 @@ typedef struct {
     unsigned subsample;
     unsigned thread_cnt;
     bool no_prediction;
+    bool no_mmap;
+    unsigned read_ahead;
+    bool luma_only;
+    char *batch_path;
+    unsigned batch_jobs;
+    unsigned memory_limit;
+    unsigned ctx_budget;
+    bool stats;
+    char *trace_path;
+    char *ref_cache_dir;
+    bool frames;
+    unsigned frame_start, frame_end;
+    char *merge_path[CLI_SETTINGS_STATIC_ARRAY_LEN];
+    unsigned merge_cnt;
+    unsigned scale_w, scale_h;
+    enum VmafScalingMethod scale_method;
 } CLISettings;
 
 void cli_parse(const int argc, char *const *const argv,
@@ -0,0 +1,285 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "vidinput.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32)
+
+/** The mapping outlives the reader: every picture handed out holds a
+ * reference, so frames still in flight stay valid after close. */
+typedef struct mmap_region {
+    uint8_t *addr;
+    size_t sz;
+    atomic_int ref_cnt;
+} mmap_region;
+
+typedef struct mmap_input {
+    mmap_region *region;
+    video_input_info info;
+    size_t *frame_offset;
+    unsigned frame_cnt;
+    unsigned frame_idx;
+    size_t frame_sz;
+    unsigned xstride;
+    int c_dec_h, c_dec_v;
+    bool semi_planar;
+    bool luma_only;
+    size_t page_sz;
+} mmap_input;
+
+static const video_input_vtbl MMAP_INPUT_VTBL;
+
+static void mmap_region_unref(mmap_region *region)
+{
+    if (--region->ref_cnt) return;
+    munmap(region->addr, region->sz);
+    free(region);
+}
+
+/** Y4M chroma types that are stored on disk exactly as they are consumed.
+ * Everything else needs conversion and stays on the stdio reader. */
+static bool y4m_chroma_is_native(const char *chroma_type)
+{
+    static const char *const native[] = {
+        "420", "420jpeg", "420p10", "444", "444p10",
+    };
+    for (unsigned i = 0; i < sizeof(native) / sizeof(*native); i++) {
+        if (!strcmp(chroma_type, native[i])) return true;
+    }
+    return false;
+}
+
+static int mmap_input_build_index(mmap_input *m, size_t offset, int framed)
+{
+    const uint8_t *addr = m->region->addr;
+    const size_t sz = m->region->sz;
+    unsigned capacity = 0;
+
+    while (offset < sz) {
+        if (framed) {
+            /* Mirrors the stdio reader: a short FRAME tag is end of file. */
+            if (sz - offset < 6) break;
+            if (memcmp(addr + offset, "FRAME", 5)) return -1;
+            const size_t tag_sz = sz - offset - 5 < 80 ? sz - offset - 5 : 80;
+            const uint8_t *nl = memchr(addr + offset + 5, '\n', tag_sz);
+            if (!nl) return -1;
+            offset = nl - addr + 1;
+        }
+        /* Truncated trailing frames are reported by the stdio reader. */
+        if (sz - offset < m->frame_sz) return -1;
+        /* High bitdepth samples are read as uint16_t straight from the
+         * mapping, which must not be misaligned. */
+        if ((m->xstride > 1) && (offset & 1)) return -1;
+
+        if (m->frame_cnt == capacity) {
+            const unsigned new_capacity = capacity ? capacity * 2 : 256;
+            size_t *frame_offset =
+                realloc(m->frame_offset, sizeof(*frame_offset) * new_capacity);
+            if (!frame_offset) return -1;
+            m->frame_offset = frame_offset;
+            capacity = new_capacity;
+        }
+        m->frame_offset[m->frame_cnt++] = offset;
+        offset += m->frame_sz;
+    }
+
+    return 0;
+}
+
+int video_input_mmap(video_input *_vid, int _framed)
+{
+    if (!_vid || !_vid->fin) return -1;
+
+    video_input_info info;
+    video_input_get_info(_vid, &info);
+    if (_framed && !y4m_chroma_is_native(info.chroma_type)) return -1;
+
+    const int fd = fileno(_vid->fin);
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) return -1;
+    const off_t offset = ftello(_vid->fin);
+    if (offset < 0 || offset >= st.st_size) return -1;
+
+    mmap_input *m = malloc(sizeof(*m));
+    if (!m) return -1;
+    memset(m, 0, sizeof(*m));
+    m->info = info;
+    m->info.pic_x = m->info.pic_y = 0;
+    m->xstride = info.depth > 8 ? 2 : 1;
+    m->page_sz = sysconf(_SC_PAGESIZE);
+    m->semi_planar = !strcmp(info.chroma_type, "nv12") ||
+                     !strcmp(info.chroma_type, "p010");
+    switch (info.pixel_fmt) {
+    case PF_420:
+        m->c_dec_h = m->c_dec_v = 2;
+        break;
+    case PF_422:
+        m->c_dec_h = 2;
+        m->c_dec_v = 1;
+        break;
+    case PF_444:
+        m->c_dec_h = m->c_dec_v = 1;
+        break;
+    default:
+        goto free_m;
+    }
+    const size_t c_w = (info.pic_w + m->c_dec_h - 1) / m->c_dec_h;
+    const size_t c_h = (info.pic_h + m->c_dec_v - 1) / m->c_dec_v;
+    m->frame_sz = ((size_t)info.pic_w * info.pic_h + 2 * c_w * c_h) *
+                  m->xstride;
+
+    m->region = malloc(sizeof(*m->region));
+    if (!m->region) goto free_m;
+    m->region->sz = st.st_size;
+    m->region->addr =
+        mmap(NULL, m->region->sz, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m->region->addr == MAP_FAILED) goto free_region;
+    m->region->ref_cnt = 1;
+    posix_madvise(m->region->addr, m->region->sz, POSIX_MADV_SEQUENTIAL);
+
+    if (mmap_input_build_index(m, offset, _framed)) goto unmap;
+
+    (*_vid->vtbl->close)(_vid->ctx);
+    free(_vid->ctx);
+    _vid->vtbl = &MMAP_INPUT_VTBL;
+    _vid->ctx = m;
+    return 0;
+
+unmap:
+    munmap(m->region->addr, m->region->sz);
+free_region:
+    free(m->region);
+free_m:
+    free(m->frame_offset);
+    free(m);
+    return -1;
+}
+
+void *video_input_retain_frame(video_input *_vid)
+{
+    if (!_vid || _vid->vtbl != &MMAP_INPUT_VTBL) return NULL;
+    mmap_input *m = _vid->ctx;
+    m->region->ref_cnt++;
+    return m->region;
+}
+
+void video_input_release_frame(void *_cookie)
+{
+    if (!_cookie) return;
+    mmap_region_unref(_cookie);
+}
+
+static void mmap_input_get_info(mmap_input *m, video_input_info *_info)
+{
+    *_info = m->info;
+}
+
+static int mmap_input_fetch_frame(mmap_input *m, FILE *_fin,
+                                  video_input_ycbcr _ycbcr, char _tag[5])
+{
+    (void) _fin;
+
+    if (m->frame_idx >= m->frame_cnt) return 0;
+    uint8_t *data = m->region->addr + m->frame_offset[m->frame_idx++];
+
+    const unsigned w = m->info.pic_w, h = m->info.pic_h;
+    const unsigned c_w = (w + m->c_dec_h - 1) / m->c_dec_h;
+    const unsigned c_h = (h + m->c_dec_v - 1) / m->c_dec_v;
+
+    _ycbcr[0].width = w;
+    _ycbcr[0].height = h;
+    _ycbcr[0].stride = w * m->xstride;
+    _ycbcr[0].data = data;
+    _ycbcr[1].width = w / m->c_dec_h;
+    _ycbcr[1].height = h / m->c_dec_v;
+    _ycbcr[1].stride = c_w * m->xstride;
+    _ycbcr[1].data = data + (size_t)w * h * m->xstride;
+    _ycbcr[2].width = _ycbcr[1].width;
+    _ycbcr[2].height = _ycbcr[1].height;
+    _ycbcr[2].stride = _ycbcr[1].stride;
+    _ycbcr[2].data = _ycbcr[1].data + (size_t)c_w * c_h * m->xstride;
+
+    if (m->luma_only) {
+        memset(&_ycbcr[1], 0, 2 * sizeof(_ycbcr[1]));
+        if (m->frame_idx < m->frame_cnt) {
+            const size_t offset = m->frame_offset[m->frame_idx];
+            const size_t page_offset = offset & ~(m->page_sz - 1);
+            posix_madvise(m->region->addr + page_offset,
+                          offset - page_offset + (size_t)w * h * m->xstride,
+                          POSIX_MADV_WILLNEED);
+        }
+    } else if (m->semi_planar) {
+        /* Cb and Cr share one interleaved plane. */
+        _ycbcr[1].stride = _ycbcr[2].stride = 2 * c_w * m->xstride;
+        _ycbcr[2].data = _ycbcr[1].data + m->xstride;
+    }
+
+    if (_tag) _tag[0] = '\0';
+    return 1;
+}
+
+static void mmap_input_close(mmap_input *m)
+{
+    mmap_region_unref(m->region);
+    free(m->frame_offset);
+}
+
+static void mmap_input_set_luma_only(mmap_input *m)
+{
+    /* Chroma is never touched, so readahead would only waste I/O on it.
+     * Luma is prefetched one frame ahead instead. */
+    m->luma_only = true;
+    posix_madvise(m->region->addr, m->region->sz, POSIX_MADV_RANDOM);
+}
+
+static int mmap_input_skip_frames(mmap_input *m, FILE *_fin, unsigned nframes)
+{
+    (void) _fin;
+
+    const unsigned left = m->frame_cnt - m->frame_idx;
+    m->frame_idx += nframes < left ? nframes : left;
+    return 0;
+}
+
+static const video_input_vtbl MMAP_INPUT_VTBL={
+  (video_input_open_func)NULL,
+  (video_input_get_info_func)mmap_input_get_info,
+  (video_input_fetch_frame_func)mmap_input_fetch_frame,
+  (video_input_close_func)mmap_input_close,
+  (video_input_set_luma_only_func)mmap_input_set_luma_only,
+  (video_input_set_threads_func)NULL,
+  (video_input_skip_frames_func)mmap_input_skip_frames
+};
+
+#else
+
+int video_input_mmap(video_input *_vid, int _framed)
+{
+    (void) _vid;
+    (void) _framed;
+    return -1;
+}
+
+void *video_input_retain_frame(video_input *_vid)
+{
+    (void) _vid;
+    return NULL;
+}
+
+void video_input_release_frame(void *_cookie)
+{
+    (void) _cookie;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reader_thread.h"
+
+struct ReaderThread {
+    video_input *vid;
+    ReaderFetchFunc fetch;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct {
+        VmafPicture *pic;
+        unsigned capacity, head, cnt;
+    } ring;
+    int status;
+    bool stop;
+};
+
+static void *reader_thread_main(void *data)
+{
+    ReaderThread *rt = data;
+
+    for (;;) {
+        pthread_mutex_lock(&rt->lock);
+        while (rt->ring.cnt == rt->ring.capacity && !rt->stop)
+            pthread_cond_wait(&rt->cond, &rt->lock);
+        const bool stop = rt->stop;
+        pthread_mutex_unlock(&rt->lock);
+        if (stop) break;
+
+        VmafPicture pic;
+        const int ret = rt->fetch(rt->vid, &pic);
+
+        pthread_mutex_lock(&rt->lock);
+        if (ret) {
+            rt->status = ret;
+        } else {
+            const unsigned tail =
+                (rt->ring.head + rt->ring.cnt) % rt->ring.capacity;
+            rt->ring.pic[tail] = pic;
+            rt->ring.cnt++;
+        }
+        pthread_cond_broadcast(&rt->cond);
+        pthread_mutex_unlock(&rt->lock);
+        if (ret) break;
+    }
+
+    return NULL;
+}
+
+int reader_thread_start(ReaderThread **rt, video_input *vid,
+                        ReaderFetchFunc fetch, unsigned depth)
+{
+    if (!rt) return -EINVAL;
+    if (!vid) return -EINVAL;
+    if (!fetch) return -EINVAL;
+    if (!depth) return -EINVAL;
+
+    ReaderThread *const r = *rt = malloc(sizeof(*r));
+    if (!r) goto fail;
+    memset(r, 0, sizeof(*r));
+    r->vid = vid;
+    r->fetch = fetch;
+    r->ring.capacity = depth;
+    r->ring.pic = malloc(sizeof(*r->ring.pic) * depth);
+    if (!r->ring.pic) goto free_r;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    if (pthread_create(&r->thread, NULL, reader_thread_main, r))
+        goto destroy_sync;
+    return 0;
+
+destroy_sync:
+    pthread_cond_destroy(&r->cond);
+    pthread_mutex_destroy(&r->lock);
+    free(r->ring.pic);
+free_r:
+    free(r);
+fail:
+    *rt = NULL;
+    return -ENOMEM;
+}
+
+int reader_thread_read(ReaderThread *rt, VmafPicture *pic)
+{
+    if (!rt) return -EINVAL;
+    if (!pic) return -EINVAL;
+
+    pthread_mutex_lock(&rt->lock);
+    while (!rt->ring.cnt && !rt->status)
+        pthread_cond_wait(&rt->cond, &rt->lock);
+
+    int ret = rt->status;
+    if (rt->ring.cnt) {
+        *pic = rt->ring.pic[rt->ring.head];
+        rt->ring.head = (rt->ring.head + 1) % rt->ring.capacity;
+        rt->ring.cnt--;
+        pthread_cond_broadcast(&rt->cond);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&rt->lock);
+    return ret;
+}
+
+void reader_thread_stop(ReaderThread *rt)
+{
+    if (!rt) return;
+
+    pthread_mutex_lock(&rt->lock);
+    rt->stop = true;
+    pthread_cond_broadcast(&rt->cond);
+    pthread_mutex_unlock(&rt->lock);
+    pthread_join(rt->thread, NULL);
+
+    for (; rt->ring.cnt; rt->ring.cnt--) {
+        vmaf_picture_unref(&rt->ring.pic[rt->ring.head]);
+        rt->ring.head = (rt->ring.head + 1) % rt->ring.capacity;
+    }
+    pthread_cond_destroy(&rt->cond);
+    pthread_mutex_destroy(&rt->lock);
+    free(rt->ring.pic);
+    free(rt);
+}
@@ -0,0 +1,47 @@
+#ifndef __VMAF_READER_THREAD_H__
+#define __VMAF_READER_THREAD_H__
+
+#include <libvmaf/picture.h>
+
+#include "vidinput.h"
+
+typedef struct ReaderThread ReaderThread;
+
+/**
+ * Fetches the next picture from `vid` into `pic`.
+ * Returns 0 on success, 1 at end of input, or < 0 on error.
+ */
+typedef int (*ReaderFetchFunc)(video_input *vid, VmafPicture *pic);
+
+/**
+ * Start a producer thread that prefetches up to `depth` pictures from `vid`.
+ * `vid` must not be touched by the caller until `reader_thread_stop()`.
+ *
+ * @param rt    The reader thread to start.
+ *
+ * @param vid   Opened video input to read from.
+ *
+ * @param fetch Function used to fetch a single picture.
+ *
+ * @param depth Number of prefetched pictures to keep ready.
+ *
+ * @return 0 on success, or < 0 (a negative errno code) on error.
+ */
+int reader_thread_start(ReaderThread **rt, video_input *vid,
+                        ReaderFetchFunc fetch, unsigned depth);
+
+/**
+ * Take the next prefetched picture, blocking until one is available.
+ * Ownership of the picture passes to the caller.
+ *
+ * @return 0 on success, 1 at end of input, or < 0 on error.
+ */
+int reader_thread_read(ReaderThread *rt, VmafPicture *pic);
+
+/**
+ * Stop the producer thread, drop all pictures that were never read and
+ * free `rt`.
+ */
+void reader_thread_stop(ReaderThread *rt);
+
+#endif /* __VMAF_READER_THREAD_H__ */
@@ -67,6 +67,46 @@ int video_input_fetch_frame(video_input *_vid,
   return (*_vid->vtbl->fetch_frame)(_vid->ctx,_vid->fin,_ycbcr,_tag);
 }
 
+int video_input_set_luma_only(video_input *_vid){
+  if(_vid->vtbl->set_luma_only==NULL)return -1;
+  (*_vid->vtbl->set_luma_only)(_vid->ctx);
+  return 0;
+}
+
+int video_input_set_threads(video_input *_vid,int _nthreads){
+  if(_vid->vtbl->set_threads==NULL)return -1;
+  return (*_vid->vtbl->set_threads)(_vid->ctx,_nthreads);
+}
+
+int video_input_skip_frames(video_input *_vid,unsigned _nframes){
+  video_input_ycbcr ycbcr;
+  if(_vid->vtbl->skip_frames!=NULL){
+    return (*_vid->vtbl->skip_frames)(_vid->ctx,_vid->fin,_nframes);
+  }
+  for(;_nframes>0;_nframes--){
+    int ret;
+    ret=video_input_fetch_frame(_vid,ycbcr,NULL);
+    if(ret<0)return -1;
+    if(ret==0)break;
+  }
+  return 0;
+}
+
+int video_input_skip_bytes(FILE *_fin,unsigned char *_buf,size_t _buf_sz,
+ size_t _nbytes){
+  if(_nbytes==0)return 0;
+  /*Seeking past the end succeeds, the last byte is read to check it is
+     there.*/
+  if(!fseek(_fin,_nbytes-1,SEEK_CUR))return fgetc(_fin)==EOF?-1:0;
+  while(_nbytes>0){
+    size_t sz;
+    sz=_nbytes<_buf_sz?_nbytes:_buf_sz;
+    if(fread(_buf,1,sz,_fin)!=sz)return -1;
+    _nbytes-=sz;
+  }
+  return 0;
+}
+
 void video_input_close(video_input *_vid){
   (*_vid->vtbl->close)(_vid->ctx);
   free(_vid->ctx);
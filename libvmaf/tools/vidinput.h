@@ -56,6 +56,10 @@ typedef void (*video_input_get_info_func)(void *_ctx,video_input_info *_ti);
 typedef int (*video_input_fetch_frame_func)(void *_ctx,FILE *_fin,
  video_input_ycbcr _ycbcr,char _tag[5]);
 typedef void (*video_input_close_func)(void *_ctx);
+typedef void (*video_input_set_luma_only_func)(void *_ctx);
+typedef int (*video_input_set_threads_func)(void *_ctx,int _nthreads);
+typedef int (*video_input_skip_frames_func)(void *_ctx,FILE *_fin,
+ unsigned _nframes);
 
 /**Pluggable method table for accessing different formats.*/
 struct video_input_vtbl{
@@ -63,6 +67,9 @@ struct video_input_vtbl{
   video_input_get_info_func     get_info;
   video_input_fetch_frame_func  fetch_frame;
   video_input_close_func        close;
+  video_input_set_luma_only_func set_luma_only;
+  video_input_set_threads_func  set_threads;
+  video_input_skip_frames_func  skip_frames;
 };
 
 struct video_input{
@@ -85,6 +92,9 @@ typedef struct raw_input_vtbl {
   video_input_get_info_func     get_info;
   video_input_fetch_frame_func  fetch_frame;
   video_input_close_func        close;
+  video_input_set_luma_only_func set_luma_only;
+  video_input_set_threads_func  set_threads;
+  video_input_skip_frames_func  skip_frames;
 } raw_input_vtbl;
 
 int video_input_open(video_input *_vid,FILE *_fin);
@@ -93,6 +103,40 @@ void video_input_close(video_input *_vid);
 void video_input_get_info(video_input *_vid,video_input_info *_ti);
 int video_input_fetch_frame(video_input *_vid,
  video_input_ycbcr _ycbcr,char _tag[5]);
+/**Stops delivering chroma: frames fetched afterwards only have a valid luma
+    plane, and chroma is skipped over instead of read.
+   Returns 0 on success, or -1 if the reader does not support it.*/
+int video_input_set_luma_only(video_input *_vid);
+/**Lets the reader convert chroma on up to _nthreads threads, counting the
+    one fetching frames.
+   Readers which convert nothing accept this and stay single-threaded.
+   Returns 0 on success, or -1 if the reader does not support it.*/
+int video_input_set_threads(video_input *_vid,int _nthreads);
+/**Moves past the next _nframes frames without decoding them, seeking over
+    the frame data where the input allows it.
+   Skipping past the end of the input is not an error, the next fetch just
+    reports the end of the input.
+   Returns 0 on success, or -1 on a read error.*/
+int video_input_skip_frames(video_input *_vid,unsigned _nframes);
+
+/**Moves _fin past the next _nbytes, reading them into _buf, _buf_sz bytes
+    at a time, where the input cannot seek.
+   Returns 0 on success, or -1 if the input ends before _nbytes.*/
+int video_input_skip_bytes(FILE *_fin,unsigned char *_buf,size_t _buf_sz,
+ size_t _nbytes);
+
+/**Switches an opened reader over to a read-only mapping of its file.
+   Frames fetched afterwards point straight into the mapping instead of a
+    reader-owned buffer.
+   _framed selects Y4M framing (FRAME tags) over raw, headerless frames.
+   Returns 0 on success; on failure the reader is left untouched.*/
+int video_input_mmap(video_input *_vid,int _framed);
+/**Takes a reference on the mapping backing the last fetched frame, keeping
+    it valid past video_input_close().
+   Returns NULL if _vid is not memory-mapped.*/
+void *video_input_retain_frame(video_input *_vid);
+/**Drops a reference taken by video_input_retain_frame().*/
+void video_input_release_frame(void *_cookie);
 
 typedef enum{
   /**Chroma decimation by 2 in both the X and Y directions (4:2:0).
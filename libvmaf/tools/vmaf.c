@@ -1,16 +1,28 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "cli_parse.h"
+#include "reader_thread.h"
 #include "vidinput.h"
 
 #include <libvmaf/picture.h>
 #include <libvmaf/libvmaf.rc.h>
 
-static enum VmafPixelFormat pix_fmt_map(int pf)
+static enum VmafPixelFormat pix_fmt_map(const video_input_info *info)
 {
-    switch (pf) {
+    if (!strcmp(info->chroma_type, "nv12"))
+        return VMAF_PIX_FMT_NV12;
+    if (!strcmp(info->chroma_type, "p010"))
+        return VMAF_PIX_FMT_P010;
+
+    switch (info->pixel_fmt) {
     case PF_420:
         return VMAF_PIX_FMT_YUV420P;
     case PF_422:
@@ -22,7 +34,8 @@ static enum VmafPixelFormat pix_fmt_map(int pf)
     }
 }
 
-static int validate_videos(video_input *vid1, video_input *vid2)
+static int validate_videos(video_input *vid1, video_input *vid2,
+                           bool scaled)
 {
     int err_cnt = 0;
 
@@ -30,7 +43,9 @@ static int validate_videos(video_input *vid1, video_input *vid2)
     video_input_get_info(vid1, &info1);
     video_input_get_info(vid2, &info2);
 
-    if ((info1.frame_w != info2.frame_w) || (info1.frame_h != info2.frame_h)) {
+    if (!scaled && ((info1.frame_w != info2.frame_w) ||
+                    (info1.frame_h != info2.frame_h)))
+    {
         fprintf(stderr, "dimensions do not match: %dx%d, %dx%d\n",
                 info1.frame_w, info1.frame_h, info2.frame_w, info2.frame_h);
         err_cnt++;
@@ -42,7 +57,13 @@ static int validate_videos(video_input *vid1, video_input *vid2)
         err_cnt++;
     }
 
-    if (!pix_fmt_map(info1.pixel_fmt) || !pix_fmt_map(info2.pixel_fmt)) {
+    if (pix_fmt_map(&info1) != pix_fmt_map(&info2)) {
+        fprintf(stderr, "pixel layouts do not match: %s, %s\n",
+                info1.chroma_type, info2.chroma_type);
+        err_cnt++;
+    }
+
+    if (!pix_fmt_map(&info1) || !pix_fmt_map(&info2)) {
         fprintf(stderr, "unsupported pixel format: %d\n", info1.pixel_fmt);
         err_cnt++;
     }
@@ -63,6 +84,8 @@ static int validate_videos(video_input *vid1, video_input *vid2)
     return err_cnt;
 }
 
+static bool luma_only = false;
+
 static int fetch_picture(video_input *vid, VmafPicture *pic)
 {
     int ret;
@@ -70,22 +93,51 @@ static int fetch_picture(video_input *vid, VmafPicture *pic)
     video_input_info info;
 
     ret = video_input_fetch_frame(vid, ycbcr, NULL);
-    if (ret < 1) return !ret;
+    if (ret < 1) return ret ? -1 : 1;
 
     video_input_get_info(vid, &info);
-    ret = vmaf_picture_alloc(pic, pix_fmt_map(info.pixel_fmt), info.depth,
+    const enum VmafPixelFormat pix_fmt =
+        luma_only ? VMAF_PIX_FMT_YUV400P : pix_fmt_map(&info);
+    /* Luma only pictures are planar, P010 samples have to be realigned. */
+    const unsigned shift =
+        luma_only && pix_fmt_map(&info) == VMAF_PIX_FMT_P010 ? 6 : 0;
+
+    void *cookie = shift ? NULL : video_input_retain_frame(vid);
+    if (cookie) {
+        pixel *data[3];
+        ptrdiff_t stride[3];
+        for (unsigned i = 0; i < 3; i++) {
+            data[i] = ycbcr[i].data;
+            stride[i] = ycbcr[i].stride;
+        }
+        ret = vmaf_picture_wrap(pic, pix_fmt, info.depth,
+                                info.pic_w, info.pic_h, data, stride,
+                                video_input_release_frame, cookie);
+        if (ret) {
+            video_input_release_frame(cookie);
+            fprintf(stderr, "problem wrapping picture.\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    ret = vmaf_picture_alloc(pic, pix_fmt, info.depth,
                              info.pic_w, info.pic_h);
     if (ret) {
         fprintf(stderr, "problem allocating picture.\n");
         return -1;
     }
 
-    assert(pic->w[0] == ycbcr[0].width);
-    assert(pic->w[1] == ycbcr[1].width);
-    assert(pic->w[2] == ycbcr[2].width);
+    /* Interleaved chroma is copied as one plane of twice the width. */
+    const int semi_planar = pic->pix_fmt == VMAF_PIX_FMT_NV12 ||
+                            pic->pix_fmt == VMAF_PIX_FMT_P010;
+    const unsigned plane_cnt = luma_only ? 1 : semi_planar ? 2 : 3;
+
+    for (unsigned i = 0; i < plane_cnt; i++)
+        assert(pic->w[i] == ycbcr[i].width);
 
     if (info.depth == 8) {
-        for (unsigned i = 0; i < 3; i++) {
+        for (unsigned i = 0; i < plane_cnt; i++) {
             int xdec = i&&!(info.pixel_fmt&1);
             int ydec = i&&!(info.pixel_fmt&2);
             int xstride = info.depth > 8 ? 2 : 1;
@@ -94,15 +146,16 @@ static int fetch_picture(video_input *vid, VmafPicture *pic)
                 (info.pic_x * xstride >> xdec);
             // ^ gross, but this is how the daala y4m API works. FIXME.
             uint8_t *pic_data = pic->data[i];
+            const unsigned w = pic->w[i] << (i && semi_planar);
 
             for (unsigned j = 0; j < pic->h[i]; j++) {
-                memcpy(pic_data, ycbcr_data, sizeof(*pic_data) * pic->w[i]);
+                memcpy(pic_data, ycbcr_data, sizeof(*pic_data) * w);
                 pic_data += pic->stride[i];
                 ycbcr_data += ycbcr[i].stride;
             }
         }
     } else {
-        for (unsigned i = 0; i < 3; i++) {
+        for (unsigned i = 0; i < plane_cnt; i++) {
             int xdec = i&&!(info.pixel_fmt&1);
             int ydec = i&&!(info.pixel_fmt&2);
             int xstride = info.depth > 8 ? 2 : 1;
@@ -111,9 +164,15 @@ static int fetch_picture(video_input *vid, VmafPicture *pic)
                 (info.pic_x * xstride >> xdec);
             // ^ gross, but this is how the daala y4m API works. FIXME.
             uint16_t *pic_data = pic->data[i];
+            const unsigned w = pic->w[i] << (i && semi_planar);
 
             for (unsigned j = 0; j < pic->h[i]; j++) {
-                memcpy(pic_data, ycbcr_data, sizeof(*pic_data) * pic->w[i]);
+                if (shift) {
+                    for (unsigned k = 0; k < w; k++)
+                        pic_data[k] = ycbcr_data[k] >> shift;
+                } else {
+                    memcpy(pic_data, ycbcr_data, sizeof(*pic_data) * w);
+                }
                 pic_data += pic->stride[i] / 2;
                 ycbcr_data += ycbcr[i].stride / 2;
             }
@@ -123,154 +182,814 @@ static int fetch_picture(video_input *vid, VmafPicture *pic)
     return 0;
 }
 
-int main(int argc, char *argv[])
+typedef struct MemoryBudget {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t limit, used;
+} MemoryBudget;
+
+static void memory_budget_acquire(MemoryBudget *budget, size_t sz)
 {
-    int err = 0;
+    if (!budget || !budget->limit) return;
+
+    pthread_mutex_lock(&budget->lock);
+    // always admit a single pair, no matter how large
+    while (budget->used && budget->used + sz > budget->limit)
+        pthread_cond_wait(&budget->cond, &budget->lock);
+    budget->used += sz;
+    pthread_mutex_unlock(&budget->lock);
+}
 
-    CLISettings c;
-    cli_parse(argc, argv, &c);
+static void memory_budget_release(MemoryBudget *budget, size_t sz)
+{
+    if (!budget || !budget->limit) return;
 
-    FILE *file_ref = fopen(c.path_ref, "r");
-    if (!file_ref) {
-        fprintf(stderr, "could not open file: %s\n", c.path_ref);
-        return -1;
-    }
+    pthread_mutex_lock(&budget->lock);
+    budget->used -= sz;
+    pthread_cond_broadcast(&budget->cond);
+    pthread_mutex_unlock(&budget->lock);
+}
 
-    FILE *file_dist = fopen(c.path_dist, "r");
-    if (!file_dist) {
-        fprintf(stderr, "could not open file: %s\n", c.path_dist);
-        return -1;
-    }
+typedef struct BatchJob {
+    char *path_ref, *path_dist, *output_path;
+} BatchJob;
+
+typedef struct BatchState {
+    const CLISettings *c;
+    VmafModel **model;
+    BatchJob *job;
+    unsigned job_cnt, next_job, fail_cnt;
+    unsigned n_threads;
+    VmafThreadPool *pool;
+    // feature extractor bytes per extracted pixel, the most of any pair yet
+    double fex_bytes_per_px;
+    pthread_mutex_t lock;
+    MemoryBudget budget;
+} BatchState;
+
+/* What a batch worker keeps from one pair to the next. */
+typedef struct BatchWorker {
+    BatchState *state;
+    VmafContext *vmaf;
+} BatchWorker;
+
+/* Working set of one pair: the pictures which can be in flight between the
+ * readers and the workers, their scaled copies, and the buffers of the
+ * feature extractors. Those are taken from `vmaf_feature_extractor_bytes()`
+ * of the pairs scored before, per extracted pixel, and only guessed for
+ * the first ones. */
+static size_t estimate_memory(const CLISettings *c,
+                              const video_input_info *info,
+                              unsigned n_threads, double fex_bytes_per_px)
+{
+    const size_t luma_sz = (size_t)info->pic_w * info->pic_h;
+    const size_t extract_sz =
+        c->scale_w ? (size_t)c->scale_w * c->scale_h : luma_sz;
+    const size_t pic_sz = (luma_sz * 3) << (info->depth > 8);
+    const size_t scaled_sz = c->scale_w ? (extract_sz * 3) << (info->depth > 8)
+                                        : 0;
+    const unsigned workers = n_threads ? n_threads : 1;
+
+    size_t fex_sz = fex_bytes_per_px > 0. ?
+                    (size_t)(fex_bytes_per_px * extract_sz) :
+                    workers * extract_sz * sizeof(float) * 16;
+    // past the first context of each extractor, --ctx_budget caps them
+    const size_t ctx_budget = (size_t)c->ctx_budget << 20;
+    if (ctx_budget && fex_sz > ctx_budget + fex_sz / workers)
+        fex_sz = ctx_budget + fex_sz / workers;
+
+    return 2 * pic_sz * (c->read_ahead + 1 + workers) +
+           2 * scaled_sz * workers + fex_sz;
+}
 
-    video_input vid_ref;
-    if (c.use_yuv) {
-        err = raw_input_open(&vid_ref, file_ref,
-                             c.width, c.height, c.pix_fmt, c.bitdepth);
-    } else {
-        err = video_input_open(&vid_ref, file_ref);
-    }
-    if (err) {
-        fprintf(stderr, "problem with reference file: %s\n", c.path_ref);
+static double batch_fex_bytes_per_px(BatchState *state)
+{
+    pthread_mutex_lock(&state->lock);
+    const double bytes_per_px = state->fex_bytes_per_px;
+    pthread_mutex_unlock(&state->lock);
+    return bytes_per_px;
+}
+
+static void batch_measure(BatchState *state, VmafContext *vmaf,
+                          size_t extract_sz)
+{
+    size_t bytes;
+    if (vmaf_feature_extractor_bytes(vmaf, NULL, &bytes) || !extract_sz)
+        return;
+
+    pthread_mutex_lock(&state->lock);
+    const double bytes_per_px = (double) bytes / extract_sz;
+    if (bytes_per_px > state->fex_bytes_per_px)
+        state->fex_bytes_per_px = bytes_per_px;
+    pthread_mutex_unlock(&state->lock);
+}
+
+static int open_input(const CLISettings *c, const char *path,
+                      video_input *vid)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "could not open file: %s\n", path);
         return -1;
     }
 
-    video_input vid_dist;
-    if (c.use_yuv) {
-        err = raw_input_open(&vid_dist, file_dist,
-                             c.width, c.height, c.pix_fmt, c.bitdepth);
+    int err;
+    if (c->use_yuv) {
+        err = raw_input_open(vid, file,
+                             c->width, c->height, c->pix_fmt, c->bitdepth);
     } else {
-        err = video_input_open(&vid_dist, file_dist);
+        err = video_input_open(vid, file);
     }
     if (err) {
-        fprintf(stderr, "problem with distorted file: %s\n", c.path_dist);
+        fclose(file);
         return -1;
     }
-
-    err = validate_videos(&vid_ref, &vid_dist);
-    if (err) {
-        fprintf(stderr, "videos are incompatible, %d %s.\n",
-                err, err == 1 ? "problem" : "problems");
+    if (!c->no_mmap)
+        video_input_mmap(vid, !c->use_yuv);
+    if (c->luma_only && video_input_set_luma_only(vid)) {
+        fprintf(stderr, "problem enabling luma only input\n");
+        video_input_close(vid);
         return -1;
     }
+    // best effort: a reader which can't share out chroma conversion is
+    // still correct, just single-threaded
+    if (c->thread_cnt > 1)
+        video_input_set_threads(vid, c->thread_cnt);
+    return 0;
+}
 
+static int open_vmaf(const CLISettings *c, VmafModel **model,
+                     unsigned n_threads, VmafThreadPool *pool,
+                     VmafContext **vmaf)
+{
     VmafConfiguration cfg = {
         .log_level = VMAF_LOG_LEVEL_INFO,
-        .n_threads = c.thread_cnt,
-        .n_subsample = c.subsample,
+        .n_threads = n_threads,
+        .n_subsample = c->subsample,
+        .flags = (c->luma_only ? VMAF_CONFIGURATION_FLAG_LUMA_ONLY : 0) |
+                 (c->stats ? VMAF_CONFIGURATION_FLAG_STATS : 0),
+        .memory_budget = (size_t)c->ctx_budget << 20,
+        .thread_pool = pool,
     };
 
-    VmafContext *vmaf;
-    err = vmaf_init(&vmaf, cfg);
+    int err = vmaf_init(vmaf, cfg);
     if (err) {
         fprintf(stderr, "problem initializing VMAF context\n");
-        return -1;
+        return err;
     }
 
-    VmafModel *model[c.model_cnt];
-    for (unsigned i = 0; i < c.model_cnt; i++) {
-        err = vmaf_model_load_from_path(&model[i], &c.model_config[i]);
-        if (err) {
-            fprintf(stderr, "problem loading model file: %s\n",
-                    c.model_config[i].path);
-            return -1;
-        }
-        err = vmaf_use_features_from_model(vmaf, model[i]);
+    for (unsigned i = 0; i < c->model_cnt; i++) {
+        err = vmaf_use_features_from_model(*vmaf, model[i]);
         if (err) {
             fprintf(stderr,
                     "problem loading feature extractors from model file: %s\n",
-                    c.model_config[i].path);
-            return -1;
+                    c->model_config[i].path);
+            goto fail;
         }
     }
 
-    for (unsigned i = 0; i < c.feature_cnt; i++) {
-        err = vmaf_use_feature(vmaf, c.feature[i]);
+    if (c->scale_w) {
+        err = vmaf_use_scaling(*vmaf, c->scale_w, c->scale_h,
+                               c->scale_method);
+        if (err) {
+            fprintf(stderr, "problem setting up scaling to %ux%u\n",
+                    c->scale_w, c->scale_h);
+            goto fail;
+        }
+    }
+
+    for (unsigned i = 0; i < c->feature_cnt; i++) {
+        err = vmaf_use_feature(*vmaf, c->feature[i]);
         if (err) {
             fprintf(stderr, "problem loading feature extractor: %s\n",
-                    c.feature[i]);
+                    c->feature[i]);
+            goto fail;
+        }
+    }
+
+    return 0;
+
+fail:
+    vmaf_close(*vmaf);
+    return err;
+}
+
+static void report_read_problem(int ret_ref, int ret_dist,
+                                const char *path_ref, const char *path_dist)
+{
+    if (ret_ref && ret_dist) {
+        return;
+    } else if (ret_ref < 0 || ret_dist < 0) {
+        fprintf(stderr, "problem while reading pictures: %s, %s\n",
+                path_ref, path_dist);
+    } else if (ret_ref) {
+        fprintf(stderr, "\"%s\" ended before \"%s\".\n", path_ref, path_dist);
+    } else if (ret_dist) {
+        fprintf(stderr, "\"%s\" ended before \"%s\".\n", path_dist, path_ref);
+    }
+}
+
+static int use_reference_cache(const CLISettings *c, VmafContext *vmaf)
+{
+    // a directory, in which the file is named after the reference contents
+    struct stat st;
+    if (stat(c->ref_cache_dir, &st) || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "reference cache is not a directory: %s\n",
+                c->ref_cache_dir);
+        return -1;
+    }
+    int err = vmaf_use_reference_cache(vmaf, c->ref_cache_dir);
+    if (err) {
+        fprintf(stderr, "problem with reference cache: %s\n",
+                c->ref_cache_dir);
+    }
+    return err;
+}
+
+/* One distorted stream, scored in its own context against the shared
+ * reference. */
+typedef struct Rendition {
+    const char *path_dist, *output_path;
+    video_input vid;
+    ReaderThread *reader;
+    VmafContext *vmaf;
+    VmafPicture pic;
+    bool has_pic;
+} Rendition;
+
+static void print_stats(VmafContext *vmaf, const char *path_dist)
+{
+    VmafStats stats;
+    if (vmaf_get_stats(vmaf, &stats)) {
+        fprintf(stderr, "problem getting stats\n");
+        return;
+    }
+
+    if (path_dist) fprintf(stderr, "%s:\n", path_dist);
+    fprintf(stderr, "%-16s %7s %10s %8s %8s %8s %10s %9s %10s %7s\n",
+            "extractor", "calls", "total ms", "min ms", "max ms", "p99 ms",
+            "prepare ms", "queue ms", "acquire ms", "MiB");
+    for (unsigned i = 0; i < stats.fex_cnt; i++) {
+        const VmafFeatureExtractorStats *s = &stats.fex[i];
+        fprintf(stderr,
+                "%-16s %7"PRIu64" %10.1f %8.3f %8.3f %8.3f %10.1f %9.1f "
+                "%10.1f %7.1f\n",
+                s->name, s->calls, s->extract * 1e3, s->extract_min * 1e3,
+                s->extract_max * 1e3, s->extract_p99 * 1e3, s->prepare * 1e3,
+                s->queue_wait * 1e3, s->acquire_wait * 1e3,
+                s->bytes / (1024. * 1024.));
+    }
+}
+
+/* With --frames, the scores of each rendition are written as a partial,
+ * pooling is left to --merge. */
+static int write_partials(const CLISettings *c, Rendition *r,
+                          unsigned dist_cnt, unsigned picture_cnt)
+{
+    const unsigned index_high =
+        c->frame_end < picture_cnt ? c->frame_end : picture_cnt;
+    if (c->frame_start >= index_high) {
+        fprintf(stderr, "no frames to score from frame %u, "
+                        "the videos end before it\n", c->frame_start);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < dist_cnt; i++) {
+        FILE *outfile = fopen(r[i].output_path, "w");
+        if (!outfile) {
+            fprintf(stderr, "could not open file: %s\n", r[i].output_path);
+            return -1;
+        }
+        int err = vmaf_write_partial(r[i].vmaf, outfile, c->frame_start,
+                                     index_high);
+        err |= fclose(outfile);
+        if (err) {
+            fprintf(stderr, "problem writing partial: %s\n",
+                    r[i].output_path);
             return -1;
         }
     }
+    return 0;
+}
+
+/* With more than one distorted stream (an encoding ladder), the reference is
+ * read once and its pictures are shared by every rendition's context.
+ * Reference-only features are extracted by the first context only. In
+ * batch mode, the worker's context is reset and kept for its next pair. */
+static int compute_vmaf(const CLISettings *c, VmafModel **model,
+                        const char *path_ref, char *const *path_dist,
+                        char *const *output_path, unsigned dist_cnt,
+                        unsigned n_threads, BatchWorker *worker)
+{
+    int err = 0;
+    const bool batch = worker != NULL;
+    MemoryBudget *budget = batch ? &worker->state->budget : NULL;
+    VmafThreadPool *pool = batch ? worker->state->pool : NULL;
+    const bool ladder = dist_cnt > 1;
+    // a segment is read with one picture of lookbehind and lookahead
+    const unsigned index_first = c->frames && c->frame_start ?
+                                 c->frame_start - 1 : 0;
+    const unsigned index_last = c->frames ? c->frame_end : UINT_MAX;
+
+    Rendition r[dist_cnt];
+    memset(r, 0, sizeof(r));
+    unsigned open_cnt = 0, vmaf_cnt = 0;
+    size_t memory_sz = 0;
+    FILE *trace_file = NULL;
+
+    video_input vid_ref;
+    err = open_input(c, path_ref, &vid_ref);
+    if (err) {
+        fprintf(stderr, "problem with reference file: %s\n", path_ref);
+        return -1;
+    }
+
+    for (; open_cnt < dist_cnt; open_cnt++) {
+        Rendition *rd = &r[open_cnt];
+        rd->path_dist = path_dist[open_cnt];
+        rd->output_path = output_path ? output_path[open_cnt] : NULL;
+        err = open_input(c, rd->path_dist, &rd->vid);
+        if (err) {
+            fprintf(stderr, "problem with distorted file: %s\n",
+                    rd->path_dist);
+            goto close_dist;
+        }
+        err = validate_videos(&vid_ref, &rd->vid, c->scale_w);
+        if (err) {
+            fprintf(stderr, "videos are incompatible, %d %s.\n",
+                    err, err == 1 ? "problem" : "problems");
+            err = -1;
+            video_input_close(&rd->vid);
+            goto close_dist;
+        }
+    }
+
+    video_input_info info;
+    video_input_get_info(&vid_ref, &info);
+    const size_t extract_sz = c->scale_w ? (size_t)c->scale_w * c->scale_h :
+                                           (size_t)info.pic_w * info.pic_h;
+    memory_sz = estimate_memory(c, &info, n_threads,
+                                batch ? batch_fex_bytes_per_px(worker->state)
+                                      : 0.) * dist_cnt;
+    memory_budget_acquire(budget, memory_sz);
+
+    // threads are split evenly between the renditions' contexts
+    // a rendition left without a thread would score on the reading thread
+    unsigned ctx_threads = ladder ? n_threads / dist_cnt : n_threads;
+    if (n_threads && !ctx_threads) ctx_threads = 1;
+    for (; vmaf_cnt < dist_cnt; vmaf_cnt++) {
+        if (batch && worker->vmaf) {
+            r[vmaf_cnt].vmaf = worker->vmaf;
+            worker->vmaf = NULL;
+            continue;
+        }
+        err = open_vmaf(c, model, ctx_threads, pool, &r[vmaf_cnt].vmaf);
+        if (err) goto close_vmaf;
+        if (!vmaf_cnt) continue;
+        err = vmaf_use_reference_features_from(r[vmaf_cnt].vmaf, r[0].vmaf);
+        if (err) {
+            fprintf(stderr, "problem sharing reference features\n");
+            vmaf_close(r[vmaf_cnt].vmaf);
+            goto close_vmaf;
+        }
+    }
+
+    if (c->ref_cache_dir) {
+        err = use_reference_cache(c, r[0].vmaf);
+        if (err) goto close_vmaf;
+    }
+
+    if (c->trace_path) {
+        trace_file = fopen(c->trace_path, "w");
+        if (!trace_file) {
+            fprintf(stderr, "could not open file: %s\n", c->trace_path);
+            err = -1;
+            goto close_vmaf;
+        }
+        err = vmaf_use_trace(r[0].vmaf, trace_file);
+        if (err) {
+            fprintf(stderr, "problem initializing trace\n");
+            goto close_vmaf;
+        }
+    }
+
+    // a segment seeks to its first picture instead of decoding up to it
+    if (index_first) {
+        err = video_input_skip_frames(&vid_ref, index_first);
+        for (unsigned i = 0; !err && i < dist_cnt; i++)
+            err = video_input_skip_frames(&r[i].vid, index_first);
+        if (err) {
+            fprintf(stderr, "problem seeking to frame %u\n", index_first);
+            goto close_vmaf;
+        }
+    }
+
+    ReaderThread *reader_ref;
+    err = reader_thread_start(&reader_ref, &vid_ref, fetch_picture,
+                              c->read_ahead);
+    if (err) {
+        fprintf(stderr, "problem starting reader threads\n");
+        goto close_vmaf;
+    }
+    for (unsigned i = 0; i < dist_cnt; i++) {
+        err = reader_thread_start(&r[i].reader, &r[i].vid, fetch_picture,
+                                  c->read_ahead);
+        if (err) {
+            fprintf(stderr, "problem starting reader threads\n");
+            goto stop_readers;
+        }
+    }
 
     unsigned picture_index;
-    for (picture_index = 0 ;; picture_index++) {
-        VmafPicture pic_ref, pic_dist;
-        int ret1 = fetch_picture(&vid_ref, &pic_ref);
-        int ret2 = fetch_picture(&vid_dist, &pic_dist);
+    for (picture_index = index_first; picture_index <= index_last;
+         picture_index++) {
+        VmafPicture pic_ref;
+        const int ret_ref = reader_thread_read(reader_ref, &pic_ref);
+        bool stop = ret_ref != 0;
+        for (unsigned i = 0; i < dist_cnt; i++) {
+            const int ret_dist = reader_thread_read(r[i].reader, &r[i].pic);
+            r[i].has_pic = !ret_dist;
+            report_read_problem(ret_ref, ret_dist, path_ref, r[i].path_dist);
+            if (ret_dist) stop = true;
+        }
 
-        if (ret1 && ret2) {
-            break;
-        } else if (ret1 < 0 || ret2 < 0) {
-            fprintf(stderr, "problem while reading pictures\n",
-                    c.path_ref, c.path_dist);
-            break;
-        } else if (ret1) {
-            fprintf(stderr, "\"%s\" ended before \"%s\".\n",
-                    c.path_ref, c.path_dist);
-            break;
-        } else if (ret2) {
-            fprintf(stderr, "\"%s\" ended before \"%s\".\n",
-                    c.path_dist, c.path_ref);
+        if (stop) {
+            if (!ret_ref) vmaf_picture_unref(&pic_ref);
+            for (unsigned i = 0; i < dist_cnt; i++) {
+                if (r[i].has_pic) vmaf_picture_unref(&r[i].pic);
+            }
             break;
         }
 
-        fprintf(stderr, "\r%d", picture_index);
-        err = vmaf_read_pictures(vmaf, &pic_ref, &pic_dist, picture_index);
+        if (!batch) fprintf(stderr, "\r%d", picture_index);
+        for (unsigned i = 0; i < dist_cnt; i++) {
+            VmafPicture ref;
+            vmaf_picture_ref(&ref, &pic_ref);
+            if (!err) {
+                err = vmaf_read_pictures(r[i].vmaf, &ref, &r[i].pic,
+                                         picture_index);
+                if (!err) continue;
+                fprintf(stderr, "problem reading pictures\n");
+            }
+            vmaf_picture_unref(&ref);
+            vmaf_picture_unref(&r[i].pic);
+        }
+        vmaf_picture_unref(&pic_ref);
+        if (err) break;
+    }
+    if (!batch) fprintf(stderr, "\n");
+
+    if (c->frames) {
+        if (!err) err = write_partials(c, r, dist_cnt, picture_index);
+        goto stop_readers;
+    }
+
+    for (unsigned i = 0; i < dist_cnt; i++) {
+        for (unsigned j = 0; j < c->model_cnt; j++) {
+            double vmaf_score;
+            err = vmaf_score_pooled(r[i].vmaf, model[j], VMAF_POOL_METHOD_MEAN,
+                                    &vmaf_score, 0, picture_index);
+            if (err) {
+                fprintf(stderr, "problem generating pooled VMAF score\n");
+                goto stop_readers;
+            }
+
+            if (batch || ladder) {
+                fprintf(stderr, "%s: %s: %f\n", r[i].path_dist,
+                        c->model_config[j].path, vmaf_score);
+            } else {
+                fprintf(stderr, "%s: %f\n", c->model_config[j].path,
+                        vmaf_score);
+            }
+        }
+
+        if (r[i].output_path) {
+            FILE *outfile = fopen(r[i].output_path, "w");
+            if (!outfile) {
+                fprintf(stderr, "could not open file: %s\n",
+                        r[i].output_path);
+                err = -1;
+                goto stop_readers;
+            }
+            vmaf_write_output(r[i].vmaf, outfile, c->output_fmt);
+            fclose(outfile);
+        }
+    }
+
+stop_readers:
+    for (unsigned i = 0; i < dist_cnt; i++)
+        reader_thread_stop(r[i].reader);
+    reader_thread_stop(reader_ref);
+    if (c->stats && !err) {
+        for (unsigned i = 0; i < dist_cnt; i++)
+            print_stats(r[i].vmaf, batch || ladder ? r[i].path_dist : NULL);
+    }
+close_vmaf:
+    if (batch && vmaf_cnt) {
+        if (!err) batch_measure(worker->state, r[0].vmaf, extract_sz);
+        // the trace is written on reset
+        if (vmaf_reset(r[0].vmaf)) {
+            if (trace_file) {
+                fprintf(stderr, "problem writing trace: %s\n",
+                        c->trace_path);
+                err = -1;
+            }
+            vmaf_close(r[0].vmaf);
+        } else {
+            worker->vmaf = r[0].vmaf;
+        }
+        vmaf_cnt--;
+    }
+    // the first context is shared by the others, close it last
+    while (vmaf_cnt--) {
+        // the trace is written on close
+        if (vmaf_close(r[vmaf_cnt].vmaf) && trace_file && !vmaf_cnt) {
+            fprintf(stderr, "problem writing trace: %s\n", c->trace_path);
+            err = -1;
+        }
+    }
+    if (trace_file) fclose(trace_file);
+    memory_budget_release(budget, memory_sz);
+close_dist:
+    while (open_cnt--)
+        video_input_close(&r[open_cnt].vid);
+    video_input_close(&vid_ref);
+    return err;
+}
+
+static void *batch_worker(void *data)
+{
+    BatchState *state = data;
+    BatchWorker worker = { .state = state };
+
+    for (;;) {
+        pthread_mutex_lock(&state->lock);
+        const unsigned i = state->next_job++;
+        pthread_mutex_unlock(&state->lock);
+        if (i >= state->job_cnt) break;
+
+        BatchJob *job = &state->job[i];
+        int err = compute_vmaf(state->c, state->model, job->path_ref,
+                               &job->path_dist, &job->output_path, 1,
+                               state->n_threads, &worker);
         if (err) {
-            fprintf(stderr, "problem reading pictures\n");
-            break;
+            fprintf(stderr, "problem with batch entry %u: %s %s\n", i + 1,
+                    job->path_ref, job->path_dist);
+            pthread_mutex_lock(&state->lock);
+            state->fail_cnt++;
+            pthread_mutex_unlock(&state->lock);
         }
     }
-    fprintf(stderr, "\n");
 
-    for (unsigned i = 0; i < c.model_cnt; i++) {
+    if (worker.vmaf) vmaf_close(worker.vmaf);
+    return NULL;
+}
+
+/* Each line of the batch list is "$reference $distorted [$output]".
+ * Empty lines and lines starting with '#' are ignored. */
+static int parse_batch_list(const char *path, BatchJob **job,
+                            unsigned *job_cnt)
+{
+    FILE *list = fopen(path, "r");
+    if (!list) {
+        fprintf(stderr, "could not open file: %s\n", path);
+        return -1;
+    }
+
+    int err = 0;
+    unsigned cnt = 0, capacity = 0;
+    BatchJob *j = NULL;
+    char line[4096];
+    for (unsigned n = 1; fgets(line, sizeof(line), list); n++) {
+        const char *delim = " \t\r\n";
+        char *path_ref = strtok(line, delim);
+        if (!path_ref || path_ref[0] == '#') continue;
+        char *path_dist = strtok(NULL, delim);
+        char *output_path = strtok(NULL, delim);
+        if (!path_dist) {
+            fprintf(stderr, "%s:%u: distorted path is missing\n", path, n);
+            err = -1;
+            goto fail;
+        }
+
+        if (cnt == capacity) {
+            const unsigned new_capacity = capacity ? capacity * 2 : 64;
+            BatchJob *new_j = realloc(j, sizeof(*j) * new_capacity);
+            if (!new_j) {
+                err = -1;
+                goto fail;
+            }
+            j = new_j;
+            capacity = new_capacity;
+        }
+        j[cnt].path_ref = strdup(path_ref);
+        j[cnt].path_dist = strdup(path_dist);
+        j[cnt].output_path = output_path ? strdup(output_path) : NULL;
+        cnt++;
+    }
+
+    fclose(list);
+    *job = j;
+    *job_cnt = cnt;
+    return 0;
+
+fail:
+    for (unsigned i = 0; i < cnt; i++) {
+        free(j[i].path_ref);
+        free(j[i].path_dist);
+        free(j[i].output_path);
+    }
+    free(j);
+    fclose(list);
+    return err;
+}
+
+static int run_batch(const CLISettings *c, VmafModel **model)
+{
+    BatchState state = {
+        .c = c,
+        .model = model,
+        .budget = { .limit = (size_t)c->memory_limit << 20 },
+    };
+
+    int err = parse_batch_list(c->batch_path, &state.job, &state.job_cnt);
+    if (err) return err;
+
+    const unsigned worker_cnt =
+        c->batch_jobs < state.job_cnt ? c->batch_jobs : state.job_cnt;
+    // the threads are shared by every pair, each of which keeps feature
+    // extractor contexts for its share of them
+    state.n_threads = worker_cnt ? c->thread_cnt / worker_cnt : 0;
+    if (c->thread_cnt && !state.n_threads) state.n_threads = 1;
+    if (c->thread_cnt) {
+        err = vmaf_thread_pool_create(&state.pool, c->thread_cnt);
+        if (err) {
+            fprintf(stderr, "problem starting threads\n");
+            goto free_jobs;
+        }
+    }
+
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_mutex_init(&state.budget.lock, NULL);
+    pthread_cond_init(&state.budget.cond, NULL);
+
+    {
+        pthread_t worker[worker_cnt ? worker_cnt : 1];
+        unsigned started = 0;
+        for (; started < worker_cnt; started++) {
+            if (pthread_create(&worker[started], NULL, batch_worker, &state))
+                break;
+        }
+        if (!started && state.job_cnt) batch_worker(&state);
+        for (unsigned i = 0; i < started; i++)
+            pthread_join(worker[i], NULL);
+    }
+
+    pthread_cond_destroy(&state.budget.cond);
+    pthread_mutex_destroy(&state.budget.lock);
+    pthread_mutex_destroy(&state.lock);
+    if (state.pool) vmaf_thread_pool_destroy(state.pool);
+
+free_jobs:
+    for (unsigned i = 0; i < state.job_cnt; i++) {
+        free(state.job[i].path_ref);
+        free(state.job[i].path_dist);
+        free(state.job[i].output_path);
+    }
+    free(state.job);
+
+    if (state.fail_cnt) {
+        fprintf(stderr, "%u of %u batch entries failed\n",
+                state.fail_cnt, state.job_cnt);
+        return -1;
+    }
+    return err;
+}
+
+/* Partials may be passed in any order, but together they have to cover
+ * every frame from the first one on, exactly once. */
+static int merge_partials(const CLISettings *c, VmafModel **model)
+{
+    VmafConfiguration cfg = {
+        .log_level = VMAF_LOG_LEVEL_INFO,
+        .n_subsample = c->subsample,
+    };
+
+    VmafContext *vmaf;
+    int err = vmaf_init(&vmaf, cfg);
+    if (err) {
+        fprintf(stderr, "problem initializing VMAF context\n");
+        return -1;
+    }
+
+    unsigned low[c->merge_cnt], high[c->merge_cnt], order[c->merge_cnt];
+    for (unsigned i = 0; i < c->merge_cnt; i++) {
+        FILE *infile = fopen(c->merge_path[i], "r");
+        if (!infile) {
+            fprintf(stderr, "could not open file: %s\n", c->merge_path[i]);
+            err = -1;
+            goto close_vmaf;
+        }
+        low[i] = high[i] = 0;
+        err = vmaf_import_partial(vmaf, infile, &low[i], &high[i]);
+        fclose(infile);
+        if (err) {
+            fprintf(stderr, "problem importing partial: %s\n",
+                    c->merge_path[i]);
+            for (unsigned j = 0; j < i; j++) {
+                if (low[i] >= high[j] || low[j] >= high[i]) continue;
+                fprintf(stderr, "partials cover frames %u to %u more than "
+                                "once\n", low[i] > low[j] ? low[i] : low[j],
+                        (high[i] < high[j] ? high[i] : high[j]) - 1);
+                break;
+            }
+            goto close_vmaf;
+        }
+    }
+
+    // walk the partials in frame order, the first gap or overlap is fatal
+    for (unsigned i = 0; i < c->merge_cnt; i++) {
+        unsigned j = i;
+        for (; j && low[order[j - 1]] > low[i]; j--)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+    unsigned picture_cnt = 0;
+    for (unsigned i = 0; i < c->merge_cnt; i++) {
+        const unsigned lo = low[order[i]], hi = high[order[i]];
+        if (lo > picture_cnt) {
+            fprintf(stderr, "partials do not cover frames %u to %u\n",
+                    picture_cnt, lo - 1);
+            err = -1;
+            goto close_vmaf;
+        }
+        if (lo < picture_cnt) {
+            fprintf(stderr, "partials cover frames %u to %u more than once\n",
+                    lo, (hi < picture_cnt ? hi : picture_cnt) - 1);
+            err = -1;
+            goto close_vmaf;
+        }
+        picture_cnt = hi;
+    }
+
+    for (unsigned i = 0; i < c->model_cnt; i++) {
         double vmaf_score;
         err = vmaf_score_pooled(vmaf, model[i], VMAF_POOL_METHOD_MEAN,
-                                &vmaf_score, 0, picture_index);
+                                &vmaf_score, 0, picture_cnt);
         if (err) {
             fprintf(stderr, "problem generating pooled VMAF score\n");
-            return -1;
+            goto close_vmaf;
         }
-
-        fprintf(stderr, "%s: %f\n", c.model_config[i].path, vmaf_score);
+        fprintf(stderr, "%s: %f\n", c->model_config[i].path, vmaf_score);
     }
 
-    if (c.output_path) {
-        FILE *outfile = fopen(c.output_path, "w");
+    if (c->output_cnt) {
+        FILE *outfile = fopen(c->output_path[0], "w");
         if (!outfile) {
-            fprintf(stderr, "could not open file: %s\n", c.output_path);
-            return -1;
+            fprintf(stderr, "could not open file: %s\n", c->output_path[0]);
+            err = -1;
+            goto close_vmaf;
         }
-        vmaf_write_output(vmaf, outfile, c.output_fmt);
+        vmaf_write_output(vmaf, outfile, c->output_fmt);
         fclose(outfile);
     }
 
+close_vmaf:
+    vmaf_close(vmaf);
+    return err;
+}
+
+int main(int argc, char *argv[])
+{
+    int err = 0;
+
+    CLISettings c;
+    cli_parse(argc, argv, &c);
+    luma_only = c.luma_only;
+
+    VmafModel *model[c.model_cnt ? c.model_cnt : 1];
+    for (unsigned i = 0; i < c.model_cnt; i++) {
+        err = vmaf_model_load_from_path(&model[i], &c.model_config[i]);
+        if (err) {
+            fprintf(stderr, "problem loading model file: %s\n",
+                    c.model_config[i].path);
+            return -1;
+        }
+    }
+
+    if (c.merge_cnt) {
+        err = merge_partials(&c, model);
+    } else if (c.batch_path) {
+        err = run_batch(&c, model);
+    } else {
+        err = compute_vmaf(&c, model, c.path_ref, c.path_dist,
+                           c.output_cnt ? c.output_path : NULL, c.dist_cnt,
+                           c.thread_cnt, NULL);
+    }
+
     for (unsigned i = 0; i < c.model_cnt; i++) {
         vmaf_model_destroy(model[i]);
     }
 
-    video_input_close(&vid_ref);
-    video_input_close(&vid_dist);
-    vmaf_close(vmaf);
     return err;
 }
@@ -23,6 +23,7 @@ OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 
 #include "vidinput.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,6 +33,11 @@ typedef struct y4m_input y4m_input;
 typedef void (*y4m_convert_func)(y4m_input *_y4m,
  unsigned char *_dst,unsigned char *_aux);
 
+/*One pass of a chroma conversion, over rows [_y0,_y1) of both chroma planes
+   taken one after the other.*/
+typedef void (*y4m_rows_func)(y4m_input *_y4m,
+ unsigned char *_dst,unsigned char *_aux,int _y0,int _y1);
+
 /** Linkage will break without this if using a C++ compiler, and will issue
  * warnings without this for a C compiler*/
 #if defined(__cplusplus)
@@ -73,8 +79,88 @@ struct y4m_input{
   y4m_convert_func  convert;
   unsigned char    *dst_buf;
   unsigned char    *aux_buf;
+  /*Skip chroma instead of reading and converting it.*/
+  int               luma_only;
+  /*Helper threads splitting each conversion pass into bands of rows.
+    The fetching thread works on a band too.*/
+  int               nthreads;
+  pthread_t        *threads;
+  pthread_mutex_t   lock;
+  pthread_cond_t    cond;
+  /*The pass being run: bumping pass_id hands it to the helpers.*/
+  y4m_rows_func     pass;
+  unsigned char    *pass_dst;
+  unsigned char    *pass_aux;
+  int               pass_rows;
+  int               pass_band;
+  int               pass_next;
+  int               pass_pending;
+  unsigned          pass_id;
+  int               stop;
 };
 
+/*Smallest band of rows worth handing to another thread.*/
+#define Y4M_MIN_BAND_ROWS (16)
+
+/*Claims and converts bands of the current pass until none are left.
+  Called with _y4m->lock held, and returns with it held.*/
+static void y4m_run_bands(y4m_input *_y4m){
+  while(_y4m->pass_next<_y4m->pass_rows){
+    int y0;
+    int y1;
+    y0=_y4m->pass_next;
+    y1=OC_MINI(y0+_y4m->pass_band,_y4m->pass_rows);
+    _y4m->pass_next=y1;
+    pthread_mutex_unlock(&_y4m->lock);
+    (*_y4m->pass)(_y4m,_y4m->pass_dst,_y4m->pass_aux,y0,y1);
+    pthread_mutex_lock(&_y4m->lock);
+    if(--_y4m->pass_pending==0)pthread_cond_broadcast(&_y4m->cond);
+  }
+}
+
+static void *y4m_helper_main(void *_ctx){
+  y4m_input *y4m;
+  unsigned   pass_id;
+  y4m=(y4m_input *)_ctx;
+  pthread_mutex_lock(&y4m->lock);
+  pass_id=y4m->pass_id;
+  for(;;){
+    while(y4m->pass_id==pass_id&&!y4m->stop){
+      pthread_cond_wait(&y4m->cond,&y4m->lock);
+    }
+    if(y4m->stop)break;
+    pass_id=y4m->pass_id;
+    y4m_run_bands(y4m);
+  }
+  pthread_mutex_unlock(&y4m->lock);
+  return NULL;
+}
+
+/*Runs a conversion pass over _rows rows, split across the helper threads
+   when there are any, and returns once every row is done.*/
+static void y4m_run_pass(y4m_input *_y4m,y4m_rows_func _pass,
+ unsigned char *_dst,unsigned char *_aux,int _rows){
+  int nbands;
+  nbands=OC_MINI(_y4m->nthreads+1,_rows/Y4M_MIN_BAND_ROWS);
+  if(nbands<2){
+    (*_pass)(_y4m,_dst,_aux,0,_rows);
+    return;
+  }
+  pthread_mutex_lock(&_y4m->lock);
+  _y4m->pass=_pass;
+  _y4m->pass_dst=_dst;
+  _y4m->pass_aux=_aux;
+  _y4m->pass_rows=_rows;
+  _y4m->pass_band=(_rows+nbands-1)/nbands;
+  _y4m->pass_next=0;
+  _y4m->pass_pending=(_rows+_y4m->pass_band-1)/_y4m->pass_band;
+  _y4m->pass_id++;
+  pthread_cond_broadcast(&_y4m->cond);
+  y4m_run_bands(_y4m);
+  while(_y4m->pass_pending>0)pthread_cond_wait(&_y4m->cond,&_y4m->lock);
+  pthread_mutex_unlock(&_y4m->lock);
+}
+
 static int y4m_parse_tags(y4m_input *_y4m,char *_tags){
   int   got_w;
   int   got_h;
@@ -195,40 +281,45 @@ static int y4m_parse_tags(y4m_input *_y4m,char *_tags){
   The 4:2:2 modes look exactly the same, except there are twice as many chroma
    lines, and they are vertically co-sited with the luma samples in both the
    mpeg2 and jpeg cases (thus requiring no vertical resampling).*/
+/*Shifts one row of chroma sites a quarter pixel to the right.*/
+static void y4m_42xmpeg2_42xjpeg_row(unsigned char *_dst,
+ const unsigned char *_aux,int _c_w){
+  int x;
+  /*Filter: [4 -17 114 35 -9 1]/128, derived from a 6-tap Lanczos window.*/
+  for(x=0;x<OC_MINI(_c_w,2);x++){
+    _dst[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[0]-17*_aux[OC_MAXI(x-1,0)]+
+     114*_aux[x]+35*_aux[OC_MINI(x+1,_c_w-1)]-9*_aux[OC_MINI(x+2,_c_w-1)]+
+     _aux[OC_MINI(x+3,_c_w-1)]+64)>>7,255);
+  }
+  for(;x<_c_w-3;x++){
+    _dst[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[x-2]-17*_aux[x-1]+
+     114*_aux[x]+35*_aux[x+1]-9*_aux[x+2]+_aux[x+3]+64)>>7,255);
+  }
+  for(;x<_c_w;x++){
+    _dst[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[x-2]-17*_aux[x-1]+
+     114*_aux[x]+35*_aux[OC_MINI(x+1,_c_w-1)]-9*_aux[OC_MINI(x+2,_c_w-1)]+
+     _aux[_c_w-1]+64)>>7,255);
+  }
+}
+
+static void y4m_42xmpeg2_42xjpeg_rows(y4m_input *_y4m,unsigned char *_dst,
+ unsigned char *_aux,int _y0,int _y1){
+  int c_w;
+  int y;
+  c_w=(_y4m->pic_w+_y4m->dst_c_dec_h-1)/_y4m->dst_c_dec_h;
+  /*Both chroma planes are filtered alike, so rows never cross planes.*/
+  for(y=_y0;y<_y1;y++){
+    y4m_42xmpeg2_42xjpeg_row(_dst+y*c_w,_aux+y*c_w,c_w);
+  }
+}
+
 static void y4m_convert_42xmpeg2_42xjpeg(y4m_input *_y4m,unsigned char *_dst,
  unsigned char *_aux){
-  int c_w;
   int c_h;
-  int pli;
-  int y;
-  int x;
   /*Skip past the luma data.*/
   _dst+=_y4m->pic_w*_y4m->pic_h;
-  /*Compute the size of each chroma plane.*/
-  c_w=(_y4m->pic_w+_y4m->dst_c_dec_h-1)/_y4m->dst_c_dec_h;
   c_h=(_y4m->pic_h+_y4m->dst_c_dec_v-1)/_y4m->dst_c_dec_v;
-  for(pli=1;pli<3;pli++){
-    for(y=0;y<c_h;y++){
-      /*Filter: [4 -17 114 35 -9 1]/128, derived from a 6-tap Lanczos
-         window.*/
-      for(x=0;x<OC_MINI(c_w,2);x++){
-        _dst[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[0]-17*_aux[OC_MAXI(x-1,0)]+
-         114*_aux[x]+35*_aux[OC_MINI(x+1,c_w-1)]-9*_aux[OC_MINI(x+2,c_w-1)]+
-         _aux[OC_MINI(x+3,c_w-1)]+64)>>7,255);
-      }
-      for(;x<c_w-3;x++){
-        _dst[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[x-2]-17*_aux[x-1]+
-         114*_aux[x]+35*_aux[x+1]-9*_aux[x+2]+_aux[x+3]+64)>>7,255);
-      }
-      for(;x<c_w;x++){
-        _dst[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[x-2]-17*_aux[x-1]+
-         114*_aux[x]+35*_aux[OC_MINI(x+1,c_w-1)]-9*_aux[OC_MINI(x+2,c_w-1)]+
-         _aux[c_w-1]+64)>>7,255);
-      }
-      _dst+=c_w;
-      _aux+=c_w;
-    }
-  }
+  y4m_run_pass(_y4m,y4m_42xmpeg2_42xjpeg_rows,_dst,_aux,2*c_h);
 }
 
 /*This format is only used for interlaced content, but is included for
@@ -274,110 +365,77 @@ static void y4m_convert_42xmpeg2_42xjpeg(y4m_input *_y4m,unsigned char *_dst,
    the chroma plane's resolution) to the right.
   Then we use another filter to move the C_r location down one quarter pixel,
    and the C_b location up one quarter pixel.*/
-static void y4m_convert_42xpaldv_42xjpeg(y4m_input *_y4m,unsigned char *_dst,
- unsigned char *_aux){
+static void y4m_42xpaldv_hfilter_rows(y4m_input *_y4m,unsigned char *_dst,
+ unsigned char *_aux,int _y0,int _y1){
   unsigned char *tmp;
   int            c_w;
   int            c_h;
-  int            c_sz;
-  int            pli;
   int            y;
-  int            x;
-  /*Skip past the luma data.*/
-  _dst+=_y4m->pic_w*_y4m->pic_h;
-  /*Compute the size of each chroma plane.*/
+  (void)_dst;
   c_w=(_y4m->pic_w+1)/2;
   c_h=(_y4m->pic_h+_y4m->dst_c_dec_h-1)/_y4m->dst_c_dec_h;
-  c_sz=c_w*c_h;
-  /*First do the horizontal re-sampling.
-    This is the same as the mpeg2 case, except that after the horizontal case,
-     we need to apply a second vertical filter.*/
-  tmp=_aux+2*c_sz;
-  for(pli=1;pli<3;pli++){
-    for(y=0;y<c_h;y++){
-      /*Filter: [4 -17 114 35 -9 1]/128, derived from a 6-tap Lanczos
-         window.*/
-      for(x=0;x<OC_MINI(c_w,2);x++){
-        tmp[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[0]-17*_aux[OC_MAXI(x-1,0)]+
-         114*_aux[x]+35*_aux[OC_MINI(x+1,c_w-1)]-9*_aux[OC_MINI(x+2,c_w-1)]+
-         _aux[OC_MINI(x+3,c_w-1)]+64)>>7,255);
-      }
-      for(;x<c_w-3;x++){
-        tmp[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[x-2]-17*_aux[x-1]+
-         114*_aux[x]+35*_aux[x+1]-9*_aux[x+2]+_aux[x+3]+64)>>7,255);
-      }
-      for(;x<c_w;x++){
-        tmp[x]=(unsigned char)OC_CLAMPI(0,(4*_aux[x-2]-17*_aux[x-1]+
-         114*_aux[x]+35*_aux[OC_MINI(x+1,c_w-1)]-9*_aux[OC_MINI(x+2,c_w-1)]+
-         _aux[c_w-1]+64)>>7,255);
-      }
-      tmp+=c_w;
-      _aux+=c_w;
-    }
-    switch(pli){
-      case 1:{
-        tmp-=c_sz;
-        /*Slide C_b up a quarter-pel.
-          This is the same filter used above, but in the other order.*/
-        for(x=0;x<c_w;x++){
-          for(y=0;y<OC_MINI(c_h,3);y++){
-            _dst[y*c_w]=(unsigned char)OC_CLAMPI(0,(tmp[0]-
-             9*tmp[OC_MAXI(y-2,0)*c_w]+35*tmp[OC_MAXI(y-1,0)*c_w]+
-             114*tmp[y*c_w]-17*tmp[OC_MINI(y+1,c_h-1)*c_w]+
-             4*tmp[OC_MINI(y+2,c_h-1)*c_w]+64)>>7,255);
-          }
-          for(;y<c_h-2;y++){
-            _dst[y*c_w]=(unsigned char)OC_CLAMPI(0,(tmp[(y-3)*c_w]-
-             9*tmp[(y-2)*c_w]+35*tmp[(y-1)*c_w]+114*tmp[y*c_w]-
-             17*tmp[(y+1)*c_w]+4*tmp[(y+2)*c_w]+64)>>7,255);
-          }
-          for(;y<c_h;y++){
-            _dst[y*c_w]=(unsigned char)OC_CLAMPI(0,(tmp[(y-3)*c_w]-
-             9*tmp[(y-2)*c_w]+35*tmp[(y-1)*c_w]+114*tmp[y*c_w]-
-             17*tmp[OC_MINI(y+1,c_h-1)*c_w]+4*tmp[(c_h-1)*c_w]+64)>>7,255);
-          }
-          _dst++;
-          tmp++;
-        }
-        _dst+=c_sz-c_w;
-        tmp-=c_w;
-      }break;
-      case 2:{
-        tmp-=c_sz;
-        /*Slide C_r down a quarter-pel.
-          This is the same as the horizontal filter.*/
-        for(x=0;x<c_w;x++){
-          for(y=0;y<OC_MINI(c_h,2);y++){
-            _dst[y*c_w]=(unsigned char)OC_CLAMPI(0,(4*tmp[0]-
-             17*tmp[OC_MAXI(y-1,0)*c_w]+114*tmp[y*c_w]+
-             35*tmp[OC_MINI(y+1,c_h-1)*c_w]-9*tmp[OC_MINI(y+2,c_h-1)*c_w]+
-             tmp[OC_MINI(y+3,c_h-1)*c_w]+64)>>7,255);
-          }
-          for(;y<c_h-3;y++){
-            _dst[y*c_w]=(unsigned char)OC_CLAMPI(0,(4*tmp[(y-2)*c_w]-
-             17*tmp[(y-1)*c_w]+114*tmp[y*c_w]+35*tmp[(y+1)*c_w]-
-             9*tmp[(y+2)*c_w]+tmp[(y+3)*c_w]+64)>>7,255);
-          }
-          for(;y<c_h;y++){
-            _dst[y*c_w]=(unsigned char)OC_CLAMPI(0,(4*tmp[(y-2)*c_w]-
-             17*tmp[(y-1)*c_w]+114*tmp[y*c_w]+35*tmp[OC_MINI(y+1,c_h-1)*c_w]-
-             9*tmp[OC_MINI(y+2,c_h-1)*c_w]+tmp[(c_h-1)*c_w]+64)>>7,255);
-          }
-          _dst++;
-          tmp++;
-        }
-      }break;
+  tmp=_aux+2*c_w*c_h;
+  for(y=_y0;y<_y1;y++){
+    y4m_42xmpeg2_42xjpeg_row(tmp+y*c_w,_aux+y*c_w,c_w);
+  }
+}
+
+static void y4m_42xpaldv_vfilter_rows(y4m_input *_y4m,unsigned char *_dst,
+ unsigned char *_aux,int _y0,int _y1){
+  /*Slide C_b up a quarter-pel.
+    This is the same filter as the horizontal one, but in the other order.*/
+  static const int CB_TAPS[6]={1,-9,35,114,-17,4};
+  /*Slide C_r down a quarter-pel.
+    This is the same as the horizontal filter.*/
+  static const int CR_TAPS[6]={4,-17,114,35,-9,1};
+  const unsigned char *tmp;
+  const unsigned char *row[6];
+  const int           *taps;
+  int                  c_w;
+  int                  c_h;
+  int                  y;
+  int                  x;
+  int                  k;
+  c_w=(_y4m->pic_w+1)/2;
+  c_h=(_y4m->pic_h+_y4m->dst_c_dec_h-1)/_y4m->dst_c_dec_h;
+  for(y=_y0;y<_y1;y++){
+    int pli_y;
+    int off;
+    pli_y=y<c_h?y:y-c_h;
+    tmp=_aux+2*c_w*c_h+(y-pli_y)*c_w;
+    taps=y<c_h?CB_TAPS:CR_TAPS;
+    off=y<c_h?-3:-2;
+    /*Filtering a whole row at a time keeps the inner loop free of edge
+       handling: the edges are in the choice of source rows.*/
+    for(k=0;k<6;k++)row[k]=tmp+OC_CLAMPI(0,pli_y+off+k,c_h-1)*c_w;
+    for(x=0;x<c_w;x++){
+      _dst[y*c_w+x]=(unsigned char)OC_CLAMPI(0,(taps[0]*row[0][x]+
+       taps[1]*row[1][x]+taps[2]*row[2][x]+taps[3]*row[3][x]+
+       taps[4]*row[4][x]+taps[5]*row[5][x]+64)>>7,255);
     }
-    /*For actual interlaced material, this would have to be done separately on
-       each field, and the shift amounts would be different.
-      C_r moves down 1/8, C_b up 3/8 in the top field, and C_r moves down 3/8,
-       C_b up 1/8 in the bottom field.
-      The corresponding filters would be:
-       Down 1/8 (reverse order for up): [3 -11 125 15 -4 0]/128
-       Down 3/8 (reverse order for up): [4 -19 98 56 -13 2]/128*/
   }
 }
 
+static void y4m_convert_42xpaldv_42xjpeg(y4m_input *_y4m,unsigned char *_dst,
+ unsigned char *_aux){
+  int c_h;
+  /*Skip past the luma data.*/
+  _dst+=_y4m->pic_w*_y4m->pic_h;
+  c_h=(_y4m->pic_h+_y4m->dst_c_dec_h-1)/_y4m->dst_c_dec_h;
+  /*First do the horizontal re-sampling of both planes into the back half of
+     the aux buffer; the vertical filter then needs rows on either side of
+     its own, so it only starts once every row is done.*/
+  y4m_run_pass(_y4m,y4m_42xpaldv_hfilter_rows,_dst,_aux,2*c_h);
+  y4m_run_pass(_y4m,y4m_42xpaldv_vfilter_rows,_dst,_aux,2*c_h);
+  /*For actual interlaced material, this would have to be done separately on
+     each field, and the shift amounts would be different.
+    C_r moves down 1/8, C_b up 3/8 in the top field, and C_r moves down 3/8,
+     C_b up 1/8 in the bottom field.
+    The corresponding filters would be:
+     Down 1/8 (reverse order for up): [3 -11 125 15 -4 0]/128
+     Down 3/8 (reverse order for up): [4 -19 98 56 -13 2]/128*/
+}
+
 /*422jpeg chroma samples are sited like:
   Y---BR--Y-------Y---BR--Y-------
   |       |       |       |
@@ -417,50 +475,53 @@ static void y4m_convert_42xpaldv_42xjpeg(y4m_input *_y4m,unsigned char *_dst,
   We use a filter to resample at site locations one eighth pixel (at the source
    chroma plane's horizontal resolution) and five eighths of a pixel to the
    right.*/
-static void y4m_convert_411_422jpeg(y4m_input *_y4m,unsigned char *_dst,
- unsigned char *_aux){
+static void y4m_411_422jpeg_rows(y4m_input *_y4m,unsigned char *_dst,
+ unsigned char *_aux,int _y0,int _y1){
   int c_w;
   int dst_c_w;
-  int c_h;
-  int pli;
   int y;
   int x;
-  /*Skip past the luma data.*/
-  _dst+=_y4m->pic_w*_y4m->pic_h;
-  /*Compute the size of each chroma plane.*/
   c_w=(_y4m->pic_w+_y4m->src_c_dec_h-1)/_y4m->src_c_dec_h;
   dst_c_w=(_y4m->pic_w+_y4m->dst_c_dec_h-1)/_y4m->dst_c_dec_h;
-  c_h=(_y4m->pic_h+_y4m->dst_c_dec_v-1)/_y4m->dst_c_dec_v;
-  for(pli=1;pli<3;pli++){
-    for(y=0;y<c_h;y++){
-      /*Filters: [1 110 18 -1]/128 and [-3 50 86 -5]/128, both derived from a
-         4-tap Mitchell window.*/
-      for(x=0;x<OC_MINI(c_w,1);x++){
-        _dst[x<<1]=(unsigned char)OC_CLAMPI(0,(111*_aux[0]+
-         18*_aux[OC_MINI(1,c_w-1)]-_aux[OC_MINI(2,c_w-1)]+64)>>7,255);
-        _dst[x<<1|1]=(unsigned char)OC_CLAMPI(0,(47*_aux[0]+
-         86*_aux[OC_MINI(1,c_w-1)]-5*_aux[OC_MINI(2,c_w-1)]+64)>>7,255);
-      }
-      for(;x<c_w-2;x++){
-        _dst[x<<1]=(unsigned char)OC_CLAMPI(0,(_aux[x-1]+110*_aux[x]+
-         18*_aux[x+1]-_aux[x+2]+64)>>7,255);
+  _dst+=_y0*dst_c_w;
+  _aux+=_y0*c_w;
+  for(y=_y0;y<_y1;y++){
+    /*Filters: [1 110 18 -1]/128 and [-3 50 86 -5]/128, both derived from a
+       4-tap Mitchell window.*/
+    for(x=0;x<OC_MINI(c_w,1);x++){
+      _dst[x<<1]=(unsigned char)OC_CLAMPI(0,(111*_aux[0]+
+       18*_aux[OC_MINI(1,c_w-1)]-_aux[OC_MINI(2,c_w-1)]+64)>>7,255);
+      _dst[x<<1|1]=(unsigned char)OC_CLAMPI(0,(47*_aux[0]+
+       86*_aux[OC_MINI(1,c_w-1)]-5*_aux[OC_MINI(2,c_w-1)]+64)>>7,255);
+    }
+    for(;x<c_w-2;x++){
+      _dst[x<<1]=(unsigned char)OC_CLAMPI(0,(_aux[x-1]+110*_aux[x]+
+       18*_aux[x+1]-_aux[x+2]+64)>>7,255);
+      _dst[x<<1|1]=(unsigned char)OC_CLAMPI(0,(-3*_aux[x-1]+50*_aux[x]+
+       86*_aux[x+1]-5*_aux[x+2]+64)>>7,255);
+    }
+    for(;x<c_w;x++){
+      _dst[x<<1]=(unsigned char)OC_CLAMPI(0,(_aux[x-1]+110*_aux[x]+
+       18*_aux[OC_MINI(x+1,c_w-1)]-_aux[c_w-1]+64)>>7,255);
+      if((x<<1|1)<dst_c_w){
         _dst[x<<1|1]=(unsigned char)OC_CLAMPI(0,(-3*_aux[x-1]+50*_aux[x]+
-         86*_aux[x+1]-5*_aux[x+2]+64)>>7,255);
-      }
-      for(;x<c_w;x++){
-        _dst[x<<1]=(unsigned char)OC_CLAMPI(0,(_aux[x-1]+110*_aux[x]+
-         18*_aux[OC_MINI(x+1,c_w-1)]-_aux[c_w-1]+64)>>7,255);
-        if((x<<1|1)<dst_c_w){
-          _dst[x<<1|1]=(unsigned char)OC_CLAMPI(0,(-3*_aux[x-1]+50*_aux[x]+
-           86*_aux[OC_MINI(x+1,c_w-1)]-5*_aux[c_w-1]+64)>>7,255);
-        }
+         86*_aux[OC_MINI(x+1,c_w-1)]-5*_aux[c_w-1]+64)>>7,255);
       }
-      _dst+=dst_c_w;
-      _aux+=c_w;
     }
+    _dst+=dst_c_w;
+    _aux+=c_w;
   }
 }
 
+static void y4m_convert_411_422jpeg(y4m_input *_y4m,unsigned char *_dst,
+ unsigned char *_aux){
+  int c_h;
+  /*Skip past the luma data.*/
+  _dst+=_y4m->pic_w*_y4m->pic_h;
+  c_h=(_y4m->pic_h+_y4m->dst_c_dec_v-1)/_y4m->dst_c_dec_v;
+  y4m_run_pass(_y4m,y4m_411_422jpeg_rows,_dst,_aux,2*c_h);
+}
+
 /*The image is padded with empty chroma components at 4:2:0.
   This costs about 17 bits a frame to code.*/
 static void y4m_convert_mono_420jpeg(y4m_input *_y4m,unsigned char *_dst,
@@ -590,6 +651,9 @@ static int y4m_input_open_impl(y4m_input *_y4m,FILE *_fin){
     return -1;
   }
   _y4m->depth=8;
+  _y4m->luma_only=0;
+  _y4m->nthreads=0;
+  _y4m->threads=NULL;
   if(strcmp(_y4m->chroma_type,"420")==0||
    strcmp(_y4m->chroma_type,"420jpeg")==0){
     _y4m->src_c_dec_h=_y4m->dst_c_dec_h=_y4m->src_c_dec_v=_y4m->dst_c_dec_v=2;
@@ -629,8 +693,8 @@ static int y4m_input_open_impl(y4m_input *_y4m,FILE *_fin){
     _y4m->dst_buf_read_sz=_y4m->pic_w*_y4m->pic_h;
     /*Chroma filter required: read into the aux buf first.
       We need to make two filter passes, so we need some extra space in the
-       aux buffer.*/
-    _y4m->aux_buf_sz=3*((_y4m->pic_w+1)/2)*((_y4m->pic_h+1)/2);
+       aux buffer: the first pass keeps both planes there.*/
+    _y4m->aux_buf_sz=4*((_y4m->pic_w+1)/2)*((_y4m->pic_h+1)/2);
     _y4m->aux_buf_read_sz=2*((_y4m->pic_w+1)/2)*((_y4m->pic_h+1)/2);
     _y4m->convert=y4m_convert_42xpaldv_42xjpeg;
   }
@@ -727,12 +791,34 @@ static void y4m_input_get_info(y4m_input *_y4m,video_input_info *_info){
   _info->par_d=_y4m->par_d;
   _info->pixel_fmt=_y4m->dst_c_dec_h==2?
    (_y4m->dst_c_dec_v==2?PF_420:PF_422):PF_444;
+  _info->interlace=_y4m->interlace;
+  memcpy(_info->chroma_type,_y4m->chroma_type,sizeof(_info->chroma_type));
   _info->depth=_y4m->depth;
 }
 
+/*Returns 1 once past a frame header, 0 at the end of the input, or -1 on
+   error.*/
+static int y4m_read_frame_header(FILE *_fin){
+  char frame[6];
+  if(fread(frame,1,6,_fin)<6)return 0;
+  if(memcmp(frame,"FRAME",5)){
+    fprintf(stderr,"Loss of framing in YUV input data\n");
+    return -1;
+  }
+  if(frame[5]!='\n'){
+    char c;
+    int  j;
+    for(j=0;j<79&&fread(&c,1,1,_fin)&&c!='\n';j++);
+    if(j==79){
+      fprintf(stderr,"Error parsing YUV frame header\n");
+      return -1;
+    }
+  }
+  return 1;
+}
+
 static int y4m_input_fetch_frame(y4m_input *_y4m,FILE *_fin,
  video_input_ycbcr _ycbcr,char _tag[5]){
-  char frame[6];
   int  pic_sz;
   int  frame_c_w;
   int  frame_c_h;
@@ -749,20 +835,30 @@ static int y4m_input_fetch_frame(y4m_input *_y4m,FILE *_fin,
   c_h=(_y4m->pic_h+_y4m->dst_c_dec_v-1)/_y4m->dst_c_dec_v;
   c_sz=c_w*c_h*xstride;
   /*Read and skip the frame header.*/
-  ret=fread(frame,1,6,_fin);
-  if(ret<6)return 0;
-  if(memcmp(frame,"FRAME",5)){
-    fprintf(stderr,"Loss of framing in YUV input data\n");
-    return -1;
-  }
-  if(frame[5]!='\n'){
-    char c;
-    int  j;
-    for(j=0;j<79&&fread(&c,1,1,_fin)&&c!='\n';j++);
-    if(j==79){
-      fprintf(stderr,"Error parsing YUV frame header\n");
+  ret=y4m_read_frame_header(_fin);
+  if(ret<=0)return ret;
+  if(_y4m->luma_only){
+    size_t luma_sz;
+    size_t chroma_sz;
+    luma_sz=(size_t)_y4m->pic_w*_y4m->pic_h*xstride;
+    chroma_sz=_y4m->dst_buf_read_sz-luma_sz+_y4m->aux_buf_read_sz;
+    if(fread(_y4m->dst_buf,1,luma_sz,_fin)!=luma_sz){
+      fprintf(stderr,"Error reading YUV frame data.\n");
+      return -1;
+    }
+    /*Skip chroma; a frame truncated within it is still an error.*/
+    if(video_input_skip_bytes(_fin,_y4m->dst_buf+luma_sz,
+     _y4m->dst_buf_sz-luma_sz,chroma_sz)){
+      fprintf(stderr,"Error reading YUV frame data.\n");
       return -1;
     }
+    memset(_ycbcr,0,sizeof(video_input_ycbcr));
+    _ycbcr[0].width=_y4m->frame_w;
+    _ycbcr[0].height=_y4m->frame_h;
+    _ycbcr[0].stride=_y4m->pic_w*xstride;
+    _ycbcr[0].data=_y4m->dst_buf-(_y4m->pic_x+_y4m->pic_y*_y4m->pic_w)*xstride;
+    if(_tag!=NULL)_tag[0]='\0';
+    return 1;
   }
   /*Read the frame data that needs no conversion.*/
   if(fread(_y4m->dst_buf,1,_y4m->dst_buf_read_sz,_fin)!=_y4m->dst_buf_read_sz){
@@ -794,14 +890,82 @@ static int y4m_input_fetch_frame(y4m_input *_y4m,FILE *_fin,
   return 1;
 }
 
+static int y4m_input_skip_frames(y4m_input *_y4m,FILE *_fin,
+ unsigned _nframes){
+  for(;_nframes>0;_nframes--){
+    size_t frame_sz;
+    int    ret;
+    ret=y4m_read_frame_header(_fin);
+    if(ret<=0)return ret;
+    frame_sz=_y4m->dst_buf_read_sz+_y4m->aux_buf_read_sz;
+    /*Unseekable input still has to be read.*/
+    while(frame_sz>0&&fseek(_fin,frame_sz,SEEK_CUR)){
+      size_t sz;
+      sz=OC_MINI(frame_sz,_y4m->dst_buf_sz);
+      if(fread(_y4m->dst_buf,1,sz,_fin)!=sz){
+        fprintf(stderr,"Error reading YUV frame data.\n");
+        return -1;
+      }
+      frame_sz-=sz;
+    }
+  }
+  return 0;
+}
+
 static void y4m_input_close(y4m_input *_y4m){
+  int i;
+  if(_y4m->nthreads>0){
+    pthread_mutex_lock(&_y4m->lock);
+    _y4m->stop=1;
+    pthread_cond_broadcast(&_y4m->cond);
+    pthread_mutex_unlock(&_y4m->lock);
+    for(i=0;i<_y4m->nthreads;i++)pthread_join(_y4m->threads[i],NULL);
+    pthread_cond_destroy(&_y4m->cond);
+    pthread_mutex_destroy(&_y4m->lock);
+    free(_y4m->threads);
+  }
   free(_y4m->dst_buf);
   free(_y4m->aux_buf);
 }
 
+static void y4m_input_set_luma_only(y4m_input *_y4m){
+  _y4m->luma_only=1;
+}
+
+static int y4m_input_set_threads(y4m_input *_y4m,int _nthreads){
+  int i;
+  if(_y4m->nthreads>0)return -1;
+  /*Formats stored the way they are consumed have nothing to share out.*/
+  if(_y4m->convert==y4m_convert_null||
+   _y4m->convert==y4m_convert_mono_420jpeg||_y4m->luma_only||_nthreads<2){
+    return 0;
+  }
+  _y4m->threads=(pthread_t *)malloc(sizeof(*_y4m->threads)*(_nthreads-1));
+  if(_y4m->threads==NULL)return -1;
+  pthread_mutex_init(&_y4m->lock,NULL);
+  pthread_cond_init(&_y4m->cond,NULL);
+  _y4m->pass_id=0;
+  _y4m->stop=0;
+  for(i=0;i<_nthreads-1;i++){
+    if(pthread_create(_y4m->threads+i,NULL,y4m_helper_main,_y4m))break;
+  }
+  _y4m->nthreads=i;
+  if(i==0){
+    pthread_cond_destroy(&_y4m->cond);
+    pthread_mutex_destroy(&_y4m->lock);
+    free(_y4m->threads);
+    _y4m->threads=NULL;
+    return -1;
+  }
+  return 0;
+}
+
 OC_EXTERN const video_input_vtbl Y4M_INPUT_VTBL={
   (video_input_open_func)y4m_input_open,
   (video_input_get_info_func)y4m_input_get_info,
   (video_input_fetch_frame_func)y4m_input_fetch_frame,
-  (video_input_close_func)y4m_input_close
+  (video_input_close_func)y4m_input_close,
+  (video_input_set_luma_only_func)y4m_input_set_luma_only,
+  (video_input_set_threads_func)y4m_input_set_threads,
+  (video_input_skip_frames_func)y4m_input_skip_frames
 };
@@ -23,6 +23,7 @@ typedef struct yuv_input {
     uint8_t *dst_buf;
     int src_c_dec_v, src_c_dec_h;
     int dst_c_dec_h, dst_c_dec_v;
+    bool luma_only;
 } yuv_input;
 
 
@@ -42,10 +43,13 @@ static yuv_input *yuv_input_open(FILE *_fin,
     yuv->height = height;
     yuv->pix_fmt = pix_fmt;
     yuv->bitdepth = bitdepth;
+    yuv->luma_only = false;
     bool hbd = yuv->bitdepth > 8;
 
     switch (yuv->pix_fmt) {
     case VMAF_PIX_FMT_YUV420P:
+    case VMAF_PIX_FMT_NV12:
+    case VMAF_PIX_FMT_P010:
         yuv->src_c_dec_h=yuv->dst_c_dec_h=yuv->src_c_dec_v=yuv->dst_c_dec_v=2;
         yuv->dst_buf_sz = (yuv->width*yuv->height
          +2*((yuv->width+1)/2)*((yuv->height+1)/2)) << hbd;
@@ -81,6 +85,8 @@ static int pix_fmt_map(enum VmafPixelFormat pix_fmt)
 {
     switch (pix_fmt) {
     case VMAF_PIX_FMT_YUV420P:
+    case VMAF_PIX_FMT_NV12:
+    case VMAF_PIX_FMT_P010:
         return PF_420;
     case VMAF_PIX_FMT_YUV422P:
         return PF_422;
@@ -98,11 +104,46 @@ static void yuv_input_get_info(yuv_input *_yuv, video_input_info *_info)
     _info->frame_h = _info->pic_h = _yuv->height;
     _info->pixel_fmt = pix_fmt_map(_yuv->pix_fmt);
     _info->depth = _yuv->bitdepth;
+    if (_yuv->pix_fmt == VMAF_PIX_FMT_NV12)
+        strcpy(_info->chroma_type, "nv12");
+    if (_yuv->pix_fmt == VMAF_PIX_FMT_P010)
+        strcpy(_info->chroma_type, "p010");
+}
+
+static int yuv_input_fetch_luma(yuv_input *yuv, FILE *fin,
+                                video_input_ycbcr _ycbcr)
+{
+    const unsigned xstride = (yuv->bitdepth>8)?2:1;
+    const size_t luma_sz = (size_t)yuv->width * yuv->height * xstride;
+
+    size_t bytes_read = fread(yuv->dst_buf, 1, luma_sz, fin);
+    if (bytes_read == 0) return 0;
+    if (bytes_read != luma_sz) {
+        fprintf(stderr, "Error reading YUV frame data.\n");
+        return -1;
+    }
+    /* Skip chroma, a frame truncated within it is still an error. */
+    const size_t chroma_sz = yuv->dst_buf_sz - luma_sz;
+    if (video_input_skip_bytes(fin, yuv->dst_buf + luma_sz, chroma_sz,
+                               chroma_sz))
+    {
+        fprintf(stderr, "Error reading YUV frame data.\n");
+        return -1;
+    }
+
+    memset(_ycbcr, 0, sizeof(video_input_ycbcr));
+    _ycbcr[0].width = yuv->width;
+    _ycbcr[0].height = yuv->height;
+    _ycbcr[0].stride = yuv->width*xstride;
+    _ycbcr[0].data = yuv->dst_buf;
+    return 1;
 }
 
 static int yuv_input_fetch_frame(yuv_input *yuv, FILE *fin,
                                  video_input_ycbcr _ycbcr, char _tag[5])
 {
+    if (yuv->luma_only) return yuv_input_fetch_luma(yuv, fin, _ycbcr);
+
     size_t bytes_read = fread(yuv->dst_buf, 1, yuv->dst_buf_sz, fin); 
     if (bytes_read == 0) return 0;
     if (bytes_read != yuv->dst_buf_sz) {
@@ -133,16 +174,44 @@ static int yuv_input_fetch_frame(yuv_input *yuv, FILE *fin,
     _ycbcr[2].stride = c_w*xstride;
     _ycbcr[2].data = _ycbcr[1].data+c_sz;
 
+    if (yuv->pix_fmt == VMAF_PIX_FMT_NV12 || yuv->pix_fmt == VMAF_PIX_FMT_P010) {
+        /* Cb and Cr share one interleaved plane. */
+        _ycbcr[1].stride = _ycbcr[2].stride = 2*c_w*xstride;
+        _ycbcr[2].data = _ycbcr[1].data+xstride;
+    }
+
     return 1;
 }
 
+static int yuv_input_skip_frames(yuv_input *yuv, FILE *fin, unsigned nframes)
+{
+    /* Seek frame by frame, unseekable input still has to be read. */
+    for (; nframes > 0; nframes--) {
+        if (!fseek(fin, yuv->dst_buf_sz, SEEK_CUR)) continue;
+        size_t bytes_read = fread(yuv->dst_buf, 1, yuv->dst_buf_sz, fin);
+        if (bytes_read == 0) return 0;
+        if (bytes_read != yuv->dst_buf_sz) {
+            fprintf(stderr, "Error reading YUV frame data.\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
 static void yuv_input_close(yuv_input *_yuv){
   free(_yuv->dst_buf);
 }
 
+static void yuv_input_set_luma_only(yuv_input *_yuv){
+  _yuv->luma_only = true;
+}
+
 OC_EXTERN const raw_input_vtbl YUV_INPUT_VTBL={
   (raw_input_open_func)yuv_input_open,
   (video_input_get_info_func)yuv_input_get_info,
   (video_input_fetch_frame_func)yuv_input_fetch_frame,
-  (video_input_close_func)yuv_input_close
+  (video_input_close_func)yuv_input_close,
+  (video_input_set_luma_only_func)yuv_input_set_luma_only,
+  (video_input_set_threads_func)NULL,
+  (video_input_skip_frames_func)yuv_input_skip_frames
 };